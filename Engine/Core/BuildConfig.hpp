@@ -56,4 +56,15 @@
 // 0 - Profiler disabled
 // 1 - Profiler enabled
 
+//-------------------------------------------------------------------------------------------------
+
+// NET_TELEMETRY - Per connection RTT/jitter/ack histograms, bytes per message type, resends, queue depths
+// Console Commands: net_telemetry, net_telemetry_print, net_telemetry_export
+// (Default = 1)
+
+#define NET_TELEMETRY 1
+
+// 0 - Compiled out
+// 1 - Available, off until turned on with net_telemetry
+
 //-------------------------------------------------------------------------------------------------
\ No newline at end of file
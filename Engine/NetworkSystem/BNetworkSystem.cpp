@@ -1,6 +1,7 @@
 #include "Engine/NetworkSystem/BNetworkSystem.hpp"
 
 #include "Engine/EventSystem/BEventSystem.hpp"
+#include "Engine/NetworkSystem/Session/NetSession.hpp"
 #include "Engine/Utils/NetworkUtils.hpp"
 
 
@@ -23,6 +24,7 @@ STATIC bool BNetworkSystem::Startup()
 		NetworkUtils::ReportError();
 	}
 
+	NetSession::RegisterCommands();
 	BEventSystem::RegisterEvent(EVENT_ENGINE_UPDATE, &BNetworkSystem::OnUpdate, -10);
 	BEventSystem::TriggerEvent(EVENT_NETWORK_STARTUP);
 
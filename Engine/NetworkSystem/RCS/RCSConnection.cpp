@@ -1,17 +1,84 @@
 #include "Engine/NetworkSystem/RCS/RCSConnection.hpp"
 
+#include <cstring>
 #include "Engine/NetworkSystem/Sockets/TCPSocket.hpp"
-#include "Engine/Core/NamedProperties.hpp"
-#include "Engine/NetworkSystem/RCS/RemoteCommandServer.hpp"
-#include "Engine/EventSystem/BEventSystem.hpp"
+#include "Engine/Utils/CompressionUtils.hpp"
+#include "Engine/Utils/MathUtils.hpp"
+
+#if defined(__linux__)
+#include <cerrno>
+#include <sys/socket.h>
+#endif // __linux__
+
+
+//-------------------------------------------------------------------------------------------------
+#if defined(__linux__)
+static int const SEND_FLAGS = MSG_NOSIGNAL; //A closed peer is an error code, not a SIGPIPE
+#else
+static int const SEND_FLAGS = 0;
+#endif // __linux__
+
+
+//-------------------------------------------------------------------------------------------------
+static byte_t const STREAM_FIRST = 1 << 0;
+static byte_t const STREAM_LAST = 1 << 1;
+static byte_t const STREAM_COMPRESSED = 1 << 2;
+
+
+//-------------------------------------------------------------------------------------------------
+// Chunk header fields are little endian
+static void WriteLittleEndian(byte_t * out_dest, uint32_t value, size_t byteCount)
+{
+	for(size_t byteIndex = 0; byteIndex < byteCount; ++byteIndex)
+	{
+		out_dest[byteIndex] = (byte_t)(value >> (byteIndex * 8));
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+static uint32_t ReadLittleEndian(byte_t const * source, size_t byteCount)
+{
+	uint32_t value = 0;
+	for(size_t byteIndex = 0; byteIndex < byteCount; ++byteIndex)
+	{
+		value |= (uint32_t)source[byteIndex] << (byteIndex * 8);
+	}
+	return value;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Nothing to do until the socket is ready again
+static bool IsWouldBlock()
+{
+#if defined(__linux__)
+	return errno == EAGAIN || errno == EWOULDBLOCK;
+#else
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+#endif // __linux__
+}
 
 
 //-------------------------------------------------------------------------------------------------
-RCSConnection::RCSConnection(TCPSocketPtr tcpSocket)
+RCSConnection::RCSConnection(TCPSocketPtr tcpSocket, uint32_t id)
 	: m_tcpSocket(tcpSocket)
-	, m_messageBufferIndex(0)
+	, m_id(id)
+	, m_address(tcpSocket->GetAddressString())
+	, m_writeBuffer(INITIAL_WRITE_BUFFER_SIZE)
+	, m_writeHead(0)
+	, m_writeSize(0)
+	, m_isWriteWatched(false)
+	, m_compressBuffer(STREAM_CHUNK_SIZE)
+	, m_queuedStreamSize(0)
+	, m_nextStreamID(0)
+	, m_bytesSent(0)
+	, m_bytesReceived(0)
+	, m_partialWriteCount(0)
+	, m_streamChunkCount(0)
+	, m_compressionSavedSize(0)
 {
-	//Nothing
+	m_tcpSocket->SetBlocking(false);
 }
 
 
@@ -23,46 +90,155 @@ RCSConnection::~RCSConnection()
 
 
 //-------------------------------------------------------------------------------------------------
-void RCSConnection::Send(eRCSMessageType messageType, char const * message) const
+// False if they're too far behind to take any more
+bool RCSConnection::QueueSend(eRCSMessageType messageType, std::string const & message)
 {
-	if(m_tcpSocket)
+	size_t messageSize = message.size() + 2;
+	if(!ReserveWriteSpace(messageSize))
 	{
-		m_tcpSocket->Send((void*)&messageType, 1);
-		m_tcpSocket->Send((void*)message, strlen(message));
-		char end = eRCSMessageType_END;
-		m_tcpSocket->Send((void*)&end, 1);
+		return false;
 	}
+
+	char type = messageType;
+	char end = eRCSMessageType_END;
+	WriteToRing(&type, 1);
+	WriteToRing(message.c_str(), message.size());
+	WriteToRing(&end, 1);
+	return true;
 }
 
 
 //-------------------------------------------------------------------------------------------------
-void RCSConnection::Receive()
+// Nothing is written yet, the stream's chunks go into the ring as it empties
+void RCSConnection::QueueStream(eRCSStreamChannel channel, RCSStreamPtr data, bool shouldCompress)
 {
-	if(!m_tcpSocket)
-	{
-		return;
-	}
+	RCSOutgoingStream stream;
+	stream.data = data;
+	stream.offset = 0;
+	stream.streamID = m_nextStreamID;
+	stream.channel = channel;
+	stream.shouldCompress = shouldCompress;
+	m_outgoingStreams.push_back(stream);
+	m_queuedStreamSize += data->size();
+	++m_nextStreamID;
+}
 
-	char buffer[BUFFER_SIZE];
-	int readLength = m_tcpSocket->Receive(buffer, BUFFER_SIZE);
 
-	while(readLength > 0)
+//-------------------------------------------------------------------------------------------------
+// Writes as much as the socket will take (up to MAX_FLUSH_SIZE), false if the connection broke
+bool RCSConnection::Flush()
+{
+	size_t flushedSize = 0;
+	for(;;)
 	{
-		for(int index = 0; index < readLength; ++index)
+		while(m_writeSize < STREAM_CHUNK_SIZE && !m_outgoingStreams.empty())
 		{
-			char readChar = buffer[index];
-			AddToBuffer(readChar);
-			if(readChar == eRCSMessageType_END)
+			if(!WriteNextStreamChunk())
 			{
-				CreateMessageEvent();
-				ClearMessageBuffer();
+				return false;
 			}
 		}
-		readLength = m_tcpSocket->Receive(buffer, BUFFER_SIZE);
+
+		if(m_writeSize == 0)
+		{
+			break;
+		}
+
+		if(flushedSize >= MAX_FLUSH_SIZE)
+		{
+			//Still writable, so the event loop comes back around after the others
+			return true;
+		}
+
+		//Up to the end of the ring, the wrapped part goes on the next pass
+		size_t chunkSize = Min(m_writeSize, m_writeBuffer.size() - m_writeHead);
+		int sentCount = send(m_tcpSocket->m_socket, (char const *)&m_writeBuffer[m_writeHead], (int)chunkSize, SEND_FLAGS);
+		if(sentCount < 0)
+		{
+			return IsWouldBlock();
+		}
+
+		m_bytesSent += (size_t)sentCount;
+		flushedSize += (size_t)sentCount;
+		m_writeHead = (m_writeHead + (size_t)sentCount) % m_writeBuffer.size();
+		m_writeSize -= (size_t)sentCount;
+		if((size_t)sentCount < chunkSize)
+		{
+			//Socket buffer is full, wait to be told it's writable
+			++m_partialWriteCount;
+			return true;
+		}
+	}
+
+	//Start over at the front so small messages don't wrap
+	m_writeHead = 0;
+	return true;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Reads everything waiting, false if the connection closed, broke, or sent something malformed.
+// Messages come back whole (type first), streams only once their last chunk has arrived.
+bool RCSConnection::Receive(std::vector<std::string> * out_messages, std::vector<RCSIncomingStream> * out_streams)
+{
+	char buffer[BUFFER_SIZE];
+	for(;;)
+	{
+		int readLength = recv(m_tcpSocket->m_socket, buffer, BUFFER_SIZE, 0);
+		if(readLength == 0)
+		{
+			return false;
+		}
+		if(readLength < 0)
+		{
+			return IsWouldBlock();
+		}
+
+		m_bytesReceived += (size_t)readLength;
+		m_readBuffer.append(buffer, (size_t)readLength);
+		if(!ReadBuffered(out_messages, out_streams))
+		{
+			return false;
+		}
 	}
 }
 
 
+//-------------------------------------------------------------------------------------------------
+bool RCSConnection::HasPendingWrites() const
+{
+	return m_writeSize > 0 || !m_outgoingStreams.empty();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+size_t RCSConnection::GetPendingWriteSize() const
+{
+	return m_writeSize;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+size_t RCSConnection::GetQueuedStreamSize() const
+{
+	return m_queuedStreamSize;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool RCSConnection::IsWriteWatched() const
+{
+	return m_isWriteWatched;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void RCSConnection::SetWriteWatched(bool isWatched)
+{
+	m_isWriteWatched = isWatched;
+}
+
+
 //-------------------------------------------------------------------------------------------------
 SOCKET RCSConnection::GetSocket() const
 {
@@ -71,33 +247,242 @@ SOCKET RCSConnection::GetSocket() const
 
 
 //-------------------------------------------------------------------------------------------------
-std::string RCSConnection::GetAddress() const
+uint32_t RCSConnection::GetID() const
 {
-	return m_tcpSocket->GetAddressString();
+	return m_id;
 }
 
 
 //-------------------------------------------------------------------------------------------------
-void RCSConnection::AddToBuffer(char readChar)
+std::string const & RCSConnection::GetAddress() const
 {
-	m_messageBuffer[m_messageBufferIndex] = readChar;
-	m_messageBufferIndex += 1;
+	return m_address;
 }
 
 
 //-------------------------------------------------------------------------------------------------
-void RCSConnection::ClearMessageBuffer()
+// Grows the ring (unwrapping it) if there isn't room for size more bytes
+bool RCSConnection::ReserveWriteSpace(size_t size)
 {
-	memset(m_messageBuffer, 0, RCSConnection::BUFFER_SIZE);
-	m_messageBufferIndex = 0;
+	size_t capacity = m_writeBuffer.size();
+	if(m_writeSize + size <= capacity)
+	{
+		return true;
+	}
+
+	while(capacity < m_writeSize + size)
+	{
+		capacity *= 2;
+	}
+	if(capacity > MAX_WRITE_BUFFER_SIZE)
+	{
+		return false;
+	}
+
+	std::vector<byte_t> grown(capacity);
+	size_t firstSize = Min(m_writeSize, m_writeBuffer.size() - m_writeHead);
+	memcpy(&grown[0], &m_writeBuffer[m_writeHead], firstSize);
+	memcpy(&grown[firstSize], &m_writeBuffer[0], m_writeSize - firstSize);
+	m_writeBuffer.swap(grown);
+	m_writeHead = 0;
+	return true;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void RCSConnection::WriteToRing(void const * data, size_t size)
+{
+	size_t capacity = m_writeBuffer.size();
+	size_t tail = (m_writeHead + m_writeSize) % capacity;
+	size_t firstSize = Min(size, capacity - tail);
+	memcpy(&m_writeBuffer[tail], data, firstSize);
+	memcpy(&m_writeBuffer[0], (byte_t const *)data + firstSize, size - firstSize);
+	m_writeSize += size;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Next chunk of the stream at the front, which then goes to the back if it isn't finished
+bool RCSConnection::WriteNextStreamChunk()
+{
+	RCSOutgoingStream stream = m_outgoingStreams.front();
+	m_outgoingStreams.pop_front();
+
+	size_t streamSize = stream.data->size();
+	size_t rawSize = Min(streamSize - stream.offset, STREAM_CHUNK_SIZE);
+	byte_t flags = 0;
+	if(stream.offset == 0)
+	{
+		flags |= STREAM_FIRST;
+	}
+	if(stream.offset + rawSize == streamSize)
+	{
+		flags |= STREAM_LAST;
+	}
+
+	byte_t const * payload = rawSize > 0 ? &(*stream.data)[stream.offset] : nullptr;
+	size_t payloadSize = rawSize;
+	if(stream.shouldCompress && rawSize > 1)
+	{
+		//Only worth it if it comes out smaller
+		size_t compressedSize = CompressLZ(payload, rawSize, &m_compressBuffer[0], rawSize - 1);
+		if(compressedSize > 0)
+		{
+			flags |= STREAM_COMPRESSED;
+			payload = &m_compressBuffer[0];
+			payloadSize = compressedSize;
+			m_compressionSavedSize += rawSize - compressedSize;
+		}
+	}
+
+	if(!ReserveWriteSpace(STREAM_HEADER_SIZE + payloadSize))
+	{
+		return false;
+	}
+
+	byte_t header[STREAM_HEADER_SIZE];
+	header[0] = eRCSMessageType_STREAM;
+	header[1] = flags;
+	header[2] = stream.channel;
+	WriteLittleEndian(&header[3], stream.streamID, 2);
+	WriteLittleEndian(&header[5], (uint32_t)payloadSize, 4);
+	WriteLittleEndian(&header[9], (uint32_t)rawSize, 4);
+	WriteToRing(header, STREAM_HEADER_SIZE);
+	if(payloadSize > 0)
+	{
+		WriteToRing(payload, payloadSize);
+	}
+
+	++m_streamChunkCount;
+	m_queuedStreamSize -= rawSize;
+	stream.offset += rawSize;
+	if((flags & STREAM_LAST) == 0)
+	{
+		m_outgoingStreams.push_back(stream);
+	}
+	return true;
 }
 
 
 //-------------------------------------------------------------------------------------------------
-void RCSConnection::CreateMessageEvent()
+// Pulls every whole message and chunk out of m_readBuffer, leaving any partial one at the front
+bool RCSConnection::ReadBuffered(std::vector<std::string> * out_messages, std::vector<RCSIncomingStream> * out_streams)
 {
-	NamedProperties data;
-	data.Set("MessageType", (eRCSMessageType)m_messageBuffer[0]);
-	data.Set("Message", &m_messageBuffer[1]);
-	BEventSystem::TriggerEvent(RemoteCommandServer::EVENT_RCS_MESSAGE, data);
+	size_t readPos = 0;
+	bool isValid = true;
+	while(isValid && readPos < m_readBuffer.size())
+	{
+		byte_t const * next = (byte_t const *)&m_readBuffer[readPos];
+		size_t availableSize = m_readBuffer.size() - readPos;
+		if(next[0] == eRCSMessageType_STREAM)
+		{
+			if(availableSize < STREAM_HEADER_SIZE)
+			{
+				break;
+			}
+
+			size_t payloadSize = ReadLittleEndian(&next[5], 4);
+			if(payloadSize > STREAM_CHUNK_SIZE)
+			{
+				isValid = false;
+				break;
+			}
+			if(availableSize < STREAM_HEADER_SIZE + payloadSize)
+			{
+				break;
+			}
+
+			isValid = ReadStreamChunk(next, out_streams);
+			readPos += STREAM_HEADER_SIZE + payloadSize;
+		}
+		else
+		{
+			byte_t const * end = (byte_t const *)memchr(next, eRCSMessageType_END, availableSize);
+			if(!end)
+			{
+				isValid = availableSize <= MAX_MESSAGE_SIZE;
+				break;
+			}
+
+			size_t messageSize = (size_t)(end - next);
+			out_messages->push_back(m_readBuffer.substr(readPos, messageSize));
+			readPos += messageSize + 1;
+		}
+	}
+
+	m_readBuffer.erase(0, readPos);
+	return isValid;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Chunk is whole (header and payload), false if it doesn't make sense
+bool RCSConnection::ReadStreamChunk(byte_t const * chunk, std::vector<RCSIncomingStream> * out_streams)
+{
+	byte_t flags = chunk[1];
+	eRCSStreamChannel channel = (eRCSStreamChannel)chunk[2];
+	uint16_t streamID = (uint16_t)ReadLittleEndian(&chunk[3], 2);
+	size_t payloadSize = ReadLittleEndian(&chunk[5], 4);
+	size_t rawSize = ReadLittleEndian(&chunk[9], 4);
+	bool isCompressed = (flags & STREAM_COMPRESSED) != 0;
+	if(rawSize > STREAM_CHUNK_SIZE || (isCompressed && rawSize == 0) || (!isCompressed && rawSize != payloadSize))
+	{
+		return false;
+	}
+
+	size_t streamIndex = 0;
+	while(streamIndex < m_incomingStreams.size() && m_incomingStreams[streamIndex].streamID != streamID)
+	{
+		++streamIndex;
+	}
+
+	if(flags & STREAM_FIRST)
+	{
+		if(streamIndex == m_incomingStreams.size())
+		{
+			if(m_incomingStreams.size() >= MAX_INCOMING_STREAMS)
+			{
+				return false;
+			}
+			m_incomingStreams.push_back(RCSIncomingStream());
+		}
+		RCSIncomingStream & stream = m_incomingStreams[streamIndex];
+		stream.data = std::make_shared<std::vector<byte_t>>();
+		stream.streamID = streamID;
+		stream.channel = channel;
+	}
+	else if(streamIndex == m_incomingStreams.size())
+	{
+		//Never saw it start
+		return false;
+	}
+
+	RCSIncomingStream & stream = m_incomingStreams[streamIndex];
+	std::vector<byte_t> & data = *stream.data;
+	size_t oldSize = data.size();
+	if(oldSize + rawSize > MAX_STREAM_SIZE)
+	{
+		return false;
+	}
+
+	data.resize(oldSize + rawSize);
+	byte_t const * payload = chunk + STREAM_HEADER_SIZE;
+	if(isCompressed)
+	{
+		if(DecompressLZ(payload, payloadSize, &data[oldSize], rawSize) != rawSize)
+		{
+			return false;
+		}
+	}
+	else if(rawSize > 0)
+	{
+		memcpy(&data[oldSize], payload, rawSize);
+	}
+
+	if(flags & STREAM_LAST)
+	{
+		out_streams->push_back(stream);
+		m_incomingStreams.erase(m_incomingStreams.begin() + streamIndex);
+	}
+	return true;
 }
\ No newline at end of file
@@ -1,43 +1,116 @@
 #pragma once
 
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Engine/Core/EngineCommon.hpp"
 #include "Engine/Utils/NetworkUtils.hpp"
 
 
 //-------------------------------------------------------------------------------------------------
 class TCPSocket;
+typedef std::shared_ptr<std::vector<byte_t>> RCSStreamPtr;
 
 
 //-------------------------------------------------------------------------------------------------
+class RCSOutgoingStream
+{
+public:
+	RCSStreamPtr data; //Shared between every connection it's going to
+	size_t offset;
+	uint16_t streamID;
+	eRCSStreamChannel channel;
+	bool shouldCompress;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+class RCSIncomingStream
+{
+public:
+	RCSStreamPtr data;
+	uint16_t streamID;
+	eRCSStreamChannel channel;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// One TCP link, owned by the RCSEventLoop thread. Sends are copied into a ring buffer and written
+// out as the socket takes them (so a partial write just leaves the rest for next time), receives
+// are assembled until their END and handed back whole.
+//
+// Streams skip the ring until there's room for them: one chunk at a time gets written as the ring
+// empties, round robin between streams, so a big one never holds up messages queued after it.
+// Chunks are [STREAM][flags][channel][streamID 2][payload size 4][raw size 4][payload], and the
+// payload is LZ compressed when that makes it smaller.
 class RCSConnection
 {
 	//-------------------------------------------------------------------------------------------------
 	// Static Members
 	//-------------------------------------------------------------------------------------------------
 public:
-	static int const BUFFER_SIZE = 1024;
+	static int const BUFFER_SIZE = 16 * 1024; //Read size
+	static size_t const MAX_MESSAGE_SIZE = 64 * 1024; //Longer than this without an END and they're dropped
+	static size_t const INITIAL_WRITE_BUFFER_SIZE = 4 * 1024;
+	static size_t const MAX_WRITE_BUFFER_SIZE = 1024 * 1024; //Further behind than this and they're dropped
+	static size_t const MAX_FLUSH_SIZE = 256 * 1024; //Per Flush(), so one fast link can't starve the rest
+	static size_t const STREAM_HEADER_SIZE = 13;
+	static size_t const STREAM_CHUNK_SIZE = 16 * 1024; //Raw bytes per chunk
+	static size_t const MAX_STREAM_SIZE = 64 * 1024 * 1024; //Bigger incoming streams and they're dropped
+	static size_t const MAX_INCOMING_STREAMS = 16;
 
 	//-------------------------------------------------------------------------------------------------
 	// Members
 	//-------------------------------------------------------------------------------------------------
 private:
 	TCPSocketPtr m_tcpSocket;
-	char m_messageBuffer[BUFFER_SIZE];
-	size_t m_messageBufferIndex;
+	uint32_t m_id;
+	std::string m_address;
+	std::string m_readBuffer; //Received but not a whole message or chunk yet
+	std::vector<byte_t> m_writeBuffer; //Ring, doubles when full up to MAX_WRITE_BUFFER_SIZE
+	size_t m_writeHead; //Oldest unsent byte
+	size_t m_writeSize;
+	bool m_isWriteWatched; //Event loop is waiting for the socket to be writable
+	std::deque<RCSOutgoingStream> m_outgoingStreams;
+	std::vector<RCSIncomingStream> m_incomingStreams;
+	std::vector<byte_t> m_compressBuffer;
+	size_t m_queuedStreamSize; //Raw bytes of m_outgoingStreams not in the ring yet
+	uint16_t m_nextStreamID;
+
+public:
+	//debugging information
+	size_t m_bytesSent;
+	size_t m_bytesReceived;
+	size_t m_partialWriteCount;
+	size_t m_streamChunkCount;
+	size_t m_compressionSavedSize;
 
 	//-------------------------------------------------------------------------------------------------
 	// Functions
 	//-------------------------------------------------------------------------------------------------
 public:
-	RCSConnection(TCPSocketPtr tcpSocket);
+	RCSConnection(TCPSocketPtr tcpSocket, uint32_t id);
 	~RCSConnection();
 
-	void Send(eRCSMessageType messageType, char const * message) const;
-	void Receive();
+	bool QueueSend(eRCSMessageType messageType, std::string const & message);
+	void QueueStream(eRCSStreamChannel channel, RCSStreamPtr data, bool shouldCompress);
+	bool Flush();
+	bool Receive(std::vector<std::string> * out_messages, std::vector<RCSIncomingStream> * out_streams);
+
+	bool HasPendingWrites() const;
+	size_t GetPendingWriteSize() const;
+	size_t GetQueuedStreamSize() const;
+	bool IsWriteWatched() const;
+	void SetWriteWatched(bool isWatched);
 	SOCKET GetSocket() const;
-	std::string GetAddress() const;
+	uint32_t GetID() const;
+	std::string const & GetAddress() const;
 
 private:
-	void AddToBuffer(char readChar);
-	void ClearMessageBuffer();
-	void CreateMessageEvent();
+	bool ReserveWriteSpace(size_t size);
+	void WriteToRing(void const * data, size_t size);
+	bool WriteNextStreamChunk();
+	bool ReadBuffered(std::vector<std::string> * out_messages, std::vector<RCSIncomingStream> * out_streams);
+	bool ReadStreamChunk(byte_t const * chunk, std::vector<RCSIncomingStream> * out_streams);
 };
\ No newline at end of file
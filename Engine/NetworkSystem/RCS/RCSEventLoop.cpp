@@ -0,0 +1,599 @@
+#include "Engine/NetworkSystem/RCS/RCSEventLoop.hpp"
+
+#include <chrono>
+#include "Engine/NetworkSystem/RCS/RCSConnection.hpp"
+#include "Engine/NetworkSystem/Sockets/TCPSocket.hpp"
+#include "Engine/Threads/Thread.hpp"
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif // __linux__
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC int const RCSEventLoop::WAIT_MS = 5;
+
+
+//-------------------------------------------------------------------------------------------------
+void RCSEventLoopEntry(void * data)
+{
+	RCSEventLoop * eventLoop = (RCSEventLoop*)data;
+	eventLoop->Run();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+RCSEventLoop::RCSEventLoop()
+	: m_thread(nullptr)
+	, m_isRunning(false)
+	, m_listener(nullptr)
+	, m_nextConnectionID(ALL_CONNECTIONS + 1)
+#if defined(__linux__)
+	, m_epoll(-1)
+	, m_wakeEvent(-1)
+#else
+	, m_isPollListDirty(true)
+#endif // __linux__
+	, m_pendingStreamSize(0)
+	, m_droppedSlowCount(0)
+{
+	//Nothing
+}
+
+
+//-------------------------------------------------------------------------------------------------
+RCSEventLoop::~RCSEventLoop()
+{
+	Stop();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Listener can be null (clients), connections get added with AddConnection()
+void RCSEventLoop::Start(TCPSocketPtr listener)
+{
+	if(m_thread)
+	{
+		return;
+	}
+
+	m_listener = listener;
+	if(!OpenPoller())
+	{
+		m_listener = nullptr;
+		return;
+	}
+
+	m_isRunning = true;
+	m_thread = new Thread(RCSEventLoopEntry, this);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Closes every connection, anything still queued either way is thrown out
+void RCSEventLoop::Stop()
+{
+	if(!m_thread)
+	{
+		return;
+	}
+
+	m_isRunning = false;
+	Wake();
+	m_thread->Join();
+	delete m_thread;
+	m_thread = nullptr;
+
+	CloseAllConnections();
+	ClosePoller();
+	m_listener = nullptr;
+
+	TCPSocketPtr tcpSocket;
+	while(m_newSockets.PopFront(&tcpSocket))
+	{
+		//Nothing
+	}
+	RCSOutgoing outgoing;
+	while(m_outbox.PopFront(&outgoing))
+	{
+		//Nothing
+	}
+	RCSEvent event;
+	while(m_inbox.PopFront(&event))
+	{
+		//Nothing
+	}
+	m_pendingStreamSize = 0;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void RCSEventLoop::Run()
+{
+	while(m_isRunning)
+	{
+		AddNewConnections();
+		DrainOutbox();
+		WaitForEvents();
+	}
+
+	//Last chance for anything queued before stopping
+	DrainOutbox();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Takes over a connected socket (clients joining a host)
+void RCSEventLoop::AddConnection(TCPSocketPtr tcpSocket)
+{
+	m_newSockets.PushBack(tcpSocket);
+	Wake();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void RCSEventLoop::QueueSend(uint32_t connectionID, eRCSMessageType messageType, std::string const & message)
+{
+	RCSOutgoing outgoing;
+	outgoing.connectionID = connectionID;
+	outgoing.messageType = messageType;
+	outgoing.message = message;
+	outgoing.stream = nullptr;
+	outgoing.channel = eRCSStreamChannel_TEST;
+	outgoing.shouldCompress = false;
+	m_outbox.PushBack(outgoing);
+	Wake();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Data is shared (not copied) between the connections, don't touch it after queueing
+void RCSEventLoop::QueueStream(uint32_t connectionID, eRCSStreamChannel channel, RCSStreamPtr data, bool shouldCompress)
+{
+	RCSOutgoing outgoing;
+	outgoing.connectionID = connectionID;
+	outgoing.messageType = eRCSMessageType_STREAM;
+	outgoing.stream = data;
+	outgoing.channel = channel;
+	outgoing.shouldCompress = shouldCompress;
+	m_pendingStreamSize += data->size();
+	m_outbox.PushBack(outgoing);
+	Wake();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool RCSEventLoop::PopEvent(RCSEvent * out_event)
+{
+	return m_inbox.PopFront(out_event);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool RCSEventLoop::IsRunning() const
+{
+	return m_isRunning;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+size_t RCSEventLoop::GetPendingStreamSize() const
+{
+	return m_pendingStreamSize;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool RCSEventLoop::OpenPoller()
+{
+#if defined(__linux__)
+	m_epoll = epoll_create1(0);
+	m_wakeEvent = eventfd(0, EFD_NONBLOCK);
+	if(m_epoll < 0 || m_wakeEvent < 0)
+	{
+		ClosePoller();
+		return false;
+	}
+
+	epoll_event wakeWatch;
+	wakeWatch.events = EPOLLIN;
+	wakeWatch.data.ptr = &m_wakeEvent;
+	epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeEvent, &wakeWatch);
+
+	if(m_listener)
+	{
+		epoll_event listenWatch;
+		listenWatch.events = EPOLLIN;
+		listenWatch.data.ptr = this;
+		epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_listener->m_socket, &listenWatch);
+	}
+#else
+	m_pollFDs.clear();
+	m_isPollListDirty = true;
+#endif // __linux__
+	return true;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void RCSEventLoop::ClosePoller()
+{
+#if defined(__linux__)
+	if(m_wakeEvent >= 0)
+	{
+		close(m_wakeEvent);
+		m_wakeEvent = -1;
+	}
+	if(m_epoll >= 0)
+	{
+		close(m_epoll);
+		m_epoll = -1;
+	}
+#else
+	m_pollFDs.clear();
+	m_isPollListDirty = true;
+#endif // __linux__
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Cuts the current wait short. WSAPoll has nothing to wake it, so there it just runs out at WAIT_MS.
+void RCSEventLoop::Wake()
+{
+#if defined(__linux__)
+	if(m_wakeEvent >= 0)
+	{
+		uint64_t one = 1;
+		ssize_t written = write(m_wakeEvent, &one, sizeof(one));
+		(void)written;
+	}
+#endif // __linux__
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void RCSEventLoop::WaitForEvents()
+{
+#if defined(__linux__)
+	epoll_event events[MAX_EVENTS];
+	int eventCount = epoll_wait(m_epoll, events, MAX_EVENTS, WAIT_MS);
+	bool hasNewConnections = false;
+	for(int eventIndex = 0; eventIndex < eventCount; ++eventIndex)
+	{
+		epoll_event const & event = events[eventIndex];
+		if(event.data.ptr == &m_wakeEvent)
+		{
+			uint64_t count;
+			ssize_t read = ::read(m_wakeEvent, &count, sizeof(count));
+			(void)read;
+			continue;
+		}
+
+		if(event.data.ptr == this)
+		{
+			hasNewConnections = true;
+			continue;
+		}
+
+		//Each socket shows up once per wait, so closing it here can't leave a later event dangling
+		RCSConnection * connection = (RCSConnection*)event.data.ptr;
+		bool isAlive = (event.events & (EPOLLERR | EPOLLHUP)) == 0;
+		if(isAlive && (event.events & EPOLLIN))
+		{
+			isAlive = ReadConnection(connection);
+		}
+		if(isAlive && (event.events & EPOLLOUT))
+		{
+			isAlive = FlushConnection(connection);
+		}
+		if(!isAlive)
+		{
+			CloseConnection(connection);
+		}
+	}
+
+	if(hasNewConnections)
+	{
+		AcceptNewConnections();
+	}
+#else
+	size_t connectionOffset = m_listener ? 1 : 0;
+	if(m_isPollListDirty)
+	{
+		m_pollFDs.clear();
+		if(m_listener)
+		{
+			WSAPOLLFD listenPoll;
+			listenPoll.fd = m_listener->m_socket;
+			listenPoll.events = POLLRDNORM;
+			listenPoll.revents = 0;
+			m_pollFDs.push_back(listenPoll);
+		}
+		for(size_t connIndex = 0; connIndex < m_connections.size(); ++connIndex)
+		{
+			RCSConnection * connection = m_connections[connIndex];
+			WSAPOLLFD connectionPoll;
+			connectionPoll.fd = connection->GetSocket();
+			connectionPoll.events = POLLRDNORM | (connection->IsWriteWatched() ? POLLWRNORM : 0);
+			connectionPoll.revents = 0;
+			m_pollFDs.push_back(connectionPoll);
+		}
+		m_isPollListDirty = false;
+	}
+
+	if(m_pollFDs.empty())
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_MS));
+		return;
+	}
+
+	int result = WSAPoll(&m_pollFDs[0], (ULONG)m_pollFDs.size(), WAIT_MS);
+	if(result <= 0)
+	{
+		return;
+	}
+
+	//Backwards, so closing one doesn't move the ones still to check
+	for(size_t connIndex = m_connections.size(); connIndex > 0; --connIndex)
+	{
+		RCSConnection * connection = m_connections[connIndex - 1];
+		short revents = m_pollFDs[connectionOffset + connIndex - 1].revents;
+		bool isAlive = (revents & (POLLERR | POLLHUP | POLLNVAL)) == 0;
+		if(isAlive && (revents & POLLRDNORM))
+		{
+			isAlive = ReadConnection(connection);
+		}
+		if(isAlive && (revents & POLLWRNORM))
+		{
+			isAlive = FlushConnection(connection);
+		}
+		if(!isAlive)
+		{
+			CloseConnection(connection);
+		}
+	}
+
+	if(m_listener && (m_pollFDs[0].revents & POLLRDNORM))
+	{
+		AcceptNewConnections();
+	}
+#endif // __linux__
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void RCSEventLoop::AcceptNewConnections()
+{
+	TCPSocketPtr tcpSocket = m_listener->Accept();
+	while(tcpSocket)
+	{
+		m_newSockets.PushBack(tcpSocket);
+		tcpSocket = m_listener->Accept();
+	}
+	AddNewConnections();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void RCSEventLoop::AddNewConnections()
+{
+	TCPSocketPtr tcpSocket;
+	while(m_newSockets.PopFront(&tcpSocket))
+	{
+		RCSConnection * connection = new RCSConnection(tcpSocket, m_nextConnectionID);
+		++m_nextConnectionID;
+		if(m_nextConnectionID == ALL_CONNECTIONS)
+		{
+			++m_nextConnectionID;
+		}
+		m_connections.push_back(connection);
+		WatchConnection(connection);
+
+		RCSEvent event;
+		event.type = eRCSEventType_CONNECTED;
+		event.connectionID = connection->GetID();
+		event.address = connection->GetAddress();
+		event.messageType = eRCSMessageType_END;
+		m_inbox.PushBack(event);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Copies everything the game thread queued into the connections' write buffers and writes what the
+// sockets will take right away
+void RCSEventLoop::DrainOutbox()
+{
+	RCSOutgoing outgoing;
+	bool hasQueued = false;
+	while(m_outbox.PopFront(&outgoing))
+	{
+		hasQueued = true;
+		if(outgoing.stream)
+		{
+			//Counted again below for each connection it goes to
+			m_pendingStreamSize -= outgoing.stream->size();
+		}
+
+		for(size_t connIndex = m_connections.size(); connIndex > 0; --connIndex)
+		{
+			RCSConnection * connection = m_connections[connIndex - 1];
+			if(outgoing.connectionID != ALL_CONNECTIONS && outgoing.connectionID != connection->GetID())
+			{
+				continue;
+			}
+
+			if(outgoing.stream)
+			{
+				connection->QueueStream(outgoing.channel, outgoing.stream, outgoing.shouldCompress);
+				m_pendingStreamSize += outgoing.stream->size();
+			}
+			else if(!connection->QueueSend(outgoing.messageType, outgoing.message))
+			{
+				++m_droppedSlowCount;
+				CloseConnection(connection);
+			}
+		}
+	}
+
+	if(!hasQueued)
+	{
+		return;
+	}
+
+	for(size_t connIndex = m_connections.size(); connIndex > 0; --connIndex)
+	{
+		RCSConnection * connection = m_connections[connIndex - 1];
+		if(connection->HasPendingWrites() && !FlushConnection(connection))
+		{
+			CloseConnection(connection);
+		}
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool RCSEventLoop::ReadConnection(RCSConnection * connection)
+{
+	std::vector<std::string> messages;
+	std::vector<RCSIncomingStream> streams;
+	bool isAlive = connection->Receive(&messages, &streams);
+	for(size_t messageIndex = 0; messageIndex < messages.size(); ++messageIndex)
+	{
+		std::string const & message = messages[messageIndex];
+		if(message.empty())
+		{
+			continue;
+		}
+
+		RCSEvent event;
+		event.type = eRCSEventType_MESSAGE;
+		event.connectionID = connection->GetID();
+		event.messageType = (eRCSMessageType)message[0];
+		event.message = message.substr(1);
+		m_inbox.PushBack(event);
+	}
+
+	for(size_t streamIndex = 0; streamIndex < streams.size(); ++streamIndex)
+	{
+		RCSEvent event;
+		event.type = eRCSEventType_STREAM;
+		event.connectionID = connection->GetID();
+		event.messageType = eRCSMessageType_STREAM;
+		event.channel = streams[streamIndex].channel;
+		event.data = streams[streamIndex].data;
+		m_inbox.PushBack(event);
+	}
+	return isAlive;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool RCSEventLoop::FlushConnection(RCSConnection * connection)
+{
+	size_t queuedStreamSize = connection->GetQueuedStreamSize();
+	bool isAlive = connection->Flush();
+	m_pendingStreamSize -= queuedStreamSize - connection->GetQueuedStreamSize();
+	if(!isAlive)
+	{
+		return false;
+	}
+	UpdateWriteWatch(connection);
+	return true;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void RCSEventLoop::WatchConnection(RCSConnection * connection)
+{
+#if defined(__linux__)
+	epoll_event watch;
+	watch.events = EPOLLIN | EPOLLRDHUP;
+	watch.data.ptr = connection;
+	epoll_ctl(m_epoll, EPOLL_CTL_ADD, connection->GetSocket(), &watch);
+#else
+	UNREFERENCED(connection);
+	m_isPollListDirty = true;
+#endif // __linux__
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Only ask about writability while something is waiting, a writable socket would wake every wait
+void RCSEventLoop::UpdateWriteWatch(RCSConnection * connection)
+{
+	bool shouldWatch = connection->HasPendingWrites();
+	if(shouldWatch == connection->IsWriteWatched())
+	{
+		return;
+	}
+	connection->SetWriteWatched(shouldWatch);
+
+#if defined(__linux__)
+	epoll_event watch;
+	watch.events = EPOLLIN | EPOLLRDHUP | (shouldWatch ? EPOLLOUT : 0);
+	watch.data.ptr = connection;
+	epoll_ctl(m_epoll, EPOLL_CTL_MOD, connection->GetSocket(), &watch);
+#else
+	if(m_isPollListDirty)
+	{
+		return;
+	}
+
+	size_t connectionOffset = m_listener ? 1 : 0;
+	for(size_t connIndex = 0; connIndex < m_connections.size(); ++connIndex)
+	{
+		if(m_connections[connIndex] == connection)
+		{
+			m_pollFDs[connectionOffset + connIndex].events = POLLRDNORM | (shouldWatch ? POLLWRNORM : 0);
+			break;
+		}
+	}
+#endif // __linux__
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void RCSEventLoop::CloseConnection(RCSConnection * connection)
+{
+	for(size_t connIndex = 0; connIndex < m_connections.size(); ++connIndex)
+	{
+		if(m_connections[connIndex] == connection)
+		{
+			m_connections.erase(m_connections.begin() + connIndex);
+			break;
+		}
+	}
+
+#if defined(__linux__)
+	epoll_ctl(m_epoll, EPOLL_CTL_DEL, connection->GetSocket(), nullptr);
+#else
+	m_isPollListDirty = true;
+#endif // __linux__
+	m_pendingStreamSize -= connection->GetQueuedStreamSize();
+
+	RCSEvent event;
+	event.type = eRCSEventType_DISCONNECTED;
+	event.connectionID = connection->GetID();
+	event.address = connection->GetAddress();
+	event.messageType = eRCSMessageType_END;
+	m_inbox.PushBack(event);
+	delete connection;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Only once the thread has stopped
+void RCSEventLoop::CloseAllConnections()
+{
+	for(size_t connIndex = 0; connIndex < m_connections.size(); ++connIndex)
+	{
+		delete m_connections[connIndex];
+	}
+	m_connections.clear();
+#if !defined(__linux__)
+	m_isPollListDirty = true;
+#endif // !__linux__
+}
\ No newline at end of file
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/NetworkSystem/RCS/RCSConnection.hpp"
+#include "Engine/Threads/BQueue.hpp"
+#include "Engine/Utils/NetworkUtils.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+class Thread;
+
+
+//-------------------------------------------------------------------------------------------------
+void RCSEventLoopEntry(void * data);
+
+
+//-------------------------------------------------------------------------------------------------
+enum eRCSEventType
+{
+	eRCSEventType_CONNECTED,
+	eRCSEventType_DISCONNECTED,
+	eRCSEventType_MESSAGE,
+	eRCSEventType_STREAM,
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Event loop to game thread
+class RCSEvent
+{
+public:
+	eRCSEventType type;
+	uint32_t connectionID;
+	std::string address; //CONNECTED and DISCONNECTED
+	eRCSMessageType messageType; //MESSAGE
+	std::string message; //MESSAGE
+	eRCSStreamChannel channel; //STREAM
+	RCSStreamPtr data; //STREAM
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Game thread to event loop
+class RCSOutgoing
+{
+public:
+	uint32_t connectionID;
+	eRCSMessageType messageType;
+	std::string message;
+	RCSStreamPtr stream; //Null for messages
+	eRCSStreamChannel channel;
+	bool shouldCompress;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Owns the RCS sockets while running and does all of their IO on its own thread: epoll on Linux,
+// WSAPoll everywhere else (with the poll list only rebuilt when connections come or go, and only
+// asking about writability while something is waiting to go out). The game thread just queues
+// sends and pops events.
+class RCSEventLoop
+{
+	//-------------------------------------------------------------------------------------------------
+	// Static Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	static uint32_t const ALL_CONNECTIONS = 0;
+	static int const WAIT_MS; //Longest a wait goes (WSAPoll can't be woken up for new sends)
+	static int const MAX_EVENTS = 64;
+
+	//-------------------------------------------------------------------------------------------------
+	// Members
+	//-------------------------------------------------------------------------------------------------
+private:
+	Thread * m_thread;
+	std::atomic<bool> m_isRunning;
+	TCPSocketPtr m_listener; //Hosts only
+
+	//Event loop thread only
+	std::vector<RCSConnection*> m_connections;
+	uint32_t m_nextConnectionID;
+
+	BQueue<TCPSocketPtr> m_newSockets;
+	BQueue<RCSOutgoing> m_outbox;
+	BQueue<RCSEvent> m_inbox;
+
+#if defined(__linux__)
+	int m_epoll;
+	int m_wakeEvent;
+#else
+	std::vector<WSAPOLLFD> m_pollFDs; //Listener first (if hosting), then m_connections in order
+	bool m_isPollListDirty;
+#endif // __linux__
+
+	//Raw stream bytes queued or still waiting in connections, what callers check before queueing more
+	std::atomic<size_t> m_pendingStreamSize;
+
+public:
+	//debugging information
+	std::atomic<size_t> m_droppedSlowCount; //Connections dropped for falling too far behind
+
+	//-------------------------------------------------------------------------------------------------
+	// Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	RCSEventLoop();
+	~RCSEventLoop();
+
+	void Start(TCPSocketPtr listener);
+	void Stop();
+	void Run();
+
+	//Game thread
+	void AddConnection(TCPSocketPtr tcpSocket);
+	void QueueSend(uint32_t connectionID, eRCSMessageType messageType, std::string const & message);
+	void QueueStream(uint32_t connectionID, eRCSStreamChannel channel, RCSStreamPtr data, bool shouldCompress);
+	bool PopEvent(RCSEvent * out_event);
+	bool IsRunning() const;
+	size_t GetPendingStreamSize() const;
+
+private:
+	//Event loop thread
+	bool OpenPoller();
+	void ClosePoller();
+	void Wake();
+	void WaitForEvents();
+	void AcceptNewConnections();
+	void AddNewConnections();
+	void DrainOutbox();
+	bool ReadConnection(RCSConnection * connection);
+	bool FlushConnection(RCSConnection * connection);
+	void WatchConnection(RCSConnection * connection);
+	void UpdateWriteWatch(RCSConnection * connection);
+	void CloseConnection(RCSConnection * connection);
+	void CloseAllConnections();
+};
\ No newline at end of file
@@ -1,16 +1,16 @@
 #include "Engine/NetworkSystem/RCS/RemoteCommandServer.hpp"
 
+#include "Engine/Core/NamedProperties.hpp"
 #include "Engine/EventSystem/BEventSystem.hpp"
 #include "Engine/NetworkSystem/BNetworkSystem.hpp"
-#include "Engine/NetworkSystem/RCS/RCSConnection.hpp"
 #include "Engine/NetworkSystem/Sockets/TCPSocket.hpp"
 #include "Engine/NetworkSystem/Sockets/SocketAddress.hpp"
 
 
 //-------------------------------------------------------------------------------------------------
-STATIC const int RemoteCommandServer::DEFAULT_WAIT = 0;
 STATIC size_t RemoteCommandServer::RCS_PORT = 4325;
 STATIC char const * RemoteCommandServer::EVENT_RCS_MESSAGE = "RCSMessageEvent";
+STATIC char const * RemoteCommandServer::EVENT_RCS_STREAM = "RCSStreamEvent";
 STATIC RemoteCommandServer * RemoteCommandServer::s_Instance = nullptr;
 
 
@@ -121,8 +121,11 @@ void RCSInfo(Command const &)
 	{
 		BConsoleSystem::AddLog("Status: Client", BConsoleSystem::INFO);
 		std::vector<std::string> connectionAddressList = rcs->GetConnectionAddresses();
-		std::string clientString = Stringf("Client: %s", connectionAddressList[0].c_str());
-		BConsoleSystem::AddLog(clientString, BConsoleSystem::GOOD);
+		if(!connectionAddressList.empty())
+		{
+			std::string clientString = Stringf("Client: %s", connectionAddressList[0].c_str());
+			BConsoleSystem::AddLog(clientString, BConsoleSystem::GOOD);
+		}
 	}
 	else
 	{
@@ -145,6 +148,46 @@ void RCSSend(Command const & command)
 }
 
 
+//-------------------------------------------------------------------------------------------------
+// Repeating text, so it also shows what compression does
+void RCSStream(Command const & command)
+{
+	RemoteCommandServer const * rcs = RemoteCommandServer::CreateOrGetInstance();
+	if(!rcs->IsConnected())
+	{
+		BConsoleSystem::AddLog("Not connected.", BConsoleSystem::BAD);
+		return;
+	}
+
+	int sizeKB = command.GetArg(0, 1024);
+	if(sizeKB <= 0)
+	{
+		BConsoleSystem::AddLog("Size must be positive.", BConsoleSystem::BAD);
+		return;
+	}
+
+	std::vector<byte_t> data;
+	data.reserve((size_t)sizeKB * 1024);
+	size_t lineIndex = 0;
+	while(data.size() < (size_t)sizeKB * 1024)
+	{
+		std::string line = Stringf("RCS stream test line %u\n", lineIndex);
+		data.insert(data.end(), line.begin(), line.end());
+		++lineIndex;
+	}
+	data.resize((size_t)sizeKB * 1024);
+
+	if(RemoteCommandServer::SendStream(eRCSStreamChannel_TEST, std::move(data)))
+	{
+		BConsoleSystem::AddLog(Stringf("Streaming %d KB.", sizeKB), BConsoleSystem::GOOD);
+	}
+	else
+	{
+		BConsoleSystem::AddLog(Stringf("Stream refused, %u bytes still waiting to go out.", rcs->GetPendingStreamSize()), BConsoleSystem::BAD);
+	}
+}
+
+
 //-------------------------------------------------------------------------------------------------
 STATIC void RemoteCommandServer::Startup()
 {
@@ -245,6 +288,33 @@ STATIC bool RemoteCommandServer::Send(eRCSMessageType const & type, std::string
 }
 
 
+//-------------------------------------------------------------------------------------------------
+// Goes out in chunks from the event loop thread, so this only costs the move. False if not connected,
+// or if the other end hasn't kept up with earlier streams (skip this one and try again later).
+STATIC bool RemoteCommandServer::SendStream(eRCSStreamChannel channel, std::vector<byte_t> && data, bool shouldCompress /*= true*/)
+{
+	if(!s_Instance)
+	{
+		//Startup required
+		return false;
+	}
+
+	if(!s_Instance->IsConnected())
+	{
+		return false;
+	}
+
+	if(s_Instance->GetPendingStreamSize() + data.size() > MAX_PENDING_STREAM_SIZE)
+	{
+		return false;
+	}
+
+	RCSStreamPtr stream = std::make_shared<std::vector<byte_t>>(std::move(data));
+	s_Instance->m_eventLoop.QueueStream(RCSEventLoop::ALL_CONNECTIONS, channel, stream, shouldCompress);
+	return true;
+}
+
+
 //-------------------------------------------------------------------------------------------------
 STATIC bool RemoteCommandServer::Leave()
 {
@@ -270,23 +340,21 @@ RemoteCommandServer::RemoteCommandServer()
 {
 	BEventSystem::RegisterEvent(BNetworkSystem::EVENT_NETWORK_UPDATE, this, &RemoteCommandServer::OnUpdate);
 	BEventSystem::RegisterEvent(EVENT_RCS_MESSAGE, this, &RemoteCommandServer::OnMessage);
+	BEventSystem::RegisterEvent(EVENT_RCS_STREAM, this, &RemoteCommandServer::OnStream);
 
 	BConsoleSystem::Register("rcs_host", RCSHost, ": Host a local server.");
 	BConsoleSystem::Register("rcs_join", RCSJoin, " [host address] : Join server.");
 	BConsoleSystem::Register("rcs_leave", RCSLeave, ": Leave current server.");
 	BConsoleSystem::Register("rcs_info", RCSInfo, ": Prints current network state.");
 	BConsoleSystem::Register("rcs_send", RCSSend, " [cmd] : Sends command to all connections.");
+	BConsoleSystem::Register("rcs_stream", RCSStream, " [kb] : Streams test data to all connections.");
 }
 
 
 //-------------------------------------------------------------------------------------------------
 RemoteCommandServer::~RemoteCommandServer()
 {
-	for(RCSConnection * conn : m_connections)
-	{
-		delete conn;
-		conn = nullptr;
-	}
+	m_eventLoop.Stop();
 	m_connections.clear();
 }
 
@@ -299,8 +367,7 @@ void RemoteCommandServer::OnUpdate(NamedProperties &)
 		return;
 	}
 
-	AcceptNewConnections();
-	UpdateConnections();
+	ProcessEvents();
 }
 
 
@@ -326,6 +393,22 @@ void RemoteCommandServer::OnMessage(NamedProperties & params)
 }
 
 
+//-------------------------------------------------------------------------------------------------
+// Other channels are for whoever registers for EVENT_RCS_STREAM
+void RemoteCommandServer::OnStream(NamedProperties & params)
+{
+	eRCSStreamChannel channel;
+	params.Get("Channel", channel);
+	RCSStreamPtr data;
+	params.Get("Data", data);
+
+	if(channel == eRCSStreamChannel_TEST && data)
+	{
+		BConsoleSystem::AddLog(Stringf("REMOTE: Test stream, %u bytes", data->size()), BConsoleSystem::REMOTE, true);
+	}
+}
+
+
 //-------------------------------------------------------------------------------------------------
 void RemoteCommandServer::StartTCPListener(SocketAddressPtr address)
 {
@@ -343,6 +426,7 @@ void RemoteCommandServer::StartTCPListener(SocketAddressPtr address)
 	if(error == NO_ERROR)
 	{
 		m_state = eRCSState_HOST;
+		m_eventLoop.Start(m_listener);
 	}
 }
 
@@ -358,192 +442,114 @@ void RemoteCommandServer::CreateRCSConnection(SocketAddressPtr address)
 		int error = tcpSocket->Connect(address);
 		if(error == NO_ERROR)
 		{
-			CreateRCSConnection(tcpSocket);
+			//Event loop takes it from here (and makes it non-blocking)
+			m_state = eRCSState_CLIENT;
+			m_eventLoop.Start(nullptr);
+			m_eventLoop.AddConnection(tcpSocket);
 		}
 	}
 }
 
 
-//-------------------------------------------------------------------------------------------------
-void RemoteCommandServer::CreateRCSConnection(TCPSocketPtr tcpSocket)
-{
-	if(tcpSocket)
-	{
-		tcpSocket->SetBlocking(false);
-		RCSConnection * connection = new RCSConnection(tcpSocket);
-		m_connections.push_back(connection);
-	}
-
-	if(!IsConnected())
-	{
-		m_state = eRCSState_CLIENT;
-	}
-}
-
-
 //-------------------------------------------------------------------------------------------------
 void RemoteCommandServer::SendRCSMessage(eRCSMessageType const & type, std::string const & message)
 {
-	for(RCSConnection const * conn : m_connections)
-	{
-		if(conn)
-		{
-			conn->Send(type, message.c_str());
-		}
-	}
+	m_eventLoop.QueueSend(RCSEventLoop::ALL_CONNECTIONS, type, message);
 }
 
 
 //-------------------------------------------------------------------------------------------------
 void RemoteCommandServer::Disconnect()
 {
-	if(IsHost())
-	{
-		m_listener = nullptr;
-		for(RCSConnection * conn : m_connections)
-		{
-			if(conn)
-			{
-				delete conn;
-				conn = nullptr;
-			}
-		}
-		m_connections.clear();
-		m_state = eRCSState_DISCONNECTED;
-	}
-
-	if(IsClient())
-	{
-		ASSERT_RECOVERABLE(m_connections.size() == 1, "Incorrect number of client connections.")
-			delete m_connections[0];
-		m_connections[0] = nullptr;
-		m_connections.clear();
-		m_state = eRCSState_DISCONNECTED;
-	}
+	m_eventLoop.Stop();
+	m_listener = nullptr;
+	m_connections.clear();
+	m_state = eRCSState_DISCONNECTED;
 }
 
 
 //-------------------------------------------------------------------------------------------------
-void RemoteCommandServer::AcceptNewConnections()
+void RemoteCommandServer::ProcessEvents()
 {
-	if(!IsHost())
-	{
-		return;
-	}
-
-	if(m_listener)
+	RCSEvent event;
+	while(IsConnected() && m_eventLoop.PopEvent(&event))
 	{
-		TCPSocketPtr tcpSocket = m_listener->Accept();
-		if(tcpSocket)
+		switch(event.type)
 		{
-			CreateRCSConnection(tcpSocket);
-			BConsoleSystem::AddLog("Client connected: " + tcpSocket->GetAddressString(), BConsoleSystem::REMOTE);
+		case eRCSEventType_CONNECTED:
+			HandleConnect(event);
+			break;
+		case eRCSEventType_DISCONNECTED:
+			HandleDisconnect(event);
+			break;
+		case eRCSEventType_MESSAGE:
+			HandleMessage(event);
+			break;
+		case eRCSEventType_STREAM:
+			HandleStream(event);
+			break;
 		}
 	}
 }
 
 
 //-------------------------------------------------------------------------------------------------
-void RemoteCommandServer::UpdateConnections()
+void RemoteCommandServer::HandleConnect(RCSEvent const & event)
 {
-	std::vector<WSAPOLLFD> fdArray;
-	FDArrayFill(fdArray);
-	if(fdArray.size() <= 0)
-	{
-		return;
-	}
+	RCSConnectionInfo info;
+	info.connectionID = event.connectionID;
+	info.address = event.address;
+	m_connections.push_back(info);
 
-	uint32_t result = WSAPoll(&fdArray[0], fdArray.size(), DEFAULT_WAIT);
-	if(result <= 0)
+	if(IsHost())
 	{
-		return;
+		BConsoleSystem::AddLog("Client connected: " + event.address, BConsoleSystem::REMOTE);
 	}
-
-	FDArrayProcess(fdArray);
 }
 
 
 //-------------------------------------------------------------------------------------------------
-void RemoteCommandServer::FDArrayFill(std::vector<WSAPOLLFD> & fdArray)
+void RemoteCommandServer::HandleDisconnect(RCSEvent const & event)
 {
 	for(size_t connIndex = 0; connIndex < m_connections.size(); ++connIndex)
 	{
-		RCSConnection * conn = m_connections[connIndex];
-		if(conn)
+		if(m_connections[connIndex].connectionID == event.connectionID)
 		{
-			WSAPOLLFD poll;
-			poll.fd = conn->GetSocket();
-			poll.events = POLLRDNORM | POLLWRNORM;
-			fdArray.push_back(poll);
+			m_connections.erase(m_connections.begin() + connIndex);
+			break;
 		}
 	}
-}
 
-
-//-------------------------------------------------------------------------------------------------
-void RemoteCommandServer::FDArrayProcess(std::vector<WSAPOLLFD> & fdArray)
-{
-	for(size_t fdIndex = 0; fdIndex < fdArray.size(); )
+	if(IsHost())
 	{
-		if(!m_connections[fdIndex])
-		{
-			continue;
-		}
-
-		//Connection can be read from
-		if(fdArray[fdIndex].revents & POLLRDNORM)
-		{
-			m_connections[fdIndex]->Receive();
-		}
-
-		//Connection can be sent to
-		if(fdArray[fdIndex].revents & POLLWRNORM)
-		{
-			//Nothing
-		}
-
-		//Connection left
-		if(fdArray[fdIndex].revents & POLLHUP)
-		{
-			HandleDisconnect(m_connections[fdIndex]);
-
-			//Remove from fdArray
-			std::vector<WSAPOLLFD>::iterator fdIter = fdArray.begin() + fdIndex;
-			fdArray.erase(fdIter);
+		BConsoleSystem::AddLog(Stringf("Client left: %s", event.address.c_str()), BConsoleSystem::REMOTE);
+	}
 
-			//Remove from 
-			std::vector<RCSConnection*>::iterator connIter = m_connections.begin() + fdIndex;
-			m_connections.erase(connIter);
-		}
-		else
-		{
-			++fdIndex;
-		}
+	if(IsClient())
+	{
+		BConsoleSystem::AddLog(Stringf("Host disconnected."), BConsoleSystem::REMOTE);
+		Disconnect();
 	}
 }
 
 
 //-------------------------------------------------------------------------------------------------
-void RemoteCommandServer::HandleDisconnect(RCSConnection *& conn)
+void RemoteCommandServer::HandleMessage(RCSEvent const & event)
 {
-	if(!conn)
-	{
-		return;
-	}
-
-	if(IsHost())
-	{
-		BConsoleSystem::AddLog(Stringf("Client left: %s", conn->GetAddress().c_str()), BConsoleSystem::REMOTE);
-	}
+	NamedProperties data;
+	data.Set("MessageType", event.messageType);
+	data.Set("Message", event.message);
+	BEventSystem::TriggerEvent(EVENT_RCS_MESSAGE, data);
+}
 
-	if(IsClient())
-	{
-		BConsoleSystem::AddLog(Stringf("Host disconnected."), BConsoleSystem::REMOTE);
-		m_state = eRCSState_DISCONNECTED;
-	}
 
-	delete conn;
-	conn = nullptr;
+//-------------------------------------------------------------------------------------------------
+void RemoteCommandServer::HandleStream(RCSEvent const & event)
+{
+	NamedProperties data;
+	data.Set("Channel", event.channel);
+	data.Set("Data", event.data);
+	BEventSystem::TriggerEvent(EVENT_RCS_STREAM, data);
 }
 
 
@@ -587,13 +593,17 @@ std::vector<std::string> RemoteCommandServer::GetConnectionAddresses() const
 {
 	std::vector<std::string> connectionAddressList;
 
-	for(RCSConnection * conn : m_connections)
+	for(RCSConnectionInfo const & info : m_connections)
 	{
-		if(conn)
-		{
-			connectionAddressList.push_back(conn->GetAddress());
-		}
+		connectionAddressList.push_back(info.address);
 	}
 
 	return connectionAddressList;
 }
+
+
+//-------------------------------------------------------------------------------------------------
+size_t RemoteCommandServer::GetPendingStreamSize() const
+{
+	return m_eventLoop.GetPendingStreamSize();
+}
\ No newline at end of file
@@ -1,12 +1,12 @@
 #pragma once
 
 #include <vector>
+#include "Engine/NetworkSystem/RCS/RCSEventLoop.hpp"
 #include "Engine/Utils/NetworkUtils.hpp"
 
 
 //-------------------------------------------------------------------------------------------------
 class NamedProperties;
-class RCSConnection;
 class Command;
 
 
@@ -16,6 +16,7 @@ void RCSJoin(Command const &);
 void RCSLeave(Command const &);
 void RCSInfo(Command const &);
 void RCSSend(Command const &);
+void RCSStream(Command const &);
 
 
 //-------------------------------------------------------------------------------------------------
@@ -28,17 +29,30 @@ enum eRCSState
 
 
 //-------------------------------------------------------------------------------------------------
+// Game thread's view of a connection, kept up to date from the event loop's events
+class RCSConnectionInfo
+{
+public:
+	uint32_t connectionID;
+	std::string address;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Socket IO happens on the RCSEventLoop thread, the game thread only queues sends and handles the
+// events it gets back
 class RemoteCommandServer
 {
 	//-------------------------------------------------------------------------------------------------
 	// Static Members
 	//-------------------------------------------------------------------------------------------------
 private:
-	static int const DEFAULT_WAIT;
 	static size_t RCS_PORT;
 
 public:
+	static size_t const MAX_PENDING_STREAM_SIZE = 16 * 1024 * 1024; //Past this SendStream() says no
 	static char const * EVENT_RCS_MESSAGE;
+	static char const * EVENT_RCS_STREAM;
 	static RemoteCommandServer * s_Instance;
 
 	//-------------------------------------------------------------------------------------------------
@@ -47,7 +61,8 @@ public:
 private:
 	eRCSState m_state;
 	TCPSocketPtr m_listener;
-	std::vector<RCSConnection*> m_connections;
+	RCSEventLoop m_eventLoop;
+	std::vector<RCSConnectionInfo> m_connections;
 
 	//-------------------------------------------------------------------------------------------------
 	// Static Functions
@@ -59,6 +74,7 @@ public:
 	static bool Host(uint32_t port = RCS_PORT);
 	static bool Join(char const * host, uint32_t port = RCS_PORT);
 	static bool Send(eRCSMessageType const & type, std::string const & message);
+	static bool SendStream(eRCSStreamChannel channel, std::vector<byte_t> && data, bool shouldCompress = true);
 	static bool Leave();
 
 	//-------------------------------------------------------------------------------------------------
@@ -70,17 +86,17 @@ private:
 
 	void OnUpdate(NamedProperties & params);
 	void OnMessage(NamedProperties & params);
+	void OnStream(NamedProperties & params);
 	void StartTCPListener(SocketAddressPtr address);
 	void CreateRCSConnection(SocketAddressPtr address);
-	void CreateRCSConnection(TCPSocketPtr tcpSocket);
 	void SendRCSMessage(eRCSMessageType const & type, std::string const & message);
 	void Disconnect();
 
-	void AcceptNewConnections();
-	void UpdateConnections();
-	void FDArrayFill(std::vector<WSAPOLLFD> & fdArray);
-	void FDArrayProcess(std::vector<WSAPOLLFD> & fdArray);
-	void HandleDisconnect(RCSConnection *& conn);
+	void ProcessEvents();
+	void HandleConnect(RCSEvent const & event);
+	void HandleDisconnect(RCSEvent const & event);
+	void HandleMessage(RCSEvent const & event);
+	void HandleStream(RCSEvent const & event);
 
 public:
 	bool IsConnected() const;
@@ -88,4 +104,5 @@ public:
 	bool IsClient() const;
 	std::string GetListenAddress() const;
 	std::vector<std::string> GetConnectionAddresses() const;
+	size_t GetPendingStreamSize() const;
 };
\ No newline at end of file
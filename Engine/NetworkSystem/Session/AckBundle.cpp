@@ -3,12 +3,49 @@
 #include "Engine/Core/Time.hpp"
 
 
+//-------------------------------------------------------------------------------------------------
+AckReliableRing::AckReliableRing()
+	: m_nextIndex(0)
+{
+	//Nothing
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Returns where it went
+uint32_t AckReliableRing::Push(uint16_t reliableID)
+{
+	uint32_t index = m_nextIndex;
+	m_reliableIDs[index & (CAPACITY - 1)] = reliableID;
+	++m_nextIndex;
+	return index;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+uint16_t AckReliableRing::Get(uint32_t index) const
+{
+	return m_reliableIDs[index & (CAPACITY - 1)];
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// True if nothing from firstIndex on has been written over yet
+bool AckReliableRing::IsValid(uint32_t firstIndex) const
+{
+	return (uint32_t)(m_nextIndex - firstIndex) <= CAPACITY;
+}
+
+
 //-------------------------------------------------------------------------------------------------
 AckBundle::AckBundle()
 	: m_ackID(INVALID_ACK_ID)
 	, m_reliableMessageCount(0)
+	, m_firstReliable(0)
+	, m_receiptCount(0)
 	, m_confirmReceived(false)
 	, m_sentTimeStamp(0.0)
+	, m_sentBytes(0)
 {
 	//Nothing
 }
@@ -18,17 +55,39 @@ AckBundle::AckBundle()
 AckBundle::AckBundle(uint16_t id)
 	: m_ackID(id)
 	, m_reliableMessageCount(0)
+	, m_firstReliable(0)
+	, m_receiptCount(0)
 	, m_confirmReceived(false)
-	, m_sentTimeStamp(Time::TOTAL_SECONDS)
+	, m_sentTimeStamp(Time::GetCurrentTimeSeconds())
+	, m_sentBytes(0)
 {
 	//Nothing
 }
 
 
 //-------------------------------------------------------------------------------------------------
-void AckBundle::AddReliableID(uint16_t reliableID)
+// A packet's reliables are all written before the next packet starts, so they stay back to back
+void AckBundle::AddReliableID(AckReliableRing * ring, uint16_t reliableID)
 {
-	m_attachedReliables[m_reliableMessageCount] = reliableID;
+	uint32_t index = ring->Push(reliableID);
+	if(m_reliableMessageCount == 0)
+	{
+		m_firstReliable = index;
+	}
 	++m_reliableMessageCount;
 }
 
+
+//-------------------------------------------------------------------------------------------------
+bool AckBundle::AddReceipt(unsigned char messageType, uint16_t receiptID)
+{
+	if(m_receiptCount >= MAX_RECEIPTS_PER_PACKET)
+	{
+		return false;
+	}
+
+	m_receipts[m_receiptCount].messageType = messageType;
+	m_receipts[m_receiptCount].receiptID = receiptID;
+	++m_receiptCount;
+	return true;
+}
\ No newline at end of file
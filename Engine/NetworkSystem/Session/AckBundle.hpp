@@ -3,6 +3,48 @@
 
 //-------------------------------------------------------------------------------------------------
 typedef unsigned short uint16_t;
+typedef unsigned int uint32_t;
+
+
+//-------------------------------------------------------------------------------------------------
+class AckReceipt
+{
+public:
+	unsigned char messageType;
+	uint16_t receiptID;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Reliable IDs attached to each sent packet, back to back in the order the packets were written.
+// Bundles only remember where their run starts. If a lot of reliables go out before a packet is
+// acked, its run gets written over and those reliables are confirmed by a later packet instead.
+class AckReliableRing
+{
+	//-------------------------------------------------------------------------------------------------
+	// Static Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	static size_t const CAPACITY = 4096; //Power of two
+
+	//-------------------------------------------------------------------------------------------------
+	// Members
+	//-------------------------------------------------------------------------------------------------
+private:
+	uint16_t m_reliableIDs[CAPACITY];
+	uint32_t m_nextIndex; //Only ever counts up, wrapping is fine
+
+	//-------------------------------------------------------------------------------------------------
+	// Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	AckReliableRing();
+
+	uint32_t Push(uint16_t reliableID);
+
+	uint16_t Get(uint32_t index) const;
+	bool IsValid(uint32_t firstIndex) const;
+};
 
 
 //-------------------------------------------------------------------------------------------------
@@ -13,16 +55,19 @@ class AckBundle
 	//-------------------------------------------------------------------------------------------------
 public:
 	static uint16_t const INVALID_ACK_ID = 65535;
-	static size_t const MAX_RELIABLES_PER_PACKET = 256;
+	static size_t const MAX_RECEIPTS_PER_PACKET = 8;
 
 	//-------------------------------------------------------------------------------------------------
 	// Members
 	//-------------------------------------------------------------------------------------------------
 public:
 	uint16_t m_ackID;
-	uint16_t m_attachedReliables[MAX_RELIABLES_PER_PACKET];
-	size_t m_reliableMessageCount;
+	uint16_t m_reliableMessageCount;
+	uint32_t m_firstReliable; //Index into the connection's AckReliableRing
+	AckReceipt m_receipts[MAX_RECEIPTS_PER_PACKET]; //Systems that want to know when their message arrived
+	size_t m_receiptCount;
 	double m_sentTimeStamp;
+	size_t m_sentBytes;
 	bool m_confirmReceived;
 
 	//-------------------------------------------------------------------------------------------------
@@ -32,5 +77,6 @@ public:
 	AckBundle();
 	AckBundle(uint16_t id);
 
-	void AddReliableID(uint16_t reliableID);
+	void AddReliableID(AckReliableRing * ring, uint16_t reliableID);
+	bool AddReceipt(unsigned char messageType, uint16_t receiptID);
 };
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Engine/Core/EngineCommon.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+class BitPacker;
+class NetInputCommand;
+
+
+//-------------------------------------------------------------------------------------------------
+// Anything a client simulates ahead of the host with its own inputs (usually the player's avatar).
+// ApplyInput has to be deterministic given the same state and input, the host and the client both
+// run it and the client runs it again for every input the host hasn't applied yet when a correction
+// comes in. The predicted state is everything ApplyInput reads or changes.
+class INetPredictedObject
+{
+	//-------------------------------------------------------------------------------------------------
+	// Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	virtual ~INetPredictedObject() {}
+
+	virtual void ApplyInput(NetInputCommand const & input) = 0;
+	virtual void WritePredictedState(BitPacker * writer) const = 0;
+	virtual void ReadPredictedState(BitPacker * reader) = 0;
+
+	//Client only, after a correction was read and the unacked inputs were replayed on top of it.
+	//Good place to smooth out the visual difference instead of snapping.
+	virtual void OnReconciled(uint16_t /*replayedInputCount*/) {}
+};
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Engine/Core/EngineCommon.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+class BitPacker;
+class Vector2f;
+
+
+//-------------------------------------------------------------------------------------------------
+// Anything kept in sync by the NetReplicator. Fields are written and read one at a time so the
+// replicator can tell which ones changed and only send those. Keep each field small (packed with
+// the BitPacker helpers), and write the same number of bits for a field every time.
+class INetworkedObject
+{
+	//-------------------------------------------------------------------------------------------------
+	// Static Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	static uint16_t const INVALID_NETWORK_ID = 65535;
+	static uint8_t const MAX_FIELDS = 16;
+	static size_t const MAX_FIELD_SIZE = 16; //bytes per field once packed
+
+	//-------------------------------------------------------------------------------------------------
+	// Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	uint16_t m_networkID; //Assigned by the NetReplicator
+
+	//-------------------------------------------------------------------------------------------------
+	// Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	INetworkedObject()
+		: m_networkID(INVALID_NETWORK_ID)
+	{
+		//Nothing
+	}
+	virtual ~INetworkedObject() {}
+
+	virtual byte_t GetNetworkType() const = 0;
+	virtual uint8_t GetReplicatedFieldCount() const = 0;
+	virtual void WriteReplicatedField(uint8_t fieldIndex, BitPacker * writer) const = 0;
+	virtual void ReadReplicatedField(uint8_t fieldIndex, BitPacker * reader) = 0;
+
+	//Interest management: objects without a position are relevant to everyone, higher priority gets sent sooner
+	virtual bool GetNetworkPosition(Vector2f *) const { return false; }
+	virtual float GetNetworkPriority() const { return 1.f; }
+
+	//Client only, once per new snapshot after its fields were read (even if none changed), with the
+	//host time it was captured at. Push the state into a NetInterpolationBuffer here to smooth it out.
+	virtual void OnSnapshotReceived(double /*hostTime*/) {}
+};
\ No newline at end of file
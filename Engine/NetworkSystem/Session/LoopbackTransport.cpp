@@ -0,0 +1,181 @@
+#include "Engine/NetworkSystem/Session/LoopbackTransport.hpp"
+
+#include <cstring>
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC CriticalSection LoopbackTransport::s_bindLock;
+STATIC std::map<uint16_t, LoopbackTransport*> LoopbackTransport::s_boundTransports;
+
+
+//-------------------------------------------------------------------------------------------------
+LoopbackTransport::LoopbackTransport()
+	: m_address()
+	, m_isBound(false)
+	, m_inboxLock()
+	, m_inbox()
+	, m_inboxHead(0)
+	, m_inboxCount(0)
+	, m_sentCount(0)
+	, m_sentBytes(0)
+	, m_receivedCount(0)
+	, m_receivedBytes(0)
+	, m_droppedCount(0)
+{
+	//Nothing
+}
+
+
+//-------------------------------------------------------------------------------------------------
+LoopbackTransport::~LoopbackTransport()
+{
+	Unbind();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Address is ignored, takes the first free port in the range
+void LoopbackTransport::Bind(char const * /*addr*/, size_t port, size_t range)
+{
+	if(m_isBound)
+	{
+		return;
+	}
+
+	s_bindLock.Lock();
+	for(size_t testPort = port; testPort < port + range; ++testPort)
+	{
+		uint16_t shortPort = (uint16_t)testPort;
+		if(s_boundTransports.find(shortPort) == s_boundTransports.end())
+		{
+			memset(&m_address, 0, sizeof(m_address));
+			m_address.sin_family = AF_INET;
+			m_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			m_address.sin_port = htons(shortPort);
+
+			m_inbox.resize(INBOX_SIZE);
+			m_inboxHead = 0;
+			m_inboxCount = 0;
+			m_isBound = true;
+			s_boundTransports[shortPort] = this;
+			break;
+		}
+	}
+	s_bindLock.Unlock();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void LoopbackTransport::Unbind()
+{
+	if(!m_isBound)
+	{
+		return;
+	}
+
+	//Once we're out of the map, nobody can be in the middle of sending to us
+	s_bindLock.Lock();
+	s_boundTransports.erase(ntohs(m_address.sin_port));
+	m_isBound = false;
+	s_bindLock.Unlock();
+
+	m_inboxLock.Lock();
+	m_inboxHead = 0;
+	m_inboxCount = 0;
+	m_inbox.clear();
+	m_inbox.shrink_to_fit();
+	m_inboxLock.Unlock();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool LoopbackTransport::IsConnected() const
+{
+	return m_isBound;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+char const * LoopbackTransport::GetAddressString() const
+{
+	return StringFromSockAddr(&m_address);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+sockaddr_in const & LoopbackTransport::GetAddress() const
+{
+	return m_address;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Like UDP, sending to nobody still "sends"
+// Runs on the network thread, m_isBound is only checked under s_bindLock since Bind/Unbind change it there
+size_t LoopbackTransport::Send(sockaddr_in addr, byte_t const * data, size_t dataSize) const
+{
+	if(dataSize > NetPacket::MAX_SIZE)
+	{
+		return 0;
+	}
+
+	s_bindLock.Lock();
+	if(!m_isBound)
+	{
+		s_bindLock.Unlock();
+		return 0;
+	}
+
+	auto foundTransport = s_boundTransports.find(ntohs(addr.sin_port));
+	if(foundTransport != s_boundTransports.end())
+	{
+		foundTransport->second->Deliver(m_address, data, dataSize);
+	}
+	s_bindLock.Unlock();
+
+	++m_sentCount;
+	m_sentBytes += dataSize;
+	return dataSize;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+size_t LoopbackTransport::Recv(sockaddr_in * out_addr, byte_t * data, size_t maxSize)
+{
+	size_t read = 0;
+	m_inboxLock.Lock();
+	if(m_inboxCount > 0)
+	{
+		LoopbackDatagram const & datagram = m_inbox[m_inboxHead];
+		read = datagram.size < maxSize ? datagram.size : maxSize;
+		memcpy(data, datagram.data, read);
+		*out_addr = datagram.fromAddress;
+		m_inboxHead = (m_inboxHead + 1) % INBOX_SIZE;
+		--m_inboxCount;
+		++m_receivedCount;
+		m_receivedBytes += read;
+	}
+	m_inboxLock.Unlock();
+	return read;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Called with s_bindLock held, so we can't be unbound part way through
+void LoopbackTransport::Deliver(sockaddr_in const & fromAddress, byte_t const * data, size_t dataSize)
+{
+	m_inboxLock.Lock();
+	if(m_inboxCount < INBOX_SIZE)
+	{
+		LoopbackDatagram & datagram = m_inbox[(m_inboxHead + m_inboxCount) % INBOX_SIZE];
+		datagram.fromAddress = fromAddress;
+		datagram.size = dataSize;
+		memcpy(datagram.data, data, dataSize);
+		++m_inboxCount;
+	}
+	else
+	{
+		++m_droppedCount;
+	}
+	m_inboxLock.Unlock();
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include "Engine/NetworkSystem/UDPIP/INetTransport.hpp"
+#include "Engine/NetworkSystem/Session/NetPacket.hpp"
+#include "Engine/Threads/CriticalSection.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+class LoopbackDatagram
+{
+public:
+	sockaddr_in fromAddress;
+	size_t size;
+	byte_t data[NetPacket::MAX_SIZE];
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// In memory stand-in for a UDP socket, so a bunch of NetSessions can talk to each other in one
+// process without touching the OS. Everything binds to 127.0.0.1 and only the port is used to
+// find who a packet is for. Sending copies straight into the target's inbox, a full inbox drops
+// the packet just like a full socket buffer would.
+class LoopbackTransport : public INetTransport
+{
+	//-------------------------------------------------------------------------------------------------
+	// Static Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	static size_t const INBOX_SIZE = 256;
+
+private:
+	static CriticalSection s_bindLock;
+	static std::map<uint16_t, LoopbackTransport*> s_boundTransports;
+
+	//-------------------------------------------------------------------------------------------------
+	// Members
+	//-------------------------------------------------------------------------------------------------
+private:
+	sockaddr_in m_address;
+	bool m_isBound;
+	mutable CriticalSection m_inboxLock;
+	std::vector<LoopbackDatagram> m_inbox;
+	size_t m_inboxHead;
+	size_t m_inboxCount;
+
+public:
+	//debugging information
+	mutable size_t m_sentCount;
+	mutable size_t m_sentBytes;
+	size_t m_receivedCount;
+	size_t m_receivedBytes;
+	size_t m_droppedCount; //Our inbox was full
+
+	//-------------------------------------------------------------------------------------------------
+	// Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	LoopbackTransport();
+	virtual ~LoopbackTransport() override;
+
+	virtual void Bind(char const * addr, size_t port, size_t range) override;
+	virtual void Unbind() override;
+
+	virtual bool IsConnected() const override;
+	virtual char const * GetAddressString() const override;
+	virtual sockaddr_in const & GetAddress() const override;
+
+	virtual size_t Send(sockaddr_in addr, byte_t const * data, size_t dataSize) const override;
+	virtual size_t Recv(sockaddr_in * out_addr, byte_t * data, size_t maxSize /*max you can read into data*/) override;
+
+private:
+	void Deliver(sockaddr_in const & fromAddress, byte_t const * data, size_t dataSize);
+};
\ No newline at end of file
@@ -0,0 +1,421 @@
+#include "Engine/NetworkSystem/Session/NetCapture.hpp"
+
+#include <cstring>
+#include "Engine/Core/Time.hpp"
+#include "Engine/DebugSystem/BConsoleSystem.hpp"
+#include "Engine/DebugSystem/Command.hpp"
+#include "Engine/NetworkSystem/Session/LoopbackTransport.hpp"
+#include "Engine/NetworkSystem/Session/NetCompression.hpp"
+#include "Engine/NetworkSystem/Session/NetConnectionTable.hpp"
+#include "Engine/NetworkSystem/Session/NetPacket.hpp"
+#include "Engine/NetworkSystem/Session/NetSession.hpp"
+#include "Engine/Utils/FileUtils.hpp"
+#include "Engine/Utils/StringUtils.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+// Plays a capture into a fresh hosting session every iteration, with a connection for everyone the
+// capture heard from. Only the core messages are registered, games that want their own messages in
+// the profile should drive NetReplay with their session.
+void NetReplayBenchCommand(Command const & command)
+{
+	std::string filename = command.GetArg(0, "Data/Logs/NetCapture.bncp");
+	int iterations = command.GetArg(1, 10);
+	if(iterations <= 0)
+	{
+		iterations = 1;
+	}
+
+	NetReplay replay;
+	if(!replay.Load(filename.c_str()))
+	{
+		BConsoleSystem::AddLog(Stringf("Could not load capture %s", filename.c_str()), BConsoleSystem::BAD);
+		return;
+	}
+
+	uint64_t playOpCount = 0;
+	size_t connectionCount = 0;
+	size_t rejectedCount = 0;
+	for(int iteration = 0; iteration < iterations; ++iteration)
+	{
+		//Set up outside the timing, every iteration starts with fresh reliable and sequence state
+		LoopbackTransport transport;
+		NetSession session(0U, false);
+		session.SetTransport(&transport);
+		if(!session.Start(NetReplay::BENCH_PORT))
+		{
+			BConsoleSystem::AddLog("Could not start a session to replay into", BConsoleSystem::BAD);
+			return;
+		}
+		session.Host("ReplayHost");
+		connectionCount = replay.AddConnections(&session);
+
+		uint64_t startOpCount = Time::GetCurrentOpCount();
+		replay.Start(0.0, 0.f);
+		replay.PlayAll(&session);
+		playOpCount += Time::GetCurrentOpCount() - startOpCount;
+
+		rejectedCount += (size_t)session.m_invalidMessageCount;
+
+		//Stop() only works once disconnected
+		if(session.GetState() == eNetSessionState_CONNECTED)
+		{
+			session.Leave();
+		}
+		session.Stop();
+	}
+	double seconds = Time::GetTimeFromOpCount(playOpCount);
+
+	size_t packetCount = replay.m_playedCount;
+	BConsoleSystem::AddLog(Stringf("Replayed %u packets (%u bytes) from a %.1fs capture into %u connections, %d times", replay.GetReceivedCount(), replay.m_playedBytes / iterations, replay.GetDuration(), connectionCount, iterations), BConsoleSystem::GOOD);
+	if(packetCount > 0 && seconds > 0.0)
+	{
+		BConsoleSystem::AddLog(Stringf("  %.2fus per packet, %.0f packets/s, %.1fMB/s, %u invalid packets", seconds * 1000000.0 / (double)packetCount, (double)packetCount / seconds, (double)replay.m_playedBytes / seconds / (1024.0 * 1024.0), replay.m_invalidPacketCount / iterations), BConsoleSystem::INFO);
+	}
+	BConsoleSystem::AddLog(Stringf("  %u messages rejected (game messages aren't registered, so they count too)", rejectedCount / iterations), rejectedCount > 0 ? BConsoleSystem::BAD : BConsoleSystem::INFO);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetCapture::NetCapture()
+	: m_file(nullptr)
+	, m_isCapturing(false)
+	, m_startTime(0.0)
+	, m_recordCount(0)
+	, m_recordedBytes(0)
+{
+	//Nothing
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetCapture::~NetCapture()
+{
+	Stop();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Overwrites the file if it's there
+bool NetCapture::Start(char const * filename)
+{
+	Stop();
+
+	m_lock.Lock();
+	if(fopen_s(&m_file, filename, "wb") != 0)
+	{
+		m_file = nullptr;
+		m_lock.Unlock();
+		return false;
+	}
+
+	m_startTime = Time::GetCurrentTimeSeconds();
+	m_recordCount = 0;
+	m_recordedBytes = 0;
+	m_buffer.clear();
+	m_buffer.reserve(FLUSH_SIZE + RECORD_HEADER_SIZE + 0xFFFF);
+
+	uint32_t magic = FILE_MAGIC;
+	uint16_t version = FILE_VERSION;
+	fwrite(&magic, sizeof(magic), 1, m_file);
+	fwrite(&version, sizeof(version), 1, m_file);
+	fwrite(&m_startTime, sizeof(m_startTime), 1, m_file);
+
+	m_isCapturing = true;
+	m_lock.Unlock();
+	return true;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetCapture::Stop()
+{
+	m_lock.Lock();
+	m_isCapturing = false;
+	if(m_file)
+	{
+		Flush();
+		fclose(m_file);
+		m_file = nullptr;
+	}
+	m_lock.Unlock();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetCapture::Record(eNetCaptureDirection direction, sockaddr_in const & address, byte_t const * data, size_t dataSize, double time)
+{
+	if(!m_isCapturing)
+	{
+		return;
+	}
+
+	m_lock.Lock();
+	if(m_file)
+	{
+		byte_t header[RECORD_HEADER_SIZE];
+		byte_t * write = header;
+		double offsetTime = time - m_startTime;
+		uint32_t ip = address.sin_addr.s_addr;
+		uint16_t port = address.sin_port;
+		uint16_t size = (uint16_t)dataSize;
+		*write = (byte_t)direction;
+		write += sizeof(byte_t);
+		memcpy(write, &offsetTime, sizeof(offsetTime));
+		write += sizeof(offsetTime);
+		memcpy(write, &ip, sizeof(ip));
+		write += sizeof(ip);
+		memcpy(write, &port, sizeof(port));
+		write += sizeof(port);
+		memcpy(write, &size, sizeof(size));
+
+		m_buffer.insert(m_buffer.end(), header, header + RECORD_HEADER_SIZE);
+		m_buffer.insert(m_buffer.end(), data, data + size);
+		++m_recordCount;
+		m_recordedBytes += size;
+
+		if(m_buffer.size() >= FLUSH_SIZE)
+		{
+			Flush();
+		}
+	}
+	m_lock.Unlock();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool NetCapture::IsCapturing() const
+{
+	return m_isCapturing;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Lock is already held
+void NetCapture::Flush()
+{
+	if(!m_buffer.empty())
+	{
+		fwrite(&m_buffer[0], sizeof(byte_t), m_buffer.size(), m_file);
+		m_buffer.clear();
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetReplay::NetReplay()
+	: m_nextRecord(0)
+	, m_playbackStartTime(0.0)
+	, m_speed(1.f)
+	, m_playedCount(0)
+	, m_playedBytes(0)
+	, m_invalidPacketCount(0)
+{
+	//Nothing
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetReplay::~NetReplay()
+{
+	//Nothing
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Stops at the first record that got cut off, so a capture from a crashed process still loads
+bool NetReplay::Load(char const * filename)
+{
+	m_data.clear();
+	m_records.clear();
+	m_nextRecord = 0;
+	if(!LoadBinaryFileToBuffer(filename, m_data) || m_data.size() < NetCapture::HEADER_SIZE)
+	{
+		return false;
+	}
+
+	uint32_t magic;
+	uint16_t version;
+	memcpy(&magic, &m_data[0], sizeof(magic));
+	memcpy(&version, &m_data[sizeof(magic)], sizeof(version));
+	if(magic != NetCapture::FILE_MAGIC || version != NetCapture::FILE_VERSION)
+	{
+		return false;
+	}
+
+	size_t offset = NetCapture::HEADER_SIZE;
+	while(offset + NetCapture::RECORD_HEADER_SIZE <= m_data.size())
+	{
+		NetReplayRecord record;
+		byte_t const * read = &m_data[offset];
+		uint32_t ip;
+		uint16_t port;
+		uint16_t size;
+		record.direction = (eNetCaptureDirection)*read;
+		read += sizeof(byte_t);
+		memcpy(&record.time, read, sizeof(record.time));
+		read += sizeof(record.time);
+		memcpy(&ip, read, sizeof(ip));
+		read += sizeof(ip);
+		memcpy(&port, read, sizeof(port));
+		read += sizeof(port);
+		memcpy(&size, read, sizeof(size));
+
+		record.offset = offset + NetCapture::RECORD_HEADER_SIZE;
+		record.size = size;
+		if(record.offset + record.size > m_data.size())
+		{
+			break;
+		}
+
+		memset(&record.address, 0, sizeof(record.address));
+		record.address.sin_family = AF_INET;
+		record.address.sin_addr.s_addr = ip;
+		record.address.sin_port = port;
+		m_records.push_back(record);
+		offset = record.offset + record.size;
+	}
+	return true;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetReplay::Start(double currentTime, float speed /*= 1.f*/)
+{
+	m_nextRecord = 0;
+	m_playbackStartTime = currentTime;
+	m_speed = speed;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Plays everything that's due, returns how many packets went in
+size_t NetReplay::Update(NetSession * session, double currentTime)
+{
+	double captureTime = (currentTime - m_playbackStartTime) * (double)m_speed;
+	size_t played = 0;
+	while(m_nextRecord < m_records.size())
+	{
+		NetReplayRecord const & record = m_records[m_nextRecord];
+		if(m_speed > 0.f && record.time > captureTime)
+		{
+			break;
+		}
+
+		if(record.direction == eNetCaptureDirection_RECEIVED)
+		{
+			Play(session, record);
+			++played;
+		}
+		++m_nextRecord;
+	}
+	return played;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+size_t NetReplay::PlayAll(NetSession * session)
+{
+	float speed = m_speed;
+	m_speed = 0.f;
+	size_t played = Update(session, m_playbackStartTime);
+	m_speed = speed;
+	return played;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Makes a connection for every address the capture received from, at the index its packets were
+// sent from, so a capture that started after everyone joined still plays. Indices the session is
+// already using (its own) are skipped. Returns how many connections the session has besides itself.
+size_t NetReplay::AddConnections(NetSession * session) const
+{
+	for(size_t recordIndex = 0; recordIndex < m_records.size(); ++recordIndex)
+	{
+		NetReplayRecord const & record = m_records[recordIndex];
+		if(record.direction != eNetCaptureDirection_RECEIVED || record.size == 0)
+		{
+			continue;
+		}
+
+		//Connection index is the first byte, it's never compressed
+		byte_t index = m_data[record.offset];
+		std::string guid = StringFromSockAddr(&record.address);
+		if(index >= NetConnectionTable::MAX_CONNECTIONS || session->IsValidConnectionIndex(index) || session->IsDuplicateGUID(guid))
+		{
+			continue;
+		}
+
+		NetConnection * connection = session->CreateConnection(index, record.address, guid, guid);
+		if(connection)
+		{
+			session->Connect(connection);
+		}
+	}
+
+	size_t connectionCount = session->GetActiveConnections().size();
+	return connectionCount > 0 ? connectionCount - 1 : 0;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+std::vector<NetReplayRecord> const & NetReplay::GetRecords() const
+{
+	return m_records;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+double NetReplay::GetDuration() const
+{
+	if(m_records.empty())
+	{
+		return 0.0;
+	}
+	return m_records.back().time;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+size_t NetReplay::GetReceivedCount() const
+{
+	size_t receivedCount = 0;
+	for(size_t recordIndex = 0; recordIndex < m_records.size(); ++recordIndex)
+	{
+		if(m_records[recordIndex].direction == eNetCaptureDirection_RECEIVED)
+		{
+			++receivedCount;
+		}
+	}
+	return receivedCount;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool NetReplay::IsFinished() const
+{
+	return m_nextRecord >= m_records.size();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Same path PacketChannel::RecvPackets takes, minus the socket and the simulator
+void NetReplay::Play(NetSession * session, NetReplayRecord const & record)
+{
+	++m_playedCount;
+	m_playedBytes += record.size;
+
+	NetPacket packet;
+	packet.WriteForward(&m_data[record.offset], record.size);
+	packet.Rewind();
+	if(!NetCompression::DecompressPacket(&packet) || !session->IsValidPacket(packet, packet.GetSize()))
+	{
+		++m_invalidPacketCount;
+		return;
+	}
+
+	packet.m_senderInfo.session = session;
+	packet.m_senderInfo.fromAddress = record.address;
+	packet.m_senderInfo.receivedTime = m_playbackStartTime + record.time;
+	session->ProcessPacket(packet);
+}
\ No newline at end of file
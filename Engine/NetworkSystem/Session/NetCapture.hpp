@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <stdio.h>
+#include <vector>
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Threads/CriticalSection.hpp"
+#include "Engine/Utils/NetworkUtils.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+class Command;
+class NetSession;
+
+
+//-------------------------------------------------------------------------------------------------
+void NetReplayBenchCommand(Command const &);
+
+
+//-------------------------------------------------------------------------------------------------
+enum eNetCaptureDirection
+{
+	eNetCaptureDirection_RECEIVED,
+	eNetCaptureDirection_SENT,
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Records every datagram that goes through the transport, as it was on the wire (still compressed).
+// File is a small header followed by records of
+// [direction:1][seconds since start:8][ip:4][port:2][size:2][data:size]
+// Records are buffered and written out in big chunks so capturing stays cheap on the network thread.
+class NetCapture
+{
+	//-------------------------------------------------------------------------------------------------
+	// Static Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	static uint32_t const FILE_MAGIC = 0x50434E42; //"BNCP"
+	static uint16_t const FILE_VERSION = 1;
+	static size_t const HEADER_SIZE = sizeof(uint32_t) + sizeof(uint16_t) + sizeof(double);
+	static size_t const RECORD_HEADER_SIZE = sizeof(byte_t) + sizeof(double) + sizeof(uint32_t) + sizeof(uint16_t) * 2;
+	static size_t const FLUSH_SIZE = 64 * 1024;
+
+	//-------------------------------------------------------------------------------------------------
+	// Members
+	//-------------------------------------------------------------------------------------------------
+private:
+	FILE * m_file;
+	std::atomic<bool> m_isCapturing;
+	double m_startTime;
+	std::vector<byte_t> m_buffer;
+	CriticalSection m_lock; //Sends and receives can come from the network thread
+
+public:
+	//debugging information
+	size_t m_recordCount;
+	size_t m_recordedBytes;
+
+	//-------------------------------------------------------------------------------------------------
+	// Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	NetCapture();
+	~NetCapture();
+
+	bool Start(char const * filename);
+	void Stop();
+	void Record(eNetCaptureDirection direction, sockaddr_in const & address, byte_t const * data, size_t dataSize, double time);
+
+	bool IsCapturing() const;
+
+private:
+	void Flush();
+};
+
+
+//-------------------------------------------------------------------------------------------------
+class NetReplayRecord
+{
+public:
+	eNetCaptureDirection direction;
+	double time; //Seconds since the capture started
+	sockaddr_in address;
+	size_t offset; //Into the loaded file
+	size_t size;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Plays the received side of a capture back into a session, no sockets involved. Packets go through
+// the same decompress, validate, ProcessPacket path as the receive thread. Received times come from
+// the capture, so the same capture always plays back the same way no matter how fast it's fed.
+// Sent records are kept for tools but never played.
+class NetReplay
+{
+	//-------------------------------------------------------------------------------------------------
+	// Static Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	static uint16_t const BENCH_PORT = 32000; //Loopback only, never a real socket
+
+	//-------------------------------------------------------------------------------------------------
+	// Members
+	//-------------------------------------------------------------------------------------------------
+private:
+	std::vector<byte_t> m_data;
+	std::vector<NetReplayRecord> m_records;
+	size_t m_nextRecord;
+	double m_playbackStartTime;
+	float m_speed; //0 plays everything on the next update
+
+public:
+	//debugging information
+	size_t m_playedCount;
+	size_t m_playedBytes;
+	size_t m_invalidPacketCount;
+
+	//-------------------------------------------------------------------------------------------------
+	// Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	NetReplay();
+	~NetReplay();
+
+	bool Load(char const * filename);
+	void Start(double currentTime, float speed = 1.f);
+	size_t Update(NetSession * session, double currentTime);
+	size_t PlayAll(NetSession * session);
+	size_t AddConnections(NetSession * session) const;
+
+	std::vector<NetReplayRecord> const & GetRecords() const;
+	double GetDuration() const;
+	size_t GetReceivedCount() const;
+	bool IsFinished() const;
+
+private:
+	void Play(NetSession * session, NetReplayRecord const & record);
+};
\ No newline at end of file
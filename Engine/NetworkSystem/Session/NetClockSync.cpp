@@ -0,0 +1,178 @@
+#include "Engine/NetworkSystem/Session/NetClockSync.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC float const NetClockSync::FAST_PING_INTERVAL_SECONDS = 0.1f;
+STATIC float const NetClockSync::PING_INTERVAL_SECONDS = 1.f;
+STATIC double const NetClockSync::MAX_SLEW_RATE = 0.05;
+STATIC double const NetClockSync::SNAP_SECONDS = 0.25;
+
+
+//-------------------------------------------------------------------------------------------------
+static bool SampleRoundTripCompare(NetClockSample const & lhs, NetClockSample const & rhs)
+{
+	return lhs.roundTripTime < rhs.roundTripTime;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetClockSync::NetClockSync()
+{
+	Reset();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetClockSync::~NetClockSync()
+{
+	//Nothing
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetClockSync::AddSample(double sentTime, double hostReceivedTime, double hostSentTime, double receivedTime)
+{
+	double roundTripTime = (receivedTime - sentTime) - (hostSentTime - hostReceivedTime);
+	if(roundTripTime < 0.0 || hostSentTime < hostReceivedTime)
+	{
+		++m_rejectedCount;
+		return;
+	}
+
+	NetClockSample & sample = m_samples[m_nextSample];
+	sample.offset = ((hostReceivedTime - sentTime) + (hostSentTime - receivedTime)) * 0.5;
+	sample.roundTripTime = roundTripTime;
+	m_nextSample = (m_nextSample + 1) % SAMPLE_COUNT;
+	if(m_sampleCount < SAMPLE_COUNT)
+	{
+		++m_sampleCount;
+	}
+
+	//Average the fastest few, the rest are outliers
+	NetClockSample sorted[SAMPLE_COUNT];
+	std::copy(m_samples, m_samples + m_sampleCount, sorted);
+	size_t trustedCount = (m_sampleCount < TRUSTED_SAMPLE_COUNT) ? m_sampleCount : TRUSTED_SAMPLE_COUNT;
+	std::partial_sort(sorted, sorted + trustedCount, sorted + m_sampleCount, SampleRoundTripCompare);
+
+	double offsetSum = 0.0;
+	for(size_t sampleIndex = 0; sampleIndex < trustedCount; ++sampleIndex)
+	{
+		offsetSum += sorted[sampleIndex].offset;
+	}
+	m_targetOffset = offsetSum / (double)trustedCount;
+
+	if(!m_hasOffset)
+	{
+		m_hasOffset = true;
+		m_offset = m_targetOffset;
+		m_lastUpdateTime = receivedTime;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Once a frame
+void NetClockSync::Update(double currentTime)
+{
+	double deltaSeconds = currentTime - m_lastUpdateTime;
+	m_lastUpdateTime = currentTime;
+	if(!m_hasOffset)
+	{
+		return;
+	}
+
+	double error = m_targetOffset - m_offset;
+	if(fabs(error) > SNAP_SECONDS)
+	{
+		m_offset = m_targetOffset;
+		++m_snapCount;
+		return;
+	}
+
+	double maxStep = MAX_SLEW_RATE * deltaSeconds;
+	if(error > maxStep)
+	{
+		error = maxStep;
+	}
+	else if(error < -maxStep)
+	{
+		error = -maxStep;
+	}
+	m_offset += error;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// True when it's time to send another ping
+bool NetClockSync::UpdatePingTimer(double currentTime)
+{
+	if(currentTime < m_nextPingTime)
+	{
+		return false;
+	}
+
+	float interval = (m_sampleCount < SAMPLE_COUNT) ? FAST_PING_INTERVAL_SECONDS : PING_INTERVAL_SECONDS;
+	m_nextPingTime = currentTime + (double)interval;
+	return true;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetClockSync::Reset()
+{
+	m_nextSample = 0;
+	m_sampleCount = 0;
+	m_targetOffset = 0.0;
+	m_offset = 0.0;
+	m_lastUpdateTime = 0.0;
+	m_nextPingTime = 0.0;
+	m_hasOffset = false;
+	m_rejectedCount = 0;
+	m_snapCount = 0;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+double NetClockSync::GetHostTime(double localTime) const
+{
+	return localTime + m_offset;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+double NetClockSync::GetOffset() const
+{
+	return m_offset;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+double NetClockSync::GetRoundTripTime() const
+{
+	double best = 0.0;
+	for(size_t sampleIndex = 0; sampleIndex < m_sampleCount; ++sampleIndex)
+	{
+		if(sampleIndex == 0 || m_samples[sampleIndex].roundTripTime < best)
+		{
+			best = m_samples[sampleIndex].roundTripTime;
+		}
+	}
+	return best;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+size_t NetClockSync::GetSampleCount() const
+{
+	return m_sampleCount;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool NetClockSync::IsSynced() const
+{
+	return m_hasOffset;
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Engine/Core/EngineCommon.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+// One ping and its pong, NTP style: the client's send and receive times and the host's receive and
+// send times. Time the host held the ping doesn't count against the round trip.
+class NetClockSample
+{
+public:
+	double offset; //Host time - our time
+	double roundTripTime;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Client side estimate of the host's clock, from the PING/PONG core messages. Only the fastest
+// round trips in the window are trusted (slow ones were queued somewhere, and queueing is rarely
+// the same both ways). The answer is slewed toward, so host time doesn't jump while it's close.
+// Past SNAP_SECONDS off it snaps to the answer, which can move host time backwards.
+class NetClockSync
+{
+	//-------------------------------------------------------------------------------------------------
+	// Static Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	static size_t const SAMPLE_COUNT = 16;
+	static size_t const TRUSTED_SAMPLE_COUNT = 4; //Fastest round trips that get averaged
+	static float const FAST_PING_INTERVAL_SECONDS; //Until the window fills
+	static float const PING_INTERVAL_SECONDS;
+	static double const MAX_SLEW_RATE; //Fraction faster or slower than real time host time can run
+	static double const SNAP_SECONDS; //Further off than this and host time jumps instead
+
+	//-------------------------------------------------------------------------------------------------
+	// Members
+	//-------------------------------------------------------------------------------------------------
+private:
+	NetClockSample m_samples[SAMPLE_COUNT];
+	size_t m_nextSample;
+	size_t m_sampleCount;
+	double m_targetOffset;
+	double m_offset;
+	double m_lastUpdateTime;
+	double m_nextPingTime;
+	bool m_hasOffset;
+
+public:
+	//debugging information
+	size_t m_rejectedCount;
+	size_t m_snapCount;
+
+	//-------------------------------------------------------------------------------------------------
+	// Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	NetClockSync();
+	~NetClockSync();
+
+	void AddSample(double sentTime, double hostReceivedTime, double hostSentTime, double receivedTime);
+	void Update(double currentTime);
+	bool UpdatePingTimer(double currentTime);
+	void Reset();
+
+	double GetHostTime(double localTime) const;
+	double GetOffset() const;
+	double GetRoundTripTime() const;
+	size_t GetSampleCount() const;
+	bool IsSynced() const;
+};
\ No newline at end of file
@@ -0,0 +1,201 @@
+#include "Engine/NetworkSystem/Session/NetCompression.hpp"
+
+#include <cstring>
+#include "Engine/Core/Time.hpp"
+#include "Engine/DebugSystem/BConsoleSystem.hpp"
+#include "Engine/DebugSystem/Command.hpp"
+#include "Engine/Utils/CompressionUtils.hpp"
+#include "Engine/Utils/StringUtils.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC byte_t NetCompression::s_recordedPackets[RECORDED_PACKET_COUNT][NetPacket::MAX_SIZE];
+STATIC size_t NetCompression::s_recordedSizes[RECORDED_PACKET_COUNT] = {0};
+STATIC size_t NetCompression::s_recordedCount = 0;
+STATIC size_t NetCompression::s_nextRecordIndex = 0;
+STATIC std::atomic<uint64_t> NetCompression::s_packetsSent(0);
+STATIC std::atomic<uint64_t> NetCompression::s_packetsCompressed(0);
+STATIC std::atomic<uint64_t> NetCompression::s_rawBytesSent(0);
+STATIC std::atomic<uint64_t> NetCompression::s_wireBytesSent(0);
+STATIC std::atomic<uint64_t> NetCompression::s_compressOpCount(0);
+STATIC std::atomic<uint64_t> NetCompression::s_packetsDecompressed(0);
+STATIC std::atomic<uint64_t> NetCompression::s_decompressOpCount(0);
+
+
+//-------------------------------------------------------------------------------------------------
+void NetCompressionStatsCommand(Command const &)
+{
+	NetCompression::PrintStats();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetCompressionBenchCommand(Command const & command)
+{
+	int iterations = command.GetArg(0, 100);
+	if(iterations <= 0)
+	{
+		iterations = 1;
+	}
+	NetCompression::RunBenchmark((size_t)iterations);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Leaves the packet alone (and returns false) if compressing wouldn't save anything
+STATIC bool NetCompression::CompressPacket(NetPacket * packet)
+{
+	size_t packetSize = packet->GetSize();
+	if(packetSize <= COMPRESSED_OFFSET)
+	{
+		return false;
+	}
+
+	uint64_t startOpCount = Time::GetCurrentOpCount();
+	byte_t * buffer = packet->GetBuffer();
+	byte_t compressed[NetPacket::MAX_SIZE];
+	size_t rawSize = packetSize - COMPRESSED_OFFSET;
+	size_t compressedSize = CompressLZ(buffer + COMPRESSED_OFFSET, rawSize, compressed, rawSize - 1);
+	bool saved = compressedSize > 0;
+	if(saved)
+	{
+		memcpy(buffer + COMPRESSED_OFFSET, compressed, compressedSize);
+		buffer[1] |= NetPacket::COMPRESSED_PACKET_FLAG;
+		packet->SetBufferSize(COMPRESSED_OFFSET + compressedSize);
+		++s_packetsCompressed;
+	}
+	s_compressOpCount += Time::GetCurrentOpCount() - startOpCount;
+
+	++s_packetsSent;
+	s_rawBytesSent += packetSize;
+	s_wireBytesSent += packet->GetSize();
+	return saved;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Expands the packet in place, false means it was flagged compressed but didn't decode
+STATIC bool NetCompression::DecompressPacket(NetPacket * packet)
+{
+	size_t packetSize = packet->GetSize();
+	if(packetSize <= COMPRESSED_OFFSET)
+	{
+		return true;
+	}
+
+	byte_t * buffer = packet->GetBuffer();
+	if((buffer[1] & NetPacket::COMPRESSED_PACKET_FLAG) == 0)
+	{
+		return true;
+	}
+
+	uint64_t startOpCount = Time::GetCurrentOpCount();
+	byte_t decompressed[NetPacket::MAX_SIZE];
+	size_t decompressedSize = DecompressLZ(buffer + COMPRESSED_OFFSET, packetSize - COMPRESSED_OFFSET, decompressed, NetPacket::MAX_SIZE - COMPRESSED_OFFSET);
+	if(decompressedSize == 0)
+	{
+		return false;
+	}
+
+	memcpy(buffer + COMPRESSED_OFFSET, decompressed, decompressedSize);
+	buffer[1] &= ~NetPacket::COMPRESSED_PACKET_FLAG;
+	packet->Rewind();
+	packet->SetBufferSize(COMPRESSED_OFFSET + decompressedSize);
+	s_decompressOpCount += Time::GetCurrentOpCount() - startOpCount;
+	++s_packetsDecompressed;
+	return true;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Keeps a rolling window of outgoing traffic for RunBenchmark, recorded even with compression off
+STATIC void NetCompression::RecordPacket(NetPacket const & packet)
+{
+	size_t packetSize = packet.GetSize();
+	memcpy(s_recordedPackets[s_nextRecordIndex], packet.GetBuffer(), packetSize);
+	s_recordedSizes[s_nextRecordIndex] = packetSize;
+	s_nextRecordIndex = (s_nextRecordIndex + 1) % RECORDED_PACKET_COUNT;
+	if(s_recordedCount < RECORDED_PACKET_COUNT)
+	{
+		++s_recordedCount;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC void NetCompression::PrintStats()
+{
+	uint64_t packetsSent = s_packetsSent;
+	uint64_t rawBytes = s_rawBytesSent;
+	uint64_t wireBytes = s_wireBytesSent;
+	uint64_t packetsDecompressed = s_packetsDecompressed;
+	double saved = rawBytes > 0 ? 100.0 * (double)(rawBytes - wireBytes) / (double)rawBytes : 0.0;
+	double compressMicro = packetsSent > 0 ? Time::GetTimeFromOpCount(s_compressOpCount) * 1000000.0 / (double)packetsSent : 0.0;
+	double decompressMicro = packetsDecompressed > 0 ? Time::GetTimeFromOpCount(s_decompressOpCount) * 1000000.0 / (double)packetsDecompressed : 0.0;
+
+	BConsoleSystem::AddLog(Stringf("Sent: %llu packets (%llu compressed), %llu -> %llu bytes, %.1f%% saved", packetsSent, (uint64_t)s_packetsCompressed, rawBytes, wireBytes, saved), BConsoleSystem::INFO);
+	BConsoleSystem::AddLog(Stringf("Compress: %.2fus/packet, Decompress: %.2fus/packet (%llu packets)", compressMicro, decompressMicro, packetsDecompressed), BConsoleSystem::INFO);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Runs the recorded packets through the codec, ratio counts uncompressible packets as sent raw
+STATIC void NetCompression::RunBenchmark(size_t iterations)
+{
+	if(s_recordedCount == 0)
+	{
+		BConsoleSystem::AddLog("No packets recorded yet, start a session first", BConsoleSystem::BAD);
+		return;
+	}
+
+	byte_t compressed[NetPacket::MAX_SIZE];
+	byte_t decompressed[NetPacket::MAX_SIZE];
+	size_t rawBytes = 0;
+	size_t wireBytes = 0;
+	size_t compressedCount = 0;
+	uint64_t compressOpCount = 0;
+	uint64_t decompressOpCount = 0;
+	for(size_t recordIndex = 0; recordIndex < s_recordedCount; ++recordIndex)
+	{
+		byte_t const * source = s_recordedPackets[recordIndex] + COMPRESSED_OFFSET;
+		size_t sourceSize = s_recordedSizes[recordIndex] - COMPRESSED_OFFSET;
+		size_t compressedSize = 0;
+
+		uint64_t startOpCount = Time::GetCurrentOpCount();
+		for(size_t iteration = 0; iteration < iterations; ++iteration)
+		{
+			compressedSize = CompressLZ(source, sourceSize, compressed, sourceSize - 1);
+		}
+		compressOpCount += Time::GetCurrentOpCount() - startOpCount;
+
+		rawBytes += s_recordedSizes[recordIndex];
+		if(compressedSize == 0)
+		{
+			wireBytes += s_recordedSizes[recordIndex];
+			continue;
+		}
+		wireBytes += COMPRESSED_OFFSET + compressedSize;
+		++compressedCount;
+
+		size_t decompressedSize = 0;
+		startOpCount = Time::GetCurrentOpCount();
+		for(size_t iteration = 0; iteration < iterations; ++iteration)
+		{
+			decompressedSize = DecompressLZ(compressed, compressedSize, decompressed, NetPacket::MAX_SIZE);
+		}
+		decompressOpCount += Time::GetCurrentOpCount() - startOpCount;
+
+		if(decompressedSize != sourceSize || memcmp(decompressed, source, sourceSize) != 0)
+		{
+			BConsoleSystem::AddLog(Stringf("Round trip failed on recorded packet %u", recordIndex), BConsoleSystem::BAD);
+			return;
+		}
+	}
+
+	double totalRuns = (double)(s_recordedCount * iterations);
+	double compressMicro = Time::GetTimeFromOpCount(compressOpCount) * 1000000.0 / totalRuns;
+	double decompressMicro = compressedCount > 0 ? Time::GetTimeFromOpCount(decompressOpCount) * 1000000.0 / (double)(compressedCount * iterations) : 0.0;
+	double saved = 100.0 * (double)(rawBytes - wireBytes) / (double)rawBytes;
+	BConsoleSystem::AddLog(Stringf("%u packets (%u compressible), %u -> %u bytes, %.1f%% saved", s_recordedCount, compressedCount, rawBytes, wireBytes, saved), BConsoleSystem::GOOD);
+	BConsoleSystem::AddLog(Stringf("Compress: %.2fus/packet, Decompress: %.2fus/packet (%u iterations)", compressMicro, decompressMicro, iterations), BConsoleSystem::GOOD);
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/NetworkSystem/Session/NetPacket.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+class Command;
+
+
+//-------------------------------------------------------------------------------------------------
+void NetCompressionStatsCommand(Command const &);
+void NetCompressionBenchCommand(Command const &);
+
+
+//-------------------------------------------------------------------------------------------------
+// Compresses everything after the connection index and packet flags with CompressLZ, and only
+// keeps it if it came out smaller. The last few outgoing packets are kept (uncompressed) so the
+// codec can be benchmarked against real traffic with net_compression_bench.
+// Compress/Record on the game thread, Decompress wherever packets are received.
+class NetCompression
+{
+	//-------------------------------------------------------------------------------------------------
+	// Static Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	static size_t const COMPRESSED_OFFSET = 2; //fromConnIndex + flags are never compressed
+	static size_t const RECORDED_PACKET_COUNT = 128;
+
+private:
+	static byte_t s_recordedPackets[RECORDED_PACKET_COUNT][NetPacket::MAX_SIZE];
+	static size_t s_recordedSizes[RECORDED_PACKET_COUNT];
+	static size_t s_recordedCount;
+	static size_t s_nextRecordIndex;
+
+	static std::atomic<uint64_t> s_packetsSent;
+	static std::atomic<uint64_t> s_packetsCompressed;
+	static std::atomic<uint64_t> s_rawBytesSent;
+	static std::atomic<uint64_t> s_wireBytesSent;
+	static std::atomic<uint64_t> s_compressOpCount;
+	static std::atomic<uint64_t> s_packetsDecompressed;
+	static std::atomic<uint64_t> s_decompressOpCount;
+
+	//-------------------------------------------------------------------------------------------------
+	// Static Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	static bool CompressPacket(NetPacket * packet);
+	static bool DecompressPacket(NetPacket * packet);
+	static void RecordPacket(NetPacket const & packet);
+	static void PrintStats();
+	static void RunBenchmark(size_t iterations);
+};
\ No newline at end of file
@@ -0,0 +1,144 @@
+#include "Engine/NetworkSystem/Session/NetCongestionControl.hpp"
+
+#include "Engine/Core/Time.hpp"
+#include "Engine/NetworkSystem/Session/NetPacket.hpp"
+#include "Engine/Utils/MathUtils.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC float const NetCongestionControl::MIN_SEND_RATE = 4.f * 1024.f;
+STATIC float const NetCongestionControl::MAX_SEND_RATE = 1024.f * 1024.f;
+STATIC float const NetCongestionControl::START_SEND_RATE = 64.f * 1024.f;
+STATIC float const NetCongestionControl::ADDITIVE_INCREASE = 16.f * 1024.f;
+STATIC float const NetCongestionControl::MULTIPLICATIVE_DECREASE = 0.75f;
+STATIC float const NetCongestionControl::ESTIMATE_INTERVAL_SECONDS = 0.5f;
+STATIC float const NetCongestionControl::MAX_BURST_BYTES = (float)(NetPacket::MAX_SIZE * 5); //One full tick of MAX_PACKET_SEND_AMOUNT_PER_CONNECTION
+
+
+//-------------------------------------------------------------------------------------------------
+NetCongestionControl::NetCongestionControl()
+	: m_sendRate(START_SEND_RATE)
+	, m_tokens(MAX_BURST_BYTES)
+	, m_lastRefillTime(Time::TOTAL_SECONDS)
+	, m_lastDecreaseTime(Time::TOTAL_SECONDS)
+	, m_wasLimited(false)
+	, m_bandwidthEstimate(0.f)
+	, m_ackedBytes(0)
+	, m_estimateStartTime(Time::TOTAL_SECONDS)
+	, m_sentPacketCount(0)
+	, m_lostPacketCount(0)
+{
+	//Nothing
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// The bucket may go negative by one packet, so a packet is never too big to ever send
+bool NetCongestionControl::CanSendPacket()
+{
+	Refill();
+	if(m_tokens > 0.f)
+	{
+		return true;
+	}
+
+	m_wasLimited = true;
+	return false;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetCongestionControl::OnPacketSent(size_t packetBytes)
+{
+	m_tokens -= (float)packetBytes;
+	++m_sentPacketCount;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetCongestionControl::OnPacketAcked(size_t packetBytes)
+{
+	m_ackedBytes += packetBytes;
+
+	//Delivery rate over the last interval
+	float elapsed = Time::TOTAL_SECONDS - m_estimateStartTime;
+	if(elapsed >= ESTIMATE_INTERVAL_SECONDS)
+	{
+		float deliveryRate = (float)m_ackedBytes / elapsed;
+		if(m_bandwidthEstimate == 0.f)
+		{
+			m_bandwidthEstimate = deliveryRate;
+		}
+		else
+		{
+			m_bandwidthEstimate = 0.75f * m_bandwidthEstimate + 0.25f * deliveryRate;
+		}
+		m_ackedBytes = 0;
+		m_estimateStartTime = Time::TOTAL_SECONDS;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// A burst of losses is one congestion event, so only back off once per round trip
+void NetCongestionControl::OnPacketLost(double roundTripTime)
+{
+	++m_lostPacketCount;
+	if(Time::TOTAL_SECONDS - m_lastDecreaseTime < (float)roundTripTime)
+	{
+		return;
+	}
+
+	m_lastDecreaseTime = Time::TOTAL_SECONDS;
+	float decreased = m_sendRate * MULTIPLICATIVE_DECREASE;
+	m_sendRate = Clamp(Max(decreased, m_bandwidthEstimate), MIN_SEND_RATE, m_sendRate);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+float NetCongestionControl::GetSendRate() const
+{
+	return m_sendRate;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+float NetCongestionControl::GetBandwidthEstimate() const
+{
+	return m_bandwidthEstimate;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+float NetCongestionControl::GetLossRate() const
+{
+	if(m_sentPacketCount == 0)
+	{
+		return 0.f;
+	}
+	return (float)m_lostPacketCount / (float)m_sentPacketCount;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+float NetCongestionControl::GetTokens() const
+{
+	return m_tokens;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetCongestionControl::Refill()
+{
+	float deltaSeconds = Time::TOTAL_SECONDS - m_lastRefillTime;
+	m_lastRefillTime = Time::TOTAL_SECONDS;
+
+	//Only probe for more if we actually used what we had (otherwise an idle connection grows forever)
+	if(m_wasLimited)
+	{
+		m_sendRate = Min(m_sendRate + ADDITIVE_INCREASE * deltaSeconds, MAX_SEND_RATE);
+		m_wasLimited = false;
+	}
+
+	m_tokens = Min(m_tokens + m_sendRate * deltaSeconds, MAX_BURST_BYTES);
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Engine/Core/EngineCommon.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+// Token bucket pacer whose rate is adjusted AIMD style: grows while the bucket is what's holding us
+// back and nothing is being lost, backs off when packets fall off the ack window unconfirmed (at
+// most once per round trip). The delivery rate seen through acks is tracked as the bandwidth
+// estimate, and a back off never drops below what the link was actually delivering.
+class NetCongestionControl
+{
+	//-------------------------------------------------------------------------------------------------
+	// Static Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	static float const MIN_SEND_RATE; //bytes per second
+	static float const MAX_SEND_RATE;
+	static float const START_SEND_RATE;
+	static float const ADDITIVE_INCREASE; //bytes per second, per second
+	static float const MULTIPLICATIVE_DECREASE;
+	static float const ESTIMATE_INTERVAL_SECONDS;
+	static float const MAX_BURST_BYTES;
+
+	//-------------------------------------------------------------------------------------------------
+	// Members
+	//-------------------------------------------------------------------------------------------------
+private:
+	float m_sendRate;
+	float m_tokens;
+	float m_lastRefillTime;
+	float m_lastDecreaseTime;
+	bool m_wasLimited;
+
+	float m_bandwidthEstimate;
+	size_t m_ackedBytes;
+	float m_estimateStartTime;
+
+	size_t m_sentPacketCount;
+	size_t m_lostPacketCount;
+
+	//-------------------------------------------------------------------------------------------------
+	// Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	NetCongestionControl();
+
+	bool CanSendPacket();
+	void OnPacketSent(size_t packetBytes);
+	void OnPacketAcked(size_t packetBytes);
+	void OnPacketLost(double roundTripTime);
+
+	float GetSendRate() const;
+	float GetBandwidthEstimate() const;
+	float GetLossRate() const;
+	float GetTokens() const;
+
+private:
+	void Refill();
+};
\ No newline at end of file
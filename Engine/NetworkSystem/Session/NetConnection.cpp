@@ -1,15 +1,30 @@
 #include "Engine/NetworkSystem/Session/NetConnection.hpp"
 
+#include "Engine/Core/NamedProperties.hpp"
 #include "Engine/Core/Time.hpp"
 #include "Engine/DebugSystem/ErrorWarningAssert.hpp"
+#include "Engine/EventSystem/BEventSystem.hpp"
+#include "Engine/NetworkSystem/Session/NetCompression.hpp"
 #include "Engine/NetworkSystem/Session/NetMessage.hpp"
 #include "Engine/NetworkSystem/Session/NetSession.hpp"
+#include "Engine/NetworkSystem/Session/NetTelemetry.hpp"
 #include "Engine/NetworkSystem/Session/NetPacket.hpp"
 #include "Engine/Utils/MathUtils.hpp"
 
 
 //-------------------------------------------------------------------------------------------------
 STATIC double NetConnection::s_resendDelaySeconds = 0.2; //Default 200ms
+STATIC double const NetConnection::MIN_RESEND_DELAY_SECONDS = 0.05; //A few send ticks, for LAN
+STATIC double const NetConnection::MAX_RESEND_DELAY_SECONDS = 2.0;
+STATIC float NetConnection::s_fragmentBandwidthShare = 0.5f;
+STATIC float const NetConnection::MAX_FRAGMENT_BURST_BYTES = 8.f * 1024.f;
+
+
+//-------------------------------------------------------------------------------------------------
+bool ResendTimeCompare::operator()(NetMessage const * lhs, NetMessage const * rhs) const
+{
+	return lhs->m_resendTimeStamp > rhs->m_resendTimeStamp;
+}
 
 
 //-------------------------------------------------------------------------------------------------
@@ -21,6 +36,7 @@ NetConnection::NetConnection(unsigned char index, sockaddr_in const & address, s
 	, m_dropsCounted(0)
 	, m_receivedCounted(0)
 	, m_nextToSendAck(0)
+	, m_nextLossCheckAck(0)
 	, m_mostRecentReceivedAck(AckBundle::INVALID_ACK_ID)
 	, m_mostRecentReceivedAcksBitfield(0)
 	, m_nextToSendReliableID(0)
@@ -29,7 +45,18 @@ NetConnection::NetConnection(unsigned char index, sockaddr_in const & address, s
 	, m_nextUnreceivedReliableID(0)
 	, m_oldestUnreceivedReliableID(0)
 	, m_lastJoinRequestNuonce((uint32_t)-1)
+	, m_reliablesSentCount(0)
+	, m_reliablesResentCount(0)
 	, m_roundTripTime(s_resendDelaySeconds)
+	, m_roundTripVariance(0.0)
+	, m_resendDelay(s_resendDelaySeconds)
+	, m_hasRoundTripSample(false)
+	, m_congestion()
+	, m_telemetry(nullptr)
+	, m_nextFragmentTransferID(0)
+	, m_fragmentBudget(0.f)
+	, m_lastFragmentRefillTime(Time::TOTAL_SECONDS)
+	, m_fragmentAssembly()
 {
 	//Initialize confirmed reliable IDs
 	for(size_t confirmIndex = 0; confirmIndex < MAX_RELIABLE_RANGE; ++confirmIndex)
@@ -64,26 +91,22 @@ NetConnection::NetConnection(unsigned char index, sockaddr_in const & address, s
 //-------------------------------------------------------------------------------------------------
 NetConnection::~NetConnection()
 {
-	//Destroy all remaining unreliables
-	while(m_unsentUnreliableMessages.size() > 0)
-	{
-		NetMessage const * message = m_unsentUnreliableMessages.front();
-		delete message;
-		m_unsentUnreliableMessages.pop();
-	}
+	delete m_telemetry;
+	m_telemetry = nullptr;
 
-	//Destroy all remaining reliables
-	while(m_unsentReliableMessages.size() > 0)
+	//Destroy all remaining messages
+	m_unsentMessages.Clear();
+	while(m_sentReliableMessages.size() > 0)
 	{
-		NetMessage const * message = m_unsentReliableMessages.front();
+		NetMessage const * message = m_sentReliableMessages.top();
 		delete message;
-		m_unsentReliableMessages.pop();
+		m_sentReliableMessages.pop();
 	}
-	while(m_sentReliableMessages.size() > 0)
+	while(m_unsentFragments.size() > 0)
 	{
-		NetMessage const * message = m_sentReliableMessages.front();
+		NetMessage const * message = m_unsentFragments.front();
 		delete message;
-		m_sentReliableMessages.pop();
+		m_unsentFragments.pop();
 	}
 
 	//Destroy all messages in channels
@@ -121,15 +144,50 @@ void NetConnection::AddMessage(NetMessage & message)
 		message.m_sequenceID = GetSequenceID(def->sequenceChannelID);
 	}
 
-	//Check where it belongs
-	if(def->IsReliable())
+	//Queued by priority, unreliables only wait so long for room
+	NetMessage * queued = message.Copy();
+	queued->m_expireTime = (double)Time::TOTAL_SECONDS + (double)def->expireSeconds;
+	m_unsentMessages.Push(queued);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// For payloads bigger than a message (up to NetFragment::MAX_TRANSFER_SIZE). The receiver gets one
+// message of the given type holding the whole payload, once every fragment has arrived.
+bool NetConnection::AddFragmentedMessage(byte_t type, byte_t const * data, size_t dataSize)
+{
+	if(dataSize == 0 || dataSize > NetFragment::MAX_TRANSFER_SIZE)
 	{
-		m_unsentReliableMessages.push(message.Copy());
+		ASSERT_RECOVERABLE(false, "Fragmented message is empty or too large");
+		return false;
 	}
-	else
+
+	NetMessageDefinition const * def = m_session->GetDefinition(eNetMessageType_FRAGMENT);
+	NetFragmentHeader header;
+	header.transferID = m_nextFragmentTransferID;
+	header.fragmentCount = (uint16_t)NetFragment::GetFragmentCount(dataSize);
+	header.innerType = type;
+	header.totalSize = (uint32_t)dataSize;
+	++m_nextFragmentTransferID;
+
+	for(uint16_t fragmentIndex = 0; fragmentIndex < header.fragmentCount; ++fragmentIndex)
 	{
-		m_unsentUnreliableMessages.push(message.Copy());
+		size_t offset = fragmentIndex * NetFragment::DATA_SIZE;
+		size_t fragmentSize = Min(NetFragment::DATA_SIZE, dataSize - offset);
+		header.fragmentIndex = fragmentIndex;
+
+		NetMessage * fragment = new NetMessage(eNetMessageType_FRAGMENT);
+		header.Write(fragment);
+		fragment->WriteForward(data + offset, fragmentSize);
+		fragment->m_definition = def;
+		fragment->m_sequenceID = GetSequenceID(def->sequenceChannelID);
+		if(m_session->GetSelf())
+		{
+			fragment->m_senderIndex = m_session->GetSelf()->GetIndex();
+		}
+		m_unsentFragments.push(fragment);
 	}
+	return true;
 }
 
 
@@ -173,6 +231,15 @@ void NetConnection::SendPacket()
 		return;
 	}
 
+#if NET_TELEMETRY
+	//Pick up (or drop) telemetry when it gets turned on or off
+	if(NetTelemetry::IsEnabled() != (m_telemetry != nullptr))
+	{
+		delete m_telemetry;
+		m_telemetry = NetTelemetry::IsEnabled() ? new NetConnectionTelemetry() : nullptr;
+	}
+#endif // NET_TELEMETRY
+
 	//Heartbeat is a packet with no messages
 	bool heartbeat = IsTimeForHeartbeat();
 
@@ -185,30 +252,43 @@ void NetConnection::SendPacket()
 			return;
 		}
 		//If there is nothing to send, don't continue
-		else if(m_unsentUnreliableMessages.size() == 0 &&
-			m_unsentReliableMessages.size() == 0 &&
-			m_sentReliableMessages.size() == 0)
+		else if(m_unsentMessages.IsEmpty() &&
+			m_sentReliableMessages.size() == 0 &&
+			m_unsentFragments.size() == 0)
 		{
 
 			return;
 		}
 	}
 
+	//Large transfers only get their share of the send rate, so gameplay traffic always has room
+	float currentTime = Time::TOTAL_SECONDS;
+	m_fragmentBudget += m_congestion.GetSendRate() * s_fragmentBandwidthShare * (currentTime - m_lastFragmentRefillTime);
+	m_fragmentBudget = Min(m_fragmentBudget, MAX_FRAGMENT_BURST_BYTES);
+	m_lastFragmentRefillTime = currentTime;
+
 	//Keep sending packets until we have no more data to send, up to MAX_PACKET_SEND_AMOUNT_PER_CONNECTION
+	//or until the congestion control says the link has had enough (heartbeats always go)
 	m_lastOutgoingPackageCount = 0;
 	m_lastOutgoingMessageCount = 0;
 	m_lastOutgoingByteCountPacketHeader = 0;
 	m_lastOutgoingByteCountMessages = 0;
 	for(int numberOfPacketsSent = 0; numberOfPacketsSent < NetSession::MAX_PACKET_SEND_AMOUNT_PER_CONNECTION; ++numberOfPacketsSent)
 	{
+		if(!heartbeat && !m_congestion.CanSendPacket())
+		{
+			break;
+		}
+
 		//Setup packet Header
 		PacketHeader header;
 		header.fromConnIndex = m_connectionInfo.m_index;
+		header.flags = 0;
 		header.packetAck = GetNextAck();
 		header.mostRecentReceivedAck = m_mostRecentReceivedAck;
 		header.previousReceivedAcksBitfield = m_mostRecentReceivedAcksBitfield;
 		AckBundle bundle(header.packetAck);
-		NetSession::m_NetworkTrafficActivity.Printf("Sending Packet (%u) to Connection %u", header.packetAck, m_connectionInfo.m_index);
+		NetSession::m_NetworkTrafficActivity.Printf("Sending Packet (%u) to Connection %u (rate=%.1fKB/s) (estimate=%.1fKB/s) (loss=%.1f%%)", header.packetAck, m_connectionInfo.m_index, m_congestion.GetSendRate() / 1024.f, m_congestion.GetBandwidthEstimate() / 1024.f, m_congestion.GetLossRate() * 100.f);
 
 		//Create packet
 		NetPacket packet;
@@ -238,9 +318,9 @@ void NetConnection::SendPacket()
 			size_t totalBytesWritten = 0;
 			count += WriteSentReliables(&packet, &bundle, &bytesWritten);
 			totalBytesWritten += bytesWritten;
-			count += WriteUnsentReliables(&packet, &bundle, &bytesWritten);
+			count += WriteUnsentMessages(&packet, &bundle, count, &bytesWritten);
 			totalBytesWritten += bytesWritten;
-			count += WriteUnsentUnreliables(&packet, &bytesWritten);
+			count += WriteUnsentFragments(&packet, &bundle, count, &bytesWritten);
 			totalBytesWritten += bytesWritten;
 
 			//We have no more messages to send, but we will send at least one to keep the connection
@@ -259,24 +339,42 @@ void NetConnection::SendPacket()
 
 			//Update message count
 			packet.WriteAt<uint8_t>(numMessagesBookmark, (uint8_t)count);
+
+			//Only once both sides have agreed on a version (never for connectionless sends)
+			NetCompression::RecordPacket(packet);
+			if(m_connectionInfo.m_index != NetSession::INVALID_INDEX && m_session->ShouldCompressPackets())
+			{
+				NetCompression::CompressPacket(&packet);
+			}
 			m_session->SendPacket(m_connectionInfo.m_address, packet.GetBuffer(), packet.GetSize());
+			bundle.m_sentBytes = packet.GetSize();
+			m_congestion.OnPacketSent(packet.GetSize());
+		}
+
+#if NET_TELEMETRY
+		if(m_telemetry)
+		{
+			m_telemetry->OnPacketSent(m_unsentMessages.GetReliableCount(), m_sentReliableMessages.size());
 		}
+#endif // NET_TELEMETRY
 		AddBundle(bundle);
 	}
 
-	CleanUpRemainingUnreliables();
+	CleanUpExpiredUnreliables();
 }
 
 
 //-------------------------------------------------------------------------------------------------
+// Goes first, so it only has to stop at the packet's message count byte (MAX_MESSAGES_PER_PACKET)
 size_t NetConnection::WriteSentReliables(NetPacket * packet, AckBundle * bundle, size_t * out_bytesWritten)
 {
 	//Keep track of how many we are writing
 	size_t messageCount = 0;
 	*out_bytesWritten = 0;
-	while(!m_sentReliableMessages.empty())
+	while(!m_sentReliableMessages.empty() && messageCount < NetSendQueue::MAX_MESSAGES_PER_PACKET)
 	{
-		NetMessage * message = m_sentReliableMessages.front();
+		//Soonest resend is always on top
+		NetMessage * message = m_sentReliableMessages.top();
 
 		//Delete confirmed reliables
 		if(IsReliableIDConfirmed(message->m_reliableID))
@@ -295,8 +393,21 @@ size_t NetConnection::WriteSentReliables(NetPacket * packet, AckBundle * bundle,
 				*out_bytesWritten += message->GetTotalWrittenMessageSize();
 
 				m_sentReliableMessages.pop();
-				bundle->AddReliableID(message->m_reliableID);
+				bundle->AddReliableID(&m_reliableRing, message->m_reliableID);
+				AddReceipt(bundle, message);
 				message->m_sentTimeStamp = Time::TOTAL_SECONDS;
+				++m_reliablesResentCount;
+#if NET_TELEMETRY
+				if(m_telemetry)
+				{
+					m_telemetry->OnReliableResent(message->m_type, message->GetTotalWrittenMessageSize());
+				}
+#endif // NET_TELEMETRY
+				if(message->m_resendCount < MAX_RESEND_BACKOFF)
+				{
+					++message->m_resendCount;
+				}
+				ScheduleResend(message);
 				m_sentReliableMessages.push(message);
 			}
 			else
@@ -306,7 +417,7 @@ size_t NetConnection::WriteSentReliables(NetPacket * packet, AckBundle * bundle,
 			}
 		}
 
-		//If there are no more old reliables, return
+		//If the soonest one isn't due, none of them are
 		else
 		{
 			break;
@@ -318,85 +429,128 @@ size_t NetConnection::WriteSentReliables(NetPacket * packet, AckBundle * bundle,
 
 
 //-------------------------------------------------------------------------------------------------
-size_t NetConnection::WriteUnsentReliables(NetPacket * packet, AckBundle * bundle, size_t * out_bytesWritten)
+// Everything that fits, highest priority first (resends already went, they're holding up the reliable
+// window). Expired unreliables are dropped without being written.
+size_t NetConnection::WriteUnsentMessages(NetPacket * packet, AckBundle * bundle, size_t alreadyWrittenCount, size_t * out_bytesWritten)
 {
-	//Keep track of how many we are writing
-	uint8_t messageCount = 0;
 	*out_bytesWritten = 0;
-	while(!m_unsentReliableMessages.empty() && CanSendNewReliables())
+	if(m_unsentMessages.IsEmpty())
 	{
-		NetMessage * message = m_unsentReliableMessages.front();
+		return 0;
+	}
 
-		if(packet->CanWriteMessage(message))
+	m_selectedMessages.clear();
+	size_t messagesFree = NetSendQueue::MAX_MESSAGES_PER_PACKET - Min(alreadyWrittenCount, NetSendQueue::MAX_MESSAGES_PER_PACKET);
+	size_t messageCount = m_unsentMessages.SelectForPacket(packet->GetWritableBytesLeft(), messagesFree, GetFreeReliableCount(), Time::TOTAL_SECONDS, &m_selectedMessages);
+	for(size_t selectedIndex = 0; selectedIndex < messageCount; ++selectedIndex)
+	{
+		NetMessage * message = m_selectedMessages[selectedIndex];
+		*out_bytesWritten += message->GetTotalWrittenMessageSize();
+		if(message->m_definition->IsReliable())
 		{
-			++messageCount;
-			*out_bytesWritten += message->GetTotalWrittenMessageSize();
-
-			//Assign next ID
-			message->m_reliableID = GetNextReliableID();
-			bundle->AddReliableID(message->m_reliableID);
-			packet->WriteMessage(message);
-
-			//Remove from unsent
-			m_unsentReliableMessages.pop();
-
-			//Add to sent
-			message->m_sentTimeStamp = Time::TOTAL_SECONDS;
-			m_sentReliableMessages.push(message);
+			WriteNewReliable(packet, bundle, message);
+			continue;
 		}
-		else
+
+		packet->WriteMessage(message);
+		AddReceipt(bundle, message);
+#if NET_TELEMETRY
+		if(m_telemetry)
 		{
-			break;
+			m_telemetry->OnMessageSent(message->m_type, message->GetTotalWrittenMessageSize());
 		}
+#endif // NET_TELEMETRY
+		delete message;
 	}
+	m_selectedMessages.clear();
 	return messageCount;
 }
 
 
 //-------------------------------------------------------------------------------------------------
-size_t NetConnection::WriteUnsentUnreliables(NetPacket * packet, size_t * out_bytesWritten)
+// Goes last so fragments only fill whatever room is left in the packet
+size_t NetConnection::WriteUnsentFragments(NetPacket * packet, AckBundle * bundle, size_t alreadyWrittenCount, size_t * out_bytesWritten)
 {
-	//Keep track of how many we are writing
 	size_t messageCount = 0;
+	size_t messagesFree = NetSendQueue::MAX_MESSAGES_PER_PACKET - Min(alreadyWrittenCount, NetSendQueue::MAX_MESSAGES_PER_PACKET);
 	*out_bytesWritten = 0;
-	while(m_unsentUnreliableMessages.size() > 0)
+	while(!m_unsentFragments.empty() && messageCount < messagesFree && m_fragmentBudget > 0.f && CanSendNewFragments())
 	{
-		//Get Message and Definition
-		NetMessage const * message = m_unsentUnreliableMessages.front();
-		if(packet->WriteMessage(message))
-		{
-			++messageCount;
-			*out_bytesWritten += message->GetTotalWrittenMessageSize();
-
-			m_unsentUnreliableMessages.pop();
-			delete message;
-			message = nullptr;
-		}
-		else
+		NetMessage * message = m_unsentFragments.front();
+		if(!packet->CanWriteMessage(message))
 		{
 			break;
 		}
-	}
 
+		size_t messageSize = message->GetTotalWrittenMessageSize();
+		++messageCount;
+		*out_bytesWritten += messageSize;
+		m_fragmentBudget -= (float)messageSize;
+
+		m_unsentFragments.pop();
+		WriteNewReliable(packet, bundle, message);
+	}
 	return messageCount;
 }
 
 
 //-------------------------------------------------------------------------------------------------
-void NetConnection::CleanUpRemainingUnreliables()
+// Gives the message its reliable ID and moves it to the sent reliables
+void NetConnection::WriteNewReliable(NetPacket * packet, AckBundle * bundle, NetMessage * message)
 {
-	while(m_unsentUnreliableMessages.size() > 0)
+	//Assign next ID
+	message->m_reliableID = GetNextReliableID();
+	bundle->AddReliableID(&m_reliableRing, message->m_reliableID);
+	AddReceipt(bundle, message);
+	packet->WriteMessage(message);
+
+	//Add to sent
+	message->m_sentTimeStamp = Time::TOTAL_SECONDS;
+	++m_reliablesSentCount;
+#if NET_TELEMETRY
+	if(m_telemetry)
 	{
-		NetMessage const * message = m_unsentUnreliableMessages.front();
-		delete message;
-		m_unsentUnreliableMessages.pop();
+		m_telemetry->OnReliableSent(message->m_reliableID);
+		m_telemetry->OnMessageSent(message->m_type, message->GetTotalWrittenMessageSize());
 	}
+#endif // NET_TELEMETRY
+	ScheduleResend(message);
+	m_sentReliableMessages.push(message);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetConnection::AddReceipt(AckBundle * bundle, NetMessage const * message)
+{
+	if(message->m_receiptID == NetMessage::INVALID_RECEIPT_ID)
+	{
+		return;
+	}
+
+	//Too many, this one just never gets confirmed (same as if it was dropped)
+	bool added = bundle->AddReceipt(message->m_type, message->m_receiptID);
+	ASSERT_RECOVERABLE(added, "Too many receipts in one packet");
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Unreliables without an expire time only ever get the one send
+void NetConnection::CleanUpExpiredUnreliables()
+{
+	m_unsentMessages.RemoveExpired(Time::TOTAL_SECONDS);
 }
 
 
 //-------------------------------------------------------------------------------------------------
 void NetConnection::ProcessMessage(NetSender const & sender, NetMessage const & message)
 {
+#if NET_TELEMETRY
+	if(m_telemetry)
+	{
+		m_telemetry->OnMessageReceived(message.m_type, message.GetTotalWrittenMessageSize());
+	}
+#endif // NET_TELEMETRY
+
 	//Reliable
 	if(message.m_definition->IsReliable())
 	{
@@ -551,10 +705,10 @@ void NetConnection::UpdateLastRecvTime()
 
 
 //-------------------------------------------------------------------------------------------------
-void NetConnection::MarkPacketReceived(PacketHeader const & header)
+void NetConnection::MarkPacketReceived(PacketHeader const & header, double receivedTime)
 {
 	MarkAckReceived(header.packetAck);
-	ConfirmAcksSent(header.mostRecentReceivedAck, header.previousReceivedAcksBitfield);
+	ConfirmAcksSent(header.mostRecentReceivedAck, header.previousReceivedAcksBitfield, receivedTime);
 	UpdateLastRecvTime();
 }
 
@@ -583,7 +737,7 @@ bool NetConnection::MarkAckReceived(uint16_t ackID)
 	else if(GreaterThanCycle(ackID, m_mostRecentReceivedAck))
 	{
 		uint16_t shift = ackID - m_mostRecentReceivedAck;
-		if(shift > 16) //number of bits in uint16_t
+		if(shift >= ACK_BITFIELD_SIZE)
 		{
 			m_mostRecentReceivedAcksBitfield = 0;
 		}
@@ -592,12 +746,19 @@ bool NetConnection::MarkAckReceived(uint16_t ackID)
 			m_mostRecentReceivedAcksBitfield = (m_mostRecentReceivedAcksBitfield << shift);
 		}
 		m_mostRecentReceivedAck = ackID;
-		SetBit(&m_mostRecentReceivedAcksBitfield, shift - 1);
+		if(shift <= ACK_BITFIELD_SIZE)
+		{
+			SetBit(&m_mostRecentReceivedAcksBitfield, shift - 1);
+		}
 	}
 	else
 	{
+		//Too old to fit in the bitfield, the sender has already counted it as lost
 		uint16_t offset = m_mostRecentReceivedAck - ackID;
-		SetBit(&m_mostRecentReceivedAcksBitfield, offset - 1);
+		if(offset <= ACK_BITFIELD_SIZE)
+		{
+			SetBit(&m_mostRecentReceivedAcksBitfield, offset - 1);
+		}
 	}
 
 	return true;
@@ -605,21 +766,22 @@ bool NetConnection::MarkAckReceived(uint16_t ackID)
 
 
 //-------------------------------------------------------------------------------------------------
-void NetConnection::ConfirmAcksSent(uint16_t highestAck, uint16_t ackBitfield)
+void NetConnection::ConfirmAcksSent(uint16_t highestAck, uint64_t ackBitfield, double receivedTime)
 {
-	ConfirmAckBundle(highestAck);
-	for(uint16_t bitIndex = 0; bitIndex < 16; ++bitIndex)
+	ConfirmAckBundle(highestAck, receivedTime);
+	for(uint16_t bitIndex = 0; bitIndex < ACK_BITFIELD_SIZE; ++bitIndex)
 	{
-		if(IsBitfieldSet(ackBitfield, BIT(bitIndex)))
+		if(IsBitSet(ackBitfield, bitIndex))
 		{
-			ConfirmAckBundle(highestAck - bitIndex - 1);
+			ConfirmAckBundle(highestAck - bitIndex - 1, receivedTime);
 		}
 	}
+	DetectLostPackets(highestAck);
 }
 
 
 //-------------------------------------------------------------------------------------------------
-void NetConnection::ConfirmAckBundle(uint16_t ack)
+void NetConnection::ConfirmAckBundle(uint16_t ack, double receivedTime)
 {
 	AckBundle & bundle = m_bundles[ack % MAX_ACK_BUNDLES];
 
@@ -635,17 +797,59 @@ void NetConnection::ConfirmAckBundle(uint16_t ack)
 		return;
 	}
 
-	//Confirm all reliable IDs attached
-	for(size_t reliableIndex = 0; reliableIndex < bundle.m_reliableMessageCount; ++reliableIndex)
+	//Confirm all reliable IDs attached (unless the ring has lapped them, then they just get resent)
+	if(m_reliableRing.IsValid(bundle.m_firstReliable))
 	{
-		ConfirmReliableID(bundle.m_attachedReliables[reliableIndex]);
+		for(uint16_t reliableIndex = 0; reliableIndex < bundle.m_reliableMessageCount; ++reliableIndex)
+		{
+			ConfirmReliableID(m_reliableRing.Get(bundle.m_firstReliable + reliableIndex));
+		}
 	}
 
-	//Track round trip time
-	double oldRTT = GetRoundTripTime();
-	double newRTT = Time::TOTAL_SECONDS - bundle.m_sentTimeStamp;
-	m_roundTripTime = (0.9) * oldRTT + (0.1) * newRTT;
+	//Let whoever asked know their messages made it
+	for(size_t receiptIndex = 0; receiptIndex < bundle.m_receiptCount; ++receiptIndex)
+	{
+		NamedProperties receiptEvent;
+		receiptEvent.Set("connection", this);
+		receiptEvent.Set("messageType", (byte_t)bundle.m_receipts[receiptIndex].messageType);
+		receiptEvent.Set("receiptID", bundle.m_receipts[receiptIndex].receiptID);
+		BEventSystem::TriggerEvent(NetSession::ON_RECEIPT_CONFIRMED_EVENT, receiptEvent);
+	}
+
+	//Track round trip time (both stamps are taken as close to the socket as we can get)
+	//Packets are never resent (only messages are), so every sample is unambiguous
+	UpdateRoundTripTime(receivedTime - bundle.m_sentTimeStamp);
 	bundle.m_confirmReceived = true;
+	m_congestion.OnPacketAcked(bundle.m_sentBytes);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Once a packet is further back than the ack bitfield reaches it can never be confirmed, so it was lost
+void NetConnection::DetectLostPackets(uint16_t highestAck)
+{
+	if(highestAck == AckBundle::INVALID_ACK_ID)
+	{
+		return;
+	}
+
+	uint16_t windowStart = highestAck - ACK_BITFIELD_SIZE;
+
+	//Long silence, only the bundles we still have are worth looking at
+	if(GreaterThanCycle(windowStart - (uint16_t)MAX_ACK_BUNDLES, m_nextLossCheckAck))
+	{
+		m_nextLossCheckAck = windowStart - (uint16_t)MAX_ACK_BUNDLES;
+	}
+
+	while(GreaterThanCycle(windowStart, m_nextLossCheckAck))
+	{
+		AckBundle const & bundle = m_bundles[m_nextLossCheckAck % MAX_ACK_BUNDLES];
+		if(bundle.m_ackID == m_nextLossCheckAck && !bundle.m_confirmReceived)
+		{
+			m_congestion.OnPacketLost(m_roundTripTime);
+		}
+		++m_nextLossCheckAck;
+	}
 }
 
 
@@ -659,6 +863,14 @@ void NetConnection::ConfirmReliableID(uint16_t reliableID)
 		return;
 	}
 
+#if NET_TELEMETRY
+	//Only the first confirm counts, the same ID can ride in more than one acked packet
+	if(m_telemetry && !IsReliableIDConfirmed(reliableID))
+	{
+		m_telemetry->OnReliableConfirmed(reliableID);
+	}
+#endif // NET_TELEMETRY
+
 	if(GreaterThanCycle(reliableID, m_nextUnconfirmedReliableID) || reliableID == m_nextUnconfirmedReliableID)
 	{
 		//clearing values along the way because of edge case where same value is skipped multiple times
@@ -794,6 +1006,55 @@ double NetConnection::GetRoundTripTime() const
 }
 
 
+//-------------------------------------------------------------------------------------------------
+double NetConnection::GetRoundTripVariance() const
+{
+	return m_roundTripVariance;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+double NetConnection::GetResendDelay() const
+{
+	return m_resendDelay;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetCongestionControl const & NetConnection::GetCongestionControl() const
+{
+	return m_congestion;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetConnectionTelemetry * NetConnection::GetTelemetry() const
+{
+	return m_telemetry;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetFragmentAssembly * NetConnection::GetFragmentAssembly()
+{
+	return &m_fragmentAssembly;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+size_t NetConnection::GetUnsentFragmentCount() const
+{
+	return m_unsentFragments.size();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetSendQueue const & NetConnection::GetSendQueue() const
+{
+	return m_unsentMessages;
+}
+
+
 //-------------------------------------------------------------------------------------------------
 byte_t NetConnection::GetIndex() const
 {
@@ -930,7 +1191,61 @@ bool NetConnection::IsReliableIDConfirmed(uint16_t reliableID) const
 //-------------------------------------------------------------------------------------------------
 bool NetConnection::IsMessageOld(NetMessage const * message) const
 {
-	return (Time::TOTAL_SECONDS - message->m_sentTimeStamp) > GetRoundTripTime() * 1.1;
+	return Time::TOTAL_SECONDS >= message->m_resendTimeStamp;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Each resend of the same message waits twice as long (Karn style backoff), but never longer than
+// MAX_RESEND_DELAY_SECONDS, so an RTO already near the cap barely backs off at all
+void NetConnection::ScheduleResend(NetMessage * message) const
+{
+	double delay = m_resendDelay * (double)(1 << message->m_resendCount);
+	if(delay > MAX_RESEND_DELAY_SECONDS)
+	{
+		delay = MAX_RESEND_DELAY_SECONDS;
+	}
+	message->m_resendTimeStamp = message->m_sentTimeStamp + delay;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Jacobson/Karels: RTO = SRTT + 4 * RTTVAR
+void NetConnection::UpdateRoundTripTime(double sample)
+{
+#if NET_TELEMETRY
+	if(m_telemetry)
+	{
+		m_telemetry->OnRoundTrip(sample);
+	}
+#endif // NET_TELEMETRY
+
+	if(!m_hasRoundTripSample)
+	{
+		m_roundTripTime = sample;
+		m_roundTripVariance = sample * 0.5;
+		m_hasRoundTripSample = true;
+	}
+	else
+	{
+		double error = sample - m_roundTripTime;
+		if(error < 0.0)
+		{
+			error = -error;
+		}
+		m_roundTripVariance = 0.75 * m_roundTripVariance + 0.25 * error;
+		m_roundTripTime = 0.875 * m_roundTripTime + 0.125 * sample;
+	}
+
+	m_resendDelay = m_roundTripTime + 4.0 * m_roundTripVariance;
+	if(m_resendDelay < MIN_RESEND_DELAY_SECONDS)
+	{
+		m_resendDelay = MIN_RESEND_DELAY_SECONDS;
+	}
+	else if(m_resendDelay > MAX_RESEND_DELAY_SECONDS)
+	{
+		m_resendDelay = MAX_RESEND_DELAY_SECONDS;
+	}
 }
 
 
@@ -948,6 +1263,21 @@ bool NetConnection::CanSendNewReliables() const
 }
 
 
+//-------------------------------------------------------------------------------------------------
+size_t NetConnection::GetFreeReliableCount() const
+{
+	uint16_t inFlight = (uint16_t)(m_nextToSendReliableID - m_oldestUnconfirmedReliableID);
+	return inFlight < MAX_RELIABLE_RANGE ? MAX_RELIABLE_RANGE - inFlight : 0;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool NetConnection::CanSendNewFragments() const
+{
+	return (uint16_t)(m_nextToSendReliableID - m_oldestUnconfirmedReliableID) < MAX_RELIABLE_RANGE - RESERVED_RELIABLE_RANGE;
+}
+
+
 //-------------------------------------------------------------------------------------------------
 void NetConnection::SetConnectionInfo(ConnectionInfo const & connInfo)
 {
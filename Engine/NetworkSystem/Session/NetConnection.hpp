@@ -1,13 +1,18 @@
 #pragma once
 
 #include <queue>
+#include <vector>
 #include "Engine/Core/EngineCommon.hpp"
 #include "Engine/NetworkSystem/BNetworkSystem.hpp"
 #include "Engine/NetworkSystem/Session/AckBundle.hpp"
 #include "Engine/NetworkSystem/Session/ConnectionInfo.hpp"
+#include "Engine/NetworkSystem/Session/NetCongestionControl.hpp"
+#include "Engine/NetworkSystem/Session/NetFragment.hpp"
+#include "Engine/NetworkSystem/Session/NetSendQueue.hpp"
 
 
 //-------------------------------------------------------------------------------------------------
+class NetConnectionTelemetry;
 class NetSession;
 class NetMessage;
 class NetPacket;
@@ -15,6 +20,15 @@ class NetSender;
 class PacketHeader;
 
 
+//-------------------------------------------------------------------------------------------------
+// Keeps the soonest resend on top of the sent reliables heap
+class ResendTimeCompare
+{
+public:
+	bool operator()(NetMessage const * lhs, NetMessage const * rhs) const;
+};
+
+
 //-------------------------------------------------------------------------------------------------
 class NetConnection
 {
@@ -29,7 +43,14 @@ public:
 	//range of Byte (data type of sequence ID)
 	static size_t const MAX_SEQUENCE_CHANNELS = 256;
 	static size_t const DROP_COUNT_RESET_VALUE = 1024;
-	static double s_resendDelaySeconds;
+	static uint16_t const ACK_BITFIELD_SIZE = 64; //bits in previousReceivedAcksBitfield
+	static double s_resendDelaySeconds; //Starting RTO, until there's a round trip measured
+	static double const MIN_RESEND_DELAY_SECONDS;
+	static double const MAX_RESEND_DELAY_SECONDS;
+	static byte_t const MAX_RESEND_BACKOFF = 4; //Doubles the RTO per resend (at most 4 times), still capped at MAX_RESEND_DELAY_SECONDS
+	static float s_fragmentBandwidthShare; //Most of the send rate large transfers can take
+	static float const MAX_FRAGMENT_BURST_BYTES;
+	static size_t const RESERVED_RELIABLE_RANGE = MAX_RELIABLE_RANGE / 4; //Fragments leave this much of the window to everything else
 
 	//-------------------------------------------------------------------------------------------------
 	// Members
@@ -48,9 +69,12 @@ public:
 	//Sending
 	uint16_t m_nextToSendAck;
 
+	//Anything before this that never got confirmed has been counted as lost
+	uint16_t m_nextLossCheckAck;
+
 	//Receiving
 	uint16_t m_mostRecentReceivedAck;
-	uint16_t m_mostRecentReceivedAcksBitfield;
+	uint64_t m_mostRecentReceivedAcksBitfield;
 
 	//Sending
 	uint16_t m_nextToSendReliableID;
@@ -77,15 +101,28 @@ public:
 	size_t m_lastOutgoingMessageCount;
 	size_t m_lastOutgoingByteCountPacketHeader;
 	size_t m_lastOutgoingByteCountMessages;
+	size_t m_reliablesSentCount;
+	size_t m_reliablesResentCount;
 
 private:
 	AckBundle m_bundles[MAX_ACK_BUNDLES];
-	std::queue<NetMessage*> m_unsentUnreliableMessages;
-	std::queue<NetMessage*> m_unsentReliableMessages;
-	std::queue<NetMessage*> m_sentReliableMessages;
+	AckReliableRing m_reliableRing;
+	NetSendQueue m_unsentMessages; //Reliables and unreliables, by priority
+	std::vector<NetMessage*> m_selectedMessages; //Kept around so it doesn't allocate every packet
+	std::priority_queue<NetMessage*, std::vector<NetMessage*>, ResendTimeCompare> m_sentReliableMessages;
+	std::queue<NetMessage*> m_unsentFragments;
+	uint16_t m_nextFragmentTransferID;
+	float m_fragmentBudget; //Bytes
+	float m_lastFragmentRefillTime;
+	NetFragmentAssembly m_fragmentAssembly;
 	NetMessage * m_sequenceChannels[MAX_SEQUENCE_CHANNELS]; //#TODO: change to channelInfos
 
-	double m_roundTripTime;
+	double m_roundTripTime; //Smoothed
+	double m_roundTripVariance;
+	double m_resendDelay; //RTO
+	bool m_hasRoundTripSample;
+	NetCongestionControl m_congestion;
+	NetConnectionTelemetry * m_telemetry; //Only while NetTelemetry is enabled
 
 	//-------------------------------------------------------------------------------------------------
 	// Functions
@@ -95,12 +132,15 @@ public:
 	~NetConnection();
 
 	void AddMessage(NetMessage & message);
+	bool AddFragmentedMessage(byte_t type, byte_t const * data, size_t dataSize);
 	void AddBundle(AckBundle const & bundle);
 	void SendPacket();
 	size_t WriteSentReliables(NetPacket * packet, AckBundle * bundle, size_t * out_bytesWritten);
-	size_t WriteUnsentReliables(NetPacket * packet, AckBundle * bundle, size_t * out_bytesWritten);
-	size_t WriteUnsentUnreliables(NetPacket * packet, size_t * out_bytesWritten);
-	void CleanUpRemainingUnreliables();
+	size_t WriteUnsentMessages(NetPacket * packet, AckBundle * bundle, size_t alreadyWrittenCount, size_t * out_bytesWritten);
+	size_t WriteUnsentFragments(NetPacket * packet, AckBundle * bundle, size_t alreadyWrittenCount, size_t * out_bytesWritten);
+	void WriteNewReliable(NetPacket * packet, AckBundle * bundle, NetMessage * message);
+	void AddReceipt(AckBundle * bundle, NetMessage const * message);
+	void CleanUpExpiredUnreliables();
 	void ProcessMessage(NetSender const & sender, NetMessage const & message);
 	void ProcessReliableSequence(NetSender const & sender, NetMessage const & message);
 	void ProcessNextInSequenceChannel(NetSender const & sender, byte_t sequenceChannelID);
@@ -109,10 +149,11 @@ public:
 	void SetPassword(size_t password);
 
 	void UpdateLastRecvTime();
-	void MarkPacketReceived(PacketHeader const & header);
+	void MarkPacketReceived(PacketHeader const & header, double receivedTime);
 	bool MarkAckReceived(uint16_t ackID);
-	void ConfirmAcksSent(uint16_t highestAck, uint16_t ackBitfield);
-	void ConfirmAckBundle(uint16_t ack);
+	void ConfirmAcksSent(uint16_t highestAck, uint64_t ackBitfield, double receivedTime);
+	void ConfirmAckBundle(uint16_t ack, double receivedTime);
+	void DetectLostPackets(uint16_t highestAck);
 	void ConfirmReliableID(uint16_t reliableID);
 	void UpdateOldestUnconfirmedReliableID();
 	void UpdateOldestUnreceivedReliableID();
@@ -120,6 +161,13 @@ public:
 
 	float GetDropRate() const;
 	double GetRoundTripTime() const;
+	double GetRoundTripVariance() const;
+	double GetResendDelay() const;
+	NetCongestionControl const & GetCongestionControl() const;
+	NetConnectionTelemetry * GetTelemetry() const;
+	NetFragmentAssembly * GetFragmentAssembly();
+	size_t GetUnsentFragmentCount() const;
+	NetSendQueue const & GetSendQueue() const;
 	byte_t GetIndex() const;
 	char const * GetGUID() const;
 	char const * GetUsername() const;
@@ -136,8 +184,12 @@ public:
 	bool IsReliableIDReceived(uint16_t reliableID) const;
 	bool IsReliableIDConfirmed(uint16_t reliableID) const;
 	bool IsMessageOld(NetMessage const * message) const;
+	void ScheduleResend(NetMessage * message) const;
+	void UpdateRoundTripTime(double sample);
 	bool IsHost() const;
 	bool CanSendNewReliables() const;
+	size_t GetFreeReliableCount() const;
+	bool CanSendNewFragments() const;
 
 	void SetConnectionInfo(ConnectionInfo const & connInfo);
 };
\ No newline at end of file
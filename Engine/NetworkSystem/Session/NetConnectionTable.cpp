@@ -0,0 +1,283 @@
+#include "Engine/NetworkSystem/Session/NetConnectionTable.hpp"
+
+#include <cstring>
+#include "Engine/Core/Time.hpp"
+#include "Engine/DebugSystem/BConsoleSystem.hpp"
+#include "Engine/DebugSystem/Command.hpp"
+#include "Engine/NetworkSystem/Session/NetConnection.hpp"
+#include "Engine/Utils/MathUtils.hpp"
+#include "Engine/Utils/StringUtils.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+void NetLookupBenchCommand(Command const & command)
+{
+	int connectionCount = command.GetArg(0, 250);
+	connectionCount = Clamp(connectionCount, 1, (int)NetConnectionTable::MAX_CONNECTIONS);
+	NetConnectionTable::RunBenchmark((size_t)connectionCount, 100000);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC uint64_t NetConnectionTable::GetAddressKey(sockaddr_in const & address)
+{
+	return ((uint64_t)address.sin_addr.s_addr << 16) | (uint64_t)address.sin_port;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Compares hashed lookups against the slot scan the session used to do, with fake connections
+// that never touch a socket. Lookups are spread evenly over every connection.
+STATIC void NetConnectionTable::RunBenchmark(size_t connectionCount, size_t lookupCount)
+{
+	NetConnectionTable table;
+	for(size_t connIndex = 0; connIndex < connectionCount; ++connIndex)
+	{
+		sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(0x0a000000 | (uint32_t)connIndex);
+		address.sin_port = htons((uint16_t)(4334 + connIndex));
+		table.Add(new NetConnection((byte_t)connIndex, address, Stringf("guid%u", connIndex), "bench", nullptr));
+	}
+
+	std::vector<NetConnection*> const & active = table.GetActive();
+	size_t found = 0;
+
+	//Old way, walk every slot
+	uint64_t startOpCount = Time::GetCurrentOpCount();
+	for(size_t lookupIndex = 0; lookupIndex < lookupCount; ++lookupIndex)
+	{
+		sockaddr_in const & address = active[lookupIndex % active.size()]->GetAddress();
+		for(size_t slotIndex = 0; slotIndex < MAX_CONNECTIONS; ++slotIndex)
+		{
+			if(table.m_slots[slotIndex] && IsEqual(table.m_slots[slotIndex]->GetAddress(), address))
+			{
+				++found;
+				break;
+			}
+		}
+	}
+	double scanSeconds = Time::GetTimeFromOpCount(Time::GetCurrentOpCount() - startOpCount);
+
+	startOpCount = Time::GetCurrentOpCount();
+	for(size_t lookupIndex = 0; lookupIndex < lookupCount; ++lookupIndex)
+	{
+		if(table.Find(active[lookupIndex % active.size()]->GetAddress()))
+		{
+			++found;
+		}
+	}
+	double addressSeconds = Time::GetTimeFromOpCount(Time::GetCurrentOpCount() - startOpCount);
+
+	startOpCount = Time::GetCurrentOpCount();
+	for(size_t lookupIndex = 0; lookupIndex < lookupCount; ++lookupIndex)
+	{
+		if(table.Find(active[lookupIndex % active.size()]->GetGUID()))
+		{
+			++found;
+		}
+	}
+	double guidSeconds = Time::GetTimeFromOpCount(Time::GetCurrentOpCount() - startOpCount);
+
+	BConsoleSystem::AddLog(Stringf("%u connections, %u lookups each (%u found)", connectionCount, lookupCount, found), BConsoleSystem::GOOD);
+	BConsoleSystem::AddLog(Stringf("Slot scan: %.3fus, Address hash: %.3fus, GUID hash: %.3fus per lookup", scanSeconds * 1000000.0 / (double)lookupCount, addressSeconds * 1000000.0 / (double)lookupCount, guidSeconds * 1000000.0 / (double)lookupCount), BConsoleSystem::GOOD);
+
+	while(!active.empty())
+	{
+		NetConnection * connection = active.back();
+		table.Remove(connection);
+		delete connection;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetConnectionTable::NetConnectionTable()
+{
+	for(size_t index = 0; index < MAX_CONNECTIONS; ++index)
+	{
+		m_slots[index] = nullptr;
+	}
+
+	for(size_t maskIndex = 0; maskIndex < INDEX_MASK_COUNT; ++maskIndex)
+	{
+		m_usedIndexMask[maskIndex] = 0;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Fails if the index is taken. Address and GUID collisions keep the first one, same as the old scan did.
+// Remove() hands a shared entry to the lowest remaining index.
+bool NetConnectionTable::Add(NetConnection * connection)
+{
+	byte_t index = connection->GetIndex();
+	if(index >= MAX_CONNECTIONS || m_slots[index])
+	{
+		return false;
+	}
+
+	m_slots[index] = connection;
+	m_activeConnections.push_back(connection);
+	m_addressLookup.insert(std::make_pair(GetAddressKey(connection->GetAddress()), connection));
+	m_guidLookup.insert(std::make_pair(std::string(connection->GetGUID()), connection));
+	m_usedIndexMask[index / 64] |= (1ULL << (index % 64));
+	return true;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetConnectionTable::Remove(NetConnection * connection)
+{
+	byte_t index = connection->GetIndex();
+	if(index >= MAX_CONNECTIONS || m_slots[index] != connection)
+	{
+		return;
+	}
+
+	m_slots[index] = nullptr;
+	m_usedIndexMask[index / 64] &= ~(1ULL << (index % 64));
+
+	//Order doesn't matter, swap with the back
+	for(size_t activeIndex = 0; activeIndex < m_activeConnections.size(); ++activeIndex)
+	{
+		if(m_activeConnections[activeIndex] == connection)
+		{
+			m_activeConnections[activeIndex] = m_activeConnections.back();
+			m_activeConnections.pop_back();
+			break;
+		}
+	}
+
+	//Only if this connection owned the entry, then hand it to whoever else shares the key
+	uint64_t addressKey = GetAddressKey(connection->GetAddress());
+	auto foundAddress = m_addressLookup.find(addressKey);
+	if(foundAddress != m_addressLookup.end() && foundAddress->second == connection)
+	{
+		m_addressLookup.erase(foundAddress);
+		NetConnection * nextOwner = FindActive(addressKey);
+		if(nextOwner)
+		{
+			m_addressLookup.insert(std::make_pair(addressKey, nextOwner));
+		}
+	}
+
+	std::string guid(connection->GetGUID());
+	auto foundGUID = m_guidLookup.find(guid);
+	if(foundGUID != m_guidLookup.end() && foundGUID->second == connection)
+	{
+		m_guidLookup.erase(foundGUID);
+		NetConnection * nextOwner = FindActive(guid.c_str());
+		if(nextOwner)
+		{
+			m_guidLookup.insert(std::make_pair(guid, nextOwner));
+		}
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetConnection * NetConnectionTable::Get(byte_t index) const
+{
+	if(index >= MAX_CONNECTIONS)
+	{
+		return nullptr;
+	}
+	return m_slots[index];
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetConnection * NetConnectionTable::Find(sockaddr_in const & address) const
+{
+	auto foundAddress = m_addressLookup.find(GetAddressKey(address));
+	if(foundAddress == m_addressLookup.end())
+	{
+		return nullptr;
+	}
+	return foundAddress->second;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetConnection * NetConnectionTable::Find(char const * guid) const
+{
+	auto foundGUID = m_guidLookup.find(std::string(guid));
+	if(foundGUID == m_guidLookup.end())
+	{
+		return nullptr;
+	}
+	return foundGUID->second;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Slot scan for the lowest index with that address, only used when a shared lookup entry changes hands
+NetConnection * NetConnectionTable::FindActive(uint64_t addressKey) const
+{
+	for(size_t index = 0; index < MAX_CONNECTIONS; ++index)
+	{
+		if(m_slots[index] && GetAddressKey(m_slots[index]->GetAddress()) == addressKey)
+		{
+			return m_slots[index];
+		}
+	}
+	return nullptr;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Slot scan for the lowest index with that GUID, only used when a shared lookup entry changes hands
+NetConnection * NetConnectionTable::FindActive(char const * guid) const
+{
+	for(size_t index = 0; index < MAX_CONNECTIONS; ++index)
+	{
+		if(m_slots[index] && strcmp(m_slots[index]->GetGUID(), guid) == 0)
+		{
+			return m_slots[index];
+		}
+	}
+	return nullptr;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Unordered, removing a connection moves the last one into its place
+std::vector<NetConnection*> const & NetConnectionTable::GetActive() const
+{
+	return m_activeConnections;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Lowest free index, or INVALID_INDEX (255) when full
+byte_t NetConnectionTable::GetNextFreeIndex() const
+{
+	for(size_t maskIndex = 0; maskIndex < INDEX_MASK_COUNT; ++maskIndex)
+	{
+		uint64_t freeBits = ~m_usedIndexMask[maskIndex];
+		if(freeBits == 0)
+		{
+			continue;
+		}
+
+		size_t bitIndex = 0;
+		while((freeBits & 1ULL) == 0)
+		{
+			freeBits >>= 1;
+			++bitIndex;
+		}
+
+		size_t index = maskIndex * 64 + bitIndex;
+		return index < MAX_CONNECTIONS ? (byte_t)index : (byte_t)MAX_CONNECTIONS;
+	}
+	return (byte_t)MAX_CONNECTIONS;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+size_t NetConnectionTable::GetCount() const
+{
+	return m_activeConnections.size();
+}
\ No newline at end of file
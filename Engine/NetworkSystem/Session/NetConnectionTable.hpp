@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Utils/NetworkUtils.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+class Command;
+class NetConnection;
+
+
+//-------------------------------------------------------------------------------------------------
+void NetLookupBenchCommand(Command const &);
+
+
+//-------------------------------------------------------------------------------------------------
+// Session connections indexed three ways: by connection index (the slot array), by address and by
+// GUID (hash maps), plus a dense list for walking only the connections that exist. Doesn't own the
+// connections, whoever removes one deletes it.
+class NetConnectionTable
+{
+	//-------------------------------------------------------------------------------------------------
+	// Static Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	static size_t const MAX_CONNECTIONS = 255; //largest number possible of Byte - 1
+	static size_t const INDEX_MASK_COUNT = 4; //64 bits each
+
+	//-------------------------------------------------------------------------------------------------
+	// Members
+	//-------------------------------------------------------------------------------------------------
+private:
+	NetConnection * m_slots[MAX_CONNECTIONS];
+	std::vector<NetConnection*> m_activeConnections;
+	std::unordered_map<uint64_t, NetConnection*> m_addressLookup;
+	std::unordered_map<std::string, NetConnection*> m_guidLookup;
+	uint64_t m_usedIndexMask[INDEX_MASK_COUNT];
+
+	//-------------------------------------------------------------------------------------------------
+	// Static Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	static uint64_t GetAddressKey(sockaddr_in const & address);
+	static void RunBenchmark(size_t connectionCount, size_t lookupCount);
+
+	//-------------------------------------------------------------------------------------------------
+	// Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	NetConnectionTable();
+
+	bool Add(NetConnection * connection);
+	void Remove(NetConnection * connection);
+
+	NetConnection * Get(byte_t index) const;
+	NetConnection * Find(sockaddr_in const & address) const;
+	NetConnection * Find(char const * guid) const;
+	std::vector<NetConnection*> const & GetActive() const;
+	byte_t GetNextFreeIndex() const;
+	size_t GetCount() const;
+
+private:
+	NetConnection * FindActive(uint64_t addressKey) const;
+	NetConnection * FindActive(char const * guid) const;
+};
\ No newline at end of file
@@ -0,0 +1,237 @@
+#include "Engine/NetworkSystem/Session/NetFragment.hpp"
+
+#include <cstring>
+#include "Engine/DebugSystem/BConsoleSystem.hpp"
+#include "Engine/DebugSystem/ErrorWarningAssert.hpp"
+#include "Engine/NetworkSystem/Session/NetConnection.hpp"
+#include "Engine/NetworkSystem/Session/NetMessage.hpp"
+#include "Engine/NetworkSystem/Session/NetPacket.hpp"
+#include "Engine/NetworkSystem/Session/NetSession.hpp"
+#include "Engine/NetworkSystem/Session/NetTelemetry.hpp"
+#include "Engine/Utils/MathUtils.hpp"
+#include "Engine/Utils/StringUtils.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC std::vector<byte_t*> NetFragment::s_freeBuffers[BUFFER_SIZE_CLASS_COUNT];
+STATIC size_t NetFragment::s_usedBuffers[BUFFER_SIZE_CLASS_COUNT] = {0};
+
+
+//-------------------------------------------------------------------------------------------------
+void OnFragment(NetSender const & sender, NetMessage const & message)
+{
+	NetConnection * connection = sender.connection;
+	if(!connection)
+	{
+		return;
+	}
+
+	NetFragmentHeader header;
+	NetFragmentAssembly * assembly = connection->GetFragmentAssembly();
+	if(!header.Read(message) || !assembly->AddFragment(header, message))
+	{
+		//Fragments are reliable and in order, so this is a bad peer, throw the transfer out
+		ASSERT_RECOVERABLE(false, "Received a fragment that doesn't fit the transfer in progress");
+		assembly->Reset();
+		return;
+	}
+
+	if(assembly->IsComplete())
+	{
+		assembly->Deliver(sender);
+		assembly->Reset();
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool NetFragmentHeader::Write(NetMessage * message) const
+{
+	return message->Write<uint16_t>(transferID)
+		&& message->Write<uint16_t>(fragmentIndex)
+		&& message->Write<uint16_t>(fragmentCount)
+		&& message->Write<byte_t>(innerType)
+		&& message->Write<uint32_t>(totalSize);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool NetFragmentHeader::Read(NetMessage const & message)
+{
+	return message.Read<uint16_t>(&transferID)
+		&& message.Read<uint16_t>(&fragmentIndex)
+		&& message.Read<uint16_t>(&fragmentCount)
+		&& message.Read<byte_t>(&innerType)
+		&& message.Read<uint32_t>(&totalSize);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC size_t NetFragment::GetFragmentCount(size_t totalSize)
+{
+	return (totalSize + DATA_SIZE - 1) / DATA_SIZE;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Buffers are kept once they're made, a level load's worth of transfers only allocates once
+STATIC byte_t * NetFragment::AllocateBuffer(size_t size)
+{
+	size_t sizeClass = GetSizeClass(size);
+	++s_usedBuffers[sizeClass];
+	if(s_freeBuffers[sizeClass].empty())
+	{
+		return new byte_t[MIN_BUFFER_SIZE << sizeClass];
+	}
+
+	byte_t * buffer = s_freeBuffers[sizeClass].back();
+	s_freeBuffers[sizeClass].pop_back();
+	return buffer;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Size must be the same size that was asked for in AllocateBuffer()
+STATIC void NetFragment::FreeBuffer(byte_t * buffer, size_t size)
+{
+	if(!buffer)
+	{
+		return;
+	}
+
+	size_t sizeClass = GetSizeClass(size);
+	s_freeBuffers[sizeClass].push_back(buffer);
+	--s_usedBuffers[sizeClass];
+}
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC void NetFragment::PrintStats()
+{
+	for(size_t sizeClass = 0; sizeClass < BUFFER_SIZE_CLASS_COUNT; ++sizeClass)
+	{
+		BConsoleSystem::AddLog(Stringf("%7u Byte Transfer Buffers: %u used, %u free", MIN_BUFFER_SIZE << sizeClass, s_usedBuffers[sizeClass], s_freeBuffers[sizeClass].size()), BConsoleSystem::INFO);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Buffer pools, then what every connection still has waiting to go out
+void NetFragmentStatsCommand(Command const &)
+{
+	NetFragment::PrintStats();
+
+	std::vector<NetSession const*> const & sessions = NetTelemetry::GetSessions();
+	for(size_t sessionIndex = 0; sessionIndex < sessions.size(); ++sessionIndex)
+	{
+		std::vector<NetConnection*> const & activeConnections = sessions[sessionIndex]->GetActiveConnections();
+		for(size_t activeIndex = 0; activeIndex < activeConnections.size(); ++activeIndex)
+		{
+			NetConnection const * connection = activeConnections[activeIndex];
+			if(connection->IsSelf())
+			{
+				continue;
+			}
+			BConsoleSystem::AddLog(Stringf("Connection %u: %u fragments unsent", connection->GetIndex(), connection->GetUnsentFragmentCount()), BConsoleSystem::INFO);
+		}
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC size_t NetFragment::GetSizeClass(size_t size)
+{
+	ASSERT_RECOVERABLE(size <= MAX_TRANSFER_SIZE, "Fragment transfer too large");
+
+	size_t sizeClass = 0;
+	size_t bufferSize = MIN_BUFFER_SIZE;
+	while(bufferSize < size && sizeClass < BUFFER_SIZE_CLASS_COUNT - 1)
+	{
+		bufferSize <<= 1;
+		++sizeClass;
+	}
+	return sizeClass;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetFragmentAssembly::NetFragmentAssembly()
+	: m_header()
+	, m_buffer(nullptr)
+	, m_receivedSize(0)
+{
+	//Nothing
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetFragmentAssembly::~NetFragmentAssembly()
+{
+	Reset();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Fragments show up in order, the first one starts a new transfer
+bool NetFragmentAssembly::AddFragment(NetFragmentHeader const & header, NetMessage const & fragment)
+{
+	if(header.fragmentIndex == 0)
+	{
+		Reset();
+		if(header.totalSize == 0 || header.totalSize > NetFragment::MAX_TRANSFER_SIZE || header.fragmentCount != NetFragment::GetFragmentCount(header.totalSize))
+		{
+			return false;
+		}
+		m_header = header;
+		m_buffer = NetFragment::AllocateBuffer(header.totalSize);
+	}
+	else if(!m_buffer || header.transferID != m_header.transferID || header.fragmentIndex != m_header.fragmentIndex + 1)
+	{
+		return false;
+	}
+
+	size_t dataSize = Min(NetFragment::DATA_SIZE, (size_t)m_header.totalSize - m_receivedSize);
+	if(fragment.GetReadableBytesLeft() != dataSize)
+	{
+		return false;
+	}
+
+	memcpy(m_buffer + m_receivedSize, fragment.GetHead(), dataSize);
+	m_receivedSize += dataSize;
+	m_header.fragmentIndex = header.fragmentIndex;
+	return true;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Handed to the inner type's callback as a view, copy anything you want to keep
+void NetFragmentAssembly::Deliver(NetSender const & sender)
+{
+	NetMessageDefinition const * definition = sender.session->GetDefinition((eNetMessageType)m_header.innerType);
+	if(!definition || !definition->callback || m_header.innerType == eNetMessageType_FRAGMENT)
+	{
+		ASSERT_RECOVERABLE(false, "Fragment transfer for an unregistered message type");
+		return;
+	}
+
+	NetMessage message(m_header.innerType, m_buffer, m_header.totalSize);
+	message.m_definition = definition;
+	message.m_senderIndex = sender.connection->GetIndex();
+	message.Process(sender);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetFragmentAssembly::Reset()
+{
+	NetFragment::FreeBuffer(m_buffer, m_header.totalSize);
+	m_buffer = nullptr;
+	m_receivedSize = 0;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool NetFragmentAssembly::IsComplete() const
+{
+	return m_buffer && m_receivedSize == m_header.totalSize;
+}
\ No newline at end of file
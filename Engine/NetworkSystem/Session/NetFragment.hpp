@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+#include "Engine/Core/EngineCommon.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+class Command;
+class NetMessage;
+class NetSender;
+
+
+//-------------------------------------------------------------------------------------------------
+void OnFragment(NetSender const &, NetMessage const &);
+void NetFragmentStatsCommand(Command const &);
+
+
+//-------------------------------------------------------------------------------------------------
+// Written at the front of every fragment, followed by up to DATA_SIZE bytes of the payload
+class NetFragmentHeader
+{
+public:
+	static size_t const SIZE = sizeof(uint16_t) * 3 + sizeof(byte_t) + sizeof(uint32_t);
+
+public:
+	uint16_t transferID;
+	uint16_t fragmentIndex;
+	uint16_t fragmentCount;
+	byte_t innerType; //The message type the payload is delivered as
+	uint32_t totalSize;
+
+public:
+	bool Write(NetMessage * message) const;
+	bool Read(NetMessage const & message);
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Payloads too big for one message are split into fragments that ride the reliable, in order
+// FRAGMENT_SEQUENCE_CHANNEL. In order means the receiver only ever builds one transfer per
+// connection at a time, straight into a pooled buffer, and hands it over when the last piece lands.
+class NetFragment
+{
+	//-------------------------------------------------------------------------------------------------
+	// Static Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	static size_t const DATA_SIZE = 1000; //Fits a fragment in a NetMessage with room to spare
+	static size_t const MAX_TRANSFER_SIZE = 1024 * 1024;
+	static byte_t const FRAGMENT_SEQUENCE_CHANNEL = 255;
+	static size_t const MIN_BUFFER_SIZE = 2 * 1024;
+	static size_t const BUFFER_SIZE_CLASS_COUNT = 10; //2KB to 1MB
+
+private:
+	static std::vector<byte_t*> s_freeBuffers[BUFFER_SIZE_CLASS_COUNT];
+	static size_t s_usedBuffers[BUFFER_SIZE_CLASS_COUNT];
+
+	//-------------------------------------------------------------------------------------------------
+	// Static Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	static size_t GetFragmentCount(size_t totalSize);
+	static byte_t * AllocateBuffer(size_t size);
+	static void FreeBuffer(byte_t * buffer, size_t size);
+	static void PrintStats();
+
+private:
+	static size_t GetSizeClass(size_t size);
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// One connection's transfer in progress
+class NetFragmentAssembly
+{
+	//-------------------------------------------------------------------------------------------------
+	// Members
+	//-------------------------------------------------------------------------------------------------
+private:
+	NetFragmentHeader m_header;
+	byte_t * m_buffer;
+	size_t m_receivedSize;
+
+	//-------------------------------------------------------------------------------------------------
+	// Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	NetFragmentAssembly();
+	~NetFragmentAssembly();
+
+	bool AddFragment(NetFragmentHeader const & header, NetMessage const & fragment);
+	void Deliver(NetSender const & sender);
+	void Reset();
+
+	bool IsComplete() const;
+};
\ No newline at end of file
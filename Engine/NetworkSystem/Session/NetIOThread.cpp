@@ -0,0 +1,185 @@
+#include "Engine/NetworkSystem/Session/NetIOThread.hpp"
+
+#include <chrono>
+#include "Engine/Core/Time.hpp"
+#include "Engine/NetworkSystem/Session/NetCompression.hpp"
+#include "Engine/NetworkSystem/Session/NetSession.hpp"
+#include "Engine/NetworkSystem/Session/PacketChannel.hpp"
+#include "Engine/Threads/Thread.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+void NetIOThreadEntry(void * data)
+{
+	NetIOThread * ioThread = (NetIOThread*)data;
+	ioThread->Run();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetIOThread::NetIOThread(PacketChannel * channel, NetSession const * session)
+	: m_channel(channel)
+	, m_session(session)
+	, m_thread(nullptr)
+	, m_isRunning(false)
+	, m_invalidPacketCount(0)
+	, m_inboxFullCount(0)
+	, m_outboxFullCount(0)
+{
+	//Nothing
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetIOThread::~NetIOThread()
+{
+	Stop();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetIOThread::Start()
+{
+	if(m_thread)
+	{
+		return;
+	}
+
+	m_isRunning = true;
+	m_thread = new Thread(NetIOThreadEntry, this);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetIOThread::Stop()
+{
+	if(!m_thread)
+	{
+		return;
+	}
+
+	m_isRunning = false;
+	m_thread->Join();
+	delete m_thread;
+	m_thread = nullptr;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetIOThread::Run()
+{
+	while(m_isRunning)
+	{
+		size_t workDone = 0;
+		workDone += ReceiveAll();
+		workDone += SendAll();
+		m_channel->FlushDelayedSends(Time::GetCurrentTimeSeconds());
+
+		//Nothing on the wire, give the core back for a bit
+		if(workDone == 0)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(IDLE_SLEEP_MS));
+		}
+	}
+
+	//Make sure anything queued before stopping (like leave messages) still goes out
+	SendAll();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool NetIOThread::QueueSend(sockaddr_in const & address, byte_t const * data, size_t dataSize)
+{
+	NetDatagram * datagram = m_outbox.BeginPush();
+	if(!datagram)
+	{
+		++m_outboxFullCount;
+		return false;
+	}
+
+	datagram->address = address;
+	datagram->timeStamp = Time::GetCurrentTimeSeconds();
+	datagram->size = dataSize;
+	memcpy(datagram->data, data, dataSize);
+	m_outbox.EndPush();
+	return true;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetDatagram const * NetIOThread::PeekReceived()
+{
+	return m_inbox.BeginPop();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetIOThread::PopReceived()
+{
+	m_inbox.EndPop();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool NetIOThread::IsRunning() const
+{
+	return m_isRunning;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+size_t NetIOThread::ReceiveAll()
+{
+	size_t received = 0;
+	NetPacket packet;
+	sockaddr_in address;
+	size_t read = m_channel->RecvDatagram(&address, packet.GetBuffer(), NetPacket::MAX_SIZE);
+	while(read > 0)
+	{
+		++received;
+		packet.Rewind();
+		packet.SetBufferSize(read);
+
+		//Drop bad packets here so the game thread never sees them (and decompress off the game thread)
+		if(!NetCompression::DecompressPacket(&packet) || !m_session->IsValidPacket(packet, packet.GetSize()))
+		{
+			++m_invalidPacketCount;
+		}
+		else
+		{
+			NetDatagram * datagram = m_inbox.BeginPush();
+			if(datagram)
+			{
+				datagram->address = address;
+				datagram->timeStamp = Time::GetCurrentTimeSeconds();
+				datagram->size = packet.GetSize();
+				memcpy(datagram->data, packet.GetBuffer(), packet.GetSize());
+				m_inbox.EndPush();
+			}
+			else
+			{
+				//Game thread is behind, treat it like a drop
+				++m_inboxFullCount;
+			}
+		}
+
+		read = m_channel->RecvDatagram(&address, packet.GetBuffer(), NetPacket::MAX_SIZE);
+	}
+	return received;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+size_t NetIOThread::SendAll()
+{
+	size_t sent = 0;
+	NetDatagram * datagram = m_outbox.BeginPop();
+	while(datagram)
+	{
+		m_channel->SendPackets(datagram->address, datagram->data, datagram->size);
+		m_outbox.EndPop();
+		++sent;
+		datagram = m_outbox.BeginPop();
+	}
+	return sent;
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/NetworkSystem/Session/NetPacket.hpp"
+#include "Engine/Threads/BRingQueue.hpp"
+#include "Engine/Utils/NetworkUtils.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+class NetSession;
+class PacketChannel;
+class Thread;
+
+
+//-------------------------------------------------------------------------------------------------
+void NetIOThreadEntry(void * data);
+
+
+//-------------------------------------------------------------------------------------------------
+class NetDatagram
+{
+public:
+	sockaddr_in address;
+	double timeStamp; //Received time for the inbox, queued time for the outbox
+	size_t size;
+	byte_t data[NetPacket::MAX_SIZE];
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Owns the socket while running. Reads, timestamps and validates packets into the inbox, and
+// flushes whatever the game thread put in the outbox. Messages are still processed on the game thread.
+class NetIOThread
+{
+	//-------------------------------------------------------------------------------------------------
+	// Static Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	static size_t const INBOX_SIZE = 256;
+	static size_t const OUTBOX_SIZE = 512;
+	static int const IDLE_SLEEP_MS = 1;
+
+	//-------------------------------------------------------------------------------------------------
+	// Members
+	//-------------------------------------------------------------------------------------------------
+private:
+	PacketChannel * m_channel;
+	NetSession const * m_session;
+	Thread * m_thread;
+	std::atomic<bool> m_isRunning;
+	BRingQueue<NetDatagram, INBOX_SIZE> m_inbox;
+	BRingQueue<NetDatagram, OUTBOX_SIZE> m_outbox;
+
+public:
+	//debugging information
+	std::atomic<int> m_invalidPacketCount;
+	std::atomic<int> m_inboxFullCount;
+	std::atomic<int> m_outboxFullCount;
+
+	//-------------------------------------------------------------------------------------------------
+	// Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	NetIOThread(PacketChannel * channel, NetSession const * session);
+	~NetIOThread();
+
+	void Start();
+	void Stop();
+	void Run();
+
+	//Game thread
+	bool QueueSend(sockaddr_in const & address, byte_t const * data, size_t dataSize);
+	NetDatagram const * PeekReceived();
+	void PopReceived();
+
+	bool IsRunning() const;
+
+private:
+	//Network thread
+	size_t ReceiveAll();
+	size_t SendAll();
+};
\ No newline at end of file
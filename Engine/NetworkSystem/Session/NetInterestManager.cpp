@@ -0,0 +1,344 @@
+#include "Engine/NetworkSystem/Session/NetInterestManager.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include "Engine/Core/Time.hpp"
+#include "Engine/DebugSystem/ErrorWarningAssert.hpp"
+#include "Engine/NetworkSystem/Session/INetworkedObject.hpp"
+#include "Engine/Utils/MathUtils.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC float const NetInterestManager::DEFAULT_CELL_SIZE = 16.f;
+
+
+//-------------------------------------------------------------------------------------------------
+NetConnectionInterest::NetConnectionInterest()
+	: hasView(false)
+	, viewPosition(0.f)
+	, viewRadius(0.f)
+	, bytesPerSecond(NetInterestManager::DEFAULT_BYTES_PER_SECOND)
+	, budgetBits((float)NetInterestManager::MAX_BURST_BITS)
+	, lastGatherTime(-1.0)
+{
+	//Nothing
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetInterestManager::NetInterestManager()
+	: m_cellSize(DEFAULT_CELL_SIZE)
+{
+	for(size_t connIndex = 0; connIndex < MAX_CONNECTIONS; ++connIndex)
+	{
+		m_connections[connIndex] = nullptr;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetInterestManager::~NetInterestManager()
+{
+	for(size_t connIndex = 0; connIndex < MAX_CONNECTIONS; ++connIndex)
+	{
+		delete m_connections[connIndex];
+		m_connections[connIndex] = nullptr;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Roughly the size of a typical view radius works best
+void NetInterestManager::SetCellSize(float cellSize)
+{
+	ASSERT_RECOVERABLE(cellSize > 0.f, "Cell size must be positive");
+	m_cellSize = cellSize;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetInterestManager::SetConnectionView(byte_t connectionIndex, Vector2f const & position, float radius)
+{
+	NetConnectionInterest * interest = GetConnection(connectionIndex);
+	interest->hasView = true;
+	interest->viewPosition = position;
+	interest->viewRadius = radius;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Without a view, everything is relevant
+void NetInterestManager::ClearConnectionView(byte_t connectionIndex)
+{
+	GetConnection(connectionIndex)->hasView = false;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetInterestManager::SetConnectionBudget(byte_t connectionIndex, size_t bytesPerSecond)
+{
+	GetConnection(connectionIndex)->bytesPerSecond = bytesPerSecond;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetInterestManager::RemoveConnection(byte_t connectionIndex)
+{
+	delete m_connections[connectionIndex];
+	m_connections[connectionIndex] = nullptr;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Indices line up with the list passed in
+void NetInterestManager::BuildGrid(std::vector<INetworkedObject*> const & objects)
+{
+	//Keep the cell vectors around so we don't reallocate every tick
+	for(auto cellIter = m_grid.begin(); cellIter != m_grid.end(); ++cellIter)
+	{
+		cellIter->second.clear();
+	}
+	m_unplacedObjects.clear();
+	m_previousNetworkIDs.swap(m_networkIDs);
+	m_networkIDs.resize(objects.size());
+	m_positions.resize(objects.size());
+	m_priorities.resize(objects.size());
+
+	for(size_t objectIndex = 0; objectIndex < objects.size(); ++objectIndex)
+	{
+		INetworkedObject const * object = objects[objectIndex];
+		m_networkIDs[objectIndex] = object->m_networkID;
+		m_priorities[objectIndex] = object->GetNetworkPriority();
+		if(object->GetNetworkPosition(&m_positions[objectIndex]))
+		{
+			int cellX = GetCellCoord(m_positions[objectIndex].x);
+			int cellY = GetCellCoord(m_positions[objectIndex].y);
+			m_grid[GetCellKey(cellX, cellY)].push_back(objectIndex);
+		}
+		else
+		{
+			m_unplacedObjects.push_back(objectIndex);
+		}
+	}
+
+	//Objects came or went, move everyone's priority to the new indices
+	if(m_networkIDs != m_previousNetworkIDs)
+	{
+		RemapAccumulators();
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Fills out relevant objects highest priority first, returns how many bits this connection can send
+// Pass the same vectors every call, the flags from last time are cleared in place
+size_t NetInterestManager::GatherRelevant(byte_t connectionIndex, std::vector<size_t> * out_objectIndices, std::vector<bool> * out_isRelevant)
+{
+	NetConnectionInterest * interest = GetConnection(connectionIndex);
+	size_t const objectCount = m_networkIDs.size();
+	out_isRelevant->resize(objectCount, false);
+	for(size_t relevantIndex = 0; relevantIndex < out_objectIndices->size(); ++relevantIndex)
+	{
+		size_t objectIndex = (*out_objectIndices)[relevantIndex];
+		if(objectIndex < objectCount)
+		{
+			(*out_isRelevant)[objectIndex] = false;
+		}
+	}
+	out_objectIndices->clear();
+	interest->priorityAccumulators.resize(objectCount, 0.f);
+
+	//Refill budget
+	double currentTime = Time::GetCurrentTimeSeconds();
+	double deltaSeconds = 0.0;
+	if(interest->lastGatherTime >= 0.0)
+	{
+		deltaSeconds = currentTime - interest->lastGatherTime;
+	}
+	interest->lastGatherTime = currentTime;
+	interest->budgetBits += (float)((double)(interest->bytesPerSecond * 8) * deltaSeconds);
+	interest->budgetBits = Min(interest->budgetBits, (float)MAX_BURST_BITS);
+
+	//Everyone hears about objects without a position
+	for(size_t unplacedIndex = 0; unplacedIndex < m_unplacedObjects.size(); ++unplacedIndex)
+	{
+		out_objectIndices->push_back(m_unplacedObjects[unplacedIndex]);
+	}
+
+	if(!interest->hasView)
+	{
+		for(auto cellIter = m_grid.begin(); cellIter != m_grid.end(); ++cellIter)
+		{
+			out_objectIndices->insert(out_objectIndices->end(), cellIter->second.begin(), cellIter->second.end());
+		}
+	}
+	else
+	{
+		//Only look at cells the view circle touches
+		Vector2f const & center = interest->viewPosition;
+		float radius = interest->viewRadius;
+		float radiusSquared = radius * radius;
+		int minCellX = GetCellCoord(center.x - radius);
+		int maxCellX = GetCellCoord(center.x + radius);
+		int minCellY = GetCellCoord(center.y - radius);
+		int maxCellY = GetCellCoord(center.y + radius);
+		size_t cellsCovered = (size_t)(maxCellX - minCellX + 1) * (size_t)(maxCellY - minCellY + 1);
+
+		//Huge view, cheaper to just walk the cells we have
+		if(cellsCovered > m_grid.size())
+		{
+			for(auto cellIter = m_grid.begin(); cellIter != m_grid.end(); ++cellIter)
+			{
+				GatherInRadius(cellIter->second, center, radiusSquared, out_objectIndices);
+			}
+		}
+		else
+		{
+			for(int cellY = minCellY; cellY <= maxCellY; ++cellY)
+			{
+				for(int cellX = minCellX; cellX <= maxCellX; ++cellX)
+				{
+					auto foundCell = m_grid.find(GetCellKey(cellX, cellY));
+					if(foundCell != m_grid.end())
+					{
+						GatherInRadius(foundCell->second, center, radiusSquared, out_objectIndices);
+					}
+				}
+			}
+		}
+	}
+
+	//Build up priority
+	std::vector<float> & accumulators = interest->priorityAccumulators;
+	m_sortKeys.resize(objectCount);
+	for(size_t relevantIndex = 0; relevantIndex < out_objectIndices->size(); ++relevantIndex)
+	{
+		size_t objectIndex = (*out_objectIndices)[relevantIndex];
+		(*out_isRelevant)[objectIndex] = true;
+		accumulators[objectIndex] += m_priorities[objectIndex];
+		m_sortKeys[objectIndex] = accumulators[objectIndex];
+	}
+
+	//Anything that fell out of view starts over when it comes back
+	for(size_t objectIndex = 0; objectIndex < objectCount; ++objectIndex)
+	{
+		if(!(*out_isRelevant)[objectIndex])
+		{
+			accumulators[objectIndex] = 0.f;
+		}
+	}
+
+	std::vector<float> const & sortKeys = m_sortKeys;
+	std::stable_sort(out_objectIndices->begin(), out_objectIndices->end(), [&sortKeys](size_t lhs, size_t rhs)
+	{
+		return sortKeys[lhs] > sortKeys[rhs];
+	});
+
+	return (interest->budgetBits > 0.f) ? (size_t)interest->budgetBits : 0;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Sent (or nothing needed sending), start building priority again
+void NetInterestManager::MarkSent(byte_t connectionIndex, size_t objectIndex)
+{
+	NetConnectionInterest * interest = GetConnection(connectionIndex);
+	if(objectIndex < interest->priorityAccumulators.size())
+	{
+		interest->priorityAccumulators[objectIndex] = 0.f;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetInterestManager::SpendBudget(byte_t connectionIndex, size_t bitsUsed)
+{
+	NetConnectionInterest * interest = GetConnection(connectionIndex);
+	interest->budgetBits -= (float)bitsUsed;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool NetInterestManager::IsRelevant(byte_t connectionIndex, Vector2f const & position) const
+{
+	NetConnectionInterest const * interest = m_connections[connectionIndex];
+	if(!interest || !interest->hasView)
+	{
+		return true;
+	}
+
+	float radiusSquared = interest->viewRadius * interest->viewRadius;
+	return DistanceBetweenPointsSquared(interest->viewPosition, position) <= radiusSquared;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetConnectionInterest * NetInterestManager::GetConnection(byte_t connectionIndex)
+{
+	if(!m_connections[connectionIndex])
+	{
+		m_connections[connectionIndex] = new NetConnectionInterest();
+	}
+	return m_connections[connectionIndex];
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Accumulators follow their object by network ID, new objects start at zero
+void NetInterestManager::RemapAccumulators()
+{
+	m_previousIndices.clear();
+	for(size_t previousIndex = 0; previousIndex < m_previousNetworkIDs.size(); ++previousIndex)
+	{
+		m_previousIndices[m_previousNetworkIDs[previousIndex]] = previousIndex;
+	}
+
+	for(size_t connIndex = 0; connIndex < MAX_CONNECTIONS; ++connIndex)
+	{
+		NetConnectionInterest * interest = m_connections[connIndex];
+		if(!interest)
+		{
+			continue;
+		}
+
+		std::vector<float> const & previous = interest->priorityAccumulators;
+		m_remappedAccumulators.assign(m_networkIDs.size(), 0.f);
+		for(size_t objectIndex = 0; objectIndex < m_networkIDs.size(); ++objectIndex)
+		{
+			auto foundPrevious = m_previousIndices.find(m_networkIDs[objectIndex]);
+			if(foundPrevious != m_previousIndices.end() && foundPrevious->second < previous.size())
+			{
+				m_remappedAccumulators[objectIndex] = previous[foundPrevious->second];
+			}
+		}
+		interest->priorityAccumulators.swap(m_remappedAccumulators);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetInterestManager::GatherInRadius(std::vector<size_t> const & cell, Vector2f const & center, float radiusSquared, std::vector<size_t> * out_objectIndices) const
+{
+	for(size_t cellIndex = 0; cellIndex < cell.size(); ++cellIndex)
+	{
+		size_t objectIndex = cell[cellIndex];
+		if(DistanceBetweenPointsSquared(center, m_positions[objectIndex]) <= radiusSquared)
+		{
+			out_objectIndices->push_back(objectIndex);
+		}
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+uint32_t NetInterestManager::GetCellKey(int cellX, int cellY) const
+{
+	return ((uint32_t)(uint16_t)cellY << 16) | (uint32_t)(uint16_t)cellX;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+int NetInterestManager::GetCellCoord(float position) const
+{
+	return (int)floorf(position / m_cellSize);
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Math/Vector2f.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+class INetworkedObject;
+
+
+//-------------------------------------------------------------------------------------------------
+class NetConnectionInterest
+{
+public:
+	bool hasView;
+	Vector2f viewPosition;
+	float viewRadius;
+	size_t bytesPerSecond;
+	float budgetBits;
+	double lastGatherTime;
+	std::vector<float> priorityAccumulators; //Indexed like the objects passed to BuildGrid
+
+public:
+	NetConnectionInterest();
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Decides what each connection hears about and in what order. Objects are put in a uniform grid once
+// per tick, and each connection only looks at the cells around its view. Relevant objects build up
+// priority every tick they aren't sent, and each connection gets a byte budget per second.
+class NetInterestManager
+{
+	//-------------------------------------------------------------------------------------------------
+	// Static Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	static size_t const MAX_CONNECTIONS = 256;
+	static float const DEFAULT_CELL_SIZE;
+	static size_t const DEFAULT_BYTES_PER_SECOND = 16 * 1024;
+	static size_t const MAX_BURST_BITS = 16000; //Budget can't save up more than this
+
+	//-------------------------------------------------------------------------------------------------
+	// Members
+	//-------------------------------------------------------------------------------------------------
+private:
+	float m_cellSize;
+	std::unordered_map<uint32_t, std::vector<size_t>> m_grid;
+	std::vector<size_t> m_unplacedObjects; //No position, relevant to everyone
+	std::vector<uint16_t> m_networkIDs;
+	std::vector<uint16_t> m_previousNetworkIDs;
+	std::unordered_map<uint16_t, size_t> m_previousIndices; //Only used when the object list changes
+	std::vector<float> m_remappedAccumulators;
+	std::vector<Vector2f> m_positions;
+	std::vector<float> m_priorities;
+	std::vector<float> m_sortKeys;
+	NetConnectionInterest * m_connections[MAX_CONNECTIONS];
+
+	//-------------------------------------------------------------------------------------------------
+	// Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	NetInterestManager();
+	~NetInterestManager();
+
+	void SetCellSize(float cellSize);
+	void SetConnectionView(byte_t connectionIndex, Vector2f const & position, float radius);
+	void ClearConnectionView(byte_t connectionIndex);
+	void SetConnectionBudget(byte_t connectionIndex, size_t bytesPerSecond);
+	void RemoveConnection(byte_t connectionIndex);
+
+	void BuildGrid(std::vector<INetworkedObject*> const & objects);
+	size_t GatherRelevant(byte_t connectionIndex, std::vector<size_t> * out_objectIndices, std::vector<bool> * out_isRelevant);
+	void MarkSent(byte_t connectionIndex, size_t objectIndex);
+	void SpendBudget(byte_t connectionIndex, size_t bitsUsed);
+	bool IsRelevant(byte_t connectionIndex, Vector2f const & position) const;
+
+private:
+	NetConnectionInterest * GetConnection(byte_t connectionIndex);
+	void RemapAccumulators();
+	void GatherInRadius(std::vector<size_t> const & cell, Vector2f const & center, float radiusSquared, std::vector<size_t> * out_objectIndices) const;
+	uint32_t GetCellKey(int cellX, int cellY) const;
+	int GetCellCoord(float position) const;
+};
\ No newline at end of file
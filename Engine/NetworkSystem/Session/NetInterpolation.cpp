@@ -0,0 +1,137 @@
+#include "Engine/NetworkSystem/Session/NetInterpolation.hpp"
+
+#include <cmath>
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC double const NetPlaybackClock::MIN_DELAY_SECONDS = 0.05;
+STATIC double const NetPlaybackClock::MAX_DELAY_SECONDS = 0.5;
+STATIC double const NetPlaybackClock::JITTER_DEVIATIONS = 3.0;
+
+
+//-------------------------------------------------------------------------------------------------
+NetPlaybackClock::NetPlaybackClock()
+{
+	Reset();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetPlaybackClock::~NetPlaybackClock()
+{
+	//Nothing
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Both times are host time, the received one from NetClockSync::GetHostTime(receivedTime). Round trip
+// variance comes from the host's NetConnection, half of it is a floor on the one way jitter for when
+// there haven't been enough snapshots to measure it
+void NetPlaybackClock::AddSample(double snapshotHostTime, double receivedHostTime, double roundTripVariance)
+{
+	++m_sampleCount;
+	double transitTime = receivedHostTime - snapshotHostTime;
+	if(!m_hasSample)
+	{
+		m_hasSample = true;
+		m_transitTime = transitTime;
+		m_lastHostTime = snapshotHostTime;
+		m_delay = m_transitTime + MIN_DELAY_SECONDS;
+		m_playbackTime = receivedHostTime - m_delay;
+		return;
+	}
+
+	if(snapshotHostTime < m_playbackTime)
+	{
+		++m_lateSnapshotCount;
+	}
+
+	//Out of order snapshots still say something about the transit time, but not the interval
+	if(snapshotHostTime > m_lastHostTime)
+	{
+		m_snapshotInterval += (snapshotHostTime - m_lastHostTime - m_snapshotInterval) * 0.125;
+		m_lastHostTime = snapshotHostTime;
+	}
+
+	double deviation = fabs(transitTime - m_transitTime);
+	m_transitTime += (transitTime - m_transitTime) * 0.125;
+	m_jitter += (deviation - m_jitter) * 0.0625;
+
+	double jitter = m_jitter;
+	if(roundTripVariance * 0.5 > jitter)
+	{
+		jitter = roundTripVariance * 0.5;
+	}
+
+	double delay = m_snapshotInterval + JITTER_DEVIATIONS * jitter;
+	if(delay < MIN_DELAY_SECONDS)
+	{
+		delay = MIN_DELAY_SECONDS;
+	}
+	else if(delay > MAX_DELAY_SECONDS)
+	{
+		delay = MAX_DELAY_SECONDS;
+	}
+	m_delay = m_transitTime + delay;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Once a frame with the session's host time, returns the host time to sample remote objects at
+double NetPlaybackClock::Update(double hostTime)
+{
+	if(!m_hasSample)
+	{
+		return m_playbackTime;
+	}
+
+	double playbackTime = hostTime - m_delay;
+	if(playbackTime > m_playbackTime)
+	{
+		m_playbackTime = playbackTime;
+	}
+	return m_playbackTime;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetPlaybackClock::Reset()
+{
+	m_transitTime = 0.0;
+	m_jitter = 0.0;
+	m_snapshotInterval = 0.0;
+	m_lastHostTime = 0.0;
+	m_delay = 0.0;
+	m_playbackTime = 0.0;
+	m_hasSample = false;
+	m_sampleCount = 0;
+	m_lateSnapshotCount = 0;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+double NetPlaybackClock::GetPlaybackTime() const
+{
+	return m_playbackTime;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+double NetPlaybackClock::GetDelay() const
+{
+	return m_delay;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+double NetPlaybackClock::GetJitter() const
+{
+	return m_jitter;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool NetPlaybackClock::HasSample() const
+{
+	return m_hasSample;
+}
\ No newline at end of file
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <vector>
+#include "Engine/Core/EngineCommon.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+// Decides how far behind the session's host time (NetSession::GetHostTime) to play remote objects.
+// Every snapshot is a sample of how long it took to get here in host time, the delay covers that
+// plus a snapshot interval plus a few deviations of jitter. Host time already comes from NetClockSync,
+// so there's no clock estimate of our own here. Playback never runs backwards: if host time snaps
+// back, playback holds until it catches up.
+class NetPlaybackClock
+{
+	//-------------------------------------------------------------------------------------------------
+	// Static Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	static double const MIN_DELAY_SECONDS;
+	static double const MAX_DELAY_SECONDS; //Not counting the time snapshots take to get here
+	static double const JITTER_DEVIATIONS; //How many deviations of jitter the delay covers
+
+	//-------------------------------------------------------------------------------------------------
+	// Members
+	//-------------------------------------------------------------------------------------------------
+private:
+	double m_transitTime; //Smoothed host time from a snapshot being sent to it arriving
+	double m_jitter; //Smoothed deviation from the transit time
+	double m_snapshotInterval; //Smoothed host time between snapshots
+	double m_lastHostTime;
+	double m_delay; //Host time - playback time
+	double m_playbackTime;
+	bool m_hasSample;
+
+public:
+	//debugging information
+	size_t m_sampleCount;
+	size_t m_lateSnapshotCount; //Showed up after playback had already passed them
+
+	//-------------------------------------------------------------------------------------------------
+	// Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	NetPlaybackClock();
+	~NetPlaybackClock();
+
+	void AddSample(double snapshotHostTime, double receivedHostTime, double roundTripVariance);
+	double Update(double hostTime);
+	void Reset();
+
+	double GetPlaybackTime() const;
+	double GetDelay() const;
+	double GetJitter() const;
+	bool HasSample() const;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Not clamped, fractions past 1 keep going (that's the extrapolation). Works for anything with + - and
+// float *, overload it for states that don't (angles, structs of several values, ...).
+template<typename StateType>
+StateType NetLerp(StateType const & start, StateType const & end, float fraction)
+{
+	return start + fraction * (end - start);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Received states for a fixed number of remote objects, all sampled at the same playback time once a
+// frame (see NetLerp for what StateType needs). Slots are the game's to hand out, all storage is made
+// up front and laid out by slot so the whole batch walks memory in order.
+template<typename StateType, size_t HISTORY_SIZE = 32>
+class NetInterpolationBuffer
+{
+	//-------------------------------------------------------------------------------------------------
+	// Members
+	//-------------------------------------------------------------------------------------------------
+private:
+	size_t m_slotCount;
+	std::vector<double> m_times; //HISTORY_SIZE per slot, ring ordered
+	std::vector<StateType> m_states;
+	std::vector<size_t> m_heads; //Where the next state goes
+	std::vector<size_t> m_counts;
+	std::vector<StateType> m_results;
+
+public:
+	//debugging information
+	size_t m_extrapolatedCount; //Last InterpolateAll()
+	size_t m_heldCount; //Last InterpolateAll(), past the extrapolation limit
+	size_t m_outOfOrderCount;
+
+	//-------------------------------------------------------------------------------------------------
+	// Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	NetInterpolationBuffer(size_t slotCount)
+		: m_slotCount(slotCount)
+		, m_times(slotCount * HISTORY_SIZE, 0.0)
+		, m_states(slotCount * HISTORY_SIZE)
+		, m_heads(slotCount, 0)
+		, m_counts(slotCount, 0)
+		, m_results(slotCount)
+		, m_extrapolatedCount(0)
+		, m_heldCount(0)
+		, m_outOfOrderCount(0)
+	{
+		//Nothing
+	}
+
+	//Call when a slot is handed to a new object
+	void Clear(size_t slot)
+	{
+		m_heads[slot] = 0;
+		m_counts[slot] = 0;
+	}
+
+	//States have to come in time order, anything older than the newest is thrown out
+	bool Push(size_t slot, double time, StateType const & state)
+	{
+		size_t base = slot * HISTORY_SIZE;
+		if(m_counts[slot] > 0)
+		{
+			double newestTime = m_times[base + (m_heads[slot] + HISTORY_SIZE - 1) % HISTORY_SIZE];
+			if(time <= newestTime)
+			{
+				++m_outOfOrderCount;
+				return false;
+			}
+		}
+
+		m_times[base + m_heads[slot]] = time;
+		m_states[base + m_heads[slot]] = state;
+		m_heads[slot] = (m_heads[slot] + 1) % HISTORY_SIZE;
+		if(m_counts[slot] < HISTORY_SIZE)
+		{
+			++m_counts[slot];
+		}
+		return true;
+	}
+
+	//Past the newest state, objects keep going the way they were for up to maxExtrapolationSeconds
+	//and then hold there until something new shows up
+	void InterpolateAll(double playbackTime, double maxExtrapolationSeconds)
+	{
+		m_extrapolatedCount = 0;
+		m_heldCount = 0;
+		for(size_t slot = 0; slot < m_slotCount; ++slot)
+		{
+			size_t count = m_counts[slot];
+			if(count == 0)
+			{
+				continue;
+			}
+
+			size_t base = slot * HISTORY_SIZE;
+			size_t newest = (m_heads[slot] + HISTORY_SIZE - 1) % HISTORY_SIZE;
+			size_t oldest = (m_heads[slot] + HISTORY_SIZE - count) % HISTORY_SIZE;
+			if(count == 1 || playbackTime <= m_times[base + oldest])
+			{
+				m_results[slot] = (playbackTime <= m_times[base + oldest]) ? m_states[base + oldest] : m_states[base + newest];
+				continue;
+			}
+
+			//Playback is usually only a few states behind the newest, so search back from there
+			size_t after = newest;
+			size_t before = (newest + HISTORY_SIZE - 1) % HISTORY_SIZE;
+			double sampleTime = playbackTime;
+			if(playbackTime >= m_times[base + newest])
+			{
+				double extrapolateLimit = m_times[base + newest] + maxExtrapolationSeconds;
+				if(sampleTime > extrapolateLimit)
+				{
+					sampleTime = extrapolateLimit;
+					++m_heldCount;
+				}
+				++m_extrapolatedCount;
+			}
+			else
+			{
+				while(m_times[base + before] > playbackTime)
+				{
+					after = before;
+					before = (before + HISTORY_SIZE - 1) % HISTORY_SIZE;
+				}
+			}
+
+			double beforeTime = m_times[base + before];
+			double span = m_times[base + after] - beforeTime;
+			float fraction = (span > 0.0) ? (float)((sampleTime - beforeTime) / span) : 1.f;
+			m_results[slot] = NetLerp(m_states[base + before], m_states[base + after], fraction);
+		}
+	}
+
+	StateType const & GetResult(size_t slot) const
+	{
+		return m_results[slot];
+	}
+
+	bool HasState(size_t slot) const
+	{
+		return m_counts[slot] > 0;
+	}
+
+	size_t GetSlotCount() const
+	{
+		return m_slotCount;
+	}
+};
\ No newline at end of file
@@ -3,9 +3,24 @@
 //include for NetSender
 #include "Engine/NetworkSystem/Session/NetPacket.hpp"
 #include "Engine/NetworkSystem/Session/NetConnection.hpp"
+#include "Engine/NetworkSystem/Session/NetMessagePool.hpp"
 #include "Engine/NetworkSystem/Session/NetSession.hpp"
 
 
+//-------------------------------------------------------------------------------------------------
+STATIC void * NetMessage::operator new(size_t size)
+{
+	return NetMessagePool::Allocate(size);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC void NetMessage::operator delete(void * message, size_t size)
+{
+	NetMessagePool::Free(message, size);
+}
+
+
 //-------------------------------------------------------------------------------------------------
 NetMessage::NetMessage(byte_t type /*= eNetMessageType_INVALID*/)
 	: NetMessage(type, NetSession::INVALID_INDEX)
@@ -16,15 +31,20 @@ NetMessage::NetMessage(byte_t type /*= eNetMessageType_INVALID*/)
 
 //-------------------------------------------------------------------------------------------------
 NetMessage::NetMessage(byte_t type, byte_t senderIndex)
-	: BytePacker(m_data, MAX_SIZE, 0)
+	: BytePacker(NetMessagePool::Allocate(MAX_SIZE), MAX_SIZE, 0)
 	, m_sentTimeStamp(0.0)
+	, m_resendTimeStamp(0.0)
+	, m_expireTime(0.0)
+	, m_resendCount(0)
 	, m_definition(nullptr)
 	, m_type((byte_t)type)
 	, m_reliableID(INVALID_RELIABLE_ID)
 	, m_sequenceID(0)
+	, m_receiptID(INVALID_RECEIPT_ID)
 	, m_senderIndex(senderIndex)
 	, m_next(nullptr)
 	, m_prev(nullptr)
+	, m_isView(false)
 {
 	//Nothing
 }
@@ -32,18 +52,99 @@ NetMessage::NetMessage(byte_t type, byte_t senderIndex)
 
 //-------------------------------------------------------------------------------------------------
 NetMessage::NetMessage(byte_t * buffer, size_t bufferSize)
-	: BytePacker(m_data, MAX_SIZE, bufferSize)
+	: BytePacker(NetMessagePool::Allocate(bufferSize), NetMessagePool::GetBlockSize(bufferSize), bufferSize)
+	, m_sentTimeStamp(0.0)
+	, m_resendTimeStamp(0.0)
+	, m_expireTime(0.0)
+	, m_resendCount(0)
+	, m_definition(nullptr)
+	, m_type((byte_t)-1)
+	, m_reliableID(INVALID_RELIABLE_ID)
+	, m_sequenceID(0)
+	, m_receiptID(INVALID_RECEIPT_ID)
+	, m_senderIndex(NetSession::INVALID_INDEX)
+	, m_next(nullptr)
+	, m_prev(nullptr)
+	, m_isView(false)
+{
+	memcpy(m_buffer, buffer, bufferSize);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetMessage::NetMessage(NetPacket const & packet)
+	: BytePacker(packet.GetHead(), 0, 0)
 	, m_sentTimeStamp(0.0)
+	, m_resendTimeStamp(0.0)
+	, m_expireTime(0.0)
+	, m_resendCount(0)
 	, m_definition(nullptr)
 	, m_type((byte_t)-1)
 	, m_reliableID(INVALID_RELIABLE_ID)
 	, m_sequenceID(0)
+	, m_receiptID(INVALID_RECEIPT_ID)
 	, m_senderIndex(NetSession::INVALID_INDEX)
 	, m_next(nullptr)
 	, m_prev(nullptr)
+	, m_isView(true)
 {
-	memcpy(m_data, buffer, bufferSize);
-	m_buffer = m_data;
+	//Nothing
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetMessage::NetMessage(byte_t type, byte_t * data, size_t dataSize)
+	: BytePacker(data, dataSize, dataSize)
+	, m_sentTimeStamp(0.0)
+	, m_resendTimeStamp(0.0)
+	, m_expireTime(0.0)
+	, m_resendCount(0)
+	, m_definition(nullptr)
+	, m_type(type)
+	, m_reliableID(INVALID_RELIABLE_ID)
+	, m_sequenceID(0)
+	, m_receiptID(INVALID_RECEIPT_ID)
+	, m_senderIndex(NetSession::INVALID_INDEX)
+	, m_next(nullptr)
+	, m_prev(nullptr)
+	, m_isView(true)
+{
+	//Nothing
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetMessage::NetMessage(NetMessage const & copy)
+	: BytePacker(NetMessagePool::Allocate(copy.m_bufferSize), NetMessagePool::GetBlockSize(copy.m_bufferSize), copy.m_bufferSize)
+	, m_sentTimeStamp(copy.m_sentTimeStamp)
+	, m_resendTimeStamp(copy.m_resendTimeStamp)
+	, m_expireTime(copy.m_expireTime)
+	, m_resendCount(copy.m_resendCount)
+	, m_definition(copy.m_definition)
+	, m_type(copy.m_type)
+	, m_reliableID(copy.m_reliableID)
+	, m_sequenceID(copy.m_sequenceID)
+	, m_ackID(copy.m_ackID)
+	, m_receiptID(copy.m_receiptID)
+	, m_senderIndex(copy.m_senderIndex)
+	, m_next(nullptr)
+	, m_prev(nullptr)
+	, m_isView(false)
+{
+	m_offset = copy.m_offset;
+	m_endianness = copy.m_endianness;
+	memcpy(m_buffer, copy.m_buffer, copy.m_bufferSize);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetMessage::~NetMessage()
+{
+	if(!m_isView)
+	{
+		NetMessagePool::Free(m_buffer, m_bufferMax);
+	}
+	m_buffer = nullptr;
 }
 
 
@@ -54,6 +155,17 @@ void NetMessage::Process(NetSender const & senderInfo) const
 }
 
 
+//-------------------------------------------------------------------------------------------------
+void NetMessage::SetView(byte_t * data, size_t dataSize)
+{
+	ASSERT_RECOVERABLE(m_isView, "Only view messages can point at outside data");
+	m_buffer = data;
+	m_bufferMax = dataSize;
+	m_bufferSize = dataSize;
+	Rewind();
+}
+
+
 //-------------------------------------------------------------------------------------------------
 size_t NetMessage::GetPayloadSize() const
 {
@@ -81,10 +193,17 @@ eNetMessageType NetMessage::GetNetMessageType() const
 }
 
 
+//-------------------------------------------------------------------------------------------------
+bool NetMessage::IsView() const
+{
+	return m_isView;
+}
+
+
 //-------------------------------------------------------------------------------------------------
 NetMessage * NetMessage::Copy() const
 {
-	NetMessage * copy = new NetMessage(*this);
-	copy->m_buffer = copy->m_data;
-	return copy;
+	//Only copies the bytes written, resends reuse this copy until it's confirmed
+	//Copies of views own their bytes, so they can outlive the packet
+	return new NetMessage(*this);
 }
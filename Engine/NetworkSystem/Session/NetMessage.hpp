@@ -5,6 +5,7 @@
 
 
 //-------------------------------------------------------------------------------------------------
+class NetPacket;
 class NetSender;
 
 
@@ -19,36 +20,60 @@ private:
 
 public:
 	static uint16_t const INVALID_RELIABLE_ID = 65535;
+	static uint16_t const INVALID_RECEIPT_ID = 65535;
 
 	//-------------------------------------------------------------------------------------------------
 	// Members
 	//-------------------------------------------------------------------------------------------------
 public:
 	double m_sentTimeStamp;
+	double m_resendTimeStamp; //Reliables only, when to send it again if it hasn't been confirmed
+	double m_expireTime; //Unreliables only, dropped instead of sent after this
+	byte_t m_resendCount;
 	NetMessageDefinition const * m_definition;
 	byte_t m_type;
 	uint16_t m_reliableID;
 	uint16_t m_sequenceID;
 	uint16_t m_ackID;
+	uint16_t m_receiptID; //Set to get an ON_RECEIPT_CONFIRMED_EVENT when the packet carrying this is acked
 	byte_t m_senderIndex;
 	NetMessage * m_next;
 	NetMessage * m_prev;
 
 private:
-	byte_t m_data[MAX_SIZE];
+	bool m_isView; //Points into a packet's buffer, doesn't own it
+
+	//-------------------------------------------------------------------------------------------------
+	// Static Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	static void * operator new(size_t size);
+	static void operator delete(void * message, size_t size);
 
 	//-------------------------------------------------------------------------------------------------
 	// Functions
 	//-------------------------------------------------------------------------------------------------
 public:
+	//Payload comes from NetMessagePool: new messages get a full block to write into,
+	//copies only get a block as big as what was written
 	NetMessage(byte_t type = eNetMessageType_INVALID);
 	NetMessage(byte_t type, byte_t senderIndex);
 	NetMessage(byte_t * buffer, size_t bufferSize);
+	//Read-only view into a received packet, valid only as long as the packet is. Copy() it to keep it.
+	NetMessage(NetPacket const & packet);
+	//Read-only view of a whole payload somewhere else (like a reassembled fragment transfer)
+	NetMessage(byte_t type, byte_t * data, size_t dataSize);
+	NetMessage(NetMessage const & copy);
+	~NetMessage();
+
+	NetMessage & operator=(NetMessage const &) = delete;
 
 	void Process(NetSender const & senderInfo) const;
+	void SetView(byte_t * data, size_t dataSize);
 
 	size_t GetPayloadSize() const;
 	size_t GetTotalWrittenMessageSize() const;
 	eNetMessageType GetNetMessageType() const;
+	bool IsView() const;
 	NetMessage * Copy() const;
 };
\ No newline at end of file
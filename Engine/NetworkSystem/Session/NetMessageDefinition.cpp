@@ -46,4 +46,12 @@ bool NetMessageDefinition::IsReliable() const
 bool NetMessageDefinition::IsSequence() const
 {
 	return IsBitfieldSet(optionFlags, SEQUENCE_OPTION_FLAG);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Reliables have to get there no matter how late
+bool NetMessageDefinition::CanExpire() const
+{
+	return !IsReliable();
 }
\ No newline at end of file
@@ -21,6 +21,10 @@ enum eNetMessageType : byte_t
 	eNetMessageType_JOIN_DENY,
 	eNetMessageType_JOIN_ACCEPT,
 	eNetMessageType_LEAVE,
+	eNetMessageType_SNAPSHOT,
+	eNetMessageType_FRAGMENT,
+	eNetMessageType_INPUT,
+	eNetMessageType_INPUT_ACK,
 	eNetMessageType_COUNT,
 	eNetMessageType_INVALID = 255,
 };
@@ -36,6 +40,10 @@ public:
 	static byte_t const CONNECTIONLESS_CONTROL_FLAG = BIT(0);
 	static byte_t const RELIABLE_OPTION_FLAG = BIT(0);
 	static byte_t const SEQUENCE_OPTION_FLAG = BIT(1);
+	//Higher goes out first, same priority goes out in the order it was added
+	static byte_t const LOW_PRIORITY = 64;
+	static byte_t const DEFAULT_PRIORITY = 128;
+	static byte_t const HIGH_PRIORITY = 192;
 
 	//-------------------------------------------------------------------------------------------------
 	// Members
@@ -47,6 +55,8 @@ public:
 	byte_t sequenceChannelID;
 	size_t headerSize;
 	MessageCallback * callback;
+	byte_t priority;
+	float expireSeconds; //Unreliables only, how long one can wait for room in a packet (0 = only the next send)
 
 	//-------------------------------------------------------------------------------------------------
 	// Functions
@@ -56,4 +66,5 @@ public:
 	bool IsConnectionless() const;
 	bool IsReliable() const;
 	bool IsSequence() const;
+	bool CanExpire() const;
 };
\ No newline at end of file
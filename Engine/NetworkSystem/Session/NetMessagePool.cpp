@@ -0,0 +1,100 @@
+#include "Engine/NetworkSystem/Session/NetMessagePool.hpp"
+
+#include "Engine/DebugSystem/BConsoleSystem.hpp"
+#include "Engine/Utils/StringUtils.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC BlockNode * NetMessagePool::s_freeLists[SIZE_CLASS_COUNT] = {nullptr};
+STATIC size_t NetMessagePool::s_usedBlocks[SIZE_CLASS_COUNT] = {0};
+STATIC size_t NetMessagePool::s_highBlockCount[SIZE_CLASS_COUNT] = {0};
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC byte_t * NetMessagePool::Allocate(size_t size)
+{
+	size_t sizeClass = GetSizeClass(size);
+	if(!s_freeLists[sizeClass])
+	{
+		AddChunk(sizeClass);
+	}
+
+	//Pop the head of the free list
+	BlockNode * block = s_freeLists[sizeClass];
+	s_freeLists[sizeClass] = block->next;
+
+	++s_usedBlocks[sizeClass];
+	if(s_usedBlocks[sizeClass] > s_highBlockCount[sizeClass])
+	{
+		s_highBlockCount[sizeClass] = s_usedBlocks[sizeClass];
+	}
+	return (byte_t*)block;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Size must be the same size that was asked for in Allocate()
+STATIC void NetMessagePool::Free(void * block, size_t size)
+{
+	if(!block)
+	{
+		return;
+	}
+
+	size_t sizeClass = GetSizeClass(size);
+	BlockNode * freed = (BlockNode*)block;
+	freed->next = s_freeLists[sizeClass];
+	s_freeLists[sizeClass] = freed;
+	--s_usedBlocks[sizeClass];
+}
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC size_t NetMessagePool::GetBlockSize(size_t size)
+{
+	return MIN_BLOCK_SIZE << GetSizeClass(size);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC void NetMessagePool::PrintStats()
+{
+	for(size_t sizeClass = 0; sizeClass < SIZE_CLASS_COUNT; ++sizeClass)
+	{
+		BConsoleSystem::AddLog(Stringf("%4u Byte Blocks: %u used, %u high", MIN_BLOCK_SIZE << sizeClass, s_usedBlocks[sizeClass], s_highBlockCount[sizeClass]), BConsoleSystem::INFO);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC size_t NetMessagePool::GetSizeClass(size_t size)
+{
+	ASSERT_RECOVERABLE(size <= MAX_BLOCK_SIZE, "NetMessagePool block too large");
+
+	size_t sizeClass = 0;
+	size_t blockSize = MIN_BLOCK_SIZE;
+	while(blockSize < size && sizeClass < SIZE_CLASS_COUNT - 1)
+	{
+		blockSize <<= 1;
+		++sizeClass;
+	}
+	return sizeClass;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Chunks are never given back, the pool only grows to the high water mark
+STATIC void NetMessagePool::AddChunk(size_t sizeClass)
+{
+	size_t blockSize = MIN_BLOCK_SIZE << sizeClass;
+	size_t blockCount = CHUNK_SIZE / blockSize;
+	byte_t * chunk = (byte_t*)malloc(CHUNK_SIZE);
+
+	//Push back to front so blocks come out in address order
+	for(int blockIndex = (int)blockCount - 1; blockIndex >= 0; --blockIndex)
+	{
+		BlockNode * node = (BlockNode*)(chunk + blockIndex * blockSize);
+		node->next = s_freeLists[sizeClass];
+		s_freeLists[sizeClass] = node;
+	}
+}
\ No newline at end of file
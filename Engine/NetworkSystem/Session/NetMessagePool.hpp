@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/MemorySystem/ObjectPool.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+// Free lists of power of two blocks (16 to 1024 bytes) for message payloads and the messages
+// themselves. Chunks are grabbed as needed and kept for reuse, so steady traffic never hits the heap.
+// Game thread only.
+class NetMessagePool
+{
+	//-------------------------------------------------------------------------------------------------
+	// Static Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	static size_t const MIN_BLOCK_SIZE = 16;
+	static size_t const MAX_BLOCK_SIZE = 1024;
+	static size_t const SIZE_CLASS_COUNT = 7; //16, 32, 64, 128, 256, 512, 1024
+	static size_t const CHUNK_SIZE = 16 * 1024;
+
+private:
+	static BlockNode * s_freeLists[SIZE_CLASS_COUNT];
+	static size_t s_usedBlocks[SIZE_CLASS_COUNT];
+	static size_t s_highBlockCount[SIZE_CLASS_COUNT];
+
+	//-------------------------------------------------------------------------------------------------
+	// Static Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	static byte_t * Allocate(size_t size);
+	static void Free(void * block, size_t size);
+	static size_t GetBlockSize(size_t size);
+	static void PrintStats();
+
+private:
+	static size_t GetSizeClass(size_t size);
+	static void AddChunk(size_t sizeClass);
+};
\ No newline at end of file
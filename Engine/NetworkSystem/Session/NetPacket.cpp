@@ -17,9 +17,17 @@ NetPacket::NetPacket()
 void NetPacket::WriteHeader(PacketHeader * header)
 {
 	Write<uint8_t>(header->fromConnIndex);
+	Write<uint8_t>(header->flags);
 	Write<uint16_t>(header->packetAck);
 	Write<uint16_t>(header->mostRecentReceivedAck);
-	Write<uint16_t>(header->previousReceivedAcksBitfield);
+
+	//Byte count, then the low bytes of the bitfield
+	size_t ackByteCount = header->GetAckBitfieldByteCount();
+	Write<uint8_t>((uint8_t)ackByteCount);
+	for(size_t byteIndex = 0; byteIndex < ackByteCount; ++byteIndex)
+	{
+		Write<uint8_t>((uint8_t)(header->previousReceivedAcksBitfield >> (byteIndex * 8)));
+	}
 }
 
 
@@ -108,13 +116,31 @@ bool NetPacket::WriteMessage(NetMessage const * message)
 
 
 //-------------------------------------------------------------------------------------------------
-void NetPacket::ReadHeader(PacketHeader * header) const
+// False if the header runs off the end of the packet or the ack bitfield is too wide
+bool NetPacket::ReadHeader(PacketHeader * header) const
 {
-	Read<uint8_t>(&(header->fromConnIndex));
-	Read<uint16_t>(&(header->packetAck));
-	Read<uint16_t>(&(header->mostRecentReceivedAck));
-	Read<uint16_t>(&(header->previousReceivedAcksBitfield));
-	Read<uint8_t>(&(header->messageCount));
+	bool valid = Read<uint8_t>(&(header->fromConnIndex));
+	valid = valid && Read<uint8_t>(&(header->flags));
+	valid = valid && Read<uint16_t>(&(header->packetAck));
+	valid = valid && Read<uint16_t>(&(header->mostRecentReceivedAck));
+
+	uint8_t ackByteCount = 0;
+	valid = valid && Read<uint8_t>(&ackByteCount);
+	valid = valid && ackByteCount <= sizeof(uint64_t);
+	header->previousReceivedAcksBitfield = 0;
+	for(uint8_t byteIndex = 0; valid && byteIndex < ackByteCount; ++byteIndex)
+	{
+		uint8_t ackByte;
+		valid = Read<uint8_t>(&ackByte);
+		header->previousReceivedAcksBitfield |= (uint64_t)ackByte << (byteIndex * 8);
+	}
+
+	valid = valid && Read<uint8_t>(&(header->messageCount));
+	if(!valid)
+	{
+		header->messageCount = 0;
+	}
+	return valid;
 }
 
 
@@ -19,6 +19,7 @@ public:
 	NetSession * session;
 	NetConnection * connection;
 	sockaddr_in fromAddress;
+	double receivedTime;
 };
 
 
@@ -27,15 +28,26 @@ class PacketHeader
 {
 public:
 	uint8_t fromConnIndex;
+	uint8_t flags;
 	uint16_t packetAck;
 	uint16_t mostRecentReceivedAck;
-	uint16_t previousReceivedAcksBitfield;
+	uint64_t previousReceivedAcksBitfield; //Written with only as many bytes as it needs
 	uint8_t messageCount;
 
 public:
 	size_t const GetTotalWrittenHeaderSize()
 	{
-		return sizeof(uint8_t) * 2 + sizeof(uint16_t) * 3;
+		return sizeof(uint8_t) * 4 + sizeof(uint16_t) * 2 + GetAckBitfieldByteCount();
+	};
+
+	size_t GetAckBitfieldByteCount() const
+	{
+		size_t byteCount = 0;
+		while(byteCount < sizeof(uint64_t) && (previousReceivedAcksBitfield >> (byteCount * 8)) != 0)
+		{
+			++byteCount;
+		}
+		return byteCount;
 	};
 };
 
@@ -48,6 +60,7 @@ class NetPacket : public BytePacker
 	//-------------------------------------------------------------------------------------------------
 public:
 	static size_t const MAX_SIZE = 1444;
+	static byte_t const COMPRESSED_PACKET_FLAG = BIT(0);
 
 	//-------------------------------------------------------------------------------------------------
 	// Members
@@ -68,7 +81,7 @@ public:
 	bool CanWriteMessage(NetMessage const * message) const;
 	bool WriteMessage(NetMessage const * message);
 
-	void ReadHeader(PacketHeader * header) const;
+	bool ReadHeader(PacketHeader * header) const;
 
 	size_t GetSize() const;
 	NetPacket * Copy() const;
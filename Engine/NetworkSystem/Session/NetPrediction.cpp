@@ -0,0 +1,407 @@
+#include "Engine/NetworkSystem/Session/NetPrediction.hpp"
+
+#include <cstring>
+#include "Engine/Core/NamedProperties.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/DebugSystem/ErrorWarningAssert.hpp"
+#include "Engine/EventSystem/BEventSystem.hpp"
+#include "Engine/NetworkSystem/Session/NetConnection.hpp"
+#include "Engine/NetworkSystem/Session/NetMessage.hpp"
+#include "Engine/NetworkSystem/Session/NetPacket.hpp"
+#include "Engine/NetworkSystem/Session/NetSession.hpp"
+#include "Engine/Utils/BitPacker.hpp"
+#include "Engine/Utils/BytePacker.hpp"
+#include "Engine/Utils/MathUtils.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC float const NetPrediction::STATE_RESEND_SECONDS = 0.25f;
+
+
+//-------------------------------------------------------------------------------------------------
+void OnInput(NetSender const & sender, NetMessage const & message)
+{
+	NetPrediction * prediction = sender.session->GetPrediction();
+	if(prediction)
+	{
+		prediction->ReceiveInput(sender, message);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void OnInputAck(NetSender const & sender, NetMessage const & message)
+{
+	NetPrediction * prediction = sender.session->GetPrediction();
+	if(prediction)
+	{
+		prediction->ReceiveInputAck(sender, message);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetPrediction::NetPrediction(NetSession * session)
+	: m_session(session)
+	, m_localObject(nullptr)
+	, m_nextInputID(0)
+	, m_oldestUnackedInputID(0)
+	, m_lastAckedInputID(0)
+	, m_hasAck(false)
+	, m_reconcileCount(0)
+	, m_replayedInputCount(0)
+	, m_droppedInputCount(0)
+	, m_appliedInputCount(0)
+	, m_skippedInputCount(0)
+{
+	for(size_t connIndex = 0; connIndex < MAX_CONNECTIONS; ++connIndex)
+	{
+		m_hostStates[connIndex].object = nullptr;
+		m_hostStates[connIndex].lastAppliedInputID = 0;
+		m_hostStates[connIndex].hasAppliedInput = false;
+		m_hostStates[connIndex].isStateDirty = false;
+		m_hostStates[connIndex].lastStateSentTime = 0.0;
+	}
+
+	m_session->SetPrediction(this);
+	BEventSystem::RegisterEvent(NetSession::PREPARE_PACKET_EVENT, this, &NetPrediction::OnPreparePacket);
+	BEventSystem::RegisterEvent(NetSession::ON_CONNECTION_LEAVE_EVENT, this, &NetPrediction::OnConnectionLeave);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetPrediction::~NetPrediction()
+{
+	BEventSystem::Unregister(this);
+
+	if(m_session->GetPrediction() == this)
+	{
+		m_session->SetPrediction(nullptr);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Client side, inputs made before this are thrown out
+void NetPrediction::SetLocalObject(INetPredictedObject * object)
+{
+	m_localObject = object;
+	ResetClient();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Call once per simulation tick on the client that owns the local object. The input is applied
+// right away. The host applies its own inputs directly, it has nothing to predict.
+uint16_t NetPrediction::AddInput(byte_t const * data, size_t dataSize, float deltaSeconds)
+{
+	ASSERT_RECOVERABLE(dataSize <= NetInputCommand::MAX_DATA_SIZE, "Input is larger than MAX_DATA_SIZE");
+	dataSize = Min(dataSize, NetInputCommand::MAX_DATA_SIZE);
+
+	//Ring is full, the oldest input gets forgotten and can't be replayed anymore
+	if(GetUnackedInputCount() >= INPUT_HISTORY_SIZE)
+	{
+		++m_oldestUnackedInputID;
+		++m_droppedInputCount;
+	}
+
+	uint16_t inputID = m_nextInputID;
+	NetInputCommand & input = GetInput(inputID);
+	input.inputID = inputID;
+	input.clientTime = Time::GetCurrentTimeSeconds();
+	input.deltaSeconds = deltaSeconds;
+	input.dataSize = (uint8_t)dataSize;
+	memcpy(input.data, data, dataSize);
+
+	if(m_localObject)
+	{
+		m_localObject->ApplyInput(input);
+	}
+
+	if(m_session->IsHost())
+	{
+		m_oldestUnackedInputID = inputID + 1;
+	}
+	++m_nextInputID;
+	return inputID;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+uint16_t NetPrediction::GetUnackedInputCount() const
+{
+	return (uint16_t)(m_nextInputID - m_oldestUnackedInputID);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Host side, the object a client's inputs drive. Pass nullptr to stop taking their inputs.
+void NetPrediction::SetControlledObject(NetConnection const * connection, INetPredictedObject * object)
+{
+	byte_t index = connection->GetIndex();
+	if(index >= MAX_CONNECTIONS)
+	{
+		return;
+	}
+
+	NetPredictionHostState & state = m_hostStates[index];
+	state.object = object;
+	state.hasAppliedInput = false;
+	state.isStateDirty = false;
+	state.lastStateSentTime = 0.0;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetPrediction::OnPreparePacket(NamedProperties & netEvent)
+{
+	NetConnection * connection = nullptr;
+	netEvent.Get("connection", connection);
+	if(!connection || connection->GetSession() != m_session || connection->IsSelf())
+	{
+		return;
+	}
+
+	if(m_session->IsHost())
+	{
+		byte_t index = connection->GetIndex();
+		if(index < MAX_CONNECTIONS && m_hostStates[index].object)
+		{
+			SendState(connection, &m_hostStates[index]);
+		}
+	}
+	else if(connection->IsHost())
+	{
+		SendInputs(connection);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetPrediction::OnConnectionLeave(NamedProperties & netEvent)
+{
+	NetConnection * connection = nullptr;
+	netEvent.Get("connection", connection);
+	if(!connection || connection->GetSession() != m_session)
+	{
+		return;
+	}
+
+	//Lost the host, nothing we sent is ever getting acked
+	if(connection->IsHost() && !connection->IsSelf())
+	{
+		ResetClient();
+	}
+
+	byte_t index = connection->GetIndex();
+	if(index < MAX_CONNECTIONS)
+	{
+		m_hostStates[index].object = nullptr;
+		m_hostStates[index].hasAppliedInput = false;
+		m_hostStates[index].isStateDirty = false;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Host side. Every message repeats all the unacked inputs, so most of them have been applied already.
+void NetPrediction::ReceiveInput(NetSender const & sender, NetMessage const & message)
+{
+	if(!m_session->IsHost() || !sender.connection)
+	{
+		return;
+	}
+
+	byte_t index = sender.connection->GetIndex();
+	if(index >= MAX_CONNECTIONS || !m_hostStates[index].object)
+	{
+		return;
+	}
+	NetPredictionHostState & state = m_hostStates[index];
+
+	uint16_t firstInputID;
+	uint8_t inputCount;
+	double firstClientTime;
+	if(!message.Read<uint16_t>(&firstInputID)
+		|| !message.Read<uint8_t>(&inputCount)
+		|| !message.Read<double>(&firstClientTime)
+		|| inputCount > MAX_INPUTS_PER_MESSAGE)
+	{
+		++m_session->m_invalidMessageCount;
+		return;
+	}
+
+	NetInputCommand input;
+	for(uint8_t inputIndex = 0; inputIndex < inputCount; ++inputIndex)
+	{
+		float timeOffset;
+		input.inputID = firstInputID + inputIndex;
+		if(!message.Read<float>(&timeOffset)
+			|| !message.Read<float>(&input.deltaSeconds)
+			|| !message.Read<uint8_t>(&input.dataSize)
+			|| input.dataSize > NetInputCommand::MAX_DATA_SIZE
+			|| !message.Read(input.data, input.dataSize))
+		{
+			++m_session->m_invalidMessageCount;
+			return;
+		}
+		input.clientTime = firstClientTime + (double)timeOffset;
+
+		if(state.hasAppliedInput)
+		{
+			if(!GreaterThanCycle(input.inputID, state.lastAppliedInputID))
+			{
+				continue;
+			}
+
+			//Every message that had these got lost, go on without them
+			m_skippedInputCount += (uint16_t)(input.inputID - state.lastAppliedInputID - 1);
+		}
+
+		state.object->ApplyInput(input);
+		state.lastAppliedInputID = input.inputID;
+		state.hasAppliedInput = true;
+		state.isStateDirty = true;
+		++m_appliedInputCount;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Client side. Reset to what the host has, then replay everything it hasn't seen yet.
+void NetPrediction::ReceiveInputAck(NetSender const & sender, NetMessage const & message)
+{
+	if(m_session->IsHost() || !sender.connection || sender.connection != m_session->GetHost() || !m_localObject)
+	{
+		return;
+	}
+
+	uint16_t ackedInputID;
+	if(!message.Read<uint16_t>(&ackedInputID))
+	{
+		++m_session->m_invalidMessageCount;
+		return;
+	}
+
+	//Never sent, or older than a correction we already took (the same ID is fine, the host may have
+	//pushed the object around since)
+	if(!GreaterThanCycle(m_nextInputID, ackedInputID) || (m_hasAck && GreaterThanCycle(m_lastAckedInputID, ackedInputID)))
+	{
+		return;
+	}
+
+	//Keep what we had, a truncated ack would leave the object half overwritten
+	byte_t backupBuffer[NetPacket::MAX_SIZE];
+	BytePacker backup(backupBuffer, NetPacket::MAX_SIZE, 0);
+	{
+		BitPacker writer(&backup);
+		m_localObject->WritePredictedState(&writer);
+	}
+
+	BitPacker reader(&message);
+	m_localObject->ReadPredictedState(&reader);
+	if(reader.HasError())
+	{
+		BytePacker const restore(backupBuffer, NetPacket::MAX_SIZE, backup.GetCurrentOffset());
+		BitPacker restoreReader(&restore);
+		m_localObject->ReadPredictedState(&restoreReader);
+		++m_session->m_invalidMessageCount;
+		return;
+	}
+
+	//Only now that the state is in, the inputs it covers aren't needed for replay anymore
+	m_lastAckedInputID = ackedInputID;
+	m_hasAck = true;
+	if(GreaterThanCycle(ackedInputID + 1, m_oldestUnackedInputID))
+	{
+		m_oldestUnackedInputID = ackedInputID + 1;
+	}
+
+	uint16_t replayedCount = GetUnackedInputCount();
+	for(uint16_t inputID = m_oldestUnackedInputID; inputID != m_nextInputID; ++inputID)
+	{
+		m_localObject->ApplyInput(GetInput(inputID));
+	}
+
+	++m_reconcileCount;
+	m_replayedInputCount += replayedCount;
+	m_localObject->OnReconciled(replayedCount);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Unreliable, and every packet carries the newest unacked inputs so a lost one costs nothing
+void NetPrediction::SendInputs(NetConnection * connection)
+{
+	uint16_t inputCount = Min(GetUnackedInputCount(), (uint16_t)MAX_INPUTS_PER_MESSAGE);
+	if(inputCount == 0)
+	{
+		return;
+	}
+
+	uint16_t firstInputID = m_nextInputID - inputCount;
+	NetInputCommand const & firstInput = GetInput(firstInputID);
+
+	NetMessage message(eNetMessageType_INPUT);
+	message.Write<uint16_t>(firstInputID);
+	message.Write<uint8_t>((uint8_t)inputCount);
+	message.Write<double>(firstInput.clientTime);
+	for(uint16_t inputIndex = 0; inputIndex < inputCount; ++inputIndex)
+	{
+		NetInputCommand const & input = GetInput(firstInputID + inputIndex);
+		message.Write<float>((float)(input.clientTime - firstInput.clientTime));
+		message.Write<float>(input.deltaSeconds);
+		message.Write<uint8_t>(input.dataSize);
+		message.Write(input.data, input.dataSize);
+	}
+	connection->AddMessage(message);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Sent when an input changed it, and every so often anyway in case the last one got lost
+void NetPrediction::SendState(NetConnection * connection, NetPredictionHostState * state)
+{
+	if(!state->hasAppliedInput)
+	{
+		return;
+	}
+
+	double currentTime = Time::GetCurrentTimeSeconds();
+	if(!state->isStateDirty && currentTime - state->lastStateSentTime < (double)STATE_RESEND_SECONDS)
+	{
+		return;
+	}
+
+	NetMessage message(eNetMessageType_INPUT_ACK);
+	message.Write<uint16_t>(state->lastAppliedInputID);
+	{
+		BitPacker writer(&message);
+		state->object->WritePredictedState(&writer);
+		writer.Flush();
+		if(writer.HasError())
+		{
+			ASSERT_RECOVERABLE(false, "Predicted state doesn't fit in a message");
+			return;
+		}
+	}
+	connection->AddMessage(message);
+
+	state->isStateDirty = false;
+	state->lastStateSentTime = currentTime;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetInputCommand & NetPrediction::GetInput(uint16_t inputID)
+{
+	return m_inputHistory[inputID & (INPUT_HISTORY_SIZE - 1)];
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetPrediction::ResetClient()
+{
+	m_oldestUnackedInputID = m_nextInputID;
+	m_hasAck = false;
+}
\ No newline at end of file
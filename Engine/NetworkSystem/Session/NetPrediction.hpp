@@ -0,0 +1,116 @@
+#pragma once
+
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/NetworkSystem/Session/INetPredictedObject.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+class NamedProperties;
+class NetConnection;
+class NetMessage;
+class NetSender;
+class NetSession;
+
+
+//-------------------------------------------------------------------------------------------------
+void OnInput(NetSender const &, NetMessage const &);
+void OnInputAck(NetSender const &, NetMessage const &);
+
+
+//-------------------------------------------------------------------------------------------------
+// One tick of player input. The data is whatever the game packs into it (buttons, aim, ...).
+class NetInputCommand
+{
+public:
+	static size_t const MAX_DATA_SIZE = 16;
+
+public:
+	uint16_t inputID;
+	double clientTime; //When the client made it, in the client's clock
+	float deltaSeconds; //How long to simulate it for
+	uint8_t dataSize;
+	byte_t data[MAX_DATA_SIZE];
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Host side, one per client that controls a predicted object
+class NetPredictionHostState
+{
+public:
+	INetPredictedObject * object;
+	uint16_t lastAppliedInputID;
+	bool hasAppliedInput;
+	bool isStateDirty;
+	double lastStateSentTime;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Client prediction and host reconciliation. The client applies its inputs right away, keeps them in
+// a ring, and sends every input the host hasn't acked yet in each packet (unreliable, the redundancy
+// covers loss). The host applies inputs in order as they arrive and sends back the predicted state
+// along with the last input it applied. The client resets to that state and replays whatever inputs
+// are still unacked, so it stays ahead of the host by one round trip without drifting.
+class NetPrediction
+{
+	//-------------------------------------------------------------------------------------------------
+	// Static Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	static size_t const MAX_CONNECTIONS = 256;
+	static uint16_t const INPUT_HISTORY_SIZE = 128; //2 seconds at 60 inputs a second, power of 2
+	static uint8_t const MAX_INPUTS_PER_MESSAGE = 32;
+	static float const STATE_RESEND_SECONDS;
+
+	//-------------------------------------------------------------------------------------------------
+	// Members
+	//-------------------------------------------------------------------------------------------------
+private:
+	NetSession * m_session;
+
+	//Client
+	INetPredictedObject * m_localObject;
+	NetInputCommand m_inputHistory[INPUT_HISTORY_SIZE];
+	uint16_t m_nextInputID;
+	uint16_t m_oldestUnackedInputID;
+	uint16_t m_lastAckedInputID;
+	bool m_hasAck;
+
+	//Host
+	NetPredictionHostState m_hostStates[MAX_CONNECTIONS];
+
+public:
+	//debugging information
+	size_t m_reconcileCount;
+	size_t m_replayedInputCount;
+	size_t m_droppedInputCount; //Fell out of the ring before the host acked them
+	size_t m_appliedInputCount;
+	size_t m_skippedInputCount; //Host never got them
+
+	//-------------------------------------------------------------------------------------------------
+	// Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	NetPrediction(NetSession * session);
+	~NetPrediction();
+
+	//Client
+	void SetLocalObject(INetPredictedObject * object);
+	uint16_t AddInput(byte_t const * data, size_t dataSize, float deltaSeconds);
+	uint16_t GetUnackedInputCount() const;
+
+	//Host
+	void SetControlledObject(NetConnection const * connection, INetPredictedObject * object);
+
+	void OnPreparePacket(NamedProperties & netEvent);
+	void OnConnectionLeave(NamedProperties & netEvent);
+	void ReceiveInput(NetSender const & sender, NetMessage const & message);
+	void ReceiveInputAck(NetSender const & sender, NetMessage const & message);
+
+private:
+	void SendInputs(NetConnection * connection);
+	void SendState(NetConnection * connection, NetPredictionHostState * state);
+	NetInputCommand & GetInput(uint16_t inputID);
+	void ResetClient();
+};
\ No newline at end of file
@@ -0,0 +1,845 @@
+#include "Engine/NetworkSystem/Session/NetReplicator.hpp"
+
+#include "Engine/Core/NamedProperties.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/DebugSystem/BConsoleSystem.hpp"
+#include "Engine/EventSystem/BEventSystem.hpp"
+#include "Engine/NetworkSystem/Session/NetConnection.hpp"
+#include "Engine/NetworkSystem/Session/NetMessage.hpp"
+#include "Engine/NetworkSystem/Session/NetPacket.hpp"
+#include "Engine/NetworkSystem/Session/NetSession.hpp"
+#include "Engine/Utils/BitPacker.hpp"
+#include "Engine/Utils/MathUtils.hpp"
+#include "Engine/Utils/StringUtils.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+void OnSnapshot(NetSender const & sender, NetMessage const & message)
+{
+	NetReplicator * replicator = sender.session->GetReplicator();
+	if(replicator)
+	{
+		replicator->ReceiveSnapshot(sender, message);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+static void CaptureField(INetworkedObject const * object, uint8_t fieldIndex, NetFieldState * out_field)
+{
+	BytePacker scratch(out_field->data, INetworkedObject::MAX_FIELD_SIZE, 0);
+	BitPacker writer(&scratch);
+	object->WriteReplicatedField(fieldIndex, &writer);
+	writer.Flush();
+	ASSERT_RECOVERABLE(!writer.HasError(), "Replicated field is larger than MAX_FIELD_SIZE");
+	out_field->bitCount = (uint8_t)writer.GetBitsWritten();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+static uint16_t GetAllFieldsMask(uint8_t fieldCount)
+{
+	return (uint16_t)((1U << fieldCount) - 1);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+static bool IsSnapshotNewer(uint16_t snapshotID, uint16_t comparedTo)
+{
+	return snapshotID == comparedTo || GreaterThanCycle(snapshotID, comparedTo);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool NetFieldState::IsSame(NetFieldState const & other) const
+{
+	if(bitCount != other.bitCount)
+	{
+		return false;
+	}
+
+	//Unused bits in the last byte are always zero
+	size_t byteCount = (bitCount + 7) / 8;
+	return memcmp(data, other.data, byteCount) == 0;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetObjectState::Capture(INetworkedObject const * object)
+{
+	networkID = object->m_networkID;
+	networkType = object->GetNetworkType();
+	fieldCount = object->GetReplicatedFieldCount();
+	ASSERT_RECOVERABLE(fieldCount <= INetworkedObject::MAX_FIELDS, "Too many replicated fields");
+	for(uint8_t fieldIndex = 0; fieldIndex < fieldCount; ++fieldIndex)
+	{
+		CaptureField(object, fieldIndex, &fields[fieldIndex]);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetReplicationState::NetReplicationState()
+{
+	//Nothing has been sent yet
+	for(size_t sentIndex = 0; sentIndex < MAX_SENT_SNAPSHOTS; ++sentIndex)
+	{
+		m_sent[sentIndex].snapshotID = 0;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetReplicator::NetReplicator(NetSession * session)
+	: m_session(session)
+	, m_nextNetworkID(0)
+	, m_snapshotID(0)
+	, m_newestReceivedSnapshotID(0)
+	, m_hasReceivedSnapshot(false)
+	, m_lastCaptureTime(-1.0)
+	, m_lastCaptureHostTime(0.0)
+	, m_lastSnapshotBits(0)
+	, m_lastSnapshotObjectCount(0)
+{
+	for(size_t typeIndex = 0; typeIndex < MAX_TYPES; ++typeIndex)
+	{
+		m_createCallbacks[typeIndex] = nullptr;
+		m_destroyCallbacks[typeIndex] = nullptr;
+	}
+
+	for(size_t connIndex = 0; connIndex < MAX_CONNECTIONS; ++connIndex)
+	{
+		m_connectionStates[connIndex] = nullptr;
+	}
+
+	m_session->SetReplicator(this);
+	BEventSystem::RegisterEvent(NetSession::PREPARE_PACKET_EVENT, this, &NetReplicator::OnPreparePacket);
+	BEventSystem::RegisterEvent(NetSession::ON_RECEIPT_CONFIRMED_EVENT, this, &NetReplicator::OnReceiptConfirmed);
+	BEventSystem::RegisterEvent(NetSession::ON_CONNECTION_LEAVE_EVENT, this, &NetReplicator::OnConnectionLeave);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetReplicator::~NetReplicator()
+{
+	BEventSystem::Unregister(this);
+
+	if(m_session->GetReplicator() == this)
+	{
+		m_session->SetReplicator(nullptr);
+	}
+
+	for(size_t connIndex = 0; connIndex < MAX_CONNECTIONS; ++connIndex)
+	{
+		delete m_connectionStates[connIndex];
+		m_connectionStates[connIndex] = nullptr;
+	}
+
+	ClearReceivedObjects();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetReplicator::RegisterType(byte_t networkType, NetObjectCreateCallback * createCallback, NetObjectDestroyCallback * destroyCallback /*= nullptr*/)
+{
+	m_createCallbacks[networkType] = createCallback;
+	m_destroyCallbacks[networkType] = destroyCallback;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Host side, the object has to stay alive until it's removed
+uint16_t NetReplicator::AddObject(INetworkedObject * object)
+{
+	//Find an unused ID
+	while(m_nextNetworkID == INetworkedObject::INVALID_NETWORK_ID || m_objects.find(m_nextNetworkID) != m_objects.end())
+	{
+		++m_nextNetworkID;
+	}
+
+	object->m_networkID = m_nextNetworkID;
+	m_objects[m_nextNetworkID] = object;
+	++m_nextNetworkID;
+	return object->m_networkID;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetReplicator::RemoveObject(INetworkedObject * object)
+{
+	m_objects.erase(object->m_networkID);
+	object->m_networkID = INetworkedObject::INVALID_NETWORK_ID;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+INetworkedObject * NetReplicator::GetObject(uint16_t networkID) const
+{
+	auto foundObject = m_objects.find(networkID);
+	if(foundObject != m_objects.end())
+	{
+		return foundObject->second;
+	}
+
+	auto foundReceived = m_receivedObjects.find(networkID);
+	if(foundReceived != m_receivedObjects.end())
+	{
+		return foundReceived->second.object;
+	}
+
+	return nullptr;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetInterestManager * NetReplicator::GetInterestManager()
+{
+	return &m_interest;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Client side, where in the host's timeline remote objects should be drawn
+NetPlaybackClock * NetReplicator::GetPlaybackClock()
+{
+	return &m_playbackClock;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetReplicator::OnPreparePacket(NamedProperties & netEvent)
+{
+	NetConnection * connection = nullptr;
+	netEvent.Get("connection", connection);
+	if(!connection || connection->GetSession() != m_session)
+	{
+		return;
+	}
+
+	//Only the host replicates
+	if(!m_session->IsHost() || connection->IsSelf())
+	{
+		return;
+	}
+
+	SendSnapshot(connection);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetReplicator::OnReceiptConfirmed(NamedProperties & netEvent)
+{
+	byte_t messageType = eNetMessageType_INVALID;
+	netEvent.Get("messageType", messageType);
+	if(messageType != eNetMessageType_SNAPSHOT)
+	{
+		return;
+	}
+
+	NetConnection * connection = nullptr;
+	netEvent.Get("connection", connection);
+	if(!connection || connection->GetSession() != m_session)
+	{
+		return;
+	}
+
+	NetReplicationState * state = m_connectionStates[connection->GetIndex()];
+	if(!state)
+	{
+		return;
+	}
+
+	uint16_t snapshotID = 0;
+	netEvent.Get("receiptID", snapshotID);
+	ConfirmSnapshot(state, snapshotID);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetReplicator::OnConnectionLeave(NamedProperties & netEvent)
+{
+	NetConnection * connection = nullptr;
+	netEvent.Get("connection", connection);
+	if(!connection || connection->GetSession() != m_session)
+	{
+		return;
+	}
+
+	//Lost the host, everything we got from them goes away
+	if(connection->IsHost() && !connection->IsSelf())
+	{
+		ClearReceivedObjects();
+	}
+
+	byte_t index = connection->GetIndex();
+	if(index < MAX_CONNECTIONS)
+	{
+		delete m_connectionStates[index];
+		m_connectionStates[index] = nullptr;
+		m_interest.RemoveConnection(index);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetReplicator::ReceiveSnapshot(NetSender const & sender, NetMessage const & message)
+{
+	//Only take snapshots from the host
+	if(m_session->IsHost() || !sender.connection || sender.connection != m_session->GetHost())
+	{
+		return;
+	}
+
+	uint16_t snapshotID;
+	double hostTime;
+	uint16_t objectCount;
+	if(!message.Read<uint16_t>(&snapshotID) || !message.Read<double>(&hostTime) || !message.Read<uint16_t>(&objectCount))
+	{
+		++m_session->m_invalidMessageCount;
+		return;
+	}
+
+	//Snapshot times only mean something on the synced timeline
+	NetClockSync const & clockSync = m_session->GetClockSync();
+	if(clockSync.IsSynced())
+	{
+		m_playbackClock.AddSample(hostTime, clockSync.GetHostTime(sender.receivedTime), sender.connection->GetRoundTripVariance());
+	}
+
+	BitPacker reader(&message);
+	for(uint16_t objectIndex = 0; objectIndex < objectCount; ++objectIndex)
+	{
+		if(!ReadObject(&reader, snapshotID))
+		{
+			++m_session->m_invalidMessageCount;
+			BConsoleSystem::AddLog(Stringf("Could not read snapshot %u", snapshotID), BConsoleSystem::BAD);
+			break;
+		}
+	}
+
+	//Late snapshots only fill in fields, interpolation has already moved past them
+	if(!m_hasReceivedSnapshot || GreaterThanCycle(snapshotID, m_newestReceivedSnapshotID))
+	{
+		m_hasReceivedSnapshot = true;
+		m_newestReceivedSnapshotID = snapshotID;
+		for(auto receivedIter = m_receivedObjects.begin(); receivedIter != m_receivedObjects.end(); ++receivedIter)
+		{
+			receivedIter->second.object->OnSnapshotReceived(hostTime);
+		}
+	}
+
+	//Forget destroyed objects once no late packet could still mention them
+	uint16_t oldestSnapshotID = snapshotID - (uint16_t)(NetReplicationState::MAX_SENT_SNAPSHOTS * 2);
+	auto destroyedIter = m_destroyedObjects.begin();
+	while(destroyedIter != m_destroyedObjects.end())
+	{
+		if(GreaterThanCycle(oldestSnapshotID, destroyedIter->second))
+		{
+			destroyedIter = m_destroyedObjects.erase(destroyedIter);
+		}
+		else
+		{
+			++destroyedIter;
+		}
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Once per send tick, every connection diffs against the same capture
+void NetReplicator::CaptureStates()
+{
+	if(m_lastCaptureTime == (double)Time::TOTAL_SECONDS)
+	{
+		return;
+	}
+	m_lastCaptureTime = (double)Time::TOTAL_SECONDS;
+	m_lastCaptureHostTime = m_session->GetHostTime();
+	++m_snapshotID;
+
+	m_currentStates.resize(m_objects.size());
+	m_currentObjects.resize(m_objects.size());
+	size_t stateIndex = 0;
+	for(auto objectIter = m_objects.begin(); objectIter != m_objects.end(); ++objectIter)
+	{
+		m_currentObjects[stateIndex] = objectIter->second;
+		m_currentStates[stateIndex].Capture(objectIter->second);
+		++stateIndex;
+	}
+
+	m_interest.BuildGrid(m_currentObjects);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetReplicator::SendSnapshot(NetConnection * connection)
+{
+	CaptureStates();
+
+	NetReplicationState * state = GetConnectionState(connection);
+	byte_t connectionIndex = connection->GetIndex();
+	size_t budgetBits = m_interest.GatherRelevant(connectionIndex, &m_relevantIndices, &m_isRelevant);
+	budgetBits = Min(budgetBits, MAX_SNAPSHOT_BITS);
+	NetSentSnapshot & sent = state->m_sent[m_snapshotID % NetReplicationState::MAX_SENT_SNAPSHOTS];
+	sent.snapshotID = m_snapshotID;
+	sent.deltas.clear();
+
+	NetMessage message(eNetMessageType_SNAPSHOT);
+	message.Write<uint16_t>(m_snapshotID);
+	message.Write<double>(m_lastCaptureHostTime);
+	size_t countBookmark = message.Reserve<uint16_t>(0U);
+
+	uint16_t objectCount = 0;
+	size_t bitsUsed = 0;
+	{
+		BitPacker writer(&message);
+		NetObjectDelta delta;
+
+		//Destroys first (gone, or no longer relevant to this connection), they're tiny
+		for(auto baselineIter = state->m_baseline.begin(); baselineIter != state->m_baseline.end(); ++baselineIter)
+		{
+			int currentIndex = FindCurrentState(baselineIter->first);
+			if(currentIndex >= 0 && m_isRelevant[currentIndex])
+			{
+				continue;
+			}
+
+			delta.op = eNetObjectOp_DESTROY;
+			delta.changedFields = 0;
+			delta.state.networkID = baselineIter->first;
+			delta.state.networkType = baselineIter->second.state.networkType;
+			delta.state.fieldCount = 0;
+
+			size_t deltaBits = GetDeltaBits(delta);
+			if(bitsUsed + deltaBits > budgetBits)
+			{
+				break;
+			}
+			WriteDelta(&writer, delta);
+			bitsUsed += deltaBits;
+			++objectCount;
+			sent.deltas.push_back(delta);
+		}
+
+		//Anything relevant that's new or changed since the acked baseline, highest priority first
+		for(size_t relevantIndex = 0; relevantIndex < m_relevantIndices.size(); ++relevantIndex)
+		{
+			size_t objectIndex = m_relevantIndices[relevantIndex];
+			NetObjectState const & current = m_currentStates[objectIndex];
+			auto foundBaseline = state->m_baseline.find(current.networkID);
+			if(foundBaseline == state->m_baseline.end())
+			{
+				delta.op = eNetObjectOp_CREATE;
+				delta.changedFields = GetAllFieldsMask(current.fieldCount);
+			}
+			else
+			{
+				delta.op = eNetObjectOp_UPDATE;
+				delta.changedFields = 0;
+				NetObjectState const & baseline = foundBaseline->second.state;
+				for(uint8_t fieldIndex = 0; fieldIndex < current.fieldCount; ++fieldIndex)
+				{
+					if(!current.fields[fieldIndex].IsSame(baseline.fields[fieldIndex]))
+					{
+						delta.changedFields |= BIT(fieldIndex);
+					}
+				}
+
+				//Client already has this one
+				if(delta.changedFields == 0)
+				{
+					m_interest.MarkSent(connectionIndex, objectIndex);
+					continue;
+				}
+			}
+			delta.state = current;
+
+			//Doesn't fit, it keeps its priority and something smaller might still fit
+			size_t deltaBits = GetDeltaBits(delta);
+			if(bitsUsed + deltaBits > budgetBits)
+			{
+				continue;
+			}
+			WriteDelta(&writer, delta);
+			bitsUsed += deltaBits;
+			++objectCount;
+			sent.deltas.push_back(delta);
+			m_interest.MarkSent(connectionIndex, objectIndex);
+		}
+	}
+
+	m_interest.SpendBudget(connectionIndex, bitsUsed);
+	m_lastSnapshotBits = bitsUsed;
+	m_lastSnapshotObjectCount = objectCount;
+
+	//Sent even when nothing changed, so every interpolation buffer gets a sample each tick and movement
+	//that starts after a quiet stretch isn't smeared back across it. An empty snapshot is 16 bytes of
+	//message (about 1KB/s per connection at 60Hz), on top of the packet it rides in.
+	message.WriteAt<uint16_t>(countBookmark, objectCount);
+	message.m_receiptID = m_snapshotID;
+	connection->AddMessage(message);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Acks can come back out of order, so each field remembers which snapshot it came from
+void NetReplicator::ConfirmSnapshot(NetReplicationState * state, uint16_t snapshotID)
+{
+	NetSentSnapshot & sent = state->m_sent[snapshotID % NetReplicationState::MAX_SENT_SNAPSHOTS];
+
+	//Too old, the slot has been reused
+	if(sent.snapshotID != snapshotID)
+	{
+		return;
+	}
+
+	for(size_t deltaIndex = 0; deltaIndex < sent.deltas.size(); ++deltaIndex)
+	{
+		NetObjectDelta const & delta = sent.deltas[deltaIndex];
+		auto foundBaseline = state->m_baseline.find(delta.state.networkID);
+
+		if(delta.op == eNetObjectOp_DESTROY)
+		{
+			if(foundBaseline != state->m_baseline.end() && GreaterThanCycle(snapshotID, foundBaseline->second.createdSnapshotID))
+			{
+				state->m_baseline.erase(foundBaseline);
+			}
+			continue;
+		}
+
+		if(foundBaseline == state->m_baseline.end())
+		{
+			//Updates only go out for objects in the baseline, so it must have been destroyed since
+			if(delta.op != eNetObjectOp_CREATE)
+			{
+				continue;
+			}
+
+			NetBaselineObject & created = state->m_baseline[delta.state.networkID];
+			created.state = delta.state;
+			created.createdSnapshotID = snapshotID;
+			for(uint8_t fieldIndex = 0; fieldIndex < INetworkedObject::MAX_FIELDS; ++fieldIndex)
+			{
+				created.fieldSnapshotIDs[fieldIndex] = snapshotID;
+			}
+			continue;
+		}
+
+		NetBaselineObject & baseline = foundBaseline->second;
+		for(uint8_t fieldIndex = 0; fieldIndex < delta.state.fieldCount; ++fieldIndex)
+		{
+			if((delta.changedFields & BIT(fieldIndex)) == 0)
+			{
+				continue;
+			}
+
+			if(GreaterThanCycle(snapshotID, baseline.fieldSnapshotIDs[fieldIndex]))
+			{
+				baseline.state.fields[fieldIndex] = delta.state.fields[fieldIndex];
+				baseline.fieldSnapshotIDs[fieldIndex] = snapshotID;
+			}
+		}
+	}
+
+	sent.deltas.clear();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Captured states are in network ID order
+int NetReplicator::FindCurrentState(uint16_t networkID) const
+{
+	int low = 0;
+	int high = (int)m_currentStates.size() - 1;
+	while(low <= high)
+	{
+		int middle = (low + high) / 2;
+		uint16_t middleID = m_currentStates[middle].networkID;
+		if(middleID == networkID)
+		{
+			return middle;
+		}
+		else if(middleID < networkID)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle - 1;
+		}
+	}
+	return -1;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+size_t NetReplicator::GetDeltaBits(NetObjectDelta const & delta) const
+{
+	size_t bits = NETWORK_ID_BITS + OP_BITS + TYPE_BITS;
+	if(delta.op == eNetObjectOp_DESTROY)
+	{
+		return bits;
+	}
+
+	bits += (delta.op == eNetObjectOp_CREATE) ? FIELD_COUNT_BITS : delta.state.fieldCount;
+	for(uint8_t fieldIndex = 0; fieldIndex < delta.state.fieldCount; ++fieldIndex)
+	{
+		if((delta.changedFields & BIT(fieldIndex)) != 0)
+		{
+			bits += delta.state.fields[fieldIndex].bitCount;
+		}
+	}
+	return bits;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetReplicator::WriteDelta(BitPacker * writer, NetObjectDelta const & delta) const
+{
+	writer->WriteBits(delta.state.networkID, NETWORK_ID_BITS);
+	writer->WriteBits(delta.op, OP_BITS);
+	writer->WriteBits(delta.state.networkType, TYPE_BITS);
+	if(delta.op == eNetObjectOp_DESTROY)
+	{
+		return;
+	}
+
+	//Creates send every field, updates send a bit per field saying if it changed
+	if(delta.op == eNetObjectOp_CREATE)
+	{
+		writer->WriteBits(delta.state.fieldCount, FIELD_COUNT_BITS);
+	}
+	else
+	{
+		writer->WriteBits(delta.changedFields, delta.state.fieldCount);
+	}
+
+	for(uint8_t fieldIndex = 0; fieldIndex < delta.state.fieldCount; ++fieldIndex)
+	{
+		if((delta.changedFields & BIT(fieldIndex)) != 0)
+		{
+			WriteField(writer, delta.state.fields[fieldIndex]);
+		}
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetReplicator::WriteField(BitPacker * writer, NetFieldState const & field) const
+{
+	uint8_t bitsLeft = field.bitCount;
+	size_t byteIndex = 0;
+	while(bitsLeft > 0)
+	{
+		uint8_t bits = (bitsLeft > 8) ? 8 : bitsLeft;
+		writer->WriteBits(field.data[byteIndex], bits);
+		bitsLeft -= bits;
+		++byteIndex;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool NetReplicator::ReadObject(BitPacker * reader, uint16_t snapshotID)
+{
+	uint32_t networkID;
+	uint32_t op;
+	uint32_t networkType;
+	reader->ReadBits(&networkID, NETWORK_ID_BITS);
+	reader->ReadBits(&op, OP_BITS);
+	reader->ReadBits(&networkType, TYPE_BITS);
+	if(reader->HasError() || op >= eNetObjectOp_COUNT)
+	{
+		return false;
+	}
+
+	if(op == eNetObjectOp_DESTROY)
+	{
+		DestroyReceivedObject((uint16_t)networkID, snapshotID);
+		return true;
+	}
+
+	//Destroyed in a newer snapshot than this one, read it but throw it away
+	auto foundDestroyed = m_destroyedObjects.find((uint16_t)networkID);
+	bool isDead = foundDestroyed != m_destroyedObjects.end() && !GreaterThanCycle(snapshotID, foundDestroyed->second);
+
+	INetworkedObject * object = nullptr;
+	uint16_t * fieldSnapshotIDs = nullptr;
+	bool isThrowaway = false;
+	auto foundReceived = m_receivedObjects.find((uint16_t)networkID);
+	if(foundReceived != m_receivedObjects.end() && !isDead)
+	{
+		object = foundReceived->second.object;
+		fieldSnapshotIDs = foundReceived->second.fieldSnapshotIDs;
+	}
+	else
+	{
+		NetObjectCreateCallback * createCallback = m_createCallbacks[networkType];
+		if(!createCallback)
+		{
+			return false;
+		}
+		object = createCallback((byte_t)networkType);
+		if(!object)
+		{
+			return false;
+		}
+
+		//Can still read an update for an object we don't have (it was just destroyed), we just don't keep it
+		if(op == eNetObjectOp_UPDATE || isDead)
+		{
+			isThrowaway = true;
+		}
+		else
+		{
+			object->m_networkID = (uint16_t)networkID;
+			NetReceivedObject & received = m_receivedObjects[(uint16_t)networkID];
+			received.object = object;
+			received.createdSnapshotID = snapshotID;
+			for(uint8_t fieldIndex = 0; fieldIndex < INetworkedObject::MAX_FIELDS; ++fieldIndex)
+			{
+				received.fieldSnapshotIDs[fieldIndex] = snapshotID;
+			}
+			fieldSnapshotIDs = received.fieldSnapshotIDs;
+			m_destroyedObjects.erase((uint16_t)networkID);
+		}
+	}
+
+	uint8_t fieldCount = object->GetReplicatedFieldCount();
+	uint32_t changedFields = 0;
+	bool isValid = true;
+	if(op == eNetObjectOp_CREATE)
+	{
+		uint32_t sentFieldCount;
+		reader->ReadBits(&sentFieldCount, FIELD_COUNT_BITS);
+		isValid = (sentFieldCount == fieldCount);
+		changedFields = GetAllFieldsMask(fieldCount);
+	}
+	else
+	{
+		reader->ReadBits(&changedFields, fieldCount);
+	}
+
+	if(isValid)
+	{
+		ReadFields(reader, object, (uint16_t)changedFields, snapshotID, fieldSnapshotIDs);
+	}
+
+	if(isThrowaway)
+	{
+		NetObjectDestroyCallback * destroyCallback = m_destroyCallbacks[networkType];
+		if(destroyCallback)
+		{
+			destroyCallback(object);
+		}
+		else
+		{
+			delete object;
+		}
+	}
+
+	return isValid && !reader->HasError();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Fields newer than this snapshot still have to be read to get past them, then they get put back
+void NetReplicator::ReadFields(BitPacker * reader, INetworkedObject * object, uint16_t changedFields, uint16_t snapshotID, uint16_t * fieldSnapshotIDs)
+{
+	uint8_t fieldCount = object->GetReplicatedFieldCount();
+	for(uint8_t fieldIndex = 0; fieldIndex < fieldCount; ++fieldIndex)
+	{
+		if((changedFields & BIT(fieldIndex)) == 0)
+		{
+			continue;
+		}
+
+		if(!fieldSnapshotIDs || IsSnapshotNewer(snapshotID, fieldSnapshotIDs[fieldIndex]))
+		{
+			object->ReadReplicatedField(fieldIndex, reader);
+			if(fieldSnapshotIDs)
+			{
+				fieldSnapshotIDs[fieldIndex] = snapshotID;
+			}
+		}
+		else
+		{
+			NetFieldState newerField;
+			CaptureField(object, fieldIndex, &newerField);
+			object->ReadReplicatedField(fieldIndex, reader);
+
+			BytePacker newerBytes(newerField.data, INetworkedObject::MAX_FIELD_SIZE, (newerField.bitCount + 7) / 8);
+			BitPacker newerReader((BytePacker const *)&newerBytes);
+			object->ReadReplicatedField(fieldIndex, &newerReader);
+		}
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetReplicator::DestroyReceivedObject(uint16_t networkID, uint16_t snapshotID)
+{
+	auto foundReceived = m_receivedObjects.find(networkID);
+	if(foundReceived != m_receivedObjects.end())
+	{
+		//Late destroy from before this object was created
+		if(!GreaterThanCycle(snapshotID, foundReceived->second.createdSnapshotID))
+		{
+			return;
+		}
+
+		INetworkedObject * object = foundReceived->second.object;
+		NetObjectDestroyCallback * destroyCallback = m_destroyCallbacks[object->GetNetworkType()];
+		if(destroyCallback)
+		{
+			destroyCallback(object);
+		}
+		else
+		{
+			delete object;
+		}
+		m_receivedObjects.erase(foundReceived);
+	}
+
+	//Remember it so late creates and updates don't bring it back
+	auto foundDestroyed = m_destroyedObjects.find(networkID);
+	if(foundDestroyed == m_destroyedObjects.end() || GreaterThanCycle(snapshotID, foundDestroyed->second))
+	{
+		m_destroyedObjects[networkID] = snapshotID;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetReplicator::ClearReceivedObjects()
+{
+	for(auto receivedIter = m_receivedObjects.begin(); receivedIter != m_receivedObjects.end(); ++receivedIter)
+	{
+		INetworkedObject * object = receivedIter->second.object;
+		NetObjectDestroyCallback * destroyCallback = m_destroyCallbacks[object->GetNetworkType()];
+		if(destroyCallback)
+		{
+			destroyCallback(object);
+		}
+		else
+		{
+			delete object;
+		}
+	}
+	m_receivedObjects.clear();
+	m_destroyedObjects.clear();
+	m_hasReceivedSnapshot = false;
+	m_playbackClock.Reset();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetReplicationState * NetReplicator::GetConnectionState(NetConnection const * connection)
+{
+	byte_t index = connection->GetIndex();
+	if(!m_connectionStates[index])
+	{
+		m_connectionStates[index] = new NetReplicationState();
+	}
+	return m_connectionStates[index];
+}
\ No newline at end of file
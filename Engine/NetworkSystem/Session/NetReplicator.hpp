@@ -0,0 +1,204 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/NetworkSystem/Session/INetworkedObject.hpp"
+#include "Engine/NetworkSystem/Session/NetInterestManager.hpp"
+#include "Engine/NetworkSystem/Session/NetInterpolation.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+class BitPacker;
+class NamedProperties;
+class NetConnection;
+class NetMessage;
+class NetSender;
+class NetSession;
+
+
+//-------------------------------------------------------------------------------------------------
+void OnSnapshot(NetSender const &, NetMessage const &);
+
+
+//-------------------------------------------------------------------------------------------------
+// Clients make their copy of an object through these (create should only construct it)
+typedef INetworkedObject * (NetObjectCreateCallback)(byte_t networkType);
+typedef void (NetObjectDestroyCallback)(INetworkedObject * object);
+
+
+//-------------------------------------------------------------------------------------------------
+enum eNetObjectOp : uint8_t
+{
+	eNetObjectOp_UPDATE,
+	eNetObjectOp_CREATE,
+	eNetObjectOp_DESTROY,
+	eNetObjectOp_COUNT,
+};
+
+
+//-------------------------------------------------------------------------------------------------
+class NetFieldState
+{
+public:
+	uint8_t bitCount;
+	byte_t data[INetworkedObject::MAX_FIELD_SIZE];
+
+public:
+	bool IsSame(NetFieldState const & other) const;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+class NetObjectState
+{
+public:
+	uint16_t networkID;
+	byte_t networkType;
+	uint8_t fieldCount;
+	NetFieldState fields[INetworkedObject::MAX_FIELDS];
+
+public:
+	void Capture(INetworkedObject const * object);
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// What we sent for one object in one snapshot (only changed fields are valid)
+class NetObjectDelta
+{
+public:
+	eNetObjectOp op;
+	uint16_t changedFields;
+	NetObjectState state;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Host side: what a connection is known to have, per field, and which snapshot it came from
+class NetBaselineObject
+{
+public:
+	NetObjectState state;
+	uint16_t createdSnapshotID;
+	uint16_t fieldSnapshotIDs[INetworkedObject::MAX_FIELDS];
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Client side: which snapshot each field was last set from, so late packets don't roll values back
+class NetReceivedObject
+{
+public:
+	INetworkedObject * object;
+	uint16_t createdSnapshotID;
+	uint16_t fieldSnapshotIDs[INetworkedObject::MAX_FIELDS];
+};
+
+
+//-------------------------------------------------------------------------------------------------
+class NetSentSnapshot
+{
+public:
+	uint16_t snapshotID;
+	std::vector<NetObjectDelta> deltas;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+class NetReplicationState
+{
+public:
+	static size_t const MAX_SENT_SNAPSHOTS = 64;
+
+public:
+	std::map<uint16_t, NetBaselineObject> m_baseline;
+	NetSentSnapshot m_sent[MAX_SENT_SNAPSHOTS];
+
+public:
+	NetReplicationState();
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Host sends each connection only what changed since the last snapshot that connection acked.
+// Snapshots are unreliable, a lost one is covered by the next because everything is diffed against
+// the acked baseline (acks come back through message receipts). The interest manager picks which
+// objects each connection hears about and in what order; objects leaving relevancy get destroyed
+// on that client and created again when they come back.
+class NetReplicator
+{
+	//-------------------------------------------------------------------------------------------------
+	// Static Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	static size_t const MAX_CONNECTIONS = 256;
+	static size_t const MAX_TYPES = 256;
+	static size_t const MAX_SNAPSHOT_BITS = 8000; //leaves room in a 1KB message for the header
+	static uint8_t const NETWORK_ID_BITS = 16;
+	static uint8_t const OP_BITS = 2;
+	static uint8_t const TYPE_BITS = 8;
+	static uint8_t const FIELD_COUNT_BITS = 5;
+
+	//-------------------------------------------------------------------------------------------------
+	// Members
+	//-------------------------------------------------------------------------------------------------
+private:
+	NetSession * m_session;
+	std::map<uint16_t, INetworkedObject*> m_objects;
+	std::map<uint16_t, NetReceivedObject> m_receivedObjects;
+	std::map<uint16_t, uint16_t> m_destroyedObjects; //network ID to snapshot ID it was destroyed in
+	NetObjectCreateCallback * m_createCallbacks[MAX_TYPES];
+	NetObjectDestroyCallback * m_destroyCallbacks[MAX_TYPES];
+	NetReplicationState * m_connectionStates[MAX_CONNECTIONS];
+	std::vector<NetObjectState> m_currentStates;
+	std::vector<INetworkedObject*> m_currentObjects;
+	std::vector<size_t> m_relevantIndices;
+	std::vector<bool> m_isRelevant;
+	NetInterestManager m_interest;
+	NetPlaybackClock m_playbackClock;
+	uint16_t m_nextNetworkID;
+	uint16_t m_snapshotID;
+	uint16_t m_newestReceivedSnapshotID;
+	bool m_hasReceivedSnapshot;
+	double m_lastCaptureTime;
+	double m_lastCaptureHostTime; //Session host time, what clients interpolate against
+
+public:
+	//debugging information
+	size_t m_lastSnapshotBits;
+	size_t m_lastSnapshotObjectCount;
+
+	//-------------------------------------------------------------------------------------------------
+	// Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	NetReplicator(NetSession * session);
+	~NetReplicator();
+
+	void RegisterType(byte_t networkType, NetObjectCreateCallback * createCallback, NetObjectDestroyCallback * destroyCallback = nullptr);
+	uint16_t AddObject(INetworkedObject * object);
+	void RemoveObject(INetworkedObject * object);
+	INetworkedObject * GetObject(uint16_t networkID) const;
+	NetInterestManager * GetInterestManager();
+	NetPlaybackClock * GetPlaybackClock();
+
+	void OnPreparePacket(NamedProperties & netEvent);
+	void OnReceiptConfirmed(NamedProperties & netEvent);
+	void OnConnectionLeave(NamedProperties & netEvent);
+	void ReceiveSnapshot(NetSender const & sender, NetMessage const & message);
+
+private:
+	void CaptureStates();
+	void SendSnapshot(NetConnection * connection);
+	void ConfirmSnapshot(NetReplicationState * state, uint16_t snapshotID);
+	int FindCurrentState(uint16_t networkID) const;
+	size_t GetDeltaBits(NetObjectDelta const & delta) const;
+	void WriteDelta(BitPacker * writer, NetObjectDelta const & delta) const;
+	void WriteField(BitPacker * writer, NetFieldState const & field) const;
+	bool ReadObject(BitPacker * reader, uint16_t snapshotID);
+	void ReadFields(BitPacker * reader, INetworkedObject * object, uint16_t changedFields, uint16_t snapshotID, uint16_t * fieldSnapshotIDs);
+	void DestroyReceivedObject(uint16_t networkID, uint16_t snapshotID);
+	void ClearReceivedObjects();
+	NetReplicationState * GetConnectionState(NetConnection const * connection);
+};
\ No newline at end of file
@@ -0,0 +1,363 @@
+#include "Engine/NetworkSystem/Session/NetRewindHistory.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include "Engine/DebugSystem/BConsoleSystem.hpp"
+#include "Engine/DebugSystem/ErrorWarningAssert.hpp"
+#include "Engine/Math/AABB2f.hpp"
+#include "Engine/NetworkSystem/Session/NetConnection.hpp"
+#include "Engine/Utils/MathUtils.hpp"
+#include "Engine/Utils/StringUtils.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC double const NetRewindHistory::MAX_REWIND_SECONDS = 0.5;
+
+
+//-------------------------------------------------------------------------------------------------
+NetRewindQuery::NetRewindQuery(double setHostTime, AABB3 const & setBounds)
+	: hostTime(setHostTime)
+	, bounds(setBounds)
+{
+	//Nothing
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetRewindQuery::NetRewindQuery(double setHostTime, AABB2f const & setBounds)
+	: hostTime(setHostTime)
+	, bounds(Vector3f(setBounds.mins, -FLT_MAX), Vector3f(setBounds.maxs, FLT_MAX))
+{
+	//Nothing
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Best guess at when the host's world looked like what the client was drawing: half a round trip for
+// the action to get here, plus however far behind the client interpolates remote objects. Clients
+// that send their NetPlaybackClock time with the action don't need the guess.
+STATIC double NetRewindHistory::GetClientViewTime(NetConnection const * connection, double hostTime, double interpolationDelay)
+{
+	return hostTime - connection->GetRoundTripTime() * 0.5 - interpolationDelay;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetRewindHistory::NetRewindHistory(size_t maxObjects)
+	: m_maxObjects(maxObjects)
+	, m_nextFrame(0)
+	, m_frameCount(0)
+	, m_networkIDs(MAX_FRAMES * maxObjects, (uint16_t)EMPTY_SLOT)
+	, m_minXs(MAX_FRAMES * maxObjects, 0.f)
+	, m_minYs(MAX_FRAMES * maxObjects, 0.f)
+	, m_minZs(MAX_FRAMES * maxObjects, 0.f)
+	, m_maxXs(MAX_FRAMES * maxObjects, 0.f)
+	, m_maxYs(MAX_FRAMES * maxObjects, 0.f)
+	, m_maxZs(MAX_FRAMES * maxObjects, 0.f)
+	, m_lastQueryCount(0)
+	, m_lastTestCount(0)
+	, m_clampedQueryCount(0)
+{
+	for(size_t frameIndex = 0; frameIndex < MAX_FRAMES; ++frameIndex)
+	{
+		m_frameTimes[frameIndex] = 0.0;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetRewindHistory::~NetRewindHistory()
+{
+	//Nothing
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Once a tick, before the SetObject() calls. Times have to go up.
+void NetRewindHistory::BeginFrame(double hostTime)
+{
+	size_t frame = m_nextFrame;
+	m_frameTimes[frame] = hostTime;
+	std::fill(m_networkIDs.begin() + frame * m_maxObjects, m_networkIDs.begin() + (frame + 1) * m_maxObjects, (uint16_t)EMPTY_SLOT);
+
+	m_nextFrame = (m_nextFrame + 1) % MAX_FRAMES;
+	if(m_frameCount < MAX_FRAMES)
+	{
+		++m_frameCount;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetRewindHistory::SetObject(size_t slot, uint16_t networkID, AABB3 const & bounds)
+{
+	ASSERT_RECOVERABLE(m_frameCount > 0, "Call BeginFrame() before recording objects");
+	ASSERT_RECOVERABLE(slot < m_maxObjects, "Rewind slot out of range");
+	if(m_frameCount == 0 || slot >= m_maxObjects)
+	{
+		return;
+	}
+
+	size_t index = ((m_nextFrame + MAX_FRAMES - 1) % MAX_FRAMES) * m_maxObjects + slot;
+	m_networkIDs[index] = networkID;
+	m_minXs[index] = bounds.mins.x;
+	m_minYs[index] = bounds.mins.y;
+	m_minZs[index] = bounds.mins.z;
+	m_maxXs[index] = bounds.maxs.x;
+	m_maxYs[index] = bounds.maxs.y;
+	m_maxZs[index] = bounds.maxs.z;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Every object each query touched at its time goes in out_hits (which isn't cleared). Returns how
+// many hits were added.
+size_t NetRewindHistory::QueryOverlaps(NetRewindQuery const * queries, size_t queryCount, std::vector<NetRewindHit> * out_hits)
+{
+	m_lastQueryCount = queryCount;
+	m_lastTestCount = 0;
+	if(m_frameCount == 0)
+	{
+		return 0;
+	}
+
+	size_t startHitCount = out_hits->size();
+	AABB3 bounds(Vector3f(0.f), Vector3f(0.f));
+	for(size_t queryIndex = 0; queryIndex < queryCount; ++queryIndex)
+	{
+		NetRewindQuery const & query = queries[queryIndex];
+		size_t before;
+		size_t after;
+		bool isClamped;
+		float fraction = FindFrames(query.hostTime, &before, &after, &isClamped);
+		if(isClamped)
+		{
+			++m_clampedQueryCount;
+		}
+
+		for(size_t slot = 0; slot < m_maxObjects; ++slot)
+		{
+			if(!GetSlotBounds(before, after, fraction, slot, &bounds))
+			{
+				continue;
+			}
+
+			++m_lastTestCount;
+			if(OverlapAABB3s(query.bounds, bounds))
+			{
+				NetRewindHit hit;
+				hit.queryIndex = queryIndex;
+				hit.networkID = m_networkIDs[before * m_maxObjects + slot];
+				out_hits->push_back(hit);
+			}
+		}
+	}
+	return out_hits->size() - startHitCount;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// False if that object wasn't in the slot at that time
+bool NetRewindHistory::GetBounds(size_t slot, uint16_t networkID, double hostTime, AABB3 * out_bounds) const
+{
+	if(m_frameCount == 0 || slot >= m_maxObjects)
+	{
+		return false;
+	}
+
+	size_t before;
+	size_t after;
+	bool isClamped;
+	float fraction = FindFrames(hostTime, &before, &after, &isClamped);
+	if(m_networkIDs[before * m_maxObjects + slot] != networkID)
+	{
+		return false;
+	}
+	return GetSlotBounds(before, after, fraction, slot, out_bounds);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetRewindHistory::Clear()
+{
+	m_nextFrame = 0;
+	m_frameCount = 0;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+size_t NetRewindHistory::GetFrameCount() const
+{
+	return m_frameCount;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+double NetRewindHistory::GetOldestTime() const
+{
+	if(m_frameCount == 0)
+	{
+		return 0.0;
+	}
+	return m_frameTimes[(m_nextFrame + MAX_FRAMES - m_frameCount) % MAX_FRAMES];
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// The two recorded frames around hostTime and how far between them it is. Times before the history
+// (or MAX_REWIND_SECONDS) get the oldest allowed time, times after the newest frame get the newest.
+float NetRewindHistory::FindFrames(double hostTime, size_t * out_before, size_t * out_after, bool * out_isClamped) const
+{
+	size_t oldest = (m_nextFrame + MAX_FRAMES - m_frameCount) % MAX_FRAMES;
+	size_t newest = (m_nextFrame + MAX_FRAMES - 1) % MAX_FRAMES;
+	double newestTime = m_frameTimes[newest];
+	double minTime = m_frameTimes[oldest];
+	if(newestTime - MAX_REWIND_SECONDS > minTime)
+	{
+		minTime = newestTime - MAX_REWIND_SECONDS;
+	}
+
+	*out_isClamped = false;
+	if(hostTime < minTime)
+	{
+		hostTime = minTime;
+		*out_isClamped = true;
+	}
+
+	if(hostTime >= newestTime)
+	{
+		*out_before = newest;
+		*out_after = newest;
+		return 0.f;
+	}
+
+	//Last frame at or before hostTime, counted from the oldest
+	size_t low = 0;
+	size_t high = m_frameCount - 1;
+	while(low + 1 < high)
+	{
+		size_t middle = (low + high) / 2;
+		if(m_frameTimes[(oldest + middle) % MAX_FRAMES] <= hostTime)
+		{
+			low = middle;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+
+	*out_before = (oldest + low) % MAX_FRAMES;
+	*out_after = (oldest + low + 1) % MAX_FRAMES;
+	double span = m_frameTimes[*out_after] - m_frameTimes[*out_before];
+	if(span <= 0.0)
+	{
+		return 0.f;
+	}
+	return (float)((hostTime - m_frameTimes[*out_before]) / span);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Objects that weren't there yet don't count, objects that are gone by the next frame stay put
+bool NetRewindHistory::GetSlotBounds(size_t before, size_t after, float fraction, size_t slot, AABB3 * out_bounds) const
+{
+	size_t beforeIndex = before * m_maxObjects + slot;
+	size_t afterIndex = after * m_maxObjects + slot;
+	uint16_t networkID = m_networkIDs[beforeIndex];
+	if(networkID == EMPTY_SLOT)
+	{
+		return false;
+	}
+
+	if(m_networkIDs[afterIndex] != networkID)
+	{
+		afterIndex = beforeIndex;
+	}
+
+	float keep = 1.f - fraction;
+	out_bounds->mins.x = m_minXs[beforeIndex] * keep + m_minXs[afterIndex] * fraction;
+	out_bounds->mins.y = m_minYs[beforeIndex] * keep + m_minYs[afterIndex] * fraction;
+	out_bounds->mins.z = m_minZs[beforeIndex] * keep + m_minZs[afterIndex] * fraction;
+	out_bounds->maxs.x = m_maxXs[beforeIndex] * keep + m_maxXs[afterIndex] * fraction;
+	out_bounds->maxs.y = m_maxYs[beforeIndex] * keep + m_maxYs[afterIndex] * fraction;
+	out_bounds->maxs.z = m_maxZs[beforeIndex] * keep + m_maxZs[afterIndex] * fraction;
+	return true;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Records an object sliding along x at 10 units a second for more ticks than the history holds, then
+// checks that queries between two ticks see the interpolated bounds and that queries from before
+// MAX_REWIND_SECONDS are clamped to it.
+void NetRewindCheckCommand(Command const &)
+{
+	double const tickSeconds = 1.0 / 60.0;
+	float const speed = 10.f;
+	size_t const tickCount = NetRewindHistory::MAX_FRAMES + 36;
+	NetRewindHistory history(4);
+	for(size_t tick = 0; tick < tickCount; ++tick)
+	{
+		double hostTime = tick * tickSeconds;
+		float x = (float)hostTime * speed;
+		history.BeginFrame(hostTime);
+		history.SetObject(0, 7, AABB3(Vector3f(x, 0.f, 0.f), Vector3f(x + 1.f, 1.f, 1.f)));
+	}
+
+	double const newestTime = (tickCount - 1) * tickSeconds;
+	int failCount = 0;
+
+	//Halfway between two ticks, a box just left of the interpolated bounds would still touch the earlier
+	//tick and a box just inside them would miss the later one
+	double const betweenTime = newestTime - 0.2 - tickSeconds * 0.5;
+	float const betweenX = (float)betweenTime * speed;
+	AABB3 bounds(Vector3f(0.f), Vector3f(0.f));
+	if(!history.GetBounds(0, 7, betweenTime, &bounds) || fabsf(bounds.mins.x - betweenX) > 0.001f)
+	{
+		BConsoleSystem::AddLog(Stringf("net_rewind_check: GetBounds between ticks gave x %.4f, expected %.4f", bounds.mins.x, betweenX), BConsoleSystem::BAD);
+		++failCount;
+	}
+
+	//Asking for time 0 gets the oldest allowed time instead, where the object is nowhere near x 0
+	double const clampedTime = newestTime - NetRewindHistory::MAX_REWIND_SECONDS;
+	float const clampedX = (float)clampedTime * speed;
+	NetRewindQuery const queries[4] =
+	{
+		NetRewindQuery(betweenTime, AABB3(Vector3f(betweenX - 0.04f, 0.f, 0.f), Vector3f(betweenX - 0.01f, 1.f, 1.f))),
+		NetRewindQuery(betweenTime, AABB3(Vector3f(betweenX + 0.01f, 0.f, 0.f), Vector3f(betweenX + 0.04f, 1.f, 1.f))),
+		NetRewindQuery(0.0, AABB3(Vector3f(clampedX + 0.01f, 0.f, 0.f), Vector3f(clampedX + 0.04f, 1.f, 1.f))),
+		NetRewindQuery(0.0, AABB3(Vector3f(0.25f, 0.f, 0.f), Vector3f(0.75f, 1.f, 1.f))),
+	};
+	bool const shouldHit[4] = { false, true, true, false };
+
+	std::vector<NetRewindHit> hits;
+	history.QueryOverlaps(queries, 4, &hits);
+	bool didHit[4] = { false, false, false, false };
+	for(size_t hitIndex = 0; hitIndex < hits.size(); ++hitIndex)
+	{
+		didHit[hits[hitIndex].queryIndex] = hits[hitIndex].networkID == 7;
+	}
+	for(size_t queryIndex = 0; queryIndex < 4; ++queryIndex)
+	{
+		if(didHit[queryIndex] != shouldHit[queryIndex])
+		{
+			BConsoleSystem::AddLog(Stringf("net_rewind_check: query %u %s, expected %s", queryIndex, didHit[queryIndex] ? "hit" : "missed", shouldHit[queryIndex] ? "a hit" : "a miss"), BConsoleSystem::BAD);
+			++failCount;
+		}
+	}
+	if(history.m_clampedQueryCount != 2)
+	{
+		BConsoleSystem::AddLog(Stringf("net_rewind_check: %u queries clamped, expected 2", history.m_clampedQueryCount), BConsoleSystem::BAD);
+		++failCount;
+	}
+
+	if(failCount == 0)
+	{
+		BConsoleSystem::AddLog(Stringf("net_rewind_check PASS: interpolation and %.1fs clamp over %u ticks", NetRewindHistory::MAX_REWIND_SECONDS, tickCount), BConsoleSystem::GOOD);
+	}
+	else
+	{
+		BConsoleSystem::AddLog(Stringf("net_rewind_check FAIL: %d checks failed", failCount), BConsoleSystem::BAD);
+	}
+}
\ No newline at end of file
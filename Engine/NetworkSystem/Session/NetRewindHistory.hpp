@@ -0,0 +1,106 @@
+#pragma once
+
+#include <vector>
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Math/AABB3.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+class AABB2f;
+class Command;
+class NetConnection;
+
+
+//-------------------------------------------------------------------------------------------------
+void NetRewindCheckCommand(Command const &);
+
+
+//-------------------------------------------------------------------------------------------------
+// Something a client did that has to be checked against the world as they saw it
+class NetRewindQuery
+{
+public:
+	double hostTime;
+	AABB3 bounds;
+
+public:
+	NetRewindQuery(double setHostTime, AABB3 const & setBounds);
+	NetRewindQuery(double setHostTime, AABB2f const & setBounds); //Infinitely tall, for 2D games
+};
+
+
+//-------------------------------------------------------------------------------------------------
+class NetRewindHit
+{
+public:
+	size_t queryIndex;
+	uint16_t networkID;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Host side history of where networked objects were, so actions can be judged against what the
+// client was looking at instead of where things are now. Every tick the game records each object's
+// bounds into a slot (slots are the game's to hand out, keep an object in the same slot). Frames are
+// stored structure of arrays, one array per bounds component, so a query walks each frame's objects
+// straight through memory. Between two recorded ticks the bounds are interpolated.
+class NetRewindHistory
+{
+	//-------------------------------------------------------------------------------------------------
+	// Static Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	static size_t const MAX_FRAMES = 64; //About a second at 60 ticks
+	static double const MAX_REWIND_SECONDS; //Nobody gets to shoot further into the past than this
+	static uint16_t const EMPTY_SLOT = 65535;
+
+	//-------------------------------------------------------------------------------------------------
+	// Members
+	//-------------------------------------------------------------------------------------------------
+private:
+	size_t m_maxObjects;
+	double m_frameTimes[MAX_FRAMES];
+	size_t m_nextFrame;
+	size_t m_frameCount;
+
+	//MAX_FRAMES * m_maxObjects, indexed frame * m_maxObjects + slot
+	std::vector<uint16_t> m_networkIDs;
+	std::vector<float> m_minXs;
+	std::vector<float> m_minYs;
+	std::vector<float> m_minZs;
+	std::vector<float> m_maxXs;
+	std::vector<float> m_maxYs;
+	std::vector<float> m_maxZs;
+
+public:
+	//debugging information
+	size_t m_lastQueryCount;
+	size_t m_lastTestCount;
+	size_t m_clampedQueryCount; //Asked for further back than the history (or MAX_REWIND_SECONDS) goes
+
+	//-------------------------------------------------------------------------------------------------
+	// Static Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	static double GetClientViewTime(NetConnection const * connection, double hostTime, double interpolationDelay);
+
+	//-------------------------------------------------------------------------------------------------
+	// Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	NetRewindHistory(size_t maxObjects);
+	~NetRewindHistory();
+
+	void BeginFrame(double hostTime);
+	void SetObject(size_t slot, uint16_t networkID, AABB3 const & bounds);
+	size_t QueryOverlaps(NetRewindQuery const * queries, size_t queryCount, std::vector<NetRewindHit> * out_hits);
+	bool GetBounds(size_t slot, uint16_t networkID, double hostTime, AABB3 * out_bounds) const;
+	void Clear();
+
+	size_t GetFrameCount() const;
+	double GetOldestTime() const;
+
+private:
+	float FindFrames(double hostTime, size_t * out_before, size_t * out_after, bool * out_isClamped) const;
+	bool GetSlotBounds(size_t before, size_t after, float fraction, size_t slot, AABB3 * out_bounds) const;
+};
\ No newline at end of file
@@ -0,0 +1,190 @@
+#include "Engine/NetworkSystem/Session/NetSchema.hpp"
+
+#include <cmath>
+#include <vector>
+#include "Engine/Core/Time.hpp"
+#include "Engine/DebugSystem/BConsoleSystem.hpp"
+#include "Engine/DebugSystem/Command.hpp"
+#include "Engine/Utils/BitPacker.hpp"
+#include "Engine/Utils/MathUtils.hpp"
+#include "Engine/Utils/StringUtils.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+// What a typical player update carries
+class BenchPlayerState
+{
+public:
+	Vector2f position;
+	Vector2f velocity;
+	float orientationDegrees;
+	int health;
+	uint8_t ammo;
+	bool isFiring;
+	uint16_t lastInputID;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+typedef NetSchema<
+	NET_SCHEMA_FIELD(&BenchPlayerState::position, NetFieldQuantizedVector2f<-512, 512, 64>),
+	NET_SCHEMA_FIELD(&BenchPlayerState::velocity, NetFieldQuantizedVector2f<-64, 64, 32>),
+	NET_SCHEMA_FIELD(&BenchPlayerState::orientationDegrees, NetFieldQuantizedFloat<0, 360, 4>),
+	NET_SCHEMA_FIELD(&BenchPlayerState::health, NetFieldRangedInt<0, 200>),
+	NET_SCHEMA_FIELD(&BenchPlayerState::ammo, NetFieldRangedInt<0, 99>),
+	NET_SCHEMA_FIELD(&BenchPlayerState::isFiring, NetFieldBool),
+	NET_SCHEMA_FIELD(&BenchPlayerState::lastInputID, NetFieldRaw<uint16_t>)
+> BenchPlayerSchema;
+
+static_assert(BenchPlayerSchema::BYTE_COUNT == 13, "Bench schema should pack into 13 bytes");
+
+
+//-------------------------------------------------------------------------------------------------
+class BenchSerializeResult
+{
+public:
+	size_t byteCount;
+	uint64_t writeOpCount;
+	uint64_t readOpCount;
+	float maxPositionError;
+	bool isValid;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+void NetSchemaBenchCommand(Command const & command)
+{
+	int iterations = command.GetArg(0, 100);
+	if(iterations <= 0)
+	{
+		iterations = 1;
+	}
+
+	size_t const stateCount = 1024;
+	std::vector<BenchPlayerState> states(stateCount);
+	for(size_t stateIndex = 0; stateIndex < stateCount; ++stateIndex)
+	{
+		BenchPlayerState & state = states[stateIndex];
+		state.position = Vector2f(RandomFloat(-512.f, 512.f), RandomFloat(-512.f, 512.f));
+		state.velocity = Vector2f(RandomFloat(-64.f, 64.f), RandomFloat(-64.f, 64.f));
+		state.orientationDegrees = RandomFloat(0.f, 360.f);
+		state.health = RandomInt(201);
+		state.ammo = (uint8_t)RandomInt(100);
+		state.isFiring = RandomInt(2) == 0;
+		state.lastInputID = (uint16_t)RandomInt(65536);
+	}
+
+	std::vector<byte_t> buffer(stateCount * sizeof(BenchPlayerState) * 2);
+	std::vector<BenchPlayerState> readStates(stateCount);
+	BenchSerializeResult results[3] = { 0 };
+	char const * names[3] = { "BytePacker::Write<T>", "BitPacker by hand", "NetSchema" };
+	for(int iteration = 0; iteration < iterations; ++iteration)
+	{
+		for(size_t resultIndex = 0; resultIndex < 3; ++resultIndex)
+		{
+			BenchSerializeResult & result = results[resultIndex];
+			BytePacker writePacker(&buffer[0], buffer.size(), 0);
+			uint64_t startOpCount = Time::GetCurrentOpCount();
+			for(size_t stateIndex = 0; stateIndex < stateCount; ++stateIndex)
+			{
+				BenchPlayerState const & state = states[stateIndex];
+				if(resultIndex == 0)
+				{
+					//How messages are written today
+					writePacker.Write<float>(state.position.x);
+					writePacker.Write<float>(state.position.y);
+					writePacker.Write<float>(state.velocity.x);
+					writePacker.Write<float>(state.velocity.y);
+					writePacker.Write<float>(state.orientationDegrees);
+					writePacker.Write<int>(state.health);
+					writePacker.Write<uint8_t>(state.ammo);
+					writePacker.Write<bool>(state.isFiring);
+					writePacker.Write<uint16_t>(state.lastInputID);
+				}
+				else if(resultIndex == 1)
+				{
+					//The same quantization as the schema, through the BitPacker helpers. Position needs 17 bits
+					//an axis for 1/64 steps over 1024 units, more than WriteQuantizedFloat takes, so it's done here
+					BitPacker writer(&writePacker);
+					writer.WriteBits((uint32_t)Clamp((state.position.x + 512.f) * 64.f + 0.5f, 0.f, 65536.f), 17);
+					writer.WriteBits((uint32_t)Clamp((state.position.y + 512.f) * 64.f + 0.5f, 0.f, 65536.f), 17);
+					writer.WriteQuantizedVector2f(state.velocity, Vector2f(-64.f), Vector2f(64.f), 13);
+					writer.WriteQuantizedFloat(state.orientationDegrees, 0.f, 360.f, 11);
+					writer.WriteRangedInt(state.health, 0, 200);
+					writer.WriteRangedInt(state.ammo, 0, 99);
+					writer.WriteBool(state.isFiring);
+					writer.WriteBits(state.lastInputID, 16);
+				}
+				else
+				{
+					BenchPlayerSchema::Write(&writePacker, state);
+				}
+			}
+			result.writeOpCount += Time::GetCurrentOpCount() - startOpCount;
+			result.byteCount = writePacker.GetCurrentOffset();
+
+			BytePacker const readPacker(&buffer[0], buffer.size(), result.byteCount);
+			startOpCount = Time::GetCurrentOpCount();
+			for(size_t stateIndex = 0; stateIndex < stateCount; ++stateIndex)
+			{
+				BenchPlayerState & state = readStates[stateIndex];
+				if(resultIndex == 0)
+				{
+					readPacker.Read<float>(&state.position.x);
+					readPacker.Read<float>(&state.position.y);
+					readPacker.Read<float>(&state.velocity.x);
+					readPacker.Read<float>(&state.velocity.y);
+					readPacker.Read<float>(&state.orientationDegrees);
+					readPacker.Read<int>(&state.health);
+					readPacker.Read<uint8_t>(&state.ammo);
+					readPacker.Read<bool>(&state.isFiring);
+					readPacker.Read<uint16_t>(&state.lastInputID);
+				}
+				else if(resultIndex == 1)
+				{
+					BitPacker reader(&readPacker);
+					uint32_t positionX;
+					uint32_t positionY;
+					int ammo;
+					uint32_t lastInputID;
+					reader.ReadBits(&positionX, 17);
+					reader.ReadBits(&positionY, 17);
+					state.position = Vector2f((float)positionX / 64.f - 512.f, (float)positionY / 64.f - 512.f);
+					reader.ReadQuantizedVector2f(&state.velocity, Vector2f(-64.f), Vector2f(64.f), 13);
+					reader.ReadQuantizedFloat(&state.orientationDegrees, 0.f, 360.f, 11);
+					reader.ReadRangedInt(&state.health, 0, 200);
+					reader.ReadRangedInt(&ammo, 0, 99);
+					reader.ReadBool(&state.isFiring);
+					reader.ReadBits(&lastInputID, 16);
+					state.ammo = (uint8_t)ammo;
+					state.lastInputID = (uint16_t)lastInputID;
+				}
+				else
+				{
+					BenchPlayerSchema::Read(&readPacker, &state);
+				}
+			}
+			result.readOpCount += Time::GetCurrentOpCount() - startOpCount;
+
+			result.isValid = true;
+			for(size_t stateIndex = 0; stateIndex < stateCount; ++stateIndex)
+			{
+				BenchPlayerState const & written = states[stateIndex];
+				BenchPlayerState const & read = readStates[stateIndex];
+				float positionError = Max(fabsf(written.position.x - read.position.x), fabsf(written.position.y - read.position.y));
+				result.maxPositionError = Max(result.maxPositionError, positionError);
+				result.isValid = result.isValid && written.health == read.health && written.ammo == read.ammo && written.isFiring == read.isFiring && written.lastInputID == read.lastInputID;
+			}
+		}
+	}
+
+	BConsoleSystem::AddLog(Stringf("Serializing %u player states, %d iterations:", stateCount, iterations), BConsoleSystem::INFO);
+	for(size_t resultIndex = 0; resultIndex < 3; ++resultIndex)
+	{
+		BenchSerializeResult const & result = results[resultIndex];
+		double writeNano = Time::GetTimeFromOpCount(result.writeOpCount) * 1000000000.0 / (double)(stateCount * iterations);
+		double readNano = Time::GetTimeFromOpCount(result.readOpCount) * 1000000000.0 / (double)(stateCount * iterations);
+		BConsoleSystem::AddLog(Stringf("%s: %.1f bytes/state, write %.1fns, read %.1fns, position error %.4f%s",
+			names[resultIndex], (float)result.byteCount / (float)stateCount, writeNano, readNano, result.maxPositionError, result.isValid ? "" : ", MISMATCH"), result.isValid ? BConsoleSystem::INFO : BConsoleSystem::BAD);
+	}
+}
\ No newline at end of file
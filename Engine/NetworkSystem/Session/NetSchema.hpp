@@ -0,0 +1,484 @@
+#pragma once
+
+#include <cstring>
+#include <type_traits>
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Math/Vector2f.hpp"
+#include "Engine/Utils/BytePacker.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+class Command;
+
+
+//-------------------------------------------------------------------------------------------------
+void NetSchemaBenchCommand(Command const &);
+
+
+//-------------------------------------------------------------------------------------------------
+// Declarative layouts for messages and replicated state. A schema is a list of members and how
+// each one goes on the wire, and everything else (bit counts, byte size, the encode and decode) is
+// worked out at compile time:
+//
+//	typedef NetSchema<
+//		NET_SCHEMA_FIELD(&Ship::m_position, NetFieldQuantizedVector2f<-512, 512, 64>),
+//		NET_SCHEMA_FIELD(&Ship::m_health, NetFieldRangedInt<0, 200>),
+//		NET_SCHEMA_FIELD(&Ship::m_isFiring, NetFieldBool)
+//	> ShipSchema;
+//
+//	ShipSchema::Write(&message, ship); //Always ShipSchema::BYTE_COUNT bytes
+//	ShipSchema::Read(&message, &ship);
+//
+// Every encoding is a fixed number of bits (the same bits BitPacker would write), so a schema is
+// always exactly BYTE_COUNT bytes and can be checked against message sizes with static_assert.
+// WriteFields/ReadFields and WriteField/ReadField (one field by index, for INetworkedObject) also
+// work on a BitPacker when the schema is only part of what's being written.
+//-------------------------------------------------------------------------------------------------
+#define NET_SCHEMA_FIELD(member, ...) NetSchemaField<decltype(member), member, __VA_ARGS__>
+
+
+//-------------------------------------------------------------------------------------------------
+// Number of bits needed to hold maxValue
+constexpr uint8_t NetSchemaBitsRequired(uint64_t maxValue)
+{
+	return maxValue == 0 ? 0 : (uint8_t)(1 + NetSchemaBitsRequired(maxValue >> 1));
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Encodings: ValueType, BIT_COUNT, and Encode/Decode to and from the low BIT_COUNT bits.
+// Decode never trusts the bits, anything out of range is clamped.
+//-------------------------------------------------------------------------------------------------
+class NetFieldBool
+{
+public:
+	typedef bool ValueType;
+	static uint8_t const BIT_COUNT = 1;
+
+public:
+	static uint64_t Encode(bool value)
+	{
+		return value ? 1 : 0;
+	}
+
+	static bool Decode(uint64_t bits)
+	{
+		return bits != 0;
+	}
+};
+
+
+//-------------------------------------------------------------------------------------------------
+template<uint8_t BitCount>
+class NetFieldBits
+{
+	static_assert(BitCount > 0 && BitCount <= 32, "NetFieldBits is 1 to 32 bits");
+
+public:
+	typedef uint32_t ValueType;
+	static uint8_t const BIT_COUNT = BitCount;
+
+public:
+	static uint64_t Encode(uint32_t value)
+	{
+		return value & (uint32_t)((((uint64_t)1) << BitCount) - 1);
+	}
+
+	static uint32_t Decode(uint64_t bits)
+	{
+		return (uint32_t)bits;
+	}
+};
+
+
+//-------------------------------------------------------------------------------------------------
+template<int MinValue, int MaxValue>
+class NetFieldRangedInt
+{
+	static_assert(MinValue < MaxValue, "NetFieldRangedInt needs MinValue < MaxValue");
+
+public:
+	typedef int ValueType;
+	static uint32_t const RANGE = (uint32_t)((int64_t)MaxValue - (int64_t)MinValue);
+	static uint8_t const BIT_COUNT = NetSchemaBitsRequired(RANGE);
+
+public:
+	static uint64_t Encode(int value)
+	{
+		value = value < MinValue ? MinValue : (value > MaxValue ? MaxValue : value);
+		return (uint32_t)((int64_t)value - (int64_t)MinValue);
+	}
+
+	static int Decode(uint64_t bits)
+	{
+		uint32_t offset = (uint32_t)bits > RANGE ? RANGE : (uint32_t)bits;
+		return (int)((int64_t)MinValue + (int64_t)offset);
+	}
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Precision is 1 / StepsPerUnit, so <-512, 512, 64> is 1/64th of a unit across 1024 units (17 bits)
+template<int MinValue, int MaxValue, int StepsPerUnit>
+class NetFieldQuantizedFloat
+{
+	static_assert(MinValue < MaxValue, "NetFieldQuantizedFloat needs MinValue < MaxValue");
+	static_assert(StepsPerUnit > 0, "NetFieldQuantizedFloat needs at least one step per unit");
+	static_assert(((uint64_t)((int64_t)MaxValue - (int64_t)MinValue) * (uint64_t)StepsPerUnit) <= 0xffffffffULL, "NetFieldQuantizedFloat is more than 32 bits");
+
+public:
+	typedef float ValueType;
+	static uint32_t const MAX_STEP = (uint32_t)((uint64_t)((int64_t)MaxValue - (int64_t)MinValue) * (uint64_t)StepsPerUnit);
+	static uint8_t const BIT_COUNT = NetSchemaBitsRequired(MAX_STEP);
+
+public:
+	static uint64_t Encode(float value)
+	{
+		//Written this way round so NaN ends up at MinValue
+		double steps = ((double)value - (double)MinValue) * (double)StepsPerUnit + 0.5;
+		if(!(steps > 0.0))
+		{
+			return 0;
+		}
+		if(steps >= (double)MAX_STEP)
+		{
+			return MAX_STEP;
+		}
+		return (uint32_t)steps;
+	}
+
+	static float Decode(uint64_t bits)
+	{
+		uint32_t step = (uint32_t)bits > MAX_STEP ? MAX_STEP : (uint32_t)bits;
+		return (float)((double)MinValue + (double)step / (double)StepsPerUnit);
+	}
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Same range and precision on both axes, x in the low bits
+template<int MinValue, int MaxValue, int StepsPerUnit>
+class NetFieldQuantizedVector2f
+{
+	typedef NetFieldQuantizedFloat<MinValue, MaxValue, StepsPerUnit> AxisEncoding;
+
+public:
+	typedef Vector2f ValueType;
+	static uint8_t const BIT_COUNT = AxisEncoding::BIT_COUNT * 2;
+
+public:
+	static uint64_t Encode(Vector2f const & value)
+	{
+		return AxisEncoding::Encode(value.x) | (AxisEncoding::Encode(value.y) << AxisEncoding::BIT_COUNT);
+	}
+
+	static Vector2f Decode(uint64_t bits)
+	{
+		uint64_t axisMask = (((uint64_t)1) << AxisEncoding::BIT_COUNT) - 1;
+		return Vector2f(AxisEncoding::Decode(bits & axisMask), AxisEncoding::Decode(bits >> AxisEncoding::BIT_COUNT));
+	}
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Full precision, for IDs and anything that can't be quantized (up to 8 bytes)
+template<typename Type>
+class NetFieldRaw
+{
+	static_assert(sizeof(Type) <= sizeof(uint64_t), "NetFieldRaw is up to 8 bytes");
+	static_assert(std::is_trivially_copyable<Type>::value, "NetFieldRaw needs a plain type");
+
+	//Unsigned int the same size as Type
+	typedef typename std::conditional<sizeof(Type) <= 1, uint8_t,
+		typename std::conditional<sizeof(Type) <= 2, uint16_t,
+		typename std::conditional<sizeof(Type) <= 4, uint32_t, uint64_t>::type>::type>::type BitsType;
+
+public:
+	typedef Type ValueType;
+	static uint8_t const BIT_COUNT = (uint8_t)(sizeof(Type) * 8);
+
+public:
+	static uint64_t Encode(Type const & value)
+	{
+		//Same value whatever the host's endianness, the bit packers write the low bits first
+		BitsType bits = 0;
+		memcpy(&bits, &value, sizeof(Type));
+		return bits;
+	}
+
+	static Type Decode(uint64_t bits)
+	{
+		BitsType narrowBits = (BitsType)bits;
+		Type value;
+		memcpy(&value, &narrowBits, sizeof(Type));
+		return value;
+	}
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Bit writer over a buffer that's known to be big enough (a schema's BYTE_COUNT), so unlike
+// BitPacker there's nothing to check per field. Same bit order as BitPacker.
+class NetSchemaWriter
+{
+private:
+	byte_t * m_buffer;
+	size_t m_size;
+	uint64_t m_scratch;
+	uint8_t m_scratchBits;
+
+public:
+	NetSchemaWriter(byte_t * buffer)
+		: m_buffer(buffer)
+		, m_size(0)
+		, m_scratch(0)
+		, m_scratchBits(0)
+	{
+		//Nothing
+	}
+
+	//---------------------------------------------------------------------------------------------
+	bool WriteBits(uint32_t value, uint8_t bitCount)
+	{
+		m_scratch |= ((uint64_t)value & ((((uint64_t)1) << bitCount) - 1)) << m_scratchBits;
+		m_scratchBits += bitCount;
+		while(m_scratchBits >= 8)
+		{
+			m_buffer[m_size++] = (byte_t)(m_scratch & 0xff);
+			m_scratch >>= 8;
+			m_scratchBits -= 8;
+		}
+		return true;
+	}
+
+	//---------------------------------------------------------------------------------------------
+	// Last partial byte, padded with zeros
+	size_t Flush()
+	{
+		if(m_scratchBits > 0)
+		{
+			m_buffer[m_size++] = (byte_t)(m_scratch & 0xff);
+			m_scratch = 0;
+			m_scratchBits = 0;
+		}
+		return m_size;
+	}
+};
+
+
+//-------------------------------------------------------------------------------------------------
+class NetSchemaReader
+{
+private:
+	byte_t const * m_buffer;
+	size_t m_offset;
+	uint64_t m_scratch;
+	uint8_t m_scratchBits;
+
+public:
+	NetSchemaReader(byte_t const * buffer)
+		: m_buffer(buffer)
+		, m_offset(0)
+		, m_scratch(0)
+		, m_scratchBits(0)
+	{
+		//Nothing
+	}
+
+	//---------------------------------------------------------------------------------------------
+	bool ReadBits(uint32_t * out_value, uint8_t bitCount)
+	{
+		while(m_scratchBits < bitCount)
+		{
+			m_scratch |= ((uint64_t)m_buffer[m_offset++]) << m_scratchBits;
+			m_scratchBits += 8;
+		}
+		*out_value = (uint32_t)(m_scratch & ((((uint64_t)1) << bitCount) - 1));
+		m_scratch >>= bitCount;
+		m_scratchBits -= bitCount;
+		return true;
+	}
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Writers and readers take at most 32 bits at a time (BitPacker::MAX_BITS)
+template<typename Writer>
+bool NetSchemaWriteBits(Writer * writer, uint64_t bits, uint8_t bitCount)
+{
+	if(bitCount > 32)
+	{
+		return writer->WriteBits((uint32_t)bits, 32) && writer->WriteBits((uint32_t)(bits >> 32), bitCount - 32);
+	}
+	return writer->WriteBits((uint32_t)bits, bitCount);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+template<typename Reader>
+bool NetSchemaReadBits(Reader * reader, uint64_t * out_bits, uint8_t bitCount)
+{
+	uint32_t lowBits = 0;
+	uint32_t highBits = 0;
+	bool success = reader->ReadBits(&lowBits, bitCount > 32 ? 32 : bitCount);
+	if(bitCount > 32)
+	{
+		success = reader->ReadBits(&highBits, bitCount - 32) && success;
+	}
+	*out_bits = (uint64_t)lowBits | ((uint64_t)highBits << 32);
+	return success;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// One member and its encoding, made with NET_SCHEMA_FIELD
+template<typename MemberPointer, MemberPointer Member, typename Encoding>
+class NetSchemaField
+{
+public:
+	static uint8_t const BIT_COUNT = Encoding::BIT_COUNT;
+
+public:
+	template<typename Writer, typename Object>
+	static bool Write(Writer * writer, Object const & object)
+	{
+		typedef typename Encoding::ValueType ValueType;
+		return NetSchemaWriteBits(writer, Encoding::Encode((ValueType)(object.*Member)), BIT_COUNT);
+	}
+
+	template<typename Reader, typename Object>
+	static bool Read(Reader * reader, Object * out_object)
+	{
+		typedef typename std::remove_reference<decltype(out_object->*Member)>::type MemberType;
+		uint64_t bits;
+		bool success = NetSchemaReadBits(reader, &bits, BIT_COUNT);
+		out_object->*Member = (MemberType)Encoding::Decode(bits);
+		return success;
+	}
+};
+
+
+//-------------------------------------------------------------------------------------------------
+template<typename... Fields>
+class NetSchema;
+
+
+//-------------------------------------------------------------------------------------------------
+template<>
+class NetSchema<>
+{
+public:
+	static uint8_t const FIELD_COUNT = 0;
+	static size_t const BIT_COUNT = 0;
+	static uint8_t const MAX_FIELD_BIT_COUNT = 0;
+
+public:
+	template<typename Writer, typename Object>
+	static bool WriteFields(Writer *, Object const &)
+	{
+		return true;
+	}
+
+	template<typename Reader, typename Object>
+	static bool ReadFields(Reader *, Object *)
+	{
+		return true;
+	}
+
+	template<typename Writer, typename Object>
+	static bool WriteField(uint8_t, Writer *, Object const &)
+	{
+		return false;
+	}
+
+	template<typename Reader, typename Object>
+	static bool ReadField(uint8_t, Reader *, Object *)
+	{
+		return false;
+	}
+};
+
+
+//-------------------------------------------------------------------------------------------------
+template<typename Field, typename... OtherFields>
+class NetSchema<Field, OtherFields...>
+{
+	typedef NetSchema<OtherFields...> OtherSchema;
+
+	//-------------------------------------------------------------------------------------------------
+	// Static Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	static uint8_t const FIELD_COUNT = 1 + OtherSchema::FIELD_COUNT;
+	static size_t const BIT_COUNT = Field::BIT_COUNT + OtherSchema::BIT_COUNT;
+	static size_t const BYTE_COUNT = (BIT_COUNT + 7) / 8;
+	static uint8_t const MAX_FIELD_BIT_COUNT = Field::BIT_COUNT > OtherSchema::MAX_FIELD_BIT_COUNT ? Field::BIT_COUNT : OtherSchema::MAX_FIELD_BIT_COUNT;
+
+	//-------------------------------------------------------------------------------------------------
+	// Static Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	//-------------------------------------------------------------------------------------------------
+	// Packs on the stack and hands it to the BytePacker in one go, false if it doesn't fit.
+	// The bytes are already in wire order, so they go in forward whatever the packer's endianness.
+	template<typename Object>
+	static bool Write(BytePacker * packer, Object const & object)
+	{
+		byte_t buffer[BYTE_COUNT];
+		NetSchemaWriter writer(buffer);
+		WriteFields(&writer, object);
+		return packer->WriteForward(buffer, writer.Flush());
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	// Object is untouched if there aren't BYTE_COUNT bytes left to read
+	template<typename Object>
+	static bool Read(BytePacker const * packer, Object * out_object)
+	{
+		byte_t buffer[BYTE_COUNT];
+		if(!packer->ReadForward(buffer, BYTE_COUNT))
+		{
+			return false;
+		}
+		NetSchemaReader reader(buffer);
+		return ReadFields(&reader, out_object);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	// Writer is anything with WriteBits(uint32_t, uint8_t), usually a BitPacker
+	template<typename Writer, typename Object>
+	static bool WriteFields(Writer * writer, Object const & object)
+	{
+		return Field::Write(writer, object) && OtherSchema::WriteFields(writer, object);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	template<typename Reader, typename Object>
+	static bool ReadFields(Reader * reader, Object * out_object)
+	{
+		return Field::Read(reader, out_object) && OtherSchema::ReadFields(reader, out_object);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	// Just one field, for INetworkedObject::WriteReplicatedField
+	template<typename Writer, typename Object>
+	static bool WriteField(uint8_t fieldIndex, Writer * writer, Object const & object)
+	{
+		if(fieldIndex == 0)
+		{
+			return Field::Write(writer, object);
+		}
+		return OtherSchema::WriteField(fieldIndex - 1, writer, object);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	template<typename Reader, typename Object>
+	static bool ReadField(uint8_t fieldIndex, Reader * reader, Object * out_object)
+	{
+		if(fieldIndex == 0)
+		{
+			return Field::Read(reader, out_object);
+		}
+		return OtherSchema::ReadField(fieldIndex - 1, reader, out_object);
+	}
+};
\ No newline at end of file
@@ -0,0 +1,416 @@
+#include "Engine/NetworkSystem/Session/NetSendQueue.hpp"
+
+#include <algorithm>
+#include <queue>
+#include "Engine/Core/Time.hpp"
+#include "Engine/DebugSystem/BConsoleSystem.hpp"
+#include "Engine/DebugSystem/Command.hpp"
+#include "Engine/NetworkSystem/Session/NetConnection.hpp"
+#include "Engine/NetworkSystem/Session/NetMessage.hpp"
+#include "Engine/NetworkSystem/Session/NetPacket.hpp"
+#include "Engine/NetworkSystem/Session/NetSession.hpp"
+#include "Engine/Utils/MathUtils.hpp"
+#include "Engine/Utils/StringUtils.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+void NetSendQueueBenchCommand(Command const & command)
+{
+	int ticks = command.GetArg(0, 600);
+	if(ticks <= 0)
+	{
+		ticks = 1;
+	}
+	NetSendQueue::RunBenchmark((size_t)ticks);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool SendPriorityCompare::operator()(NetMessage const * lhs, NetMessage const * rhs) const
+{
+	return lhs->m_definition->priority > rhs->m_definition->priority;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetSendQueue::NetSendQueue()
+	: m_reliableCount(0)
+	, m_expiredCount(0)
+	, m_skippedCount(0)
+{
+	//Nothing
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetSendQueue::~NetSendQueue()
+{
+	Clear();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Takes ownership, the message needs its definition set
+void NetSendQueue::Push(NetMessage * message)
+{
+	//After everything with the same priority, so it stays first in first out within a priority
+	std::vector<NetMessage*>::iterator insertAt = std::upper_bound(m_messages.begin(), m_messages.end(), message, SendPriorityCompare());
+	m_messages.insert(insertAt, message);
+	if(message->m_definition->IsReliable())
+	{
+		++m_reliableCount;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Takes the messages for one packet off the queue (caller owns them now) and returns how many.
+// Expired unreliables found on the way are deleted.
+size_t NetSendQueue::SelectForPacket(size_t bytesFree, size_t messagesFree, size_t reliablesFree, double currentTime, std::vector<NetMessage*> * out_selected)
+{
+	messagesFree = Min(messagesFree, MAX_MESSAGES_PER_PACKET);
+	size_t selectedCount = 0;
+	size_t missCount = 0;
+	size_t keepCount = 0;
+	for(size_t messageIndex = 0; messageIndex < m_messages.size(); ++messageIndex)
+	{
+		NetMessage * message = m_messages[messageIndex];
+		bool isReliable = message->m_definition->IsReliable();
+		if(IsExpired(message, currentTime))
+		{
+			++m_expiredCount;
+			delete message;
+			continue;
+		}
+
+		bool canTake = selectedCount < messagesFree && missCount < MAX_MISSES_PER_PACKET && (!isReliable || reliablesFree > 0);
+		if(canTake)
+		{
+			size_t messageSize = message->GetTotalWrittenMessageSize();
+			if(messageSize <= bytesFree)
+			{
+				bytesFree -= messageSize;
+				++selectedCount;
+				out_selected->push_back(message);
+				if(isReliable)
+				{
+					--reliablesFree;
+					--m_reliableCount;
+				}
+				continue;
+			}
+
+			++missCount;
+			++m_skippedCount;
+		}
+
+		//Still waiting, slide it up over the ones that left
+		m_messages[keepCount] = message;
+		++keepCount;
+	}
+	m_messages.resize(keepCount);
+	return selectedCount;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// After every send: unreliables that were only meant for that send, or whose time is up, are
+// deleted. Returns how many.
+size_t NetSendQueue::RemoveExpired(double currentTime)
+{
+	size_t keepCount = 0;
+	for(size_t messageIndex = 0; messageIndex < m_messages.size(); ++messageIndex)
+	{
+		NetMessage * message = m_messages[messageIndex];
+		NetMessageDefinition const * definition = message->m_definition;
+		if(definition->CanExpire() && (definition->expireSeconds <= 0.f || message->m_expireTime <= currentTime))
+		{
+			delete message;
+			continue;
+		}
+
+		m_messages[keepCount] = message;
+		++keepCount;
+	}
+
+	size_t removedCount = m_messages.size() - keepCount;
+	m_messages.resize(keepCount);
+	return removedCount;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetSendQueue::Clear()
+{
+	for(size_t messageIndex = 0; messageIndex < m_messages.size(); ++messageIndex)
+	{
+		delete m_messages[messageIndex];
+	}
+	m_messages.clear();
+	m_reliableCount = 0;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+size_t NetSendQueue::GetCount() const
+{
+	return m_messages.size();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+size_t NetSendQueue::GetReliableCount() const
+{
+	return m_reliableCount;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool NetSendQueue::IsEmpty() const
+{
+	return m_messages.empty();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool NetSendQueue::IsExpired(NetMessage const * message, double currentTime) const
+{
+	NetMessageDefinition const * definition = message->m_definition;
+	return definition->CanExpire() && definition->expireSeconds > 0.f && message->m_expireTime < currentTime;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+static double const BENCH_TICK_SECONDS = 1.0 / 60.0; //Same as the session's send rate
+
+
+//-------------------------------------------------------------------------------------------------
+// Benchmark traffic: lots of small urgent messages, a snapshot every tick, and bulky low priority
+// messages that may as well be dropped if they wait too long
+class BenchMessageType
+{
+public:
+	byte_t priority;
+	float expireSeconds;
+	bool isReliable;
+	size_t minPayload;
+	size_t maxPayload;
+	int perTick; //Negative means one every -perTick ticks
+};
+
+
+//-------------------------------------------------------------------------------------------------
+class BenchPackingResult
+{
+public:
+	size_t packetCount;
+	size_t messageCount;
+	size_t byteCount;
+	size_t expiredCount;
+	size_t droppedCount; //Unreliables cleaned up without ever going out
+	double urgentDelaySum; //Ticks from added to sent for HIGH_PRIORITY messages
+	size_t urgentCount;
+	uint64_t opCount;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+static NetMessage * CreateBenchMessage(NetMessageDefinition const * definition, size_t payloadSize, size_t tick)
+{
+	NetMessage * message = new NetMessage(definition->type);
+	message->m_definition = definition;
+	for(size_t byteIndex = 0; byteIndex < payloadSize; ++byteIndex)
+	{
+		message->Write<byte_t>((byte_t)byteIndex);
+	}
+	message->m_sentTimeStamp = (double)tick; //Reused as the tick it was added on
+	message->m_expireTime = (double)tick * BENCH_TICK_SECONDS + (double)definition->expireSeconds;
+	return message;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+static void RecordBenchSent(NetMessage * message, size_t tick, BenchPackingResult * result)
+{
+	++result->messageCount;
+	result->byteCount += message->GetTotalWrittenMessageSize();
+	if(message->m_definition->priority >= NetMessageDefinition::HIGH_PRIORITY)
+	{
+		result->urgentDelaySum += (double)tick - message->m_sentTimeStamp;
+		++result->urgentCount;
+	}
+	delete message;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+static void PrintBenchResult(char const * name, BenchPackingResult const & result, size_t ticks, size_t urgentTotal)
+{
+	size_t payloadRoom = NetPacket::MAX_SIZE - 16; //Roughly, after the packet header
+	double fill = result.packetCount > 0 ? 100.0 * (double)result.byteCount / (double)(result.packetCount * payloadRoom) : 0.0;
+	double urgentDelay = result.urgentCount > 0 ? result.urgentDelaySum / (double)result.urgentCount : 0.0;
+	double microPerTick = Time::GetTimeFromOpCount(result.opCount) * 1000000.0 / (double)ticks;
+	BConsoleSystem::AddLog(Stringf("%s: %u packets, %u messages, %.1f%% full, urgent %u/%u sent %.2f ticks late, %u expired, %u dropped, %.2fus/tick",
+		name, result.packetCount, result.messageCount, fill, result.urgentCount, urgentTotal, urgentDelay, result.expiredCount, result.droppedCount, microPerTick), BConsoleSystem::INFO);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Feeds the same random traffic through the old first in first out packing (stop at the first
+// message that doesn't fit) and through NetSendQueue, at MAX_PACKET_SEND_AMOUNT_PER_CONNECTION
+// packets a tick, and compares how full the packets were and how long urgent messages waited
+STATIC void NetSendQueue::RunBenchmark(size_t ticks)
+{
+	BenchMessageType const types[] =
+	{
+		//priority								expire	reliable	payload		per tick
+		{ NetMessageDefinition::HIGH_PRIORITY,		0.f,	false,		8, 40,		4 },
+		{ NetMessageDefinition::HIGH_PRIORITY,		0.f,	true,		4, 24,		-10 },
+		{ NetMessageDefinition::DEFAULT_PRIORITY,	0.f,	false,		300, 900,	1 },
+		{ NetMessageDefinition::DEFAULT_PRIORITY,	0.f,	true,		20, 200,	2 },
+		{ NetMessageDefinition::LOW_PRIORITY,		0.25f,	false,		400, 1000,	8 },
+	};
+	size_t const typeCount = sizeof(types) / sizeof(types[0]);
+
+	NetMessageDefinition definitions[typeCount];
+	for(size_t typeIndex = 0; typeIndex < typeCount; ++typeIndex)
+	{
+		NetMessageDefinition & definition = definitions[typeIndex];
+		definition.type = (eNetMessageType)(eNetMessageType_COUNT + typeIndex);
+		definition.controlFlags = 0;
+		definition.optionFlags = types[typeIndex].isReliable ? NetMessageDefinition::RELIABLE_OPTION_FLAG : 0;
+		definition.sequenceChannelID = 0;
+		definition.callback = nullptr;
+		definition.priority = types[typeIndex].priority;
+		definition.expireSeconds = types[typeIndex].expireSeconds;
+		definition.CalculateHeaderSize();
+	}
+
+	//Same traffic for both, decided up front, in whatever order the game would have added it
+	std::vector<size_t> traffic; //typeIndex, payloadSize pairs, with a typeCount marker between ticks
+	std::vector<size_t> tickTypes;
+	size_t urgentTotal = 0;
+	for(size_t tick = 0; tick < ticks; ++tick)
+	{
+		tickTypes.clear();
+		for(size_t typeIndex = 0; typeIndex < typeCount; ++typeIndex)
+		{
+			int perTick = types[typeIndex].perTick;
+			int count = perTick >= 0 ? perTick : ((tick % (size_t)(-perTick)) == 0 ? 1 : 0);
+			tickTypes.insert(tickTypes.end(), (size_t)count, typeIndex);
+		}
+		for(size_t shuffleIndex = tickTypes.size(); shuffleIndex > 1; --shuffleIndex)
+		{
+			std::swap(tickTypes[shuffleIndex - 1], tickTypes[(size_t)RandomInt((int)shuffleIndex)]);
+		}
+
+		for(size_t messageIndex = 0; messageIndex < tickTypes.size(); ++messageIndex)
+		{
+			size_t typeIndex = tickTypes[messageIndex];
+			if(types[typeIndex].priority >= NetMessageDefinition::HIGH_PRIORITY)
+			{
+				++urgentTotal;
+			}
+			traffic.push_back(typeIndex);
+			traffic.push_back((size_t)RandomInt((int)types[typeIndex].minPayload, (int)types[typeIndex].maxPayload + 1));
+		}
+		traffic.push_back(typeCount);
+	}
+
+	size_t const packetRoom = NetPacket::MAX_SIZE - 16;
+	size_t const packetsPerTick = (size_t)NetSession::MAX_PACKET_SEND_AMOUNT_PER_CONNECTION;
+
+	//First in first out, reliables then unreliables, dropping unsent unreliables after every tick
+	BenchPackingResult fifo = { 0 };
+	{
+		std::queue<NetMessage*> reliables;
+		std::queue<NetMessage*> unreliables;
+		size_t trafficIndex = 0;
+		uint64_t startOpCount = Time::GetCurrentOpCount();
+		for(size_t tick = 0; tick < ticks; ++tick)
+		{
+			for(; traffic[trafficIndex] != typeCount; trafficIndex += 2)
+			{
+				NetMessage * message = CreateBenchMessage(&definitions[traffic[trafficIndex]], traffic[trafficIndex + 1], tick);
+				(message->m_definition->IsReliable() ? reliables : unreliables).push(message);
+			}
+			++trafficIndex;
+
+			for(size_t packetIndex = 0; packetIndex < packetsPerTick; ++packetIndex)
+			{
+				size_t bytesFree = packetRoom;
+				size_t count = 0;
+				std::queue<NetMessage*> * queues[2] = { &reliables, &unreliables };
+				for(size_t queueIndex = 0; queueIndex < 2; ++queueIndex)
+				{
+					std::queue<NetMessage*> & queue = *queues[queueIndex];
+					while(!queue.empty() && queue.front()->GetTotalWrittenMessageSize() <= bytesFree)
+					{
+						bytesFree -= queue.front()->GetTotalWrittenMessageSize();
+						RecordBenchSent(queue.front(), tick, &fifo);
+						queue.pop();
+						++count;
+					}
+				}
+				if(count == 0)
+				{
+					break;
+				}
+				++fifo.packetCount;
+			}
+
+			fifo.droppedCount += unreliables.size();
+			while(!unreliables.empty())
+			{
+				delete unreliables.front();
+				unreliables.pop();
+			}
+		}
+		fifo.opCount = Time::GetCurrentOpCount() - startOpCount;
+		while(!reliables.empty())
+		{
+			delete reliables.front();
+			reliables.pop();
+		}
+	}
+
+	//Greedy by priority
+	BenchPackingResult greedy = { 0 };
+	{
+		NetSendQueue queue;
+		std::vector<NetMessage*> selected;
+		size_t trafficIndex = 0;
+		uint64_t startOpCount = Time::GetCurrentOpCount();
+		for(size_t tick = 0; tick < ticks; ++tick)
+		{
+			double currentTime = (double)tick * BENCH_TICK_SECONDS;
+			for(; traffic[trafficIndex] != typeCount; trafficIndex += 2)
+			{
+				queue.Push(CreateBenchMessage(&definitions[traffic[trafficIndex]], traffic[trafficIndex + 1], tick));
+			}
+			++trafficIndex;
+
+			for(size_t packetIndex = 0; packetIndex < packetsPerTick; ++packetIndex)
+			{
+				selected.clear();
+				if(queue.SelectForPacket(packetRoom, MAX_MESSAGES_PER_PACKET, NetConnection::MAX_RELIABLE_RANGE, currentTime, &selected) == 0)
+				{
+					break;
+				}
+				for(size_t selectedIndex = 0; selectedIndex < selected.size(); ++selectedIndex)
+				{
+					RecordBenchSent(selected[selectedIndex], tick, &greedy);
+				}
+				++greedy.packetCount;
+			}
+
+			greedy.droppedCount += queue.RemoveExpired(currentTime);
+		}
+		greedy.opCount = Time::GetCurrentOpCount() - startOpCount;
+		greedy.expiredCount = queue.m_expiredCount;
+	}
+
+	BConsoleSystem::AddLog(Stringf("Packing %u ticks of random traffic, %u packets a tick:", ticks, packetsPerTick), BConsoleSystem::INFO);
+	PrintBenchResult("First in first out", fifo, ticks, urgentTotal);
+	PrintBenchResult("Priority greedy", greedy, ticks, urgentTotal);
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+#include "Engine/Core/EngineCommon.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+class Command;
+class NetMessage;
+
+
+//-------------------------------------------------------------------------------------------------
+void NetSendQueueBenchCommand(Command const &);
+
+
+//-------------------------------------------------------------------------------------------------
+// Highest priority first, and oldest first within the same priority
+class SendPriorityCompare
+{
+public:
+	bool operator()(NetMessage const * lhs, NetMessage const * rhs) const;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// A connection's unsent reliables and unreliables, in the order their definitions' priorities say
+// they should go out. Each packet is packed greedily: walking down the queue, everything that still
+// fits goes in, so a big message that doesn't fit no longer holds up the small ones behind it.
+// Unreliables past their expire time are deleted on the way without ever being serialized.
+class NetSendQueue
+{
+	//-------------------------------------------------------------------------------------------------
+	// Static Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	static size_t const MAX_MESSAGES_PER_PACKET = 255; //Packet message count is a byte
+	static size_t const MAX_MISSES_PER_PACKET = 16; //Stop looking for something small enough after this many
+
+	//-------------------------------------------------------------------------------------------------
+	// Members
+	//-------------------------------------------------------------------------------------------------
+private:
+	std::vector<NetMessage*> m_messages;
+	size_t m_reliableCount;
+
+public:
+	//debugging information
+	size_t m_expiredCount;
+	size_t m_skippedCount; //Didn't fit, something further down the queue went instead
+
+	//-------------------------------------------------------------------------------------------------
+	// Static Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	static void RunBenchmark(size_t ticks);
+
+	//-------------------------------------------------------------------------------------------------
+	// Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	NetSendQueue();
+	~NetSendQueue();
+
+	void Push(NetMessage * message);
+	size_t SelectForPacket(size_t bytesFree, size_t messagesFree, size_t reliablesFree, double currentTime, std::vector<NetMessage*> * out_selected);
+	size_t RemoveExpired(double currentTime);
+	void Clear();
+
+	size_t GetCount() const;
+	size_t GetReliableCount() const;
+	bool IsEmpty() const;
+
+private:
+	bool IsExpired(NetMessage const * message, double currentTime) const;
+};
\ No newline at end of file
@@ -4,11 +4,23 @@
 #include "Engine/Core/NamedProperties.hpp"
 #include "Engine/Core/Time.hpp"
 #include "Engine/DebugSystem/BConsoleSystem.hpp"
+#include "Engine/DebugSystem/ErrorWarningAssert.hpp"
 #include "Engine/EventSystem/BEventSystem.hpp"
 #include "Engine/NetworkSystem/BNetworkSystem.hpp"
+#include "Engine/NetworkSystem/Session/NetCapture.hpp"
+#include "Engine/NetworkSystem/Session/NetCompression.hpp"
+#include "Engine/NetworkSystem/Session/NetFragment.hpp"
+#include "Engine/NetworkSystem/Session/NetIOThread.hpp"
 #include "Engine/NetworkSystem/Session/NetMessage.hpp"
 #include "Engine/NetworkSystem/Session/NetPacket.hpp"
 #include "Engine/NetworkSystem/Session/NetConnection.hpp"
+#include "Engine/NetworkSystem/Session/NetPrediction.hpp"
+#include "Engine/NetworkSystem/Session/NetReplicator.hpp"
+#include "Engine/NetworkSystem/Session/NetRewindHistory.hpp"
+#include "Engine/NetworkSystem/Session/NetSchema.hpp"
+#include "Engine/NetworkSystem/Session/NetSendQueue.hpp"
+#include "Engine/NetworkSystem/Session/NetSoakTest.hpp"
+#include "Engine/NetworkSystem/Session/NetTelemetry.hpp"
 #include "Engine/Utils/StringUtils.hpp"
 
 
@@ -24,6 +36,7 @@ STATIC char const * NetSession::ON_CONNECTION_JOIN_EVENT = "ConnectionJoinEvent"
 STATIC char const * NetSession::ON_CONNECTION_LEAVE_EVENT = "ConnectionLeaveEvent";
 STATIC char const * NetSession::ON_GAME_JOIN_VALIDATION_EVENT = "GameJoinValidation";
 STATIC char const * NetSession::ON_JOIN_DENY_EVENT = "JoinDenyEvent";
+STATIC char const * NetSession::ON_RECEIPT_CONFIRMED_EVENT = "ReceiptConfirmedEvent";
 STATIC DebugLog NetSession::m_NetworkTrafficActivity = DebugLog("Data/Logs/NetworkTraffic.txt");
 
 
@@ -36,15 +49,24 @@ public:
 
 
 //-------------------------------------------------------------------------------------------------
+// Answered right away with when it got here and when the answer left, for clock sync
 void OnPing(NetSender const & sender, NetMessage const & message)
 {
+	double sentTime = 0.0;
 	char * sent = nullptr;
+	message.Read<double>(&sentTime);
 	message.ReadString(&(sent));
-	sent = sent ? sent : "[null]";
 	sockaddr_in addr = sender.fromAddress;
-	BConsoleSystem::AddLog(Stringf("Received Ping from %s: %s", StringFromSockAddr(&addr), sent), BConsoleSystem::GOOD);
+	if(sent)
+	{
+		BConsoleSystem::AddLog(Stringf("Received Ping from %s: %s", StringFromSockAddr(&addr), sent), BConsoleSystem::GOOD);
+	}
 
 	NetMessage pong(eNetMessageType_PONG);
+	pong.Write<double>(sentTime);
+	pong.Write<double>(sender.receivedTime);
+	pong.Write<double>(Time::GetCurrentTimeSeconds());
+	pong.Write<bool>(sent != nullptr);
 	sender.session->SendDirect(addr, pong);
 }
 
@@ -57,10 +79,32 @@ class Pong
 
 
 //-------------------------------------------------------------------------------------------------
-void OnPong(NetSender const & sender, NetMessage const &)
+void OnPong(NetSender const & sender, NetMessage const & message)
 {
+	double sentTime;
+	double hostReceivedTime;
+	double hostSentTime;
+	bool hadNote;
+	if(!message.Read<double>(&sentTime)
+		|| !message.Read<double>(&hostReceivedTime)
+		|| !message.Read<double>(&hostSentTime)
+		|| !message.Read<bool>(&hadNote))
+	{
+		return;
+	}
+
 	sockaddr_in addr = sender.fromAddress;
-	BConsoleSystem::AddLog(Stringf("Received Pong from %s", StringFromSockAddr(&addr)), BConsoleSystem::GOOD);
+	NetSession * session = sender.session;
+	NetConnection * host = session->GetHost();
+	if(!session->IsHost() && host && IsEqual(addr, host->GetAddress()))
+	{
+		session->AddClockSample(sentTime, hostReceivedTime, hostSentTime, sender.receivedTime);
+	}
+
+	if(hadNote)
+	{
+		BConsoleSystem::AddLog(Stringf("Received Pong from %s, %.2fms", StringFromSockAddr(&addr), (sender.receivedTime - sentTime) * 1000.0), BConsoleSystem::GOOD);
+	}
 }
 
 
@@ -253,13 +297,51 @@ void OnLeave(NetSender const & sender, NetMessage const &)
 
 
 //-------------------------------------------------------------------------------------------------
-NetSession::NetSession(uint16_t gameVersion /*= 0U*/)
+void NetStatsCommand(Command const &)
+{
+	std::vector<NetSession const*> const & sessions = NetTelemetry::GetSessions();
+	for(size_t sessionIndex = 0; sessionIndex < sessions.size(); ++sessionIndex)
+	{
+		sessions[sessionIndex]->PrintConnectionStats();
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Once, from BNetworkSystem::Startup(). Sessions come and go (net_soak makes hundreds), the commands don't.
+STATIC void NetSession::RegisterCommands()
+{
+	BConsoleSystem::Register("net_stats", NetStatsCommand, " : Round trip, resend delay, loss and send rate for every connection.");
+	BConsoleSystem::Register("net_fragment_stats", NetFragmentStatsCommand, " : Fragment buffer pools and unsent fragments for every connection.");
+	BConsoleSystem::Register("net_compression_stats", NetCompressionStatsCommand, " : Bytes saved and time spent compressing packets.");
+	BConsoleSystem::Register("net_lookup_bench", NetLookupBenchCommand, " [connections] : Time connection lookups by address and GUID. Default = 250");
+	BConsoleSystem::Register("net_compression_bench", NetCompressionBenchCommand, " [iterations] : Run recently sent packets through the packet compressor. Default = 100");
+	BConsoleSystem::Register("net_send_bench", NetSendQueueBenchCommand, " [ticks] : Compare first in first out and priority packing on random traffic. Default = 600");
+	BConsoleSystem::Register("net_schema_bench", NetSchemaBenchCommand, " [iterations] : Compare hand written and schema serialization of player states. Default = 100");
+	BConsoleSystem::Register("net_rewind_check", NetRewindCheckCommand, " : Check rewind history interpolation and the rewind clamp.");
+	BConsoleSystem::Register("net_soak", NetSoakCommand, " [clients] [seconds] [maxHostTickMs] : Run a host and clients over loopback, doubling clients each stage. Default = 254 2 0");
+	BConsoleSystem::Register("net_telemetry", NetTelemetryCommand, " [0/1] : Collect per connection histograms and per message byte counts. Default = toggle");
+	BConsoleSystem::Register("net_telemetry_print", NetTelemetryPrintCommand, " : Print the current telemetry window for every connection.");
+	BConsoleSystem::Register("net_telemetry_export", NetTelemetryExportCommand, " [csv/json/off] [seconds] : Append telemetry to Data/Logs every few seconds, 0 to dump once. Default = csv 0");
+	BConsoleSystem::Register("net_replay_bench", NetReplayBenchCommand, " [file] [iterations] : Time the receive path on a packet capture, no sockets. Default = Data/Logs/NetCapture.bncp 10");
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Sessions that don't update with the engine need their owner to call OnUpdate()
+NetSession::NetSession(uint16_t gameVersion /*= 0U*/, bool updateWithEngine /*= true*/)
 	: m_channel()
+	, m_ioThread(nullptr)
+	, m_useNetworkThread(false)
+	, m_compressionEnabled(true)
 	, m_self(nullptr)
 	, m_host(nullptr)
+	, m_replicator(nullptr)
+	, m_prediction(nullptr)
 	, m_state(eNetSessionState_INVALID)
 	, m_definitionCount(0)
 	, m_connectionTimeouts(true)
+	, m_timeSinceLastSend(0.f)
 	, m_invalidPacketCount(0)
 	, m_invalidMessageCount(0)
 	, m_lastError(eNetSessionError_NONE)
@@ -267,19 +349,17 @@ NetSession::NetSession(uint16_t gameVersion /*= 0U*/)
 	, m_definitionHash(0U)
 	, m_gameVersion(gameVersion)
 {
-	//Clear out all connections
-	for(size_t index = 0; index < MAX_CONNECTIONS; ++index)
-	{
-		m_connections[index] = nullptr;
-	}
-
 	//Clear out all messages
 	for(size_t defIndex = 0; defIndex < MAX_DEFINITIONS; ++defIndex)
 	{
 		m_messageDefinitions[defIndex] = nullptr;
 	}
 
-	BEventSystem::RegisterEvent(EVENT_ENGINE_UPDATE, this, &NetSession::OnUpdate);
+	if(updateWithEngine)
+	{
+		BEventSystem::RegisterEvent(EVENT_ENGINE_UPDATE, this, &NetSession::OnUpdate);
+	}
+	NetTelemetry::AddSession(this);
 
 	//Registering Core Message Types
 	byte_t controlFlags, optionFlags;
@@ -293,18 +373,35 @@ NetSession::NetSession(uint16_t gameVersion /*= 0U*/)
 	//Connectionless, Reliable
 	controlFlags = NetMessageDefinition::CONNECTIONLESS_CONTROL_FLAG;
 	optionFlags = NetMessageDefinition::RELIABLE_OPTION_FLAG;
-	RegisterMessage(eNetMessageType_JOIN_REQUEST, OnJoinRequest, controlFlags, optionFlags);
+	RegisterMessage(eNetMessageType_JOIN_REQUEST, OnJoinRequest, controlFlags, optionFlags, 0, NetMessageDefinition::HIGH_PRIORITY);
 
 	//Connection, Unreliable
 	controlFlags = NetMessageDefinition::CONNECTIONLESS_CONTROL_FLAG;
 	optionFlags = 0;
-	RegisterMessage(eNetMessageType_JOIN_DENY, OnJoinDeny, controlFlags, optionFlags);
-	RegisterMessage(eNetMessageType_LEAVE, OnLeave, controlFlags, optionFlags);
+	RegisterMessage(eNetMessageType_JOIN_DENY, OnJoinDeny, controlFlags, optionFlags, 0, NetMessageDefinition::HIGH_PRIORITY);
+	RegisterMessage(eNetMessageType_LEAVE, OnLeave, controlFlags, optionFlags, 0, NetMessageDefinition::HIGH_PRIORITY);
 
 	//Connection, Reliable
 	controlFlags = NetMessageDefinition::CONNECTIONLESS_CONTROL_FLAG;
 	optionFlags = NetMessageDefinition::RELIABLE_OPTION_FLAG;
-	RegisterMessage(eNetMessageType_JOIN_ACCEPT, OnJoinAccept, controlFlags, optionFlags);
+	RegisterMessage(eNetMessageType_JOIN_ACCEPT, OnJoinAccept, controlFlags, optionFlags, 0, NetMessageDefinition::HIGH_PRIORITY);
+
+	//Connection, Unreliable (lost snapshots are covered by the next one)
+	controlFlags = 0;
+	optionFlags = 0;
+	RegisterMessage(eNetMessageType_SNAPSHOT, OnSnapshot, controlFlags, optionFlags);
+
+	//Connection, Reliable, in order on its own channel (fragments skip the send queue, so no priority)
+	controlFlags = 0;
+	optionFlags = NetMessageDefinition::RELIABLE_OPTION_FLAG | NetMessageDefinition::SEQUENCE_OPTION_FLAG;
+	RegisterMessage(eNetMessageType_FRAGMENT, OnFragment, controlFlags, optionFlags, NetFragment::FRAGMENT_SEQUENCE_CHANNEL);
+
+	//Connection, Unreliable (every input message repeats what hasn't been acked, every ack is the full state)
+	//Ahead of snapshots, a late input costs a misprediction
+	controlFlags = 0;
+	optionFlags = 0;
+	RegisterMessage(eNetMessageType_INPUT, OnInput, controlFlags, optionFlags, 0, NetMessageDefinition::HIGH_PRIORITY);
+	RegisterMessage(eNetMessageType_INPUT_ACK, OnInputAck, controlFlags, optionFlags, 0, NetMessageDefinition::HIGH_PRIORITY);
 }
 
 
@@ -312,7 +409,7 @@ NetSession::NetSession(uint16_t gameVersion /*= 0U*/)
 NetSession::~NetSession()
 {
 	BEventSystem::Unregister(this);
-
+	NetTelemetry::RemoveSession(this);
 
 	//Delete all registered messages
 	//I had to keep track of my number of message definitions, but not the number of connections I had
@@ -327,6 +424,12 @@ NetSession::~NetSession()
 	DisconnectOtherClientConnections();
 	Disconnect(&m_host);
 
+	//Thread has to let go of the socket before we close it
+	if(m_ioThread)
+	{
+		delete m_ioThread;
+		m_ioThread = nullptr;
+	}
 	m_channel.Unbind();
 }
 
@@ -341,35 +444,74 @@ void NetSession::OnUpdate(NamedProperties &)
 //-------------------------------------------------------------------------------------------------
 void NetSession::ProcessIncomingPackets()
 {
-	m_channel.RecvPackets(this);
+	if(m_ioThread)
+	{
+		ProcessQueuedPackets();
+	}
+	else
+	{
+		m_channel.RecvPackets(this);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Packets were already read, timestamped and validated on the network thread
+void NetSession::ProcessQueuedPackets()
+{
+	double currentTime = Time::GetCurrentTimeSeconds();
+
+	NetPacket packet;
+	packet.m_senderInfo.session = this;
+
+	NetDatagram const * datagram = m_ioThread->PeekReceived();
+	while(datagram)
+	{
+		packet.Rewind();
+		packet.SetBufferSize(0);
+		packet.WriteForward(datagram->data, datagram->size);
+		packet.Rewind();
+		packet.m_senderInfo.fromAddress = datagram->address;
+		packet.m_senderInfo.receivedTime = datagram->timeStamp;
+		m_ioThread->PopReceived();
+
+		m_channel.SimulatePacket(this, packet, currentTime);
+		datagram = m_ioThread->PeekReceived();
+	}
+
+	m_channel.ProcessDelayedPackets(this, currentTime);
+	m_invalidPacketCount = m_ioThread->m_invalidPacketCount;
 }
 
 
 //-------------------------------------------------------------------------------------------------
 void NetSession::ProcessOutgoingPackets()
 {
-	static float timeSinceLastUpdate = 0.f;
-	timeSinceLastUpdate += Time::DELTA_SECONDS;
-	if(timeSinceLastUpdate >= SEND_RATE)
+	m_timeSinceLastSend += Time::DELTA_SECONDS;
+	if(m_timeSinceLastSend >= SEND_RATE)
 	{
-		for(size_t index = 0; index < MAX_CONNECTIONS; ++index)
+		std::vector<NetConnection*> const & activeConnections = m_connections.GetActive();
+		for(size_t activeIndex = 0; activeIndex < activeConnections.size(); ++activeIndex)
 		{
-			if(!m_connections[index])
-			{
-				continue;
-			}
+			NetConnection * connection = activeConnections[activeIndex];
 			NamedProperties netEvent;
-			netEvent.Set("connection", m_connections[index]);
+			netEvent.Set("connection", connection);
 			BEventSystem::TriggerEvent(PREPARE_PACKET_EVENT, netEvent);
-			m_connections[index]->SendPacket();
+			connection->SendPacket();
 		}
 
 		//I only want to process packets at most once per frame
-		while(timeSinceLastUpdate >= SEND_RATE)
+		while(m_timeSinceLastSend >= SEND_RATE)
 		{
-			timeSinceLastUpdate -= SEND_RATE;
+			m_timeSinceLastSend -= SEND_RATE;
 		}
 	}
+
+	//Network thread flushes its own simulated sends
+	if(!m_ioThread)
+	{
+		m_channel.FlushDelayedSends(Time::GetCurrentTimeSeconds());
+	}
 }
 
 
@@ -386,25 +528,41 @@ void NetSession::CheckForDisconnect()
 		}
 	}
 
-	for(size_t index = 0; index < MAX_CONNECTIONS; ++index)
+	//Backwards, disconnecting swaps the last connection into this spot
+	std::vector<NetConnection*> const & activeConnections = m_connections.GetActive();
+	for(size_t activeIndex = activeConnections.size(); activeIndex > 0; --activeIndex)
 	{
-		if(!m_connections[index])
-		{
-			continue;
-		}
-
-		float timeElapsed = (float)(Time::TOTAL_SECONDS - m_connections[index]->m_timeLastRecv);
+		NetConnection * connection = activeConnections[activeIndex - 1];
+		float timeElapsed = (float)(Time::TOTAL_SECONDS - connection->m_timeLastRecv);
 		if(timeElapsed > DISCONNECT_INTERVAL_SECONDS && m_connectionTimeouts)
 		{
-			BConsoleSystem::AddLog(Stringf("Connection %d timed out", index), BConsoleSystem::BAD);
-			Disconnect(&m_connections[index]);
+			BConsoleSystem::AddLog(Stringf("Connection %d timed out", connection->GetIndex()), BConsoleSystem::BAD);
+			DisconnectConnection(connection);
 		}
 	}
 }
 
 
 //-------------------------------------------------------------------------------------------------
-void NetSession::RegisterMessage(eNetMessageType const & type, MessageCallback * cb, byte_t const & setTypeFlags /*= 0*/, byte_t const & setOptionFlags /*= 0*/, byte_t const & setChannel /*= 0 */)
+// Clients ping the host a few times a second until the sample window is full, then once a second
+void NetSession::UpdateClockSync()
+{
+	if(m_state != eNetSessionState_CONNECTED || IsHost() || !m_host)
+	{
+		return;
+	}
+
+	double currentTime = Time::GetCurrentTimeSeconds();
+	if(m_clockSync.UpdatePingTimer(currentTime))
+	{
+		SendPing(m_host->GetAddress());
+	}
+	m_clockSync.Update(currentTime);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetSession::RegisterMessage(eNetMessageType const & type, MessageCallback * cb, byte_t const & setTypeFlags /*= 0*/, byte_t const & setOptionFlags /*= 0*/, byte_t const & setChannel /*= 0 */, byte_t setPriority /*= NetMessageDefinition::DEFAULT_PRIORITY*/, float setExpireSeconds /*= 0.f*/)
 {
 	if(GetState() != eNetSessionState_INVALID)
 	{
@@ -420,6 +578,8 @@ void NetSession::RegisterMessage(eNetMessageType const & type, MessageCallback *
 	def->sequenceChannelID = setChannel;
 	def->CalculateHeaderSize();
 	def->callback = cb;
+	def->priority = setPriority;
+	def->expireSeconds = def->CanExpire() ? setExpireSeconds : 0.f;
 	m_messageDefinitions[type] = def;
 }
 
@@ -443,6 +603,13 @@ bool NetSession::Start(unsigned int port, unsigned int range /*= PORT_RANGE*/)
 		ChangeState(eNetSessionState_DISCONNECTED);
 		BConsoleSystem::AddLog(Stringf("Net Session: %s", GetAddressString()), BConsoleSystem::GOOD);
 
+		//Hand the socket over to the network thread
+		if(m_useNetworkThread)
+		{
+			m_ioThread = new NetIOThread(&m_channel, this);
+			m_ioThread->Start();
+		}
+
 		//#TODO: Unique identifier for the definitions registered
 		m_definitionHash = m_definitionCount;
 		return true;
@@ -471,6 +638,11 @@ void NetSession::Stop()
 		return;
 	}
 
+	if(m_ioThread)
+	{
+		delete m_ioThread;
+		m_ioThread = nullptr;
+	}
 	m_channel.Unbind();
 	ChangeState(eNetSessionState_INVALID);
 	BConsoleSystem::AddLog("Successfully stopped Net Session", BConsoleSystem::GOOD);
@@ -552,10 +724,11 @@ void NetSession::Leave()
 
 	//send everyone else a LEAVE message
 	NetMessage leave(eNetMessageType_LEAVE, GetSelf()->GetIndex());
-	for(uint8_t connIndex = 0; connIndex < MAX_CONNECTIONS; ++connIndex)
+	std::vector<NetConnection*> const & activeConnections = m_connections.GetActive();
+	for(size_t activeIndex = 0; activeIndex < activeConnections.size(); ++activeIndex)
 	{
-		NetConnection * conn = GetNetConnection(connIndex);
-		if(conn && conn != m_self)
+		NetConnection * conn = activeConnections[activeIndex];
+		if(conn != m_self)
 		{
 			conn->AddMessage(leave);
 			conn->SendPacket();
@@ -585,7 +758,7 @@ NetConnection * NetSession::CreateConnection(byte_t index, sockaddr_in const & a
 		return nullptr;
 	}
 
-	if(m_connections[index])
+	if(m_connections.Get(index))
 	{
 		BConsoleSystem::AddLog("Connection index already exists", BConsoleSystem::BAD);
 		return nullptr;
@@ -605,19 +778,21 @@ NetConnection * NetSession::CreateConnection(byte_t index, sockaddr_in const & a
 //-------------------------------------------------------------------------------------------------
 void NetSession::DisconnectOtherClientConnections()
 {
-	for(size_t index = 0; index < MAX_CONNECTIONS; ++index)
+	std::vector<NetConnection*> const & activeConnections = m_connections.GetActive();
+	for(size_t activeIndex = activeConnections.size(); activeIndex > 0; --activeIndex)
 	{
-		if(m_connections[index] == m_host)
+		NetConnection * connection = activeConnections[activeIndex - 1];
+		if(connection == m_host)
 		{
 			//Nothing
 		}
-		else if(m_connections[index] == m_self)
+		else if(connection == m_self)
 		{
 			//Nothing
 		}
 		else
 		{
-			Disconnect(&m_connections[index]);
+			DisconnectConnection(connection);
 		}
 	}
 }
@@ -626,15 +801,13 @@ void NetSession::DisconnectOtherClientConnections()
 //-------------------------------------------------------------------------------------------------
 void NetSession::Connect(NetConnection * connection)
 {
-	if(m_connections[connection->GetIndex()])
+	//Set Connection
+	if(!m_connections.Add(connection))
 	{
 		BConsoleSystem::AddLog("Connection already exists", BConsoleSystem::BAD);
 		return;
 	}
 
-	//Set Connection
-	m_connections[connection->GetIndex()] = connection;
-
 	//Trigger Join Event
 	NamedProperties netEvent;
 	netEvent.Set("connection", connection);
@@ -673,7 +846,7 @@ void NetSession::Disconnect(NetConnection ** connection)
 	}
 	//You don't exist, this is a problem... but we'll still clear you out anyways
 	//Aaand the 'temp' host will call this, this is fine
-	else if(!m_connections[index])
+	else if(m_connections.Get(index) != *connection)
 	{
 		delete *connection;
 		*connection = nullptr;
@@ -687,25 +860,83 @@ void NetSession::Disconnect(NetConnection ** connection)
 	BEventSystem::TriggerEvent(ON_CONNECTION_LEAVE_EVENT, netEvent);
 
 	//Clear connection
-	delete m_connections[index];
-	m_connections[index] = nullptr;
+	m_connections.Remove(*connection);
+	delete *connection;
 	*connection = nullptr;
 
 	BConsoleSystem::AddLog(Stringf("Connection %u disconnected", index), BConsoleSystem::GOOD);
 }
 
 
+//-------------------------------------------------------------------------------------------------
+// For connections we only have in the table (m_self and m_host are cleared by passing them directly)
+void NetSession::DisconnectConnection(NetConnection * connection)
+{
+	if(connection == m_self)
+	{
+		Disconnect(&m_self);
+	}
+	else if(connection == m_host)
+	{
+		Disconnect(&m_host);
+	}
+	else
+	{
+		Disconnect(&connection);
+	}
+}
+
+
 //-------------------------------------------------------------------------------------------------
 void NetSession::AddMessageToAllClients(NetMessage & message)
 {
-	for(byte_t connIndex = 0; connIndex < MAX_CONNECTIONS; ++connIndex)
+	std::vector<NetConnection*> const & activeConnections = m_connections.GetActive();
+	for(size_t activeIndex = 0; activeIndex < activeConnections.size(); ++activeIndex)
 	{
-		if(!m_connections[connIndex])
+		activeConnections[activeIndex]->AddMessage(message);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Same as AddMessageToAllClients for payloads bigger than a message, see NetConnection::AddFragmentedMessage
+// Every connection gets its own copy of the fragments, returns false if the payload was rejected
+bool NetSession::AddFragmentedMessageToAllClients(byte_t type, byte_t const * data, size_t dataSize)
+{
+	bool added = true;
+	std::vector<NetConnection*> const & activeConnections = m_connections.GetActive();
+	for(size_t activeIndex = 0; activeIndex < activeConnections.size(); ++activeIndex)
+	{
+		NetConnection * connection = activeConnections[activeIndex];
+		if(connection->IsSelf())
 		{
 			continue;
 		}
+		added = connection->AddFragmentedMessage(type, data, dataSize) && added;
+	}
+	return added;
+}
+
 
-		m_connections[connIndex]->AddMessage(message);
+//-------------------------------------------------------------------------------------------------
+// Same as AddMessageToAllClients, but skips connections whose view doesn't reach position
+void NetSession::AddMessageToRelevantClients(NetMessage & message, Vector2f const & position)
+{
+	if(!m_replicator)
+	{
+		AddMessageToAllClients(message);
+		return;
+	}
+
+	NetInterestManager const * interest = m_replicator->GetInterestManager();
+	std::vector<NetConnection*> const & activeConnections = m_connections.GetActive();
+	for(size_t activeIndex = 0; activeIndex < activeConnections.size(); ++activeIndex)
+	{
+		NetConnection * connection = activeConnections[activeIndex];
+		if(interest->IsRelevant(connection->GetIndex(), position))
+		{
+			connection->AddMessage(message);
+		}
 	}
 }
 
@@ -744,6 +975,17 @@ void NetSession::SendDeny(sockaddr_in const & address, eNetSessionError const &
 }
 
 
+//-------------------------------------------------------------------------------------------------
+// Sent straight out instead of waiting for the next packet, so the timestamp is honest
+void NetSession::SendPing(sockaddr_in const & address, char const * note /*= nullptr*/) const
+{
+	NetMessage ping(eNetMessageType_PING);
+	ping.Write<double>(Time::GetCurrentTimeSeconds());
+	ping.WriteString(note);
+	SendDirect(address, ping);
+}
+
+
 //-------------------------------------------------------------------------------------------------
 void NetSession::SendAccept(NetConnection * connection, uint32_t nuonce) const
 {
@@ -763,7 +1005,15 @@ void NetSession::SendAccept(NetConnection * connection, uint32_t nuonce) const
 //-------------------------------------------------------------------------------------------------
 void NetSession::SendPacket(sockaddr_in const & address, byte_t const * data, size_t dataSize) const
 {
-	m_channel.SendPackets(address, data, dataSize);
+	//Network thread owns the socket, it will send it out
+	if(m_ioThread)
+	{
+		m_ioThread->QueueSend(address, data, dataSize);
+	}
+	else
+	{
+		m_channel.SendPackets(address, data, dataSize);
+	}
 }
 
 
@@ -781,15 +1031,20 @@ void NetSession::ProcessPacket(NetPacket & packet)
 	{
 		if(packet.m_senderInfo.connection)
 		{
-			packet.m_senderInfo.connection->MarkPacketReceived(header);
+			packet.m_senderInfo.connection->MarkPacketReceived(header, packet.m_senderInfo.receivedTime);
 		}
 	}
 
 	for(size_t messageIndex = 0; messageIndex < header.messageCount; ++messageIndex)
 	{
-		//Read Message
-		NetMessage message;
-		ReadMessage(packet, &message);
+		//Read Message (points into the packet, nothing is copied unless it has to wait in a sequence channel)
+		NetMessage message(packet);
+		if(!ReadMessage(packet, &message))
+		{
+			//Nothing after this can be found, the rest of the packet is thrown out
+			++m_invalidMessageCount;
+			break;
+		}
 
 		//Set Ack ID from packet (used in unreliable sequenced messages)
 		//message.m_ackID = header.packetAck;
@@ -800,7 +1055,7 @@ void NetSession::ProcessPacket(NetPacket & packet)
 			if(IsValidMessage(packet.m_senderInfo, message))
 			{
 				packet.m_senderInfo.connection->ProcessMessage(packet.m_senderInfo, message);
-				packet.m_senderInfo.connection->MarkPacketReceived(header);
+				packet.m_senderInfo.connection->MarkPacketReceived(header, packet.m_senderInfo.receivedTime);
 			}
 			else
 			{
@@ -810,7 +1065,7 @@ void NetSession::ProcessPacket(NetPacket & packet)
 		}
 		else
 		{
-			if(!message.m_definition->IsConnectionless())
+			if(!message.m_definition || !message.m_definition->IsConnectionless())
 			{
 				++m_invalidMessageCount;
 				continue;
@@ -825,7 +1080,7 @@ void NetSession::ProcessPacket(NetPacket & packet)
 			}
 			if(packet.m_senderInfo.connection)
 			{
-				packet.m_senderInfo.connection->MarkPacketReceived(header);
+				packet.m_senderInfo.connection->MarkPacketReceived(header, packet.m_senderInfo.receivedTime);
 			}
 		}
 	}
@@ -833,53 +1088,93 @@ void NetSession::ProcessPacket(NetPacket & packet)
 
 
 //-------------------------------------------------------------------------------------------------
-void NetSession::ReadMessage(NetPacket const & packet, NetMessage * out_message)
+bool NetSession::ReadMessage(NetPacket const & packet, NetMessage * out_message)
 {
 	//Read Message Size
 	uint16_t messageSize;
-	packet.Read(&messageSize);
+	bool valid = packet.Read(&messageSize);
 
 	//Read Type
-	packet.Read(&(out_message->m_type));
+	valid = valid && messageSize >= 1 && packet.Read(&(out_message->m_type));
+	if(!valid)
+	{
+		return false;
+	}
 	messageSize -= 1; //One less because we just read a byte
 
 	out_message->m_definition = GetDefinition((eNetMessageType)out_message->m_type);
 
-	//Definition does not exist on session
+	//Definition does not exist on session (ProcessPacket counts it as invalid), skip it if the size lets us
 	if(!out_message->m_definition)
 	{
-		++m_invalidMessageCount;
+		if(messageSize > packet.GetReadableBytesLeft())
+		{
+			return false;
+		}
 		packet.Advance(messageSize);
-		return;
+		return true;
 	}
 
 	//Read Index
 	if(!out_message->m_definition->IsConnectionless())
 	{
-		packet.Read(&(out_message->m_senderIndex));
+		valid = valid && messageSize >= 1 && packet.Read(&(out_message->m_senderIndex));
 		messageSize -= 1; //One less because we just read a byte
 	}
 
 	//Read ReliableID
-	if(out_message->m_definition->IsReliable())
+	if(valid && out_message->m_definition->IsReliable())
 	{
-		packet.Read(&(out_message->m_reliableID));
+		valid = messageSize >= 2 && packet.Read(&(out_message->m_reliableID));
 		messageSize -= 2; //Two less because we just read 2 bytes
 	}
 
 	//Read SequenceID
-	if(out_message->m_definition->IsReliable() && out_message->m_definition->IsSequence())
+	if(valid && out_message->m_definition->IsReliable() && out_message->m_definition->IsSequence())
 	{
-		packet.Read(&(out_message->m_sequenceID));
+		valid = messageSize >= 2 && packet.Read(&(out_message->m_sequenceID));
 		messageSize -= 2; //Two less because we just read 2 bytes
 	}
 
-	//Copy Message
-	out_message->WriteForward(packet.GetHead(), messageSize);
-	out_message->Rewind();
+	//Header sizes don't add up or the payload runs past the packet, the read offset can't be trusted anymore
+	if(!valid || messageSize > packet.GetReadableBytesLeft())
+	{
+		out_message->m_definition = nullptr;
+		return false;
+	}
+
+	//Point Message at the payload
+	if(out_message->IsView())
+	{
+		out_message->SetView(packet.GetHead(), messageSize);
+	}
+	else
+	{
+		out_message->WriteForward(packet.GetHead(), messageSize);
+		out_message->Rewind();
+	}
 
 	//Finished with message
 	packet.Advance(messageSize);
+	return true;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetSession::PrintConnectionStats() const
+{
+	std::vector<NetConnection*> const & activeConnections = m_connections.GetActive();
+	for(size_t activeIndex = 0; activeIndex < activeConnections.size(); ++activeIndex)
+	{
+		NetConnection const * connection = activeConnections[activeIndex];
+		if(connection->IsSelf())
+		{
+			continue;
+		}
+
+		NetCongestionControl const & congestion = connection->GetCongestionControl();
+		BConsoleSystem::AddLog(Stringf("Connection %u: rtt=%.0fms rto=%.0fms drop=%.1f%% loss=%.1f%% rate=%.1fKB/s estimate=%.1fKB/s", connection->GetIndex(), connection->GetRoundTripTime() * 1000.0, connection->GetResendDelay() * 1000.0, connection->GetDropRate() * 100.f, congestion.GetLossRate() * 100.f, congestion.GetSendRate() / 1024.f, congestion.GetBandwidthEstimate() / 1024.f), BConsoleSystem::INFO);
+	}
 }
 
 
@@ -937,6 +1232,7 @@ void NetSession::EnterState(eNetSessionState const & state)
 		Disconnect(&m_self);
 		DisconnectOtherClientConnections();
 		Disconnect(&m_host);
+		m_clockSync.Reset();
 		break;
 	case eNetSessionState_JOINING:
 		break;
@@ -973,10 +1269,12 @@ void NetSession::UpdateState(eNetSessionState const & state)
 		break;
 	default:
 		ProcessIncomingPackets();
+		UpdateClockSync();
 		ProcessOutgoingPackets();
 		CheckForDisconnect();
 		break;
 	}
+	NetTelemetry::Update();
 	m_NetworkTrafficActivity.WriteToFile();
 	BProfiler::StopSample();
 }
@@ -985,26 +1283,14 @@ void NetSession::UpdateState(eNetSessionState const & state)
 //-------------------------------------------------------------------------------------------------
 NetConnection * NetSession::GetNetConnection(sockaddr_in const & address) const
 {
-	for(size_t index = 0; index < MAX_CONNECTIONS; ++index)
-	{
-		if(!m_connections[index])
-		{
-			continue;
-		}
-		if(IsEqual(m_connections[index]->GetAddress(), address))
-		{
-			return m_connections[index];
-		}
-	}
-
-	return nullptr;
+	return m_connections.Find(address);
 }
 
 
 //-------------------------------------------------------------------------------------------------
 NetConnection * NetSession::GetNetConnection(uint8_t netIndex)
 {
-	return m_connections[netIndex];
+	return m_connections.Get(netIndex);
 }
 
 
@@ -1016,9 +1302,16 @@ PacketChannel const & NetSession::GetPacketChannel() const
 
 
 //-------------------------------------------------------------------------------------------------
-UDPSock const & NetSession::GetSocket() const
+INetTransport const & NetSession::GetTransport() const
 {
-	return m_channel;
+	return m_channel.GetTransport();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+std::vector<NetConnection*> const & NetSession::GetActiveConnections() const
+{
+	return m_connections.GetActive();
 }
 
 
@@ -1050,6 +1343,41 @@ NetConnection * NetSession::GetHost() const
 }
 
 
+//-------------------------------------------------------------------------------------------------
+NetReplicator * NetSession::GetReplicator() const
+{
+	return m_replicator;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetPrediction * NetSession::GetPrediction() const
+{
+	return m_prediction;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetClockSync const & NetSession::GetClockSync() const
+{
+	return m_clockSync;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Same on every machine in the session (within the sync error, usually well under a millisecond on
+// a LAN). Before the first pong comes back a client just gets its own time.
+double NetSession::GetHostTime() const
+{
+	double currentTime = Time::GetCurrentTimeSeconds();
+	if(IsHost())
+	{
+		return currentTime;
+	}
+	return m_clockSync.GetHostTime(currentTime);
+}
+
+
 //-------------------------------------------------------------------------------------------------
 eNetSessionState NetSession::GetState() const
 {
@@ -1060,14 +1388,14 @@ eNetSessionState NetSession::GetState() const
 //-------------------------------------------------------------------------------------------------
 float NetSession::GetSimDropRate() const
 {
-	return m_channel.m_dropRate;
+	return m_channel.m_receiveSimulator.GetSettings().dropRate;
 }
 
 
 //-------------------------------------------------------------------------------------------------
 Range<double> const NetSession::GetLatency() const
 {
-	return m_channel.m_latency;
+	return m_channel.m_receiveSimulator.GetSettings().latency;
 }
 
 
@@ -1098,16 +1426,7 @@ uint32_t NetSession::GetNuonce() const
 //-------------------------------------------------------------------------------------------------
 byte_t NetSession::GetNextFreeIndex() const
 {
-	byte_t check = 0;
-	while(m_connections[check])
-	{
-		++check;
-		if(check == INVALID_INDEX)
-		{
-			return INVALID_INDEX;
-		}
-	}
-	return check;
+	return m_connections.GetNextFreeIndex();
 }
 
 
@@ -1122,7 +1441,11 @@ bool NetSession::IsConnected() const
 bool NetSession::IsValidPacket(NetPacket const & packet, size_t packetSize) const
 {
 	PacketHeader header;
-	packet.ReadHeader(&header);
+	if(!packet.ReadHeader(&header))
+	{
+		packet.Rewind();
+		return false;
+	}
 
 	size_t totalSize = packet.GetCurrentOffset();
 	//Stride over each message and sum up the size
@@ -1150,10 +1473,10 @@ bool NetSession::IsValidMessage(NetSender const & senderInfo, NetMessage const &
 {
 	bool valid = true;
 
-	//Definition doesn't exist
+	//Definition doesn't exist (or the message couldn't be read)
 	if(!message.m_definition)
 	{
-		valid = false;
+		return false;
 	}
 	else if(message.m_definition->IsReliable())
 	{
@@ -1191,7 +1514,7 @@ bool NetSession::IsValidConnectionIndex(byte_t index) const
 {
 	if(index < MAX_CONNECTIONS)
 	{
-		return (m_connections[index] != nullptr);
+		return (m_connections.Get(index) != nullptr);
 	}
 	return false;
 }
@@ -1200,41 +1523,170 @@ bool NetSession::IsValidConnectionIndex(byte_t index) const
 //-------------------------------------------------------------------------------------------------
 bool NetSession::IsDuplicateGUID(std::string const & check) const
 {
-	for(byte_t connIndex = 0; connIndex < MAX_CONNECTIONS; ++connIndex)
+	return m_connections.Find(check.c_str()) != nullptr;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool NetSession::IsHost() const
+{
+	return (m_self == m_host) && (m_host != nullptr);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool NetSession::IsNetworkThreaded() const
+{
+	return m_ioThread != nullptr;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool NetSession::IsCapturing() const
+{
+	return m_channel.m_capture.IsCapturing();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Joining peers already passed the NET_VERSION check, so anyone we're connected to can decompress
+bool NetSession::ShouldCompressPackets() const
+{
+	if(!m_compressionEnabled)
 	{
-		//Skip connections that don't exist
-		if(!m_connections[connIndex])
-		{
-			continue;
-		}
+		return false;
+	}
+	return m_state == eNetSessionState_HOSTING || m_state == eNetSessionState_CONNECTED;
+}
 
-		if(strcmp(m_connections[connIndex]->GetGUID(), check.c_str()) == 0)
-		{
-			return true;
-		}
+
+//-------------------------------------------------------------------------------------------------
+// Must be set before Start(), the network thread takes the socket when the session starts
+void NetSession::SetNetworkThreadEnabled(bool enabled)
+{
+	if(GetState() != eNetSessionState_INVALID)
+	{
+		BConsoleSystem::AddLog("Can only change network thread mode before starting", BConsoleSystem::BAD);
+		return;
 	}
-	return false;
+
+	m_useNetworkThread = enabled;
 }
 
 
 //-------------------------------------------------------------------------------------------------
-bool NetSession::IsHost() const
+// Swap the UDP socket out (like for a LoopbackTransport), nullptr goes back to UDP. Caller owns it.
+void NetSession::SetTransport(INetTransport * transport)
 {
-	return (m_self == m_host) && (m_host != nullptr);
+	if(GetState() != eNetSessionState_INVALID)
+	{
+		BConsoleSystem::AddLog("Can only change transport before starting", BConsoleSystem::BAD);
+		return;
+	}
+
+	m_channel.SetTransport(transport);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Receiving always handles compressed packets, this only changes what we send
+void NetSession::SetCompressionEnabled(bool enabled)
+{
+	m_compressionEnabled = enabled;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetSession::SetReplicator(NetReplicator * replicator)
+{
+	m_replicator = replicator;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetSession::SetPrediction(NetPrediction * prediction)
+{
+	m_prediction = prediction;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetSession::AddClockSample(double sentTime, double hostReceivedTime, double hostSentTime, double receivedTime)
+{
+	m_clockSync.AddSample(sentTime, hostReceivedTime, hostSentTime, receivedTime);
 }
 
 
 //-------------------------------------------------------------------------------------------------
 void NetSession::SetDropRate(float dropRate)
 {
-	m_channel.m_dropRate = dropRate;
+	NetSimulatorSettings settings = m_channel.m_receiveSimulator.GetSettings();
+	settings.dropRate = dropRate;
+	m_channel.m_receiveSimulator.SetSettings(settings);
 }
 
 
 //-------------------------------------------------------------------------------------------------
 void NetSession::SetLatency(Range<double> latency)
 {
-	m_channel.m_latency = latency;
+	NetSimulatorSettings settings = m_channel.m_receiveSimulator.GetSettings();
+	settings.latency = latency;
+	m_channel.m_receiveSimulator.SetSettings(settings);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetSession::SetReceiveSimulation(NetSimulatorSettings const & settings)
+{
+	m_channel.m_receiveSimulator.SetSettings(settings);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Only change this before the network thread starts, it owns the send side while running
+void NetSession::SetSendSimulation(NetSimulatorSettings const & settings)
+{
+	if(IsNetworkThreaded())
+	{
+		ASSERT_RECOVERABLE(false, "Send simulation can't change while the network thread is running");
+		return;
+	}
+	m_channel.m_sendSimulator.SetSettings(settings);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Same seed and same traffic gives the same drops, jitter and reordering
+// Also only before the network thread starts, since it reseeds the send side too
+void NetSession::SetSimulationSeed(uint32_t seed)
+{
+	if(IsNetworkThreaded())
+	{
+		ASSERT_RECOVERABLE(false, "Simulation seed can't change while the network thread is running");
+		return;
+	}
+	m_channel.m_receiveSimulator.SetSeed(seed);
+	m_channel.m_sendSimulator.SetSeed(seed + 1);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Records every datagram sent and received until StopCapture, play it back with NetReplay
+bool NetSession::StartCapture(char const * filename)
+{
+	if(!m_channel.m_capture.Start(filename))
+	{
+		BConsoleSystem::AddLog(Stringf("Could not start a capture to %s", filename), BConsoleSystem::BAD);
+		return false;
+	}
+	return true;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetSession::StopCapture()
+{
+	m_channel.m_capture.Stop();
 }
 
 
@@ -1,12 +1,21 @@
 #pragma once
 
 #include "Engine/DebugSystem/DebugLog.hpp"
+#include "Engine/NetworkSystem/Session/NetClockSync.hpp"
+#include "Engine/NetworkSystem/Session/NetConnectionTable.hpp"
 #include "Engine/NetworkSystem/Session/PacketChannel.hpp"
 #include "Engine/NetworkSystem/Session/NetMessage.hpp"
 #include "Engine/Utils/NetworkUtils.hpp"
 
-#define NET_VERSION 2
+#define NET_VERSION 9
 /* Version Log
+	9:  PING and PONG carry timestamps (host clock sync)
+	8:  SNAPSHOT carries the host time it was captured at, and is sent every tick
+	7:  Added INPUT and INPUT_ACK core messages (client prediction)
+	6:  64 bit variable length ack bitfield in the packet header
+	5:  Added FRAGMENT core message (payloads larger than a message)
+	4:  Packet header flags byte, LZ compressed packets
+	3:  Added SNAPSHOT core message (state replication)
 	2:  SEND_RATE = 1/60, MAX_PACKETS = 5, MTU = 1444
 	1:	First version
 */
@@ -18,6 +27,10 @@ class NetMessage;
 class ConnectionInfo;
 class NetMessageDefinition;
 class NetSender;
+class NetIOThread;
+class NetPrediction;
+class NetReplicator;
+class Vector2f;
 
 
 //---------------------------------------------------------------------------------------------
@@ -77,7 +90,7 @@ class NetSession
 	//-------------------------------------------------------------------------------------------------
 private:
 	static int const PORT_RANGE = 12; //default
-	static int const MAX_CONNECTIONS = 255; //largest number possible of Byte - 1
+	static int const MAX_CONNECTIONS = (int)NetConnectionTable::MAX_CONNECTIONS;
 	static int const MAX_DEFINITIONS = 256; //largest number possible of Byte
 	static float const SEND_RATE; //seconds per packets
 	static uint8_t const HOST_INDEX = 0;
@@ -93,20 +106,34 @@ public:
 	static char const * ON_CONNECTION_LEAVE_EVENT;
 	static char const * ON_GAME_JOIN_VALIDATION_EVENT;
 	static char const * ON_JOIN_DENY_EVENT;
+	static char const * ON_RECEIPT_CONFIRMED_EVENT;
 	static DebugLog m_NetworkTrafficActivity;
 
+	//-------------------------------------------------------------------------------------------------
+	// Static Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	static void RegisterCommands();
+
 	//-------------------------------------------------------------------------------------------------
 	// Members
 	//-------------------------------------------------------------------------------------------------
 private:
 	PacketChannel m_channel;
-	NetConnection * m_connections[MAX_CONNECTIONS];
+	NetIOThread * m_ioThread;
+	bool m_useNetworkThread;
+	bool m_compressionEnabled;
+	NetConnectionTable m_connections;
 	NetConnection * m_self;
 	NetConnection * m_host;
+	NetReplicator * m_replicator;
+	NetPrediction * m_prediction;
 	eNetSessionState m_state;
 	NetMessageDefinition * m_messageDefinitions[MAX_DEFINITIONS];
 	byte_t m_definitionCount;
 	bool m_connectionTimeouts;
+	float m_timeSinceLastSend;
+	NetClockSync m_clockSync; //Clients only
 
 	uint16_t m_netVersion;
 	uint32_t m_definitionHash;
@@ -121,15 +148,17 @@ public:
 	// Functions
 	//-------------------------------------------------------------------------------------------------
 public:
-	NetSession(uint16_t gameVersion = 0U);
+	NetSession(uint16_t gameVersion = 0U, bool updateWithEngine = true);
 	~NetSession();
 
 	void OnUpdate(NamedProperties &);
 	void ProcessIncomingPackets();
+	void ProcessQueuedPackets();
 	void ProcessOutgoingPackets();
 	void CheckForDisconnect();
+	void UpdateClockSync();
 
-	void RegisterMessage(eNetMessageType const & type, MessageCallback * cb, byte_t const & setTypeFlags = 0, byte_t const & setOptionFlags = 0, byte_t const & setChannel = 0);
+	void RegisterMessage(eNetMessageType const & type, MessageCallback * cb, byte_t const & setTypeFlags = 0, byte_t const & setOptionFlags = 0, byte_t const & setChannel = 0, byte_t setPriority = NetMessageDefinition::DEFAULT_PRIORITY, float setExpireSeconds = 0.f);
 	bool Start(unsigned int port, unsigned int range = PORT_RANGE);
 	void Stop();
 	void Host(char const * username, size_t password = 0);
@@ -140,14 +169,19 @@ public:
 	void DisconnectOtherClientConnections();
 	void Connect(NetConnection * connection);
 	void Disconnect(NetConnection ** connection);
+	void DisconnectConnection(NetConnection * connection);
 	void AddMessageToAllClients(NetMessage & message);
+	bool AddFragmentedMessageToAllClients(byte_t type, byte_t const * data, size_t dataSize);
+	void AddMessageToRelevantClients(NetMessage & message, Vector2f const & position);
 	void SendDirect(sockaddr_in const & address, NetMessage & message) const;
 	void SendDeny(sockaddr_in const & address, eNetSessionError const & reason, uint32_t nuonce) const;
+	void SendPing(sockaddr_in const & address, char const * note = nullptr) const;
 	void SendAccept(NetConnection * connInfo, uint32_t nuonce) const;
 	void SendPacket(sockaddr_in const & address, byte_t const * data, size_t dataSize) const;
 	void ProcessPacket(NetPacket & packet);
-	void ReadMessage(NetPacket const & packet, NetMessage * out_message);
+	bool ReadMessage(NetPacket const & packet, NetMessage * out_message);
 	void PrintError(eNetSessionError const & error);
+	void PrintConnectionStats() const;
 
 	void ChangeState(eNetSessionState const & newState);
 	void EnterState(eNetSessionState const & state);
@@ -157,11 +191,16 @@ public:
 	NetConnection * GetNetConnection(sockaddr_in const & address) const;
 	NetConnection * GetNetConnection(uint8_t netIndex);
 	PacketChannel const & GetPacketChannel() const;
-	UDPSock const & GetSocket() const;
+	INetTransport const & GetTransport() const;
+	std::vector<NetConnection*> const & GetActiveConnections() const;
 	char const * GetAddressString() const;
 	NetMessageDefinition const * GetDefinition(eNetMessageType const & type) const;
 	NetConnection * GetSelf() const;
 	NetConnection * GetHost() const;
+	NetReplicator * GetReplicator() const;
+	NetPrediction * GetPrediction() const;
+	NetClockSync const & GetClockSync() const;
+	double GetHostTime() const;
 	eNetSessionState GetState() const;
 	float GetSimDropRate() const;
 	Range<double> const GetLatency() const;
@@ -174,8 +213,22 @@ public:
 	bool IsValidConnectionIndex(byte_t index) const;
 	bool IsDuplicateGUID(std::string const & check) const;
 	bool IsHost() const;
-
+	bool IsNetworkThreaded() const;
+	bool IsCapturing() const;
+	bool ShouldCompressPackets() const;
+
+	void SetNetworkThreadEnabled(bool enabled);
+	void SetTransport(INetTransport * transport);
+	void SetCompressionEnabled(bool enabled);
+	void SetReplicator(NetReplicator * replicator);
+	void SetPrediction(NetPrediction * prediction);
+	void AddClockSample(double sentTime, double hostReceivedTime, double hostSentTime, double receivedTime);
 	void SetDropRate(float dropRate);
 	void SetLatency(Range<double> latency);
+	void SetReceiveSimulation(NetSimulatorSettings const & settings);
+	void SetSendSimulation(NetSimulatorSettings const & settings);
+	void SetSimulationSeed(uint32_t seed);
+	bool StartCapture(char const * filename);
+	void StopCapture();
 	bool ToggleTimeouts();
 };
\ No newline at end of file
@@ -0,0 +1,343 @@
+#include "Engine/NetworkSystem/Session/NetSimulator.hpp"
+
+#include <cmath>
+#include <cstring>
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC double const NetSimulator::SLOT_SECONDS = 0.001;
+
+
+//-------------------------------------------------------------------------------------------------
+NetSimulatorSettings::NetSimulatorSettings()
+	: dropRate(0.f)
+	, burstDropRate(0.f)
+	, enterBurstChance(0.f)
+	, exitBurstChance(1.f)
+	, latency(Range<double>::ZERO)
+	, reorderChance(0.f)
+	, reorderDelay(0.0)
+	, duplicateChance(0.f)
+	, bytesPerSecond(0)
+	, maxQueueSeconds(0.5)
+{
+	//Nothing
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetSimulator::NetSimulator()
+	: m_settings()
+	, m_randomState(0)
+	, m_isBursting(false)
+	, m_lastDeliverTime(0.0)
+	, m_linkFreeTime(0.0)
+	, m_pool(nullptr)
+	, m_pooledCount(0)
+	, m_currentTick(0)
+	, m_readyHead(nullptr)
+	, m_readyTail(nullptr)
+	, m_droppedCount(0)
+	, m_duplicatedCount(0)
+	, m_reorderedCount(0)
+	, m_overflowCount(0)
+{
+	for(size_t slotIndex = 0; slotIndex < WHEEL_SLOTS; ++slotIndex)
+	{
+		m_wheelHeads[slotIndex] = nullptr;
+		m_wheelTails[slotIndex] = nullptr;
+	}
+	SetSeed(DEFAULT_SEED);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Pooled packets are plain data, the pool's buffer going away is all the cleanup they need
+NetSimulator::~NetSimulator()
+{
+	if(m_pool)
+	{
+		m_pool->Destroy();
+		delete m_pool;
+		m_pool = nullptr;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Can schedule zero (dropped), one, or two (duplicated) copies
+void NetSimulator::Submit(sockaddr_in const & address, byte_t const * data, size_t size, double timeStamp, double currentTime)
+{
+	//First submit, start the wheel at the current time (not at the first packet's delivery, or
+	//anything sent after it with less delay would get held back to its tick)
+	if(m_currentTick == 0)
+	{
+		m_currentTick = GetTick(currentTime);
+	}
+
+	if(RollDrop())
+	{
+		++m_droppedCount;
+		return;
+	}
+
+	//Waiting on the link, drop tail if the queue is too long
+	double departTime = currentTime;
+	if(m_settings.bytesPerSecond > 0)
+	{
+		departTime = m_linkFreeTime > currentTime ? m_linkFreeTime : currentTime;
+		if(departTime - currentTime > m_settings.maxQueueSeconds)
+		{
+			++m_overflowCount;
+			return;
+		}
+		departTime += (double)size / (double)m_settings.bytesPerSecond;
+		m_linkFreeTime = departTime;
+	}
+
+	double deliverTime = departTime + m_settings.latency.Get(GetRandomZeroToOne());
+	if(GetRandomZeroToOne() < m_settings.reorderChance)
+	{
+		//Doesn't move m_lastDeliverTime, so later packets can pass it
+		++m_reorderedCount;
+		deliverTime += m_settings.reorderDelay;
+	}
+	else
+	{
+		if(deliverTime < m_lastDeliverTime)
+		{
+			deliverTime = m_lastDeliverTime;
+		}
+		m_lastDeliverTime = deliverTime;
+	}
+	Schedule(address, data, size, timeStamp + (deliverTime - currentTime), deliverTime);
+
+	if(GetRandomZeroToOne() < m_settings.duplicateChance)
+	{
+		++m_duplicatedCount;
+		double duplicateTime = departTime + m_settings.latency.Get(GetRandomZeroToOne());
+		Schedule(address, data, size, timeStamp + (duplicateTime - currentTime), duplicateTime);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Release() whatever this returns once you're done with it
+NetSimulatedPacket * NetSimulator::PopReady(double currentTime)
+{
+	AdvanceTo(currentTime);
+
+	NetSimulatedPacket * ready = m_readyHead;
+	if(ready)
+	{
+		m_readyHead = ready->next;
+		if(!m_readyHead)
+		{
+			m_readyTail = nullptr;
+		}
+		ready->next = nullptr;
+	}
+	return ready;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetSimulator::Release(NetSimulatedPacket * packet)
+{
+	m_pool->Delete(packet);
+	--m_pooledCount;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetSimulatorSettings const & NetSimulator::GetSettings() const
+{
+	return m_settings;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Inactive simulators are skipped entirely, packets don't even get copied
+bool NetSimulator::IsActive() const
+{
+	return m_settings.dropRate > 0.f
+		|| (m_settings.burstDropRate > 0.f && m_settings.enterBurstChance > 0.f)
+		|| !(m_settings.latency == Range<double>::ZERO)
+		|| m_settings.reorderChance > 0.f
+		|| m_settings.duplicateChance > 0.f
+		|| m_settings.bytesPerSecond > 0
+		|| m_pooledCount > 0;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetSimulator::SetSettings(NetSimulatorSettings const & settings)
+{
+	m_settings = settings;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Also resets the burst state, so a seed always starts the same way
+void NetSimulator::SetSeed(uint32_t seed)
+{
+	//splitmix so small seeds still give a well mixed state (and never 0)
+	uint64_t state = (uint64_t)seed + 0x9E3779B97F4A7C15ULL;
+	state = (state ^ (state >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	state = (state ^ (state >> 27)) * 0x94D049BB133111EBULL;
+	state = state ^ (state >> 31);
+	m_randomState = state != 0 ? state : 1;
+	m_isBursting = false;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool NetSimulator::RollDrop()
+{
+	//Gilbert-Elliott state change, then loss for the state we're in
+	if(m_isBursting)
+	{
+		if(GetRandomZeroToOne() < m_settings.exitBurstChance)
+		{
+			m_isBursting = false;
+		}
+	}
+	else
+	{
+		if(GetRandomZeroToOne() < m_settings.enterBurstChance)
+		{
+			m_isBursting = true;
+		}
+	}
+
+	float dropRate = m_isBursting ? m_settings.burstDropRate : m_settings.dropRate;
+	return GetRandomZeroToOne() < dropRate;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetSimulator::Schedule(sockaddr_in const & address, byte_t const * data, size_t size, double timeStamp, double deliverTime)
+{
+	if(!m_pool)
+	{
+		m_pool = new ObjectPool<NetSimulatedPacket>(POOL_SIZE, "NetSimulator");
+	}
+
+	//Queue is full, same as a router dropping it
+	if(m_pooledCount >= POOL_SIZE)
+	{
+		++m_overflowCount;
+		return;
+	}
+
+	NetSimulatedPacket * packet = m_pool->Alloc();
+	++m_pooledCount;
+	packet->next = nullptr;
+	packet->address = address;
+	packet->timeStamp = timeStamp;
+	packet->size = size;
+	memcpy(packet->data, data, size);
+
+	//Already due, it goes out on the next tick
+	packet->deliverTick = GetTick(deliverTime);
+	if(packet->deliverTick <= m_currentTick)
+	{
+		packet->deliverTick = m_currentTick + 1;
+	}
+
+	size_t slot = (size_t)(packet->deliverTick % WHEEL_SLOTS);
+	if(m_wheelTails[slot])
+	{
+		m_wheelTails[slot]->next = packet;
+	}
+	else
+	{
+		m_wheelHeads[slot] = packet;
+	}
+	m_wheelTails[slot] = packet;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Moves everything that's due out of the wheel and into the ready list, in order
+void NetSimulator::AdvanceTo(double currentTime)
+{
+	uint64_t targetTick = GetTick(currentTime);
+	if(m_currentTick == 0 || targetTick <= m_currentTick)
+	{
+		return;
+	}
+
+	//A long stall only needs one trip around the wheel
+	uint64_t firstTick = m_currentTick + 1;
+	if(targetTick - m_currentTick > WHEEL_SLOTS)
+	{
+		firstTick = targetTick - WHEEL_SLOTS + 1;
+	}
+
+	for(uint64_t tick = firstTick; tick <= targetTick; ++tick)
+	{
+		size_t slot = (size_t)(tick % WHEEL_SLOTS);
+		NetSimulatedPacket * previous = nullptr;
+		NetSimulatedPacket * packet = m_wheelHeads[slot];
+		while(packet)
+		{
+			NetSimulatedPacket * next = packet->next;
+
+			//Still waiting for a later lap
+			if(packet->deliverTick > targetTick)
+			{
+				previous = packet;
+				packet = next;
+				continue;
+			}
+
+			//Unlink from the slot
+			if(previous)
+			{
+				previous->next = next;
+			}
+			else
+			{
+				m_wheelHeads[slot] = next;
+			}
+			if(m_wheelTails[slot] == packet)
+			{
+				m_wheelTails[slot] = previous;
+			}
+
+			//Onto the ready list
+			packet->next = nullptr;
+			if(m_readyTail)
+			{
+				m_readyTail->next = packet;
+			}
+			else
+			{
+				m_readyHead = packet;
+			}
+			m_readyTail = packet;
+			packet = next;
+		}
+	}
+	m_currentTick = targetTick;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// xorshift64*
+float NetSimulator::GetRandomZeroToOne()
+{
+	m_randomState ^= m_randomState >> 12;
+	m_randomState ^= m_randomState << 25;
+	m_randomState ^= m_randomState >> 27;
+	uint64_t result = m_randomState * 0x2545F4914F6CDD1DULL;
+	return (float)(result >> 40) / (float)(1 << 24);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+uint64_t NetSimulator::GetTick(double time) const
+{
+	return (uint64_t)ceil(time / SLOT_SECONDS);
+}
\ No newline at end of file
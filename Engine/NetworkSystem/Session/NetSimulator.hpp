@@ -0,0 +1,109 @@
+#pragma once
+
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Math/Range.hpp"
+#include "Engine/MemorySystem/ObjectPool.hpp"
+#include "Engine/NetworkSystem/Session/NetPacket.hpp"
+#include "Engine/Utils/NetworkUtils.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+class NetSimulatorSettings
+{
+public:
+	float dropRate; //Loss while the link is in its good state
+	float burstDropRate; //Loss while the link is in its bad state
+	float enterBurstChance; //Per packet chance of going good -> bad
+	float exitBurstChance; //Per packet chance of going bad -> good
+	Range<double> latency; //Spread of the range is the jitter, packets still arrive in order
+	float reorderChance; //Chance a packet skips the ordering and is held back an extra reorderDelay
+	double reorderDelay;
+	float duplicateChance;
+	size_t bytesPerSecond; //0 is unlimited
+	double maxQueueSeconds; //Packets that would wait longer than this for the link are dropped
+
+public:
+	NetSimulatorSettings();
+};
+
+
+//-------------------------------------------------------------------------------------------------
+class NetSimulatedPacket
+{
+public:
+	NetSimulatedPacket * next;
+	sockaddr_in address;
+	double timeStamp; //When it would have been received (or sent) without the simulator
+	uint64_t deliverTick;
+	size_t size;
+	byte_t data[NetPacket::MAX_SIZE];
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Bad network in a box, one per direction. Packets go in through Submit() and come back out of
+// PopReady() once their simulated delay is up. Delayed packets sit in a timing wheel of 1ms slots
+// (anything further out than the wheel just waits for its lap), and come from a fixed pool, so a
+// full pool drops like an overflowing router queue. Random rolls come from a seeded xorshift, so
+// the same seed and the same traffic give the same losses.
+// Loss is Gilbert-Elliott: a good and a bad state with their own drop rates.
+class NetSimulator
+{
+	//-------------------------------------------------------------------------------------------------
+	// Static Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	static double const SLOT_SECONDS;
+	static size_t const WHEEL_SLOTS = 1024;
+	static size_t const POOL_SIZE = 512;
+	static uint32_t const DEFAULT_SEED = 1;
+
+	//-------------------------------------------------------------------------------------------------
+	// Members
+	//-------------------------------------------------------------------------------------------------
+private:
+	NetSimulatorSettings m_settings;
+	uint64_t m_randomState;
+	bool m_isBursting;
+	double m_lastDeliverTime; //Keeps packets in order unless they get picked to reorder
+	double m_linkFreeTime; //When the bandwidth limited link is done with what's queued
+
+	ObjectPool<NetSimulatedPacket> * m_pool;
+	size_t m_pooledCount;
+	NetSimulatedPacket * m_wheelHeads[WHEEL_SLOTS];
+	NetSimulatedPacket * m_wheelTails[WHEEL_SLOTS];
+	uint64_t m_currentTick;
+	NetSimulatedPacket * m_readyHead;
+	NetSimulatedPacket * m_readyTail;
+
+public:
+	//debugging information
+	size_t m_droppedCount;
+	size_t m_duplicatedCount;
+	size_t m_reorderedCount;
+	size_t m_overflowCount;
+
+	//-------------------------------------------------------------------------------------------------
+	// Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	NetSimulator();
+	~NetSimulator();
+
+	void Submit(sockaddr_in const & address, byte_t const * data, size_t size, double timeStamp, double currentTime);
+	NetSimulatedPacket * PopReady(double currentTime);
+	void Release(NetSimulatedPacket * packet);
+
+	NetSimulatorSettings const & GetSettings() const;
+	bool IsActive() const;
+
+	void SetSettings(NetSimulatorSettings const & settings);
+	void SetSeed(uint32_t seed);
+
+private:
+	bool RollDrop();
+	void Schedule(sockaddr_in const & address, byte_t const * data, size_t size, double timeStamp, double deliverTime);
+	void AdvanceTo(double currentTime);
+	float GetRandomZeroToOne();
+	uint64_t GetTick(double time) const;
+};
\ No newline at end of file
@@ -0,0 +1,420 @@
+#include "Engine/NetworkSystem/Session/NetSoakTest.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include "Engine/Core/NamedProperties.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/DebugSystem/BConsoleSystem.hpp"
+#include "Engine/DebugSystem/Command.hpp"
+#include "Engine/NetworkSystem/Session/LoopbackTransport.hpp"
+#include "Engine/NetworkSystem/Session/NetConnection.hpp"
+#include "Engine/NetworkSystem/Session/NetMessage.hpp"
+#include "Engine/NetworkSystem/Session/NetSession.hpp"
+#include "Engine/Utils/MathUtils.hpp"
+#include "Engine/Utils/StringUtils.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC double const NetSoakTest::TICK_SECONDS = 1.0 / 60.0;
+STATIC double const NetSoakTest::JOIN_TIMEOUT_SECONDS = 5.0;
+STATIC double const NetSoakTest::ROUND_TRIP_SAMPLE_SECONDS = 0.25;
+STATIC size_t NetSoakTest::s_receivedMessageCount = 0;
+
+
+//-------------------------------------------------------------------------------------------------
+void NetSoakCommand(Command const & command)
+{
+	NetSoakSettings settings;
+	int clientCount = command.GetArg(0, (int)settings.maxClients);
+	settings.maxClients = (size_t)Clamp(clientCount, 1, (int)NetSoakTest::MAX_CLIENTS);
+	settings.secondsPerStage = command.GetArg(1, settings.secondsPerStage);
+	settings.maxHostTickMs = command.GetArg(2, settings.maxHostTickMs);
+
+	NetSoakTest soak(settings);
+	bool passed = soak.Run();
+	BConsoleSystem::AddLog(Stringf("net_soak %s: %u clients, %.1fs per stage, host tick gate %.3fms", passed ? "PASS" : "FAIL", settings.maxClients, settings.secondsPerStage, settings.maxHostTickMs), passed ? BConsoleSystem::GOOD : BConsoleSystem::BAD);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void OnSoakMessage(NetSender const &, NetMessage const &)
+{
+	++NetSoakTest::s_receivedMessageCount;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetSoakSettings::NetSoakSettings()
+	: maxClients(NetSoakTest::MAX_CLIENTS)
+	, secondsPerStage(2.0)
+	, reliablesPerSecond(10.f)
+	, unreliablesPerSecond(20.f)
+	, sequencedPerSecond(10.f)
+	, payloadBytes(32)
+	, maxHostTickMs(0.0)
+{
+	//Nothing
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Sorts the samples
+STATIC double NetSoakTest::GetPercentile(std::vector<double> * samples, float percentile)
+{
+	if(samples->empty())
+	{
+		return 0.0;
+	}
+
+	std::sort(samples->begin(), samples->end());
+	size_t sampleIndex = (size_t)(percentile * (float)(samples->size() - 1) + 0.5f);
+	return (*samples)[sampleIndex];
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Every session registers the same set, so the definition counts match on join
+STATIC void NetSoakTest::RegisterSoakMessages(NetSession * session)
+{
+	session->RegisterMessage((eNetMessageType)RELIABLE_TYPE, OnSoakMessage, 0, NetMessageDefinition::RELIABLE_OPTION_FLAG);
+	session->RegisterMessage((eNetMessageType)UNRELIABLE_TYPE, OnSoakMessage, 0, 0);
+	session->RegisterMessage((eNetMessageType)SEQUENCED_TYPE, OnSoakMessage, 0, NetMessageDefinition::RELIABLE_OPTION_FLAG | NetMessageDefinition::SEQUENCE_OPTION_FLAG, SEQUENCE_CHANNEL);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetSoakTest::NetSoakTest(NetSoakSettings const & settings)
+	: m_settings(settings)
+	, m_host(nullptr)
+	, m_hostTransport(nullptr)
+	, m_sentMessageCount(0)
+	, m_lastTickTime(0.0)
+	, m_payload(settings.payloadBytes, 0xAB)
+{
+	//Nothing
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetSoakTest::~NetSoakTest()
+{
+	StopSessions();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Returns false if any stage failed to connect everyone or went over the tick gate
+// Only prints the stages, the caller reports the overall result
+bool NetSoakTest::Run()
+{
+	//We own the clock while running, put it back so the engine doesn't see a giant frame
+	float savedTotalSeconds = Time::TOTAL_SECONDS;
+	float savedDeltaSeconds = Time::DELTA_SECONDS;
+
+	bool passed = true;
+	size_t clientCount = 1;
+	while(true)
+	{
+		clientCount = Min(clientCount, m_settings.maxClients);
+		NetSoakStageResult result;
+		bool connected = RunStage(clientCount, &result);
+		bool underGate = PrintResult(result);
+		passed = passed && connected && underGate;
+
+		if(clientCount >= m_settings.maxClients)
+		{
+			break;
+		}
+		clientCount *= 2;
+	}
+
+	Time::TOTAL_SECONDS = savedTotalSeconds;
+	Time::DELTA_SECONDS = savedDeltaSeconds;
+	return passed;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool NetSoakTest::RunStage(size_t clientCount, NetSoakStageResult * out_result)
+{
+	memset(out_result, 0, sizeof(NetSoakStageResult));
+	out_result->clientCount = clientCount;
+
+	if(!StartSessions(clientCount))
+	{
+		StopSessions();
+		return false;
+	}
+
+	//Join everyone
+	double joinStart = Time::GetCurrentTimeSeconds();
+	while(GetConnectedCount() < clientCount && Time::GetCurrentTimeSeconds() - joinStart < JOIN_TIMEOUT_SECONDS)
+	{
+		Tick(false);
+	}
+	out_result->connectedCount = GetConnectedCount();
+
+	//Soak
+	s_receivedMessageCount = 0;
+	m_sentMessageCount = 0;
+	size_t startPackets = m_hostTransport->m_sentCount + m_hostTransport->m_receivedCount;
+	size_t startBytes = m_hostTransport->m_sentBytes + m_hostTransport->m_receivedBytes;
+	std::vector<double> hostTicks;
+	std::vector<double> roundTrips;
+	double stageStart = Time::GetCurrentTimeSeconds();
+	double nextRoundTripSample = stageStart;
+	double currentTime = stageStart;
+	while(currentTime - stageStart < m_settings.secondsPerStage)
+	{
+		hostTicks.push_back(Tick(true));
+		currentTime = Time::GetCurrentTimeSeconds();
+
+		if(currentTime >= nextRoundTripSample)
+		{
+			nextRoundTripSample += ROUND_TRIP_SAMPLE_SECONDS;
+			for(size_t clientIndex = 0; clientIndex < m_clients.size(); ++clientIndex)
+			{
+				NetSession * client = m_clients[clientIndex];
+				if(client->GetState() == eNetSessionState_CONNECTED)
+				{
+					roundTrips.push_back(client->GetHost()->GetRoundTripTime() * 1000.0);
+				}
+			}
+		}
+	}
+	double elapsed = currentTime - stageStart;
+
+	//Results
+	out_result->tickCount = hostTicks.size();
+	double totalTickMs = 0.0;
+	for(size_t tickIndex = 0; tickIndex < hostTicks.size(); ++tickIndex)
+	{
+		totalTickMs += hostTicks[tickIndex];
+		if(hostTicks[tickIndex] > out_result->hostTickMaxMs)
+		{
+			out_result->hostTickMaxMs = hostTicks[tickIndex];
+		}
+	}
+	out_result->hostTickAverageMs = hostTicks.empty() ? 0.0 : totalTickMs / (double)hostTicks.size();
+	out_result->hostTickP99Ms = GetPercentile(&hostTicks, 0.99f);
+	out_result->packetsPerSecond = (double)(m_hostTransport->m_sentCount + m_hostTransport->m_receivedCount - startPackets) / elapsed;
+	out_result->bytesPerSecond = (double)(m_hostTransport->m_sentBytes + m_hostTransport->m_receivedBytes - startBytes) / elapsed;
+	out_result->roundTripP50Ms = GetPercentile(&roundTrips, 0.5f);
+	out_result->roundTripP90Ms = GetPercentile(&roundTrips, 0.9f);
+	out_result->roundTripP99Ms = GetPercentile(&roundTrips, 0.99f);
+	out_result->messagesSent = m_sentMessageCount;
+	out_result->messagesReceived = s_receivedMessageCount;
+
+	size_t reliablesSent = 0;
+	size_t reliablesResent = 0;
+	for(size_t clientIndex = 0; clientIndex < m_clients.size(); ++clientIndex)
+	{
+		NetConnection * hostConnection = m_clients[clientIndex]->GetHost();
+		if(hostConnection)
+		{
+			reliablesSent += hostConnection->m_reliablesSentCount;
+			reliablesResent += hostConnection->m_reliablesResentCount;
+		}
+	}
+	out_result->clientResendRate = reliablesSent > 0 ? (double)reliablesResent / (double)reliablesSent : 0.0;
+
+	reliablesSent = 0;
+	reliablesResent = 0;
+	std::vector<NetConnection*> const & hostConnections = m_host->GetActiveConnections();
+	for(size_t activeIndex = 0; activeIndex < hostConnections.size(); ++activeIndex)
+	{
+		NetConnection const * clientConnection = hostConnections[activeIndex];
+		if(!clientConnection->IsSelf())
+		{
+			reliablesSent += clientConnection->m_reliablesSentCount;
+			reliablesResent += clientConnection->m_reliablesResentCount;
+		}
+	}
+	out_result->hostResendRate = reliablesSent > 0 ? (double)reliablesResent / (double)reliablesSent : 0.0;
+
+	StopSessions();
+	return out_result->connectedCount == clientCount;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool NetSoakTest::StartSessions(size_t clientCount)
+{
+	m_hostTransport = new LoopbackTransport();
+	m_host = new NetSession(0U, false);
+	RegisterSoakMessages(m_host);
+	m_host->SetTransport(m_hostTransport);
+	if(!m_host->Start(HOST_PORT, 1))
+	{
+		return false;
+	}
+	m_host->Host("SoakHost");
+
+	sockaddr_in const & hostAddress = m_hostTransport->GetAddress();
+	for(size_t clientIndex = 0; clientIndex < clientCount; ++clientIndex)
+	{
+		LoopbackTransport * transport = new LoopbackTransport();
+		NetSession * client = new NetSession(0U, false);
+		m_clientTransports.push_back(transport);
+		m_clients.push_back(client);
+
+		RegisterSoakMessages(client);
+		client->SetTransport(transport);
+		if(!client->Start(HOST_PORT + 1, (unsigned int)MAX_CLIENTS))
+		{
+			return false;
+		}
+		client->Join(hostAddress, Stringf("SoakClient%u", clientIndex).c_str());
+	}
+
+	m_sendAccumulators.assign(clientCount * 3, 0.f);
+	m_hostSendAccumulators.assign(NetConnectionTable::MAX_CONNECTIONS * 3, 0.f);
+	m_lastTickTime = Time::GetCurrentTimeSeconds();
+	return true;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Transports have to outlive their sessions
+void NetSoakTest::StopSessions()
+{
+	for(size_t clientIndex = 0; clientIndex < m_clients.size(); ++clientIndex)
+	{
+		NetSession * client = m_clients[clientIndex];
+		if(client->GetState() == eNetSessionState_CONNECTED)
+		{
+			client->Leave();
+		}
+		delete client;
+		delete m_clientTransports[clientIndex];
+	}
+	m_clients.clear();
+	m_clientTransports.clear();
+
+	if(m_host)
+	{
+		if(m_host->GetState() == eNetSessionState_CONNECTED)
+		{
+			m_host->Leave();
+		}
+		delete m_host;
+		m_host = nullptr;
+	}
+	delete m_hostTransport;
+	m_hostTransport = nullptr;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// One engine frame for every session, returns how long the host's update took in ms
+double NetSoakTest::Tick(bool sendTraffic)
+{
+	double currentTime = Time::GetCurrentTimeSeconds();
+	double deltaSeconds = currentTime - m_lastTickTime;
+	m_lastTickTime = currentTime;
+	Time::DELTA_SECONDS = (float)deltaSeconds;
+	Time::TOTAL_SECONDS += (float)deltaSeconds;
+
+	if(sendTraffic)
+	{
+		SendTraffic(deltaSeconds);
+	}
+
+	NamedProperties updateEvent;
+	uint64_t startOpCount = Time::GetCurrentOpCount();
+	m_host->OnUpdate(updateEvent);
+	double hostMs = Time::GetTimeFromOpCount(Time::GetCurrentOpCount() - startOpCount) * 1000.0;
+
+	for(size_t clientIndex = 0; clientIndex < m_clients.size(); ++clientIndex)
+	{
+		m_clients[clientIndex]->OnUpdate(updateEvent);
+	}
+
+	//Sleep off the rest of the frame
+	double remainingSeconds = currentTime + TICK_SECONDS - Time::GetCurrentTimeSeconds();
+	if(remainingSeconds > 0.0)
+	{
+		std::this_thread::sleep_for(std::chrono::microseconds((long long)(remainingSeconds * 1000000.0)));
+	}
+	return hostMs;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Every client sends to the host, and the host sends the same back to every client
+void NetSoakTest::SendTraffic(double deltaSeconds)
+{
+	for(size_t clientIndex = 0; clientIndex < m_clients.size(); ++clientIndex)
+	{
+		NetSession * client = m_clients[clientIndex];
+		if(client->GetState() != eNetSessionState_CONNECTED)
+		{
+			continue;
+		}
+		SendMessages(client->GetHost(), &m_sendAccumulators[clientIndex * 3], deltaSeconds);
+	}
+
+	std::vector<NetConnection*> const & hostConnections = m_host->GetActiveConnections();
+	for(size_t activeIndex = 0; activeIndex < hostConnections.size(); ++activeIndex)
+	{
+		NetConnection * clientConnection = hostConnections[activeIndex];
+		if(clientConnection->IsSelf())
+		{
+			continue;
+		}
+		SendMessages(clientConnection, &m_hostSendAccumulators[clientConnection->GetIndex() * 3], deltaSeconds);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// One accumulator per message type
+void NetSoakTest::SendMessages(NetConnection * connection, float * accumulators, double deltaSeconds)
+{
+	float const rates[3] = { m_settings.reliablesPerSecond, m_settings.unreliablesPerSecond, m_settings.sequencedPerSecond };
+	byte_t const types[3] = { RELIABLE_TYPE, UNRELIABLE_TYPE, SEQUENCED_TYPE };
+	for(size_t typeIndex = 0; typeIndex < 3; ++typeIndex)
+	{
+		float & accumulator = accumulators[typeIndex];
+		accumulator += rates[typeIndex] * (float)deltaSeconds;
+		while(accumulator >= 1.f)
+		{
+			accumulator -= 1.f;
+			NetMessage message(types[typeIndex]);
+			message.WriteForward(m_payload.data(), m_payload.size());
+			connection->AddMessage(message);
+			++m_sentMessageCount;
+		}
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+size_t NetSoakTest::GetConnectedCount() const
+{
+	size_t connectedCount = 0;
+	for(size_t clientIndex = 0; clientIndex < m_clients.size(); ++clientIndex)
+	{
+		if(m_clients[clientIndex]->GetState() == eNetSessionState_CONNECTED)
+		{
+			++connectedCount;
+		}
+	}
+	return connectedCount;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Returns false if the host went over the tick gate
+bool NetSoakTest::PrintResult(NetSoakStageResult const & result) const
+{
+	bool passed = m_settings.maxHostTickMs <= 0.0 || result.hostTickP99Ms <= m_settings.maxHostTickMs;
+	bool connected = result.connectedCount == result.clientCount;
+	Color level = (passed && connected) ? BConsoleSystem::GOOD : BConsoleSystem::BAD;
+
+	BConsoleSystem::AddLog(Stringf("%u clients (%u connected), %u ticks: host tick avg=%.3fms p99=%.3fms max=%.3fms", result.clientCount, result.connectedCount, result.tickCount, result.hostTickAverageMs, result.hostTickP99Ms, result.hostTickMaxMs), level);
+	BConsoleSystem::AddLog(Stringf("  host %.0f packets/s %.1fKB/s, rtt p50=%.1fms p90=%.1fms p99=%.1fms, resends client->host=%.2f%% host->client=%.2f%%, messages %u/%u", result.packetsPerSecond, result.bytesPerSecond / 1024.0, result.roundTripP50Ms, result.roundTripP90Ms, result.roundTripP99Ms, result.clientResendRate * 100.0, result.hostResendRate * 100.0, result.messagesReceived, result.messagesSent), BConsoleSystem::INFO);
+	return passed;
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <vector>
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/NetworkSystem/Session/NetConnectionTable.hpp"
+#include "Engine/NetworkSystem/Session/NetMessageDefinition.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+class Command;
+class LoopbackTransport;
+class NetConnection;
+class NetMessage;
+class NetSender;
+class NetSession;
+
+
+//-------------------------------------------------------------------------------------------------
+void NetSoakCommand(Command const &);
+void OnSoakMessage(NetSender const &, NetMessage const &);
+
+
+//-------------------------------------------------------------------------------------------------
+class NetSoakSettings
+{
+public:
+	size_t maxClients;
+	double secondsPerStage;
+	float reliablesPerSecond; //Per client, each way
+	float unreliablesPerSecond;
+	float sequencedPerSecond; //Reliable, in order
+	size_t payloadBytes;
+	double maxHostTickMs; //Gate on the host's p99 tick time, 0 skips it
+
+public:
+	NetSoakSettings();
+};
+
+
+//-------------------------------------------------------------------------------------------------
+class NetSoakStageResult
+{
+public:
+	size_t clientCount;
+	size_t connectedCount;
+	size_t tickCount;
+	double hostTickAverageMs;
+	double hostTickP99Ms;
+	double hostTickMaxMs;
+	double packetsPerSecond; //Host, in and out
+	double bytesPerSecond;
+	double roundTripP50Ms;
+	double roundTripP90Ms;
+	double roundTripP99Ms;
+	double clientResendRate; //Client to host reliables
+	double hostResendRate; //Host to client reliables
+	size_t messagesSent;
+	size_t messagesReceived;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Soaks a hosting NetSession with clients, all in this process over LoopbackTransports. Stages
+// double the client count up to maxClients, each stage joins everyone, sends traffic both ways for
+// secondsPerStage and reports how the host held up. Blocks until it's done, and drives the
+// sessions (and the game clock) itself at the engine's frame rate, so the host's tick time is
+// what it would cost in a frame.
+class NetSoakTest
+{
+	//-------------------------------------------------------------------------------------------------
+	// Static Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	static size_t const MAX_CLIENTS = NetConnectionTable::MAX_CONNECTIONS - 1; //Host has index 0
+	static byte_t const RELIABLE_TYPE = eNetMessageType_COUNT;
+	static byte_t const UNRELIABLE_TYPE = eNetMessageType_COUNT + 1;
+	static byte_t const SEQUENCED_TYPE = eNetMessageType_COUNT + 2;
+	static byte_t const SEQUENCE_CHANNEL = 1;
+	static uint16_t const HOST_PORT = 31000;
+	static double const TICK_SECONDS;
+	static double const JOIN_TIMEOUT_SECONDS;
+	static double const ROUND_TRIP_SAMPLE_SECONDS;
+	static size_t s_receivedMessageCount;
+
+	//-------------------------------------------------------------------------------------------------
+	// Members
+	//-------------------------------------------------------------------------------------------------
+private:
+	NetSoakSettings m_settings;
+	NetSession * m_host;
+	LoopbackTransport * m_hostTransport;
+	std::vector<NetSession*> m_clients;
+	std::vector<LoopbackTransport*> m_clientTransports;
+	std::vector<float> m_sendAccumulators; //3 per client, fractional messages owed
+	std::vector<float> m_hostSendAccumulators; //3 per host connection index
+	size_t m_sentMessageCount;
+	double m_lastTickTime;
+	std::vector<byte_t> m_payload;
+
+	//-------------------------------------------------------------------------------------------------
+	// Static Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	static double GetPercentile(std::vector<double> * samples, float percentile);
+
+private:
+	static void RegisterSoakMessages(NetSession * session);
+
+	//-------------------------------------------------------------------------------------------------
+	// Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	NetSoakTest(NetSoakSettings const & settings);
+	~NetSoakTest();
+
+	bool Run();
+
+private:
+	bool RunStage(size_t clientCount, NetSoakStageResult * out_result);
+	bool StartSessions(size_t clientCount);
+	void StopSessions();
+	double Tick(bool sendTraffic);
+	void SendTraffic(double deltaSeconds);
+	void SendMessages(NetConnection * connection, float * accumulators, double deltaSeconds);
+	size_t GetConnectedCount() const;
+	bool PrintResult(NetSoakStageResult const & result) const;
+};
\ No newline at end of file
@@ -0,0 +1,542 @@
+#include "Engine/NetworkSystem/Session/NetTelemetry.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "Engine/Core/Time.hpp"
+#include "Engine/DebugSystem/BConsoleSystem.hpp"
+#include "Engine/DebugSystem/Command.hpp"
+#include "Engine/NetworkSystem/Session/NetConnection.hpp"
+#include "Engine/NetworkSystem/Session/NetSession.hpp"
+#include "Engine/Utils/StringUtils.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC double const NetHistogram::BUCKET_LIMITS_MS[BUCKET_COUNT] = { 1.0, 2.0, 5.0, 10.0, 20.0, 30.0, 50.0, 75.0, 100.0, 150.0, 200.0, 300.0, 500.0, 750.0, 1000.0, 1e9 };
+STATIC bool NetTelemetry::s_enabled = false;
+STATIC eNetTelemetryExport NetTelemetry::s_exportFormat = eNetTelemetryExport_NONE;
+STATIC float NetTelemetry::s_exportInterval = 5.f;
+STATIC float NetTelemetry::s_nextExportTime = 0.f;
+STATIC std::vector<NetSession const*> NetTelemetry::s_sessions;
+
+
+//-------------------------------------------------------------------------------------------------
+void NetTelemetryCommand(Command const & command)
+{
+	bool enabled = command.GetArg(0, !NetTelemetry::IsEnabled());
+	NetTelemetry::SetEnabled(enabled);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetTelemetryPrintCommand(Command const &)
+{
+	NetTelemetry::Print();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetTelemetryExportCommand(Command const & command)
+{
+	std::string format = command.GetArg(0, "csv");
+	float interval = command.GetArg(1, 0.f);
+
+	eNetTelemetryExport exportFormat = eNetTelemetryExport_CSV;
+	if(format == "json")
+	{
+		exportFormat = eNetTelemetryExport_JSON;
+	}
+	else if(format == "off")
+	{
+		exportFormat = eNetTelemetryExport_NONE;
+	}
+
+	//No interval is a one time dump
+	if(interval > 0.f || exportFormat == eNetTelemetryExport_NONE)
+	{
+		NetTelemetry::SetExport(exportFormat, interval);
+	}
+	else if(!NetTelemetry::IsEnabled())
+	{
+		BConsoleSystem::AddLog("Net telemetry is off, turn it on with net_telemetry", BConsoleSystem::BAD);
+	}
+	else
+	{
+		size_t rowCount = NetTelemetry::Export(exportFormat);
+		BConsoleSystem::AddLog(Stringf("Exported telemetry for %u connections", rowCount), BConsoleSystem::GOOD);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetHistogram::NetHistogram()
+{
+	Reset();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetHistogram::Add(double valueMs)
+{
+	size_t bucketIndex = 0;
+	while(bucketIndex < BUCKET_COUNT - 1 && valueMs > BUCKET_LIMITS_MS[bucketIndex])
+	{
+		++bucketIndex;
+	}
+	++m_buckets[bucketIndex];
+	++m_count;
+	m_totalMs += valueMs;
+	if(valueMs > m_maxMs)
+	{
+		m_maxMs = valueMs;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetHistogram::Reset()
+{
+	memset(m_buckets, 0, sizeof(m_buckets));
+	m_count = 0;
+	m_totalMs = 0.0;
+	m_maxMs = 0.0;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+uint32_t NetHistogram::GetCount() const
+{
+	return m_count;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+uint32_t NetHistogram::GetBucket(size_t bucketIndex) const
+{
+	return m_buckets[bucketIndex];
+}
+
+
+//-------------------------------------------------------------------------------------------------
+double NetHistogram::GetAverage() const
+{
+	return m_count > 0 ? m_totalMs / (double)m_count : 0.0;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+double NetHistogram::GetMax() const
+{
+	return m_maxMs;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// The last bucket has no real top, so it reports the max instead
+double NetHistogram::GetPercentile(float percentile) const
+{
+	if(m_count == 0)
+	{
+		return 0.0;
+	}
+
+	uint32_t target = (uint32_t)(percentile * (float)m_count + 0.5f);
+	uint32_t seen = 0;
+	for(size_t bucketIndex = 0; bucketIndex < BUCKET_COUNT - 1; ++bucketIndex)
+	{
+		seen += m_buckets[bucketIndex];
+		if(seen >= target)
+		{
+			return BUCKET_LIMITS_MS[bucketIndex] < m_maxMs ? BUCKET_LIMITS_MS[bucketIndex] : m_maxMs;
+		}
+	}
+	return m_maxMs;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Counts separated by '|', one per bucket
+std::string NetHistogram::GetBucketString() const
+{
+	std::string buckets;
+	for(size_t bucketIndex = 0; bucketIndex < BUCKET_COUNT; ++bucketIndex)
+	{
+		if(bucketIndex > 0)
+		{
+			buckets += "|";
+		}
+		buckets += Stringf("%u", m_buckets[bucketIndex]);
+	}
+	return buckets;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+NetConnectionTelemetry::NetConnectionTelemetry()
+	: m_lastRoundTripMs(0.0)
+{
+	Reset();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Reliables still in flight lose their sent time, so ack latency only covers ones sent this window
+void NetConnectionTelemetry::Reset()
+{
+	for(size_t slotIndex = 0; slotIndex < RELIABLE_SLOTS; ++slotIndex)
+	{
+		m_reliableSentTimes[slotIndex] = -1.f; //Unset
+	}
+
+	m_roundTripMs.Reset();
+	m_jitterMs.Reset();
+	m_ackLatencyMs.Reset();
+	memset(m_bytesOut, 0, sizeof(m_bytesOut));
+	memset(m_bytesIn, 0, sizeof(m_bytesIn));
+	memset(m_messagesOut, 0, sizeof(m_messagesOut));
+	memset(m_messagesIn, 0, sizeof(m_messagesIn));
+	m_resendCount = 0;
+	m_packetsOut = 0;
+	m_unsentReliableDepthMax = 0;
+	m_unsentReliableDepthTotal = 0;
+	m_inFlightReliableDepthMax = 0;
+	m_depthSampleCount = 0;
+	m_windowStartTime = Time::TOTAL_SECONDS;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetConnectionTelemetry::OnPacketSent(size_t unsentReliables, size_t inFlightReliables)
+{
+	++m_packetsOut;
+	++m_depthSampleCount;
+	m_unsentReliableDepthTotal += unsentReliables;
+	if(unsentReliables > m_unsentReliableDepthMax)
+	{
+		m_unsentReliableDepthMax = unsentReliables;
+	}
+	if(inFlightReliables > m_inFlightReliableDepthMax)
+	{
+		m_inFlightReliableDepthMax = inFlightReliables;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetConnectionTelemetry::OnMessageSent(byte_t type, size_t bytes)
+{
+	m_bytesOut[type] += bytes;
+	++m_messagesOut[type];
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetConnectionTelemetry::OnReliableSent(uint16_t reliableID)
+{
+	m_reliableSentTimes[reliableID % RELIABLE_SLOTS] = Time::TOTAL_SECONDS;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetConnectionTelemetry::OnReliableResent(byte_t type, size_t bytes)
+{
+	++m_resendCount;
+	OnMessageSent(type, bytes);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetConnectionTelemetry::OnReliableConfirmed(uint16_t reliableID)
+{
+	//Sent before telemetry started (or before the last window), no idea how long it took
+	float & sentTime = m_reliableSentTimes[reliableID % RELIABLE_SLOTS];
+	if(sentTime < 0.f)
+	{
+		return;
+	}
+	m_ackLatencyMs.Add((double)(Time::TOTAL_SECONDS - sentTime) * 1000.0);
+	sentTime = -1.f;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetConnectionTelemetry::OnMessageReceived(byte_t type, size_t bytes)
+{
+	m_bytesIn[type] += bytes;
+	++m_messagesIn[type];
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void NetConnectionTelemetry::OnRoundTrip(double sampleSeconds)
+{
+	double sampleMs = sampleSeconds * 1000.0;
+	if(m_roundTripMs.GetCount() > 0)
+	{
+		double change = sampleMs - m_lastRoundTripMs;
+		m_jitterMs.Add(change < 0.0 ? -change : change);
+	}
+	m_roundTripMs.Add(sampleMs);
+	m_lastRoundTripMs = sampleMs;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+uint64_t NetConnectionTelemetry::GetTotalBytesOut() const
+{
+	uint64_t total = 0;
+	for(size_t typeIndex = 0; typeIndex < MESSAGE_TYPE_COUNT; ++typeIndex)
+	{
+		total += m_bytesOut[typeIndex];
+	}
+	return total;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+uint64_t NetConnectionTelemetry::GetTotalBytesIn() const
+{
+	uint64_t total = 0;
+	for(size_t typeIndex = 0; typeIndex < MESSAGE_TYPE_COUNT; ++typeIndex)
+	{
+		total += m_bytesIn[typeIndex];
+	}
+	return total;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+double NetConnectionTelemetry::GetAverageUnsentReliableDepth() const
+{
+	return m_depthSampleCount > 0 ? (double)m_unsentReliableDepthTotal / (double)m_depthSampleCount : 0.0;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC void NetTelemetry::SetEnabled(bool enabled)
+{
+	s_enabled = enabled;
+#if NET_TELEMETRY
+	BConsoleSystem::AddLog(Stringf("Net telemetry %s", enabled ? "on" : "off"), BConsoleSystem::GOOD);
+#else
+	BConsoleSystem::AddLog("Net telemetry is compiled out (NET_TELEMETRY 0)", BConsoleSystem::BAD);
+#endif // NET_TELEMETRY
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Exporting turns telemetry on, NONE stops the periodic export
+STATIC void NetTelemetry::SetExport(eNetTelemetryExport format, float intervalSeconds)
+{
+	s_exportFormat = format;
+	s_exportInterval = intervalSeconds;
+	s_nextExportTime = Time::TOTAL_SECONDS + intervalSeconds;
+	if(format != eNetTelemetryExport_NONE && !s_enabled)
+	{
+		SetEnabled(true);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC bool NetTelemetry::IsEnabled()
+{
+#if NET_TELEMETRY
+	return s_enabled;
+#else
+	return false;
+#endif // NET_TELEMETRY
+}
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC void NetTelemetry::AddSession(NetSession const * session)
+{
+	s_sessions.push_back(session);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC void NetTelemetry::RemoveSession(NetSession const * session)
+{
+	auto foundSession = std::find(s_sessions.begin(), s_sessions.end(), session);
+	if(foundSession != s_sessions.end())
+	{
+		s_sessions.erase(foundSession);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Every live session, not just the ones with telemetry turned on
+STATIC std::vector<NetSession const*> const & NetTelemetry::GetSessions()
+{
+	return s_sessions;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Every session calls this, the first one past the interval exports for everyone
+STATIC void NetTelemetry::Update()
+{
+	if(s_exportFormat == eNetTelemetryExport_NONE || !IsEnabled())
+	{
+		return;
+	}
+
+	if(Time::TOTAL_SECONDS >= s_nextExportTime)
+	{
+		s_nextExportTime = Time::TOTAL_SECONDS + s_exportInterval;
+		Export(s_exportFormat);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC void NetTelemetry::Print()
+{
+	if(!IsEnabled())
+	{
+		BConsoleSystem::AddLog("Net telemetry is off, turn it on with net_telemetry", BConsoleSystem::BAD);
+		return;
+	}
+
+	for(size_t sessionIndex = 0; sessionIndex < s_sessions.size(); ++sessionIndex)
+	{
+		NetSession const * session = s_sessions[sessionIndex];
+		std::vector<NetConnection*> const & activeConnections = session->GetActiveConnections();
+		for(size_t activeIndex = 0; activeIndex < activeConnections.size(); ++activeIndex)
+		{
+			PrintConnection(session, activeConnections[activeIndex]);
+		}
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Appends to the file and starts a new window for every connection written, returns rows written
+STATIC size_t NetTelemetry::Export(eNetTelemetryExport format)
+{
+	if(!IsEnabled() || format == eNetTelemetryExport_NONE)
+	{
+		return 0;
+	}
+
+	bool isCSV = format == eNetTelemetryExport_CSV;
+	char const * filename = isCSV ? "Data/Logs/NetTelemetry.csv" : "Data/Logs/NetTelemetry.json";
+	FILE * fileHandle = nullptr;
+	bool isNewFile = fopen_s(&fileHandle, filename, "rb") != 0;
+	if(!isNewFile)
+	{
+		fclose(fileHandle);
+	}
+	if(fopen_s(&fileHandle, filename, "ab") != 0)
+	{
+		BConsoleSystem::AddLog(Stringf("Could not open %s", filename), BConsoleSystem::BAD);
+		return 0;
+	}
+
+	if(isCSV && isNewFile)
+	{
+		std::string header = "time,session,connection,window,packets_out,bytes_out,bytes_in,resends,rtt_avg,rtt_p50,rtt_p99,rtt_max,jitter_avg,jitter_p99,ack_avg,ack_p99,unsent_reliables_avg,unsent_reliables_max,in_flight_max,rtt_buckets\n";
+		fwrite(header.c_str(), sizeof(char), header.size(), fileHandle);
+	}
+
+	size_t rowCount = 0;
+	for(size_t sessionIndex = 0; sessionIndex < s_sessions.size(); ++sessionIndex)
+	{
+		NetSession const * session = s_sessions[sessionIndex];
+		std::vector<NetConnection*> const & activeConnections = session->GetActiveConnections();
+		for(size_t activeIndex = 0; activeIndex < activeConnections.size(); ++activeIndex)
+		{
+			NetConnection * connection = activeConnections[activeIndex];
+			NetConnectionTelemetry * telemetry = connection->GetTelemetry();
+			if(!telemetry)
+			{
+				continue;
+			}
+
+			std::string row = isCSV ? GetCSVRow(session, connection) : GetJSONObject(session, connection);
+			fwrite(row.c_str(), sizeof(char), row.size(), fileHandle);
+			telemetry->Reset();
+			++rowCount;
+		}
+	}
+	fclose(fileHandle);
+	return rowCount;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC void NetTelemetry::PrintConnection(NetSession const * session, NetConnection const * connection)
+{
+	NetConnectionTelemetry const * telemetry = connection->GetTelemetry();
+	if(!telemetry)
+	{
+		return;
+	}
+
+	BConsoleSystem::AddLog(Stringf("%s -> %u (%s), %.1fs window", session->GetAddressString(), connection->GetIndex(), connection->GetUsername(), Time::TOTAL_SECONDS - telemetry->m_windowStartTime), BConsoleSystem::GOOD);
+	BConsoleSystem::AddLog(Stringf("  rtt avg=%.1fms p50=%.1fms p99=%.1fms max=%.1fms [%s]", telemetry->m_roundTripMs.GetAverage(), telemetry->m_roundTripMs.GetPercentile(0.5f), telemetry->m_roundTripMs.GetPercentile(0.99f), telemetry->m_roundTripMs.GetMax(), telemetry->m_roundTripMs.GetBucketString().c_str()), BConsoleSystem::INFO);
+	BConsoleSystem::AddLog(Stringf("  jitter avg=%.1fms p99=%.1fms, ack latency avg=%.1fms p99=%.1fms", telemetry->m_jitterMs.GetAverage(), telemetry->m_jitterMs.GetPercentile(0.99f), telemetry->m_ackLatencyMs.GetAverage(), telemetry->m_ackLatencyMs.GetPercentile(0.99f)), BConsoleSystem::INFO);
+	BConsoleSystem::AddLog(Stringf("  %u packets, %llu bytes out, %llu bytes in, %u resends, unsent reliables avg=%.1f max=%u, in flight max=%u", telemetry->m_packetsOut, telemetry->GetTotalBytesOut(), telemetry->GetTotalBytesIn(), telemetry->m_resendCount, telemetry->GetAverageUnsentReliableDepth(), telemetry->m_unsentReliableDepthMax, telemetry->m_inFlightReliableDepthMax), BConsoleSystem::INFO);
+
+	for(size_t typeIndex = 0; typeIndex < NetConnectionTelemetry::MESSAGE_TYPE_COUNT; ++typeIndex)
+	{
+		if(telemetry->m_messagesOut[typeIndex] > 0 || telemetry->m_messagesIn[typeIndex] > 0)
+		{
+			BConsoleSystem::AddLog(Stringf("  type %u: out %u msgs %llu bytes, in %u msgs %llu bytes", typeIndex, telemetry->m_messagesOut[typeIndex], telemetry->m_bytesOut[typeIndex], telemetry->m_messagesIn[typeIndex], telemetry->m_bytesIn[typeIndex]), BConsoleSystem::INFO);
+		}
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC std::string NetTelemetry::GetCSVRow(NetSession const * session, NetConnection const * connection)
+{
+	NetConnectionTelemetry const * telemetry = connection->GetTelemetry();
+	std::string row = Stringf("%.3f,%s,%u,%.3f,", Time::TOTAL_SECONDS, session->GetAddressString(), connection->GetIndex(), Time::TOTAL_SECONDS - telemetry->m_windowStartTime);
+	row += Stringf("%u,%llu,%llu,%u,", telemetry->m_packetsOut, telemetry->GetTotalBytesOut(), telemetry->GetTotalBytesIn(), telemetry->m_resendCount);
+	row += Stringf("%.2f,%.2f,%.2f,%.2f,", telemetry->m_roundTripMs.GetAverage(), telemetry->m_roundTripMs.GetPercentile(0.5f), telemetry->m_roundTripMs.GetPercentile(0.99f), telemetry->m_roundTripMs.GetMax());
+	row += Stringf("%.2f,%.2f,%.2f,%.2f,", telemetry->m_jitterMs.GetAverage(), telemetry->m_jitterMs.GetPercentile(0.99f), telemetry->m_ackLatencyMs.GetAverage(), telemetry->m_ackLatencyMs.GetPercentile(0.99f));
+	row += Stringf("%.2f,%u,%u,%s\n", telemetry->GetAverageUnsentReliableDepth(), telemetry->m_unsentReliableDepthMax, telemetry->m_inFlightReliableDepthMax, telemetry->m_roundTripMs.GetBucketString().c_str());
+	return row;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// One object per line, so the file can be appended to forever
+STATIC std::string NetTelemetry::GetJSONObject(NetSession const * session, NetConnection const * connection)
+{
+	NetConnectionTelemetry const * telemetry = connection->GetTelemetry();
+	std::string object = Stringf("{\"time\":%.3f,\"session\":\"%s\",\"connection\":%u,\"window\":%.3f,", Time::TOTAL_SECONDS, session->GetAddressString(), connection->GetIndex(), Time::TOTAL_SECONDS - telemetry->m_windowStartTime);
+	object += Stringf("\"packetsOut\":%u,\"resends\":%u,", telemetry->m_packetsOut, telemetry->m_resendCount);
+	object += Stringf("\"unsentReliables\":{\"avg\":%.2f,\"max\":%u},\"inFlightMax\":%u,", telemetry->GetAverageUnsentReliableDepth(), telemetry->m_unsentReliableDepthMax, telemetry->m_inFlightReliableDepthMax);
+
+	NetHistogram const * histograms[3] = { &telemetry->m_roundTripMs, &telemetry->m_jitterMs, &telemetry->m_ackLatencyMs };
+	char const * names[3] = { "rtt", "jitter", "ackLatency" };
+	for(size_t histogramIndex = 0; histogramIndex < 3; ++histogramIndex)
+	{
+		NetHistogram const * histogram = histograms[histogramIndex];
+		object += Stringf("\"%s\":{\"avg\":%.2f,\"p50\":%.2f,\"p99\":%.2f,\"max\":%.2f,\"buckets\":[", names[histogramIndex], histogram->GetAverage(), histogram->GetPercentile(0.5f), histogram->GetPercentile(0.99f), histogram->GetMax());
+		for(size_t bucketIndex = 0; bucketIndex < NetHistogram::BUCKET_COUNT; ++bucketIndex)
+		{
+			object += Stringf(bucketIndex > 0 ? ",%u" : "%u", histogram->GetBucket(bucketIndex));
+		}
+		object += "]},";
+	}
+
+	//Only the types that were used
+	object += "\"types\":{";
+	bool isFirst = true;
+	for(size_t typeIndex = 0; typeIndex < NetConnectionTelemetry::MESSAGE_TYPE_COUNT; ++typeIndex)
+	{
+		if(telemetry->m_messagesOut[typeIndex] > 0 || telemetry->m_messagesIn[typeIndex] > 0)
+		{
+			object += Stringf("%s\"%u\":{\"messagesOut\":%u,\"bytesOut\":%llu,\"messagesIn\":%u,\"bytesIn\":%llu}", isFirst ? "" : ",", typeIndex, telemetry->m_messagesOut[typeIndex], telemetry->m_bytesOut[typeIndex], telemetry->m_messagesIn[typeIndex], telemetry->m_bytesIn[typeIndex]);
+			isFirst = false;
+		}
+	}
+	object += "}}\n";
+	return object;
+}
\ No newline at end of file
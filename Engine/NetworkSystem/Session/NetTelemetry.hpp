@@ -0,0 +1,158 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Engine/Core/EngineCommon.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+class Command;
+class NetConnection;
+class NetSession;
+
+
+//-------------------------------------------------------------------------------------------------
+void NetTelemetryCommand(Command const &);
+void NetTelemetryPrintCommand(Command const &);
+void NetTelemetryExportCommand(Command const &);
+
+
+//-------------------------------------------------------------------------------------------------
+enum eNetTelemetryExport
+{
+	eNetTelemetryExport_NONE,
+	eNetTelemetryExport_CSV,
+	eNetTelemetryExport_JSON,
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Fixed millisecond buckets, percentiles come back as the top of the bucket they land in
+class NetHistogram
+{
+	//-------------------------------------------------------------------------------------------------
+	// Static Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	static size_t const BUCKET_COUNT = 16;
+	static double const BUCKET_LIMITS_MS[BUCKET_COUNT];
+
+	//-------------------------------------------------------------------------------------------------
+	// Members
+	//-------------------------------------------------------------------------------------------------
+private:
+	uint32_t m_buckets[BUCKET_COUNT];
+	uint32_t m_count;
+	double m_totalMs;
+	double m_maxMs;
+
+	//-------------------------------------------------------------------------------------------------
+	// Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	NetHistogram();
+
+	void Add(double valueMs);
+	void Reset();
+
+	uint32_t GetCount() const;
+	uint32_t GetBucket(size_t bucketIndex) const;
+	double GetAverage() const;
+	double GetMax() const;
+	double GetPercentile(float percentile) const;
+	std::string GetBucketString() const;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// One connection's numbers since the last export (or since it was turned on)
+class NetConnectionTelemetry
+{
+	//-------------------------------------------------------------------------------------------------
+	// Static Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	static size_t const MESSAGE_TYPE_COUNT = 256;
+	static size_t const RELIABLE_SLOTS = 1024; //Matches NetConnection::MAX_RELIABLE_RANGE
+
+	//-------------------------------------------------------------------------------------------------
+	// Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	NetHistogram m_roundTripMs;
+	NetHistogram m_jitterMs; //Change between RTT samples
+	NetHistogram m_ackLatencyMs; //Reliable first sent -> confirmed, resends included
+	uint64_t m_bytesOut[MESSAGE_TYPE_COUNT];
+	uint64_t m_bytesIn[MESSAGE_TYPE_COUNT];
+	uint32_t m_messagesOut[MESSAGE_TYPE_COUNT];
+	uint32_t m_messagesIn[MESSAGE_TYPE_COUNT];
+	uint32_t m_resendCount;
+	uint32_t m_packetsOut;
+	size_t m_unsentReliableDepthMax;
+	uint64_t m_unsentReliableDepthTotal;
+	size_t m_inFlightReliableDepthMax;
+	uint32_t m_depthSampleCount;
+	double m_windowStartTime;
+
+private:
+	double m_lastRoundTripMs;
+	float m_reliableSentTimes[RELIABLE_SLOTS];
+
+	//-------------------------------------------------------------------------------------------------
+	// Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	NetConnectionTelemetry();
+
+	void Reset();
+	void OnPacketSent(size_t unsentReliables, size_t inFlightReliables);
+	void OnMessageSent(byte_t type, size_t bytes);
+	void OnReliableSent(uint16_t reliableID);
+	void OnReliableResent(byte_t type, size_t bytes);
+	void OnReliableConfirmed(uint16_t reliableID);
+	void OnMessageReceived(byte_t type, size_t bytes);
+	void OnRoundTrip(double sampleSeconds);
+
+	uint64_t GetTotalBytesOut() const;
+	uint64_t GetTotalBytesIn() const;
+	double GetAverageUnsentReliableDepth() const;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Turns connection telemetry on and off and writes it out for every live session. Connections only carry a telemetry
+// block while this is enabled, otherwise the cost is a null check (or nothing, with NET_TELEMETRY 0).
+// Exports append to Data/Logs/NetTelemetry.csv or .json (one JSON object per line), and reset the
+// window, so each row covers one export interval.
+class NetTelemetry
+{
+	//-------------------------------------------------------------------------------------------------
+	// Static Members
+	//-------------------------------------------------------------------------------------------------
+private:
+	static bool s_enabled;
+	static eNetTelemetryExport s_exportFormat;
+	static float s_exportInterval;
+	static float s_nextExportTime;
+	static std::vector<NetSession const*> s_sessions;
+
+	//-------------------------------------------------------------------------------------------------
+	// Static Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	static void SetEnabled(bool enabled);
+	static void SetExport(eNetTelemetryExport format, float intervalSeconds);
+	static bool IsEnabled();
+
+	static void AddSession(NetSession const * session);
+	static void RemoveSession(NetSession const * session);
+	static std::vector<NetSession const*> const & GetSessions();
+	static void Update();
+	static void Print();
+	static size_t Export(eNetTelemetryExport format);
+
+private:
+	static void PrintConnection(NetSession const * session, NetConnection const * connection);
+	static std::string GetCSVRow(NetSession const * session, NetConnection const * connection);
+	static std::string GetJSONObject(NetSession const * session, NetConnection const * connection);
+};
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "Engine/Core/Time.hpp"
 #include "Engine/Utils/MathUtils.hpp"
+#include "Engine/NetworkSystem/Session/NetCompression.hpp"
 #include "Engine/NetworkSystem/Session/NetPacket.hpp"
 #include "Engine/NetworkSystem/Session/NetSession.hpp"
 #include "Engine/NetworkSystem/Session/NetConnection.hpp"
@@ -9,9 +10,11 @@
 
 //-------------------------------------------------------------------------------------------------
 PacketChannel::PacketChannel()
-	: UDPSock()
-	, m_dropRate(0.f)
-	, m_latency(Range<double>::ZERO)
+	: m_socket()
+	, m_transport(&m_socket)
+	, m_receiveSimulator()
+	, m_sendSimulator()
+	, m_capture()
 {
 	//Nothing
 }
@@ -20,21 +23,39 @@ PacketChannel::PacketChannel()
 //-------------------------------------------------------------------------------------------------
 PacketChannel::~PacketChannel()
 {
-	for(auto packetIter : m_orderedPackets)
-	{
-		delete packetIter.second;
-		packetIter.second = nullptr;
-	}
-	m_orderedPackets.clear();
+	//Nothing
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void PacketChannel::Bind(char const * addr, size_t port, size_t range)
+{
+	m_transport->Bind(addr, port, range);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void PacketChannel::Unbind()
+{
+	m_transport->Unbind();
 }
 
 
 //-------------------------------------------------------------------------------------------------
 void PacketChannel::SendPackets(sockaddr_in addr, byte_t const * data, size_t dataSize) const
 {
-	Send(addr, data, dataSize);
+	if(!m_sendSimulator.IsActive())
+	{
+		SendDatagram(addr, data, dataSize);
+		return;
+	}
+
+	double currentTime = Time::GetCurrentTimeSeconds();
+	m_sendSimulator.Submit(addr, data, dataSize, currentTime, currentTime);
+	FlushDelayedSends(currentTime);
 }
 
+
 //-------------------------------------------------------------------------------------------------
 void PacketChannel::RecvPackets(NetSession * currentSession)
 {
@@ -42,7 +63,7 @@ void PacketChannel::RecvPackets(NetSession * currentSession)
 
 	NetPacket packet;
 	sockaddr_in address;
-	size_t read = Recv(&address, packet.GetBuffer(), NetPacket::MAX_SIZE);
+	size_t read = RecvDatagram(&address, packet.GetBuffer(), NetPacket::MAX_SIZE);
 	packet.SetBufferSize(read);
 
 	packet.m_senderInfo.session = currentSession;
@@ -51,50 +72,139 @@ void PacketChannel::RecvPackets(NetSession * currentSession)
 	while(read > 0)
 	{
 		//Packet is Invalid
-		if(!currentSession->IsValidPacket(packet, read))
+		if(!NetCompression::DecompressPacket(&packet) || !currentSession->IsValidPacket(packet, packet.GetSize()))
 		{
-			read = Recv(&address, packet.GetBuffer(), NetPacket::MAX_SIZE);
+			read = RecvDatagram(&address, packet.GetBuffer(), NetPacket::MAX_SIZE);
+			packet.Rewind();
+			packet.SetBufferSize(read);
 			++currentSession->m_invalidPacketCount;
 			continue;
 		}
 
-		//Skip packet if within drop rate
-		if(RandomFloatZeroToOne() >= m_dropRate)
-		{
-			packet.m_senderInfo.fromAddress = address;
-			if(m_latency == Range<double>::ZERO)
-			{
-				currentSession->ProcessPacket(packet);
-			}
-			else
-			{
-				double readTime = currentTime + m_latency.GetRandom();
-				m_orderedPackets.insert(std::pair<double, NetPacket*>(readTime, packet.Copy()));
-			}
-		}
+		packet.m_senderInfo.fromAddress = address;
+		packet.m_senderInfo.receivedTime = Time::GetCurrentTimeSeconds();
+		SimulatePacket(currentSession, packet, currentTime);
 
 		//Continue to the next packet
-		read = Recv(&address, packet.GetBuffer(), NetPacket::MAX_SIZE);
+		read = RecvDatagram(&address, packet.GetBuffer(), NetPacket::MAX_SIZE);
 		packet.Rewind();
 		packet.SetBufferSize(read);
 	}
 
-	//Process Packets
-	if(m_orderedPackets.size() > 0)
+	ProcessDelayedPackets(currentSession, currentTime);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+size_t PacketChannel::RecvDatagram(sockaddr_in * out_addr, byte_t * data, size_t maxSize)
+{
+	size_t read = m_transport->Recv(out_addr, data, maxSize);
+	if(read > 0 && m_capture.IsCapturing())
 	{
-		for(auto packetIter = m_orderedPackets.begin(); packetIter != m_orderedPackets.end(); /*Nothing*/)
-		{
-			if(packetIter->first <= currentTime)
-			{
-				currentSession->ProcessPacket(*(packetIter->second));
-				delete packetIter->second;
-				packetIter->second = nullptr;
-				packetIter = m_orderedPackets.erase(packetIter);
-			}
-			else
-			{
-				break;
-			}
-		}
+		m_capture.Record(eNetCaptureDirection_RECEIVED, *out_addr, data, read, Time::GetCurrentTimeSeconds());
+	}
+	return read;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void PacketChannel::SimulatePacket(NetSession * currentSession, NetPacket & packet, double currentTime)
+{
+	if(!m_receiveSimulator.IsActive())
+	{
+		currentSession->ProcessPacket(packet);
+		return;
+	}
+
+	m_receiveSimulator.Submit(packet.m_senderInfo.fromAddress, packet.GetBuffer(), packet.GetSize(), packet.m_senderInfo.receivedTime, currentTime);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void PacketChannel::ProcessDelayedPackets(NetSession * currentSession, double currentTime)
+{
+	NetPacket packet;
+	packet.m_senderInfo.session = currentSession;
+
+	NetSimulatedPacket * delayed = m_receiveSimulator.PopReady(currentTime);
+	while(delayed)
+	{
+		packet.Rewind();
+		packet.SetBufferSize(0);
+		packet.WriteForward(delayed->data, delayed->size);
+		packet.Rewind();
+
+		//Pretend it arrived when the simulator says it did
+		packet.m_senderInfo.fromAddress = delayed->address;
+		packet.m_senderInfo.receivedTime = delayed->timeStamp;
+		m_receiveSimulator.Release(delayed);
+
+		currentSession->ProcessPacket(packet);
+		delayed = m_receiveSimulator.PopReady(currentTime);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Needs to be called regularly, delayed sends only go out when something flushes them
+void PacketChannel::FlushDelayedSends(double currentTime) const
+{
+	NetSimulatedPacket * delayed = m_sendSimulator.PopReady(currentTime);
+	while(delayed)
+	{
+		SendDatagram(delayed->address, delayed->data, delayed->size);
+		m_sendSimulator.Release(delayed);
+		delayed = m_sendSimulator.PopReady(currentTime);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+INetTransport const & PacketChannel::GetTransport() const
+{
+	return *m_transport;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool PacketChannel::IsConnected() const
+{
+	return m_transport->IsConnected();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+char const * PacketChannel::GetAddressString() const
+{
+	return m_transport->GetAddressString();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+sockaddr_in const & PacketChannel::GetAddress() const
+{
+	return m_transport->GetAddress();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Only while unbound, nullptr goes back to the UDP socket. Doesn't take ownership.
+void PacketChannel::SetTransport(INetTransport * transport)
+{
+	if(m_transport->IsConnected())
+	{
+		return;
+	}
+	m_transport = transport ? transport : &m_socket;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void PacketChannel::SendDatagram(sockaddr_in const & addr, byte_t const * data, size_t dataSize) const
+{
+	m_transport->Send(addr, data, dataSize);
+	if(m_capture.IsCapturing())
+	{
+		m_capture.Record(eNetCaptureDirection_SENT, addr, data, dataSize, Time::GetCurrentTimeSeconds());
 	}
 }
\ No newline at end of file
@@ -1,8 +1,8 @@
 #pragma once
 
-#include <map>
 #include "Engine/NetworkSystem/UDPIP/UDPSock.hpp"
-#include "Engine/Math/Range.hpp"
+#include "Engine/NetworkSystem/Session/NetCapture.hpp"
+#include "Engine/NetworkSystem/Session/NetSimulator.hpp"
 
 
 //-------------------------------------------------------------------------------------------------
@@ -12,17 +12,19 @@ class PacketHeader;
 
 
 //-------------------------------------------------------------------------------------------------
-class PacketChannel : public UDPSock
+class PacketChannel
 {
 	//-------------------------------------------------------------------------------------------------
 	// Members
 	//-------------------------------------------------------------------------------------------------
-public:
-	float m_dropRate;
-	Range<double> m_latency;
-
 private:
-	std::map<double, NetPacket*> m_orderedPackets;
+	UDPSock m_socket;
+	INetTransport * m_transport; //Our socket unless something else was set
+
+public:
+	NetSimulator m_receiveSimulator;
+	mutable NetSimulator m_sendSimulator; //Whoever owns the socket (game or network thread) drives this
+	mutable NetCapture m_capture; //Sees exactly what the transport sends and receives
 
 	//-------------------------------------------------------------------------------------------------
 	// Functions
@@ -31,6 +33,22 @@ public:
 	PacketChannel();
 	~PacketChannel();
 
+	void Bind(char const * addr, size_t port, size_t range);
+	void Unbind();
 	void SendPackets(sockaddr_in addr, byte_t const * data, size_t dataSize) const;
 	void RecvPackets(NetSession * currentSession);
+	size_t RecvDatagram(sockaddr_in * out_addr, byte_t * data, size_t maxSize);
+	void SimulatePacket(NetSession * currentSession, NetPacket & packet, double currentTime);
+	void ProcessDelayedPackets(NetSession * currentSession, double currentTime);
+	void FlushDelayedSends(double currentTime) const;
+
+	INetTransport const & GetTransport() const;
+	bool IsConnected() const;
+	char const * GetAddressString() const;
+	sockaddr_in const & GetAddress() const;
+
+	void SetTransport(INetTransport * transport);
+
+private:
+	void SendDatagram(sockaddr_in const & addr, byte_t const * data, size_t dataSize) const;
 };
\ No newline at end of file
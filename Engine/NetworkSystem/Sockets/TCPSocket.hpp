@@ -19,6 +19,7 @@ private:
 private:
 	friend class NetworkUtils;
 	friend class RCSConnection;
+	friend class RCSEventLoop;
 	SOCKET m_socket;
 	SocketAddressPtr m_address;
 
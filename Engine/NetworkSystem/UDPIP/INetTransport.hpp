@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Utils/NetworkUtils.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+// Whatever moves datagrams for a PacketChannel. UDPSock by default, LoopbackTransport to run
+// sessions against each other inside one process.
+// Send() is called from the network thread when it's running, Recv() only from whoever owns the channel.
+class INetTransport
+{
+public:
+	virtual ~INetTransport() {}
+
+	virtual void Bind(char const * addr, size_t port, size_t range) = 0;
+	virtual void Unbind() = 0;
+
+	virtual bool IsConnected() const = 0;
+	virtual char const * GetAddressString() const = 0;
+	virtual sockaddr_in const & GetAddress() const = 0;
+
+	virtual size_t Send(sockaddr_in addr, byte_t const * data, size_t dataSize) const = 0;
+	virtual size_t Recv(sockaddr_in * out_addr, byte_t * data, size_t maxSize /*max you can read into data*/) = 0;
+};
\ No newline at end of file
@@ -1,10 +1,11 @@
 #pragma once
 
 #include "Engine/Core/EngineCommon.hpp"
+#include "Engine/NetworkSystem/UDPIP/INetTransport.hpp"
 #include "Engine/Utils/NetworkUtils.hpp"
 
 //-------------------------------------------------------------------------------------------------
-class UDPSock
+class UDPSock : public INetTransport
 {
 	//-------------------------------------------------------------------------------------------------
 	// Members
@@ -19,14 +20,13 @@ private:
 public:
 	UDPSock();
 
-	void Bind(char const * addr, size_t port, size_t range);
-	void Unbind();
+	virtual void Bind(char const * addr, size_t port, size_t range) override;
+	virtual void Unbind() override;
 
-	bool IsConnected() const;
-	char const * GetAddressString() const;
-	sockaddr_in const & GetAddress() const;
+	virtual bool IsConnected() const override;
+	virtual char const * GetAddressString() const override;
+	virtual sockaddr_in const & GetAddress() const override;
 
-protected:
-	size_t Send(sockaddr_in addr, byte_t const * data, size_t dataSize) const;
-	size_t Recv(sockaddr_in * out_addr, byte_t * data, size_t maxSize /*max you can read into data*/);
+	virtual size_t Send(sockaddr_in addr, byte_t const * data, size_t dataSize) const override;
+	virtual size_t Recv(sockaddr_in * out_addr, byte_t * data, size_t maxSize /*max you can read into data*/) override;
 };
\ No newline at end of file
@@ -0,0 +1,105 @@
+#pragma once
+#include <atomic>
+
+
+//-------------------------------------------------------------------------------------------------
+// Bread Engine Lock-free Ring Queue
+// Single producer, single consumer. Slots are preallocated, so the producer writes straight into
+// the slot it gets from BeginPush() and the consumer reads straight out of BeginPop().
+template<typename Type, size_t CAPACITY>
+class BRingQueue
+{
+	//-------------------------------------------------------------------------------------------------
+	// Members
+	//-------------------------------------------------------------------------------------------------
+private:
+	Type m_slots[CAPACITY];
+	std::atomic<size_t> m_head; //Next slot to pop (only written by consumer)
+	std::atomic<size_t> m_tail; //Next slot to push (only written by producer)
+
+	//-------------------------------------------------------------------------------------------------
+	// Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	//-------------------------------------------------------------------------------------------------
+	BRingQueue()
+		: m_head(0)
+		, m_tail(0)
+	{
+		//Nothing
+	}
+
+	BRingQueue(BRingQueue const & copy) = delete;
+
+	//---------------------------------------------------------------------------------------------
+	// Producer: returns nullptr if full
+	Type * BeginPush()
+	{
+		size_t tail = m_tail.load(std::memory_order_relaxed);
+		size_t head = m_head.load(std::memory_order_acquire);
+		if(tail - head >= CAPACITY)
+		{
+			return nullptr;
+		}
+		return &m_slots[tail % CAPACITY];
+	}
+
+	//---------------------------------------------------------------------------------------------
+	// Producer: publishes the slot returned from BeginPush()
+	void EndPush()
+	{
+		m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	//---------------------------------------------------------------------------------------------
+	bool PushBack(Type const & value)
+	{
+		Type * slot = BeginPush();
+		if(!slot)
+		{
+			return false;
+		}
+		*slot = value;
+		EndPush();
+		return true;
+	}
+
+	//---------------------------------------------------------------------------------------------
+	// Consumer: returns nullptr if empty
+	Type * BeginPop()
+	{
+		size_t head = m_head.load(std::memory_order_relaxed);
+		size_t tail = m_tail.load(std::memory_order_acquire);
+		if(head == tail)
+		{
+			return nullptr;
+		}
+		return &m_slots[head % CAPACITY];
+	}
+
+	//---------------------------------------------------------------------------------------------
+	// Consumer: releases the slot returned from BeginPop() back to the producer
+	void EndPop()
+	{
+		m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	//---------------------------------------------------------------------------------------------
+	bool PopFront(Type * out_value)
+	{
+		Type * slot = BeginPop();
+		if(!slot)
+		{
+			return false;
+		}
+		*out_value = *slot;
+		EndPop();
+		return true;
+	}
+
+	//---------------------------------------------------------------------------------------------
+	size_t GetSize() const
+	{
+		return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+	}
+};
\ No newline at end of file
@@ -9,6 +9,14 @@ Thread::Thread(EntryCallback * functionPtr)
 }
 
 
+//-------------------------------------------------------------------------------------------------
+Thread::Thread(EntryCallback * functionPtr, void * data)
+	: m_handle(functionPtr, data)
+{
+
+}
+
+
 //-------------------------------------------------------------------------------------------------
 void Thread::Join()
 {
@@ -20,6 +20,7 @@ private:
 	//-------------------------------------------------------------------------------------------------
 public:
 	Thread(EntryCallback * functionPtr);
+	Thread(EntryCallback * functionPtr, void * data);
 	void Join();
 	void Detach();
 };
\ No newline at end of file
@@ -0,0 +1,257 @@
+#include "Engine/Utils/BitPacker.hpp"
+
+#include "Engine/DebugSystem/ErrorWarningAssert.hpp"
+#include "Engine/Math/Vector2f.hpp"
+#include "Engine/Utils/BytePacker.hpp"
+#include "Engine/Utils/MathUtils.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+STATIC uint8_t BitPacker::GetBitsRequired(uint32_t maxValue)
+{
+	uint8_t bits = 0;
+	while(maxValue > 0)
+	{
+		++bits;
+		maxValue >>= 1;
+	}
+	return bits;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+BitPacker::BitPacker(BytePacker * writeTo)
+	: m_writer(writeTo)
+	, m_reader(writeTo)
+	, m_scratch(0)
+	, m_scratchBits(0)
+	, m_bitsWritten(0)
+	, m_bitsRead(0)
+	, m_hasError(false)
+{
+	//Nothing
+}
+
+
+//-------------------------------------------------------------------------------------------------
+BitPacker::BitPacker(BytePacker const * readFrom)
+	: m_writer(nullptr)
+	, m_reader(readFrom)
+	, m_scratch(0)
+	, m_scratchBits(0)
+	, m_bitsWritten(0)
+	, m_bitsRead(0)
+	, m_hasError(false)
+{
+	//Nothing
+}
+
+
+//-------------------------------------------------------------------------------------------------
+BitPacker::~BitPacker()
+{
+	Flush();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool BitPacker::WriteBits(uint32_t value, uint8_t bitCount)
+{
+	ASSERT_RECOVERABLE(m_writer, "BitPacker was made for reading");
+	ASSERT_RECOVERABLE(bitCount <= MAX_BITS, "Writing too many bits at once");
+	if(!m_writer || m_hasError || bitCount > MAX_BITS)
+	{
+		return false;
+	}
+
+	//Zero width fields (one value ranges) take no space
+	if(bitCount == 0)
+	{
+		return true;
+	}
+
+	//Mask off anything above bitCount
+	uint64_t mask = (((uint64_t)1) << bitCount) - 1;
+	m_scratch |= ((uint64_t)value & mask) << m_scratchBits;
+	m_scratchBits += bitCount;
+	m_bitsWritten += bitCount;
+
+	//Only whole bytes go to the packer
+	while(m_scratchBits >= 8)
+	{
+		if(!m_writer->Write<byte_t>((byte_t)(m_scratch & 0xff)))
+		{
+			m_hasError = true;
+			return false;
+		}
+		m_scratch >>= 8;
+		m_scratchBits -= 8;
+	}
+	return true;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool BitPacker::WriteBool(bool value)
+{
+	return WriteBits(value ? 1 : 0, 1);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool BitPacker::WriteRangedInt(int value, int min, int max)
+{
+	ASSERT_RECOVERABLE(min <= max, "Ranged int min is larger than max");
+	value = Clamp(value, min, max);
+	uint32_t range = (uint32_t)((int64_t)max - (int64_t)min); //Wide ranges overflow an int
+	return WriteBits((uint32_t)((int64_t)value - (int64_t)min), GetBitsRequired(range));
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Uses the top bitCount bits of CompressFloat32ToUint16 (up to 16 bits)
+bool BitPacker::WriteQuantizedFloat(float value, float min, float max, uint8_t bitCount)
+{
+	ASSERT_RECOVERABLE(bitCount > 0 && bitCount <= 16, "Quantized floats use 1 to 16 bits");
+	value = Clamp(value, min, max);
+	uint16_t compressed = CompressFloat32ToUint16(value, min, max);
+	return WriteBits(compressed >> (16 - bitCount), bitCount);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool BitPacker::WriteQuantizedVector2f(Vector2f const & value, Vector2f const & min, Vector2f const & max, uint8_t bitCount)
+{
+	bool success = WriteQuantizedFloat(value.x, min.x, max.x, bitCount);
+	success = success && WriteQuantizedFloat(value.y, min.y, max.y, bitCount);
+	return success;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Writes out the last partial byte (padded with zeros)
+bool BitPacker::Flush()
+{
+	//Leftover bits from reading stay put
+	if(!m_writer || m_bitsWritten == 0 || m_scratchBits == 0)
+	{
+		return true;
+	}
+
+	bool success = m_writer->Write<byte_t>((byte_t)(m_scratch & 0xff));
+	m_scratch = 0;
+	m_scratchBits = 0;
+	if(!success)
+	{
+		m_hasError = true;
+	}
+	return success;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool BitPacker::ReadBits(uint32_t * out_value, uint8_t bitCount)
+{
+	ASSERT_RECOVERABLE(bitCount <= MAX_BITS, "Reading too many bits at once");
+	*out_value = 0;
+	if(m_hasError || bitCount > MAX_BITS)
+	{
+		return false;
+	}
+
+	//Zero width fields (one value ranges) take no space
+	if(bitCount == 0)
+	{
+		return true;
+	}
+
+	//Pull in whole bytes until we have enough bits
+	while(m_scratchBits < bitCount)
+	{
+		byte_t nextByte;
+		if(!m_reader->Read<byte_t>(&nextByte))
+		{
+			m_hasError = true;
+			return false;
+		}
+		m_scratch |= ((uint64_t)nextByte) << m_scratchBits;
+		m_scratchBits += 8;
+	}
+
+	uint64_t mask = (((uint64_t)1) << bitCount) - 1;
+	*out_value = (uint32_t)(m_scratch & mask);
+	m_scratch >>= bitCount;
+	m_scratchBits -= bitCount;
+	m_bitsRead += bitCount;
+	return true;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool BitPacker::ReadBool(bool * out_value)
+{
+	uint32_t value;
+	bool success = ReadBits(&value, 1);
+	*out_value = (value != 0);
+	return success;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool BitPacker::ReadRangedInt(int * out_value, int min, int max)
+{
+	uint32_t range = (uint32_t)((int64_t)max - (int64_t)min); //Wide ranges overflow an int
+	uint32_t value;
+	bool success = ReadBits(&value, GetBitsRequired(range));
+	if(value > range)
+	{
+		value = range;
+	}
+	*out_value = (int)((int64_t)min + (int64_t)value);
+	return success;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool BitPacker::ReadQuantizedFloat(float * out_value, float min, float max, uint8_t bitCount)
+{
+	ASSERT_RECOVERABLE(bitCount > 0 && bitCount <= 16, "Quantized floats use 1 to 16 bits");
+	uint32_t value;
+	bool success = ReadBits(&value, bitCount);
+
+	//Stretch back out to 16 bits so the top value maps to max
+	uint32_t maxValue = (1U << bitCount) - 1;
+	uint16_t compressed = (uint16_t)((value * (uint32_t)MAX_UINT16) / maxValue);
+	*out_value = DecompressUint16ToFloat32(compressed, min, max);
+	return success;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool BitPacker::ReadQuantizedVector2f(Vector2f * out_value, Vector2f const & min, Vector2f const & max, uint8_t bitCount)
+{
+	bool success = ReadQuantizedFloat(&out_value->x, min.x, max.x, bitCount);
+	success = success && ReadQuantizedFloat(&out_value->y, min.y, max.y, bitCount);
+	return success;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+size_t BitPacker::GetBitsWritten() const
+{
+	return m_bitsWritten;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+size_t BitPacker::GetBitsRead() const
+{
+	return m_bitsRead;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+bool BitPacker::HasError() const
+{
+	return m_hasError;
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Engine/Core/EngineCommon.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+class BytePacker;
+class Vector2f;
+
+
+//-------------------------------------------------------------------------------------------------
+// Bit-granular reader/writer on top of a BytePacker (NetMessage, NetPacket, ...).
+// Bits are gathered into a scratch word and only whole bytes touch the BytePacker, so call Flush()
+// (or let it go out of scope) before writing anything else to the same packer. Use one BitPacker
+// per direction, don't mix reads and writes.
+class BitPacker
+{
+	//-------------------------------------------------------------------------------------------------
+	// Static Members
+	//-------------------------------------------------------------------------------------------------
+public:
+	static uint8_t const MAX_BITS = 32;
+
+	//-------------------------------------------------------------------------------------------------
+	// Members
+	//-------------------------------------------------------------------------------------------------
+private:
+	BytePacker * m_writer;
+	BytePacker const * m_reader;
+	uint64_t m_scratch;
+	uint8_t m_scratchBits;
+	size_t m_bitsWritten;
+	size_t m_bitsRead;
+	bool m_hasError;
+
+	//-------------------------------------------------------------------------------------------------
+	// Static Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	static uint8_t GetBitsRequired(uint32_t maxValue);
+
+	//-------------------------------------------------------------------------------------------------
+	// Functions
+	//-------------------------------------------------------------------------------------------------
+public:
+	BitPacker(BytePacker * writeTo);
+	BitPacker(BytePacker const * readFrom);
+	~BitPacker();
+
+	//Writing
+	bool WriteBits(uint32_t value, uint8_t bitCount);
+	bool WriteBool(bool value);
+	bool WriteRangedInt(int value, int min, int max);
+	bool WriteQuantizedFloat(float value, float min, float max, uint8_t bitCount);
+	bool WriteQuantizedVector2f(Vector2f const & value, Vector2f const & min, Vector2f const & max, uint8_t bitCount);
+	bool Flush();
+
+	//Reading
+	bool ReadBits(uint32_t * out_value, uint8_t bitCount);
+	bool ReadBool(bool * out_value);
+	bool ReadRangedInt(int * out_value, int min, int max);
+	bool ReadQuantizedFloat(float * out_value, float min, float max, uint8_t bitCount);
+	bool ReadQuantizedVector2f(Vector2f * out_value, Vector2f const & min, Vector2f const & max, uint8_t bitCount);
+
+	size_t GetBitsWritten() const;
+	size_t GetBitsRead() const;
+	bool HasError() const;
+};
\ No newline at end of file
@@ -0,0 +1,208 @@
+#include "Engine/Utils/CompressionUtils.hpp"
+
+#include <cstring>
+
+
+//-------------------------------------------------------------------------------------------------
+static size_t const LZ_NIBBLE_MAX = 15;
+static size_t const LZ_HASH_SIZE = 1 << LZ_HASH_BITS;
+
+
+//-------------------------------------------------------------------------------------------------
+// Lengths past the token nibble are a run of 255s plus a remainder
+static bool WriteLZLength(size_t length, byte_t * out_dest, size_t destMaxSize, size_t * inout_writePos)
+{
+	while(length >= 255)
+	{
+		if(*inout_writePos >= destMaxSize)
+		{
+			return false;
+		}
+		out_dest[(*inout_writePos)++] = 255;
+		length -= 255;
+	}
+
+	if(*inout_writePos >= destMaxSize)
+	{
+		return false;
+	}
+	out_dest[(*inout_writePos)++] = (byte_t)length;
+	return true;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+static bool ReadLZLength(byte_t const * source, size_t sourceSize, size_t * inout_readPos, size_t * out_length)
+{
+	byte_t next = 255;
+	while(next == 255)
+	{
+		if(*inout_readPos >= sourceSize)
+		{
+			return false;
+		}
+		next = source[(*inout_readPos)++];
+		*out_length += next;
+	}
+	return true;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// matchLength of 0 means this is the last sequence (literals only)
+static bool WriteLZSequence(byte_t const * literals, size_t literalCount, size_t offset, size_t matchLength, byte_t * out_dest, size_t destMaxSize, size_t * inout_writePos)
+{
+	if(*inout_writePos >= destMaxSize)
+	{
+		return false;
+	}
+
+	size_t literalNibble = literalCount < LZ_NIBBLE_MAX ? literalCount : LZ_NIBBLE_MAX;
+	size_t matchNibble = 0;
+	if(matchLength > 0)
+	{
+		size_t matchExtra = matchLength - LZ_MIN_MATCH;
+		matchNibble = matchExtra < LZ_NIBBLE_MAX ? matchExtra : LZ_NIBBLE_MAX;
+	}
+	out_dest[(*inout_writePos)++] = (byte_t)((literalNibble << 4) | matchNibble);
+
+	if(literalNibble == LZ_NIBBLE_MAX && !WriteLZLength(literalCount - LZ_NIBBLE_MAX, out_dest, destMaxSize, inout_writePos))
+	{
+		return false;
+	}
+
+	if(*inout_writePos + literalCount > destMaxSize)
+	{
+		return false;
+	}
+	memcpy(out_dest + *inout_writePos, literals, literalCount);
+	*inout_writePos += literalCount;
+
+	if(matchLength == 0)
+	{
+		return true;
+	}
+
+	if(*inout_writePos + 2 > destMaxSize)
+	{
+		return false;
+	}
+	out_dest[(*inout_writePos)++] = (byte_t)(offset & 0xff);
+	out_dest[(*inout_writePos)++] = (byte_t)(offset >> 8);
+
+	if(matchNibble == LZ_NIBBLE_MAX && !WriteLZLength(matchLength - LZ_MIN_MATCH - LZ_NIBBLE_MAX, out_dest, destMaxSize, inout_writePos))
+	{
+		return false;
+	}
+	return true;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Greedy, single probe hash of the next 4 bytes. Fast rather than tight, packets are small.
+size_t CompressLZ(byte_t const * source, size_t sourceSize, byte_t * out_dest, size_t destMaxSize)
+{
+	//Stores position + 1, 0 is empty
+	uint32_t hashTable[LZ_HASH_SIZE];
+	memset(hashTable, 0, sizeof(hashTable));
+
+	size_t readPos = 0;
+	size_t literalStart = 0;
+	size_t writePos = 0;
+	while(readPos + LZ_MIN_MATCH <= sourceSize)
+	{
+		uint32_t sequence;
+		memcpy(&sequence, source + readPos, sizeof(sequence));
+		uint32_t hash = (sequence * 2654435761U) >> (32 - LZ_HASH_BITS);
+		size_t candidate = hashTable[hash];
+		hashTable[hash] = (uint32_t)(readPos + 1);
+
+		if(candidate == 0 || readPos - (candidate - 1) > LZ_MAX_OFFSET || memcmp(source + candidate - 1, source + readPos, LZ_MIN_MATCH) != 0)
+		{
+			++readPos;
+			continue;
+		}
+
+		size_t matchPos = candidate - 1;
+		size_t matchLength = LZ_MIN_MATCH;
+		while(readPos + matchLength < sourceSize && source[matchPos + matchLength] == source[readPos + matchLength])
+		{
+			++matchLength;
+		}
+
+		if(!WriteLZSequence(source + literalStart, readPos - literalStart, readPos - matchPos, matchLength, out_dest, destMaxSize, &writePos))
+		{
+			return 0;
+		}
+		readPos += matchLength;
+		literalStart = readPos;
+	}
+
+	if(!WriteLZSequence(source + literalStart, sourceSize - literalStart, 0, 0, out_dest, destMaxSize, &writePos))
+	{
+		return 0;
+	}
+	return writePos;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Everything is bounds checked, this reads straight off the wire
+size_t DecompressLZ(byte_t const * source, size_t sourceSize, byte_t * out_dest, size_t destMaxSize)
+{
+	size_t readPos = 0;
+	size_t writePos = 0;
+	while(readPos < sourceSize)
+	{
+		byte_t token = source[readPos++];
+
+		size_t literalCount = token >> 4;
+		if(literalCount == LZ_NIBBLE_MAX && !ReadLZLength(source, sourceSize, &readPos, &literalCount))
+		{
+			return 0;
+		}
+		if(readPos + literalCount > sourceSize || writePos + literalCount > destMaxSize)
+		{
+			return 0;
+		}
+		memcpy(out_dest + writePos, source + readPos, literalCount);
+		readPos += literalCount;
+		writePos += literalCount;
+
+		//Last sequence has no match
+		if(readPos == sourceSize)
+		{
+			break;
+		}
+
+		if(readPos + 2 > sourceSize)
+		{
+			return 0;
+		}
+		size_t offset = (size_t)source[readPos] | ((size_t)source[readPos + 1] << 8);
+		readPos += 2;
+		if(offset == 0 || offset > writePos)
+		{
+			return 0;
+		}
+
+		size_t matchLength = token & 0x0f;
+		if(matchLength == LZ_NIBBLE_MAX && !ReadLZLength(source, sourceSize, &readPos, &matchLength))
+		{
+			return 0;
+		}
+		matchLength += LZ_MIN_MATCH;
+		if(writePos + matchLength > destMaxSize)
+		{
+			return 0;
+		}
+
+		//Byte at a time, the match can overlap what it's writing
+		size_t matchPos = writePos - offset;
+		for(size_t copyIndex = 0; copyIndex < matchLength; ++copyIndex)
+		{
+			out_dest[writePos++] = out_dest[matchPos + copyIndex];
+		}
+	}
+	return writePos;
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Engine/Core/EngineCommon.hpp"
+
+
+//-------------------------------------------------------------------------------------------------
+// Small LZ77 block codec meant for network packets (LZ4-style layout, no entropy coding).
+// Each sequence is [token][literal length+][literals][offset 2 bytes][match length+], the last
+// sequence is literals only. Both return 0 if the output doesn't fit or the input is corrupt.
+//-------------------------------------------------------------------------------------------------
+size_t const LZ_MIN_MATCH = 4;
+size_t const LZ_MAX_OFFSET = 0xffff;
+uint8_t const LZ_HASH_BITS = 10;
+
+
+//-------------------------------------------------------------------------------------------------
+size_t CompressLZ(byte_t const * source, size_t sourceSize, byte_t * out_dest, size_t destMaxSize);
+size_t DecompressLZ(byte_t const * source, size_t sourceSize, byte_t * out_dest, size_t destMaxSize);
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "Engine/DebugSystem/ErrorWarningAssert.hpp"
 #include "Engine/Math/AABB2f.hpp"
+#include "Engine/Math/AABB3.hpp"
 #include "Engine/Math/Matrix4f.hpp"
 #include "Engine/Math/Vector2i.hpp"
 #include "Engine/Math/Vector2f.hpp"
@@ -322,6 +323,19 @@ bool OverlapAABB2s(AABB2f const & box1, AABB2f const box2)
 }
 
 
+//-------------------------------------------------------------------------------------------------
+bool OverlapAABB3s(AABB3 const & box1, AABB3 const & box2)
+{
+	if(box1.maxs.x < box2.mins.x) return false;
+	if(box1.mins.x > box2.maxs.x) return false;
+	if(box1.maxs.y < box2.mins.y) return false;
+	if(box1.mins.y > box2.maxs.y) return false;
+	if(box1.maxs.z < box2.mins.z) return false;
+	if(box1.mins.z > box2.maxs.z) return false;
+	return true; // boxes overlap
+}
+
+
 //-------------------------------------------------------------------------------------------------
 bool OverlapDiscAndAABB2(Vector2f const & center, float radius, AABB2f const & box)
 {
@@ -795,6 +809,13 @@ bool IsBitfieldSet(uint8_t bitFlags, size_t bitMask)
 }
 
 
+//-------------------------------------------------------------------------------------------------
+bool IsBitSet(uint64_t bitFlags, size_t bitIndex)
+{
+	return (bitFlags & ((uint64_t)1 << bitIndex)) != 0;
+}
+
+
 //-------------------------------------------------------------------------------------------------
 bool IsBitSet(uint32_t bitFlags, size_t bitIndex)
 {
@@ -816,6 +837,13 @@ bool IsBitSet(uint8_t bitFlags, size_t bitIndex)
 }
 
 
+//-------------------------------------------------------------------------------------------------
+void SetBit(uint64_t * out_bitField, size_t bitToSet)
+{
+	*out_bitField |= (uint64_t)1 << bitToSet;
+}
+
+
 //-------------------------------------------------------------------------------------------------
 void SetBit(uint16_t * out_bitField, size_t bitToSet)
 {
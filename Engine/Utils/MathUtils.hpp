@@ -9,6 +9,7 @@ class Vector2f;
 class Vector3f;
 class Vector4f;
 class AABB2f;
+class AABB3;
 class Matrix4f;
 
 
@@ -53,6 +54,7 @@ float DistanceBetweenPointsSquared(Vector3f const & position1, Vector3f const &
 
 bool OverlapDiscs(Vector2f const & center1, float radius1, Vector2f const & center2, float radius2);
 bool OverlapAABB2s(AABB2f const & box1, AABB2f const box2);
+bool OverlapAABB3s(AABB3 const & box1, AABB3 const & box2);
 bool OverlapDiscAndAABB2(Vector2f const & center, float radius, AABB2f const & box);
 
 float Lerp(float start, float end, float fractionToEnd);
@@ -97,9 +99,11 @@ Vector2f GetPseudoRandomNoiseDirection2D(int positionX, int positionY);
 
 bool IsBitfieldSet(uint16_t bitFlags, size_t bitMask);
 bool IsBitfieldSet(uint8_t bitFlags, size_t bitMask);
+bool IsBitSet(uint64_t bitFlags, size_t bitIndex);
 bool IsBitSet(uint32_t bitFlags, size_t bitIndex);
 bool IsBitSet(uint16_t bitFlags, size_t bitIndex);
 bool IsBitSet(uint8_t bitFlags, size_t bitIndex);
+void SetBit(uint64_t * out_bitField, size_t bitToSet);
 void SetBit(uint16_t * out_bitField, size_t bitToSet);
 void SetBit(uint8_t * out_bitField, size_t bitToSet);
 size_t HashMemory(void const * memory, size_t const memorySize);
@@ -32,6 +32,18 @@ enum eRCSMessageType : char
 	eRCSMessageType_ECHO,
 	eRCSMessageType_RENAME,
 	eRCSMessageType_ERROR,
+	eRCSMessageType_STREAM, //Binary chunk, length prefixed instead of ended
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// What a stream is, so tools know how to read it
+enum eRCSStreamChannel : uint8_t
+{
+	eRCSStreamChannel_TEST,
+	eRCSStreamChannel_PROFILER,
+	eRCSStreamChannel_MEMORY,
+	eRCSStreamChannel_USER, //First one free for games
 };
 
 
@@ -1 +1,3 @@
 #pragma once
+
+#include "Engine/NetworkSystem/Session/INetworkedObject.hpp"